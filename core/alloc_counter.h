@@ -0,0 +1,134 @@
+// core/alloc_counter.h
+// Heap allocation counting, to check that the steady-state loop (probe, statistics, formatting,
+// rendering) allocates nothing once it has warmed up. Counting is compiled in only where
+// LT_COUNT_ALLOCATIONS is defined before this header is included, in exactly one translation
+// unit (every tool here is one), because it replaces process-wide allocation functions:
+//   glibc         malloc, calloc and realloc, forwarding to __libc_*: C library allocations
+//                 (stdio buffers, getaddrinfo) count as well as operator new, which calls malloc
+//   MSVC _DEBUG   a CRT allocation hook: malloc family and operator new
+//   otherwise     the global operator new/delete, so only C++ allocations
+// Without it AllocationCount() stays 0 and nothing is replaced.
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+
+#ifdef LT_COUNT_ALLOCATIONS
+#if defined(_WIN32) && defined(_DEBUG)
+#include <crtdbg.h>
+#define LT_ALLOC_CRT_HOOK
+#elif defined(__GLIBC__)
+#define LT_ALLOC_GLIBC
+#else
+#include <new>
+#define LT_ALLOC_OPERATOR_NEW
+#endif
+#endif
+
+namespace lt {
+
+#ifdef LT_COUNT_ALLOCATIONS
+static const bool kAllocationCounting = true;
+#else
+static const bool kAllocationCounting = false;
+#endif
+
+// Constant-initialised, so it counts allocations made before main() as well
+static inline std::atomic<uint64_t>& AllocationCounter() {
+    static std::atomic<uint64_t> count(0);
+    return count;
+}
+
+// Allocations by any thread since the process started
+static inline uint64_t AllocationCount() { return AllocationCounter().load(std::memory_order_relaxed); }
+
+// Allocations per tick of a loop: call BeginTick() and EndTick() around each pass. The first
+// warmupTicks passes (buffers sized on first use, stdio, lazy initialisation) are not counted.
+// The counter is process-wide, so other threads' allocations land in whichever tick is running.
+class AllocationWatch {
+public:
+    explicit AllocationWatch(uint32_t warmupTicks = 0)
+        : m_warmup(warmupTicks), m_ticks(0), m_start(0), m_allocations(0), m_maxPerTick(0), m_firstTick(0) {}
+
+    void BeginTick() { m_start = AllocationCount(); }
+
+    void EndTick() {
+        uint64_t n = AllocationCount() - m_start;
+        if (++m_ticks <= m_warmup) return;
+        m_allocations += n;
+        if (n > m_maxPerTick) m_maxPerTick = n;
+        if (n && !m_firstTick) m_firstTick = m_ticks;
+    }
+
+    uint64_t Ticks() const { return m_ticks; }
+    // The rest count ticks after the warm-up only
+    uint64_t Allocations() const { return m_allocations; }
+    uint64_t MaxPerTick() const { return m_maxPerTick; }
+    uint64_t FirstTick() const { return m_firstTick; }   // 1-based, 0 = none allocated
+
+private:
+    uint64_t m_warmup;
+    uint64_t m_ticks;
+    uint64_t m_start;
+    uint64_t m_allocations;
+    uint64_t m_maxPerTick;
+    uint64_t m_firstTick;
+};
+
+#ifdef LT_ALLOC_CRT_HOOK
+namespace alloc_detail {
+
+static int __cdecl CrtHook(int type, void*, size_t, int blockType, long, const unsigned char*, int) {
+    if ((type == _HOOK_ALLOC || type == _HOOK_REALLOC) && blockType != _CRT_BLOCK) {
+        AllocationCounter().fetch_add(1, std::memory_order_relaxed);
+    }
+    return 1;
+}
+
+static const int kHookInstalled = (_CrtSetAllocHook(CrtHook), 1);
+
+} // namespace alloc_detail
+#endif
+
+} // namespace lt
+
+#ifdef LT_ALLOC_GLIBC
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+
+void* malloc(size_t size) __THROW {
+    lt::AllocationCounter().fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+void* calloc(size_t count, size_t size) __THROW {
+    lt::AllocationCounter().fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+void* realloc(void* p, size_t size) __THROW {
+    lt::AllocationCounter().fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+}
+#endif
+
+#ifdef LT_ALLOC_OPERATOR_NEW
+void* operator new(size_t size) {
+    lt::AllocationCounter().fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p) abort();
+    return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    lt::AllocationCounter().fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+#endif
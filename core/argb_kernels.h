@@ -0,0 +1,333 @@
+// core/argb_kernels.h
+// 32bpp pixel kernels for icon composition: fill, latency tint, alpha premultiply and
+// glyph coverage blend. Each has a scalar reference and SSE2/AVX2 versions that give
+// bit-identical results (the same exact round(x * a / 255) in 16-bit lanes). The best
+// supported set is chosen once at runtime.
+// Pixels are 0xAARRGGBB. Blend and tint work on premultiplied pixels and take an opaque
+// 0xRRGGBB colour plus an 8-bit coverage/strength.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define LT_ARGB_X86 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define LT_TARGET_AVX2
+#else
+#define LT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace lt {
+
+enum ArgbIsa : uint8_t {
+    ARGB_SCALAR = 0,
+    ARGB_SSE2 = 1,
+    ARGB_AVX2 = 2
+};
+
+struct ArgbKernels {
+    // dst[i] = color (any pixel value, stored as is)
+    void (*fill)(uint32_t* dst, size_t n, uint32_t color);
+    // Straight to premultiplied alpha in place
+    void (*premultiply)(uint32_t* dst, size_t n);
+    // Premultiplied source-over of an opaque colour at per-pixel coverage cov[i]
+    void (*blend)(uint32_t* dst, const uint8_t* cov, size_t n, uint32_t rgb);
+    // Premultiplied source-over of an opaque colour at one constant strength
+    void (*tint)(uint32_t* dst, size_t n, uint32_t rgb, uint8_t strength);
+    ArgbIsa isa;
+    const char* name;
+};
+
+// round(x * a / 255) for x, a in 0..255, exact
+static inline uint32_t MulDiv255(uint32_t x, uint32_t a) {
+    uint32_t t = x * a + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+static inline uint32_t PremultiplyPixel(uint32_t p) {
+    uint32_t a = p >> 24;
+    return (p & 0xFF000000u) | (MulDiv255((p >> 16) & 0xFF, a) << 16) |
+           (MulDiv255((p >> 8) & 0xFF, a) << 8) | MulDiv255(p & 0xFF, a);
+}
+
+static inline uint32_t BlendPixel(uint32_t dst, uint32_t rgb, uint32_t a) {
+    uint32_t src = (a << 24) | (MulDiv255((rgb >> 16) & 0xFF, a) << 16) |
+                   (MulDiv255((rgb >> 8) & 0xFF, a) << 8) | MulDiv255(rgb & 0xFF, a);
+    uint32_t inv = 255 - a;
+    uint32_t out = 0;
+    for (int shift = 0; shift <= 24; shift += 8) {
+        // src channel <= a and the scaled dst channel <= 255 - a: the sum cannot carry
+        out |= (((src >> shift) & 0xFF) + MulDiv255((dst >> shift) & 0xFF, inv)) << shift;
+    }
+    return out;
+}
+
+// Back to straight alpha for output formats that need it (icon colour bitmaps). Scalar:
+// it only runs on non-opaque compositions and opaque pixels are left untouched.
+static inline void UnpremultiplyArgb(uint32_t* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t p = dst[i];
+        uint32_t a = p >> 24;
+        if (a == 255) continue;
+        if (a == 0) {
+            dst[i] = 0;
+            continue;
+        }
+        uint32_t out = p & 0xFF000000u;
+        for (int shift = 0; shift <= 16; shift += 8) {
+            uint32_t c = (((p >> shift) & 0xFF) * 255 + a / 2) / a;
+            out |= (c > 255 ? 255 : c) << shift;
+        }
+        dst[i] = out;
+    }
+}
+
+// Latency colour used for the icon background: green, amber, red
+static const uint32_t kTintGood = 0x2E7D32;
+static const uint32_t kTintFair = 0xB26A00;
+static const uint32_t kTintPoor = 0xC62828;
+
+static inline uint32_t LatencyTint(uint32_t rttMs, uint32_t fairMs, uint32_t poorMs) {
+    if (rttMs >= poorMs) return kTintPoor;
+    if (rttMs >= fairMs) return kTintFair;
+    return kTintGood;
+}
+
+// ---- scalar reference ----
+
+static void FillScalar(uint32_t* dst, size_t n, uint32_t color) {
+    for (size_t i = 0; i < n; ++i) dst[i] = color;
+}
+
+static void PremultiplyScalar(uint32_t* dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) dst[i] = PremultiplyPixel(dst[i]);
+}
+
+static void BlendScalar(uint32_t* dst, const uint8_t* cov, size_t n, uint32_t rgb) {
+    for (size_t i = 0; i < n; ++i) {
+        if (cov[i]) dst[i] = BlendPixel(dst[i], rgb, cov[i]);
+    }
+}
+
+static void TintScalar(uint32_t* dst, size_t n, uint32_t rgb, uint8_t strength) {
+    if (!strength) return;
+    for (size_t i = 0; i < n; ++i) dst[i] = BlendPixel(dst[i], rgb, strength);
+}
+
+#ifdef LT_ARGB_X86
+
+// ---- SSE2: 4 pixels per step, two pixels per 8 x 16-bit register ----
+
+static inline __m128i MulDiv255Sse2(__m128i x, __m128i a) {
+    __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, a), _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// Source-over for two widened pixels: src * a + dst * (255 - a), a already per channel
+static inline __m128i Over16Sse2(__m128i dst, __m128i rgb16, __m128i a) {
+    __m128i inv = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    return _mm_add_epi16(MulDiv255Sse2(rgb16, a), MulDiv255Sse2(dst, inv));
+}
+
+// 0xRRGGBB as 16-bit lanes B,G,R,255 for two pixels
+static inline __m128i ColorLanesSse2(uint32_t rgb) {
+    __m128i c = _mm_cvtsi32_si128((int)(rgb | 0xFF000000u));
+    c = _mm_unpacklo_epi8(c, _mm_setzero_si128());
+    return _mm_unpacklo_epi64(c, c);
+}
+
+static void FillSse2(uint32_t* dst, size_t n, uint32_t color) {
+    __m128i v = _mm_set1_epi32((int)color);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm_storeu_si128((__m128i*)(dst + i), v);
+    for (; i < n; ++i) dst[i] = color;
+}
+
+static void PremultiplySse2(uint32_t* dst, size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32((int)0xFF000000u);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i lo = _mm_unpacklo_epi8(p, zero);
+        __m128i hi = _mm_unpackhi_epi8(p, zero);
+        __m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, 0xFF), 0xFF);
+        __m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, 0xFF), 0xFF);
+        __m128i r = _mm_packus_epi16(MulDiv255Sse2(lo, alo), MulDiv255Sse2(hi, ahi));
+        r = _mm_or_si128(_mm_andnot_si128(alphaMask, r), _mm_and_si128(alphaMask, p));
+        _mm_storeu_si128((__m128i*)(dst + i), r);
+    }
+    PremultiplyScalar(dst + i, n - i);
+}
+
+static void BlendSse2(uint32_t* dst, const uint8_t* cov, size_t n, uint32_t rgb) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i color = ColorLanesSse2(rgb);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t c4 = (uint32_t)cov[i] | ((uint32_t)cov[i + 1] << 8) |
+                      ((uint32_t)cov[i + 2] << 16) | ((uint32_t)cov[i + 3] << 24);
+        if (!c4) continue;   // glyph margins: nothing to draw
+        // Coverage bytes -> one 16-bit value repeated across each pixel's four channels
+        __m128i c = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)c4), zero), zero);
+        c = _mm_or_si128(c, _mm_slli_epi32(c, 16));
+        __m128i clo = _mm_unpacklo_epi32(c, c);
+        __m128i chi = _mm_unpackhi_epi32(c, c);
+        __m128i p = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i lo = Over16Sse2(_mm_unpacklo_epi8(p, zero), color, clo);
+        __m128i hi = Over16Sse2(_mm_unpackhi_epi8(p, zero), color, chi);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    BlendScalar(dst + i, cov + i, n - i, rgb);
+}
+
+static void TintSse2(uint32_t* dst, size_t n, uint32_t rgb, uint8_t strength) {
+    if (!strength) return;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i color = ColorLanesSse2(rgb);
+    const __m128i a = _mm_set1_epi16(strength);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i lo = Over16Sse2(_mm_unpacklo_epi8(p, zero), color, a);
+        __m128i hi = Over16Sse2(_mm_unpackhi_epi8(p, zero), color, a);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    TintScalar(dst + i, n - i, rgb, strength);
+}
+
+// ---- AVX2: 8 pixels per step. Unpacks work per 128-bit lane, so the low half holds
+// pixels 0,1 | 4,5 and the high half 2,3 | 6,7; coverage is expanded in the same order. ----
+
+LT_TARGET_AVX2 static inline __m256i MulDiv255Avx2(__m256i x, __m256i a) {
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(x, a), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+LT_TARGET_AVX2 static inline __m256i Over16Avx2(__m256i dst, __m256i rgb16, __m256i a) {
+    __m256i inv = _mm256_sub_epi16(_mm256_set1_epi16(255), a);
+    return _mm256_add_epi16(MulDiv255Avx2(rgb16, a), MulDiv255Avx2(dst, inv));
+}
+
+LT_TARGET_AVX2 static inline __m256i ColorLanesAvx2(uint32_t rgb) {
+    __m256i c = _mm256_set1_epi32((int)(rgb | 0xFF000000u));
+    return _mm256_unpacklo_epi8(c, _mm256_setzero_si256());
+}
+
+LT_TARGET_AVX2 static void FillAvx2(uint32_t* dst, size_t n, uint32_t color) {
+    __m256i v = _mm256_set1_epi32((int)color);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_si256((__m256i*)(dst + i), v);
+    for (; i < n; ++i) dst[i] = color;
+}
+
+LT_TARGET_AVX2 static void PremultiplyAvx2(uint32_t* dst, size_t n) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set1_epi32((int)0xFF000000u);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i lo = _mm256_unpacklo_epi8(p, zero);
+        __m256i hi = _mm256_unpackhi_epi8(p, zero);
+        __m256i alo = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, 0xFF), 0xFF);
+        __m256i ahi = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, 0xFF), 0xFF);
+        __m256i r = _mm256_packus_epi16(MulDiv255Avx2(lo, alo), MulDiv255Avx2(hi, ahi));
+        r = _mm256_or_si256(_mm256_andnot_si256(alphaMask, r), _mm256_and_si256(alphaMask, p));
+        _mm256_storeu_si256((__m256i*)(dst + i), r);
+    }
+    for (; i < n; ++i) dst[i] = PremultiplyPixel(dst[i]);
+}
+
+LT_TARGET_AVX2 static void BlendAvx2(uint32_t* dst, const uint8_t* cov, size_t n, uint32_t rgb) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i color = ColorLanesAvx2(rgb);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i c8 = _mm_loadl_epi64((const __m128i*)(cov + i));
+        if ((_mm_movemask_epi8(_mm_cmpeq_epi8(c8, _mm_setzero_si128())) & 0xFF) == 0xFF) continue;
+        __m256i c = _mm256_cvtepu8_epi32(c8);
+        c = _mm256_or_si256(c, _mm256_slli_epi32(c, 16));
+        __m256i clo = _mm256_unpacklo_epi32(c, c);
+        __m256i chi = _mm256_unpackhi_epi32(c, c);
+        __m256i p = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i lo = Over16Avx2(_mm256_unpacklo_epi8(p, zero), color, clo);
+        __m256i hi = Over16Avx2(_mm256_unpackhi_epi8(p, zero), color, chi);
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+    // Tail inline: calling the non-VEX SSE2 kernel from here costs a state transition
+    for (; i < n; ++i) {
+        if (cov[i]) dst[i] = BlendPixel(dst[i], rgb, cov[i]);
+    }
+}
+
+LT_TARGET_AVX2 static void TintAvx2(uint32_t* dst, size_t n, uint32_t rgb, uint8_t strength) {
+    if (!strength) return;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i color = ColorLanesAvx2(rgb);
+    const __m256i a = _mm256_set1_epi16(strength);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i lo = Over16Avx2(_mm256_unpacklo_epi8(p, zero), color, a);
+        __m256i hi = Over16Avx2(_mm256_unpackhi_epi8(p, zero), color, a);
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_packus_epi16(lo, hi));
+    }
+    for (; i < n; ++i) dst[i] = BlendPixel(dst[i], rgb, strength);
+}
+
+static bool CpuHasAvx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) return false;
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;   // OS saves XMM and YMM state
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif // LT_ARGB_X86
+
+// Kernel set for one instruction set, nullptr if this build or CPU cannot run it.
+// tests/argb_kernels_test.cpp checks each set against ARGB_SCALAR byte for byte; latency_bench
+// times each one (argb_<isa>_<px>).
+static const ArgbKernels* ArgbKernelsFor(ArgbIsa isa) {
+    static const ArgbKernels scalar = {FillScalar, PremultiplyScalar, BlendScalar, TintScalar,
+                                       ARGB_SCALAR, "scalar"};
+#ifdef LT_ARGB_X86
+    static const ArgbKernels sse2 = {FillSse2, PremultiplySse2, BlendSse2, TintSse2,
+                                     ARGB_SSE2, "sse2"};
+    static const ArgbKernels avx2 = {FillAvx2, PremultiplyAvx2, BlendAvx2, TintAvx2,
+                                     ARGB_AVX2, "avx2"};
+    static const bool hasAvx2 = CpuHasAvx2();
+    if (isa == ARGB_AVX2) return hasAvx2 ? &avx2 : nullptr;
+    if (isa == ARGB_SSE2) return &sse2;   // baseline on every x86-64 and Windows-capable x86
+#endif
+    if (isa == ARGB_SCALAR) return &scalar;
+    return nullptr;
+}
+
+// Best kernel set for the running CPU, chosen once
+static const ArgbKernels& GetArgbKernels() {
+    static const ArgbKernels* best = [] {
+        const ArgbKernels* k = ArgbKernelsFor(ARGB_AVX2);
+        if (!k) k = ArgbKernelsFor(ARGB_SSE2);
+        if (!k) k = ArgbKernelsFor(ARGB_SCALAR);
+        return k;
+    }();
+    return *best;
+}
+
+} // namespace lt
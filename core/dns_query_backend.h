@@ -0,0 +1,565 @@
+// core/dns_query_backend.h
+// ProbeBackend that times DNS resolution: a query over UDP to resolver:port, RTT until the
+// matching response. This measures the path and the resolver itself, which is what a DNS
+// preset is about (many resolvers also rate-limit or deprioritize ICMP).
+// The query (one name and type for every target, recursion desired) is encoded once by
+// SetQuery; Send only patches in a fresh random 16-bit ID. One unconnected socket per address
+// family carries every target, so any number of resolvers are queried in parallel. A response
+// is accepted only from the queried address and port, with the QR bit set, a pending ID and our
+// question echoed back; anything else is counted as stale and ignored. NOERROR and NXDOMAIN
+// are PROBE_OK (the resolver answered); SERVFAIL, REFUSED and other codes are PROBE_ERROR.
+// On Linux, ICMP errors (port or host unreachable) come back on the socket error queue
+// (IP_RECVERR) and complete the probe as PROBE_ERROR, and receive times come from the kernel
+// (SO_TIMESTAMPNS). On Windows unreachable resolvers time out (SIO_UDP_CONNRESET is off, so
+// one ICMP error cannot break the socket for every other target).
+// Shares the wait with an ICMP backend like TcpConnectBackend (see probe_mux.h): Fd() /
+// SetWakeFd on Linux, SetWakeEvent on Windows.
+#pragma once
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>        // MUST be before windows.h
+#include <ws2tcpip.h>
+#include <windows.h>
+#ifndef SIO_UDP_CONNRESET
+#define SIO_UDP_CONNRESET _WSAIOW(IOC_VENDOR, 12)
+#endif
+#else
+#include <errno.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "probe_backend.h"
+#include "mono_clock.h"
+#include "dns_wire.h"
+
+namespace lt {
+
+struct DnsQueryStats {
+    uint64_t queries;        // queries sent
+    uint64_t answers;        // NOERROR or NXDOMAIN
+    uint64_t failures;       // other response codes (SERVFAIL, REFUSED...)
+    uint64_t errors;         // send failures and ICMP errors
+    uint64_t timeouts;
+    uint64_t stale;          // responses that matched no pending query
+};
+
+template <uint32_t MaxTargets>
+class DnsQueryBackend : public SideBackend {
+    // Fresh IDs are drawn until one is unused, which needs free IDs to be common
+    static_assert(MaxTargets <= 32768, "at most half of the 16-bit query IDs pending at once");
+
+public:
+    static const uint16_t kDefaultPort = 53;
+
+#ifdef _WIN32
+    typedef SOCKET Socket;
+    static const Socket kNoSocket = INVALID_SOCKET;
+
+    DnsQueryBackend() : m_event(NULL), m_ownEvent(false) { Reset(); }
+
+    ~DnsQueryBackend() {
+        for (int f = 0; f < 2; ++f) {
+            if (m_socket[f] != kNoSocket) closesocket(m_socket[f]);
+        }
+        if (m_ownEvent) CloseHandle(m_event);
+    }
+
+    // Event signalled whenever a response arrives, normally the ICMP backend's wake event
+    // (auto-reset). Not owned. Without one, the backend creates its own.
+    void SetWakeEvent(HANDLE wake) { m_event = wake; }
+#else
+    typedef int Socket;
+    static const Socket kNoSocket = -1;
+
+    DnsQueryBackend() : m_epoll(-1), m_wakeFd(-1) { Reset(); }
+
+    ~DnsQueryBackend() {
+        for (int f = 0; f < 2; ++f) {
+            if (m_socket[f] != kNoSocket) close(m_socket[f]);
+        }
+        if (m_epoll >= 0) close(m_epoll);
+    }
+
+    // The epoll descriptor: readable whenever a response or ICMP error is waiting (or the wake
+    // fd is readable). Give it to the ICMP backend, or the next side backend, as its wake fd.
+    int Fd() { return Epoll(); }
+
+    // Extra descriptor that ends a Poll wait when readable. Not owned.
+    void SetWakeFd(int fd) {
+        if (Epoll() < 0 || fd < 0) return;
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u64 = kWakeMarker;
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev) == 0) m_wakeFd = fd;
+    }
+#endif
+
+    const DnsQueryStats& Stats() const { return m_stats; }
+
+    // Name and type asked of every resolver. A name the resolvers have
+    // cached keeps upstream recursion out of the measurement. False when name is not a valid
+    // DNS name; the previous query stays in place. Send fails until a query is set.
+    bool SetQuery(const char* name, uint16_t qtype = kDnsTypeA) {
+        uint8_t q[kDnsMaxQuery];
+        uint32_t len = EncodeDnsQuery(name, qtype, q);
+        if (!len) return false;
+        memcpy(m_query, q, len);
+        m_queryLen = len;
+        return true;
+    }
+
+    // Port queried for the slot (0: 53). Set before SetTarget.
+    void SetPort(uint32_t target, uint16_t port) {
+        if (target < MaxTargets) m_slots[target].port = port ? port : kDefaultPort;
+    }
+
+    // Link-local addresses carry their interface: "fe80::1%eth0" or "fe80::1%2"
+    bool SetTarget(uint32_t target, const char* ip, bool isIPv6) override {
+        (void)isIPv6;   // the address says which family it is
+        return SetTargetAddress(target, ResolveIpAddress(ip));
+    }
+
+    bool SetTargetAddress(uint32_t target, const IpAddress& address) override {
+        if (target >= MaxTargets) return false;
+        Slot& s = m_slots[target];
+        s.bound = false;
+        m_ids[target] = 0;   // a late response from the old address is stale
+        if (s.pending) {
+            // Reported as PROBE_ERROR by the next Expire (deadline 0: abandoned)
+            s.deadlineUs = 0;
+            m_earliestUs = 0;
+        }
+        memset(&s.addr, 0, sizeof(s.addr));
+        if (address.IsIPv6()) {
+            struct sockaddr_in6* a6 = (struct sockaddr_in6*)&s.addr;
+            memcpy(&a6->sin6_addr, address.bytes, 16);
+            a6->sin6_family = AF_INET6;
+            a6->sin6_port = htons(s.port);
+            a6->sin6_scope_id = address.scope;
+            s.addrLen = sizeof(struct sockaddr_in6);
+        } else if (address.Valid()) {
+            struct sockaddr_in* a4 = (struct sockaddr_in*)&s.addr;
+            memcpy(&a4->sin_addr, address.bytes, 4);
+            a4->sin_family = AF_INET;
+            a4->sin_port = htons(s.port);
+            s.addrLen = sizeof(struct sockaddr_in);
+        } else {
+            return false;
+        }
+        s.isIPv6 = address.IsIPv6();
+        s.bound = true;
+        return true;
+    }
+
+    // Sends the query. False when no socket could be opened or the send failed (no route).
+    bool Send(uint32_t target, uint32_t seq, uint32_t timeoutMs) override {
+        if (target >= MaxTargets) return false;
+        Slot& s = m_slots[target];
+        if (!s.bound || s.pending || !m_queryLen) return false;
+        Socket fd = Open(s.isIPv6);
+        if (fd == kNoSocket) return false;
+
+        uint16_t id = NewId();
+        m_query[0] = (uint8_t)(id >> 8);
+        m_query[1] = (uint8_t)id;
+        s.sentUs = MonoNowUs();
+        if (!SendQuery(fd, s)) {
+            ++m_stats.errors;
+            return false;
+        }
+        ++m_stats.queries;
+        s.pending = true;
+        s.seq = seq;
+        m_ids[target] = kPendingId | id;
+        s.deadlineUs = s.sentUs + (uint64_t)timeoutMs * 1000;
+        if (s.deadlineUs < m_earliestUs) m_earliestUs = s.deadlineUs;
+        return true;
+    }
+
+    int Poll(ProbeResult* out, int maxResults, uint32_t waitMs) override {
+        int n = Collect(out, maxResults);
+        if (n == 0 && waitMs > 0) {
+            uint32_t untilTimeout = MsUntilTimeout();
+            Wait(untilTimeout < waitMs ? untilTimeout : waitMs);
+            n = Collect(out, maxResults);
+        }
+        return n;
+    }
+
+    uint64_t NowMs() override { return MonoNowUs() / 1000; }
+
+    uint32_t MsUntilTimeout() const override {
+        if (m_earliestUs == ~0ull) return kNoReply;
+        uint64_t now = MonoNowUs();
+        if (now >= m_earliestUs) return 0;
+        uint64_t ms = (m_earliestUs - now + 999) / 1000;
+        return ms < kNoReply ? (uint32_t)ms : kNoReply - 1;
+    }
+
+private:
+    static const uint32_t kPendingId = 0x10000;   // m_ids: pending flag above the ID
+    static const uint32_t kReceiveBatch = 16;
+    static const int kReceiveBuffer = 4 * 1024 * 1024;
+#ifndef _WIN32
+    static const uint64_t kWakeMarker = ~0ull;
+#endif
+
+    struct Slot {
+        bool bound;
+        bool isIPv6;
+        bool pending;
+        uint16_t port;
+        uint32_t seq;
+        uint64_t sentUs;
+        uint64_t deadlineUs;
+        struct sockaddr_storage addr;
+        socklen_t addrLen;
+    };
+
+    void Reset() {
+        memset(m_slots, 0, sizeof(m_slots));
+        memset(m_ids, 0, sizeof(m_ids));
+        memset(&m_stats, 0, sizeof(m_stats));
+        for (uint32_t i = 0; i < MaxTargets; ++i) m_slots[i].port = kDefaultPort;
+        m_socket[0] = m_socket[1] = kNoSocket;
+        m_earliestUs = ~0ull;
+        m_queryLen = 0;
+        // Seed differs per process and per start; zero would stall xorshift
+        uint64_t seed = MonoNowUs() ^ RealtimeNowUs() ^ (uint64_t)(uintptr_t)this;
+        m_rng = (uint32_t)(seed ^ (seed >> 32)) | 1;
+    }
+
+    // Random ID not used by any pending query, so a response can only match one slot
+    uint16_t NewId() {
+        for (;;) {
+            uint16_t id = NextDnsId(&m_rng);
+            if (FindId(id) == kNoReply) return id;
+        }
+    }
+
+    // Slot with this query ID pending, kNoReply if none. A flat scan of 4 bytes per slot.
+    uint32_t FindId(uint16_t id) const {
+        uint32_t key = kPendingId | id;
+        for (uint32_t i = 0; i < MaxTargets; ++i) {
+            if (m_ids[i] == key) return i;
+        }
+        return kNoReply;
+    }
+
+    bool SendQuery(Socket fd, const Slot& s) {
+        int rc = (int)sendto(fd, (const char*)m_query, (int)m_queryLen, 0, (const struct sockaddr*)&s.addr, (int)s.addrLen);
+#ifndef _WIN32
+        // An ICMP error for an earlier query fails the next socket call once (IP_RECVERR);
+        // it still reaches the error queue, so just send again
+        if (rc < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            rc = (int)sendto(fd, m_query, m_queryLen, 0, (const struct sockaddr*)&s.addr, s.addrLen);
+        }
+#endif
+        return rc == (int)m_queryLen;
+    }
+
+    static bool SameEndpoint(const Slot& s, const struct sockaddr_storage& from) {
+        if (s.isIPv6) {
+            const struct sockaddr_in6* a = (const struct sockaddr_in6*)&s.addr;
+            const struct sockaddr_in6* b = (const struct sockaddr_in6*)&from;
+            return b->sin6_family == AF_INET6 && a->sin6_port == b->sin6_port &&
+                   memcmp(&a->sin6_addr, &b->sin6_addr, sizeof(a->sin6_addr)) == 0;
+        }
+        const struct sockaddr_in* a = (const struct sockaddr_in*)&s.addr;
+        const struct sockaddr_in* b = (const struct sockaddr_in*)&from;
+        return b->sin_family == AF_INET && a->sin_port == b->sin_port && a->sin_addr.s_addr == b->sin_addr.s_addr;
+    }
+
+    // Question section of a response equals ours. Names compare case-insensitively (label
+    // lengths are below 'A', so they are left alone).
+    bool SameQuestion(const uint8_t* msg, uint32_t len) const {
+        if (len < m_queryLen || msg[4] != 0 || msg[5] != 1) return false;
+        for (uint32_t i = kDnsHeaderSize; i < m_queryLen; ++i) {
+            uint8_t a = msg[i], b = m_query[i];
+            if (a >= 'A' && a <= 'Z') a = (uint8_t)(a + 32);
+            if (b >= 'A' && b <= 'Z') b = (uint8_t)(b + 32);
+            if (a != b) return false;
+        }
+        return true;
+    }
+
+    // Match a response (or, for errors, our returned query) to its slot and fill out.
+    // Returns whether it completed a pending query.
+    bool Complete(const uint8_t* msg, uint32_t len, const struct sockaddr_storage& from, bool error, uint64_t rxUs,
+                  ProbeResult* out) {
+        if (len < kDnsHeaderSize || (!error && !(msg[2] & 0x80))) {   // QR: a response
+            ++m_stats.stale;
+            return false;
+        }
+        uint32_t target = FindId((uint16_t)((msg[0] << 8) | msg[1]));
+        if (target == kNoReply || !SameEndpoint(m_slots[target], from)) {
+            ++m_stats.stale;
+            return false;
+        }
+        uint8_t rcode = msg[3] & 0x0f;
+        // Error responses may leave the question out (QDCOUNT 0)
+        bool bareError = rcode != 0 && msg[4] == 0 && msg[5] == 0;
+        if (!error && !bareError && !SameQuestion(msg, len)) {
+            ++m_stats.stale;
+            return false;
+        }
+        Slot& s = m_slots[target];
+        s.pending = false;
+        m_ids[target] = 0;
+        out->target = target;
+        out->seq = s.seq;
+        out->apiRttMs = kNoReply;
+        if (!error && (rcode == 0 || rcode == 3)) {   // NOERROR, NXDOMAIN
+            ++m_stats.answers;
+            out->rttUs = ElapsedUs(s.sentUs, rxUs);
+            out->status = PROBE_OK;
+            return true;
+        }
+        if (error) {
+            ++m_stats.errors;
+        } else {
+            ++m_stats.failures;
+        }
+        out->rttUs = kNoReply;
+        out->status = PROBE_ERROR;
+        return true;
+    }
+
+#ifdef _WIN32
+    Socket Open(bool isIPv6) {
+        Socket& fd = m_socket[isIPv6 ? 1 : 0];
+        if (fd != kNoSocket) return fd;
+        if (!m_event) {
+            m_event = CreateEventW(NULL, FALSE, FALSE, NULL);
+            if (!m_event) return kNoSocket;
+            m_ownEvent = true;
+        }
+        fd = socket(isIPv6 ? AF_INET6 : AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (fd == kNoSocket) return kNoSocket;
+        // Also makes the socket non-blocking
+        if (WSAEventSelect(fd, m_event, FD_READ) != 0) {
+            closesocket(fd);
+            fd = kNoSocket;
+            return kNoSocket;
+        }
+        BOOL off = FALSE;
+        DWORD bytes = 0;
+        WSAIoctl(fd, SIO_UDP_CONNRESET, &off, sizeof(off), NULL, 0, &bytes, NULL, NULL);
+        int size = kReceiveBuffer;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, (const char*)&size, sizeof(size));
+        return fd;
+    }
+
+    void Wait(uint32_t waitMs) {
+        if (m_event) {
+            WaitForSingleObject(m_event, waitMs);
+        } else if (waitMs) {
+            Sleep(waitMs);
+        }
+    }
+
+    // Responses on both sockets, then expired queries
+    int Collect(ProbeResult* out, int maxResults) {
+        int n = 0;
+        uint64_t now = MonoNowUs();
+        for (int f = 0; f < 2; ++f) {
+            if (m_socket[f] == kNoSocket) continue;
+            while (n < maxResults) {
+                struct sockaddr_storage from;
+                int fromLen = sizeof(from);
+                int len = recvfrom(m_socket[f], (char*)m_response[0], kDnsMaxResponse, 0, (struct sockaddr*)&from, &fromLen);
+                if (len < 0) {
+                    if (WSAGetLastError() == WSAEMSGSIZE) continue;   // oversized datagram, dropped
+                    break;
+                }
+                now = MonoNowUs();
+                if (Complete(m_response[0], (uint32_t)len, from, false, now, &out[n])) ++n;
+            }
+        }
+        return n + Expire(now, out + n, maxResults - n);
+    }
+#else
+    int Epoll() {
+        if (m_epoll < 0) m_epoll = epoll_create1(EPOLL_CLOEXEC);
+        return m_epoll;
+    }
+
+    Socket Open(bool isIPv6) {
+        int f = isIPv6 ? 1 : 0;
+        Socket& fd = m_socket[f];
+        if (fd != kNoSocket) return fd;
+        if (Epoll() < 0) return kNoSocket;
+        fd = socket(isIPv6 ? AF_INET6 : AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+        if (fd < 0) return kNoSocket;
+        EnableRxTimestamps(fd);
+        int on = 1;
+        if (isIPv6) {
+            setsockopt(fd, IPPROTO_IPV6, IPV6_RECVERR, &on, sizeof(on));
+        } else {
+            setsockopt(fd, IPPROTO_IP, IP_RECVERR, &on, sizeof(on));
+        }
+        int size = kReceiveBuffer;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;   // EPOLLERR is always reported: ICMP errors
+        ev.data.u64 = (uint64_t)f;
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            close(fd);
+            fd = kNoSocket;
+        }
+        return fd;
+    }
+
+    void Wait(uint32_t waitMs) {
+        struct epoll_event ev;
+        if (m_epoll >= 0) {
+            // Only waits; Collect reads the events
+            int rc = epoll_wait(m_epoll, &ev, 1, (int)waitMs);
+            (void)rc;
+        } else if (waitMs) {
+            usleep((useconds_t)waitMs * 1000);
+        }
+    }
+
+    // Sockets with something waiting, then expired queries
+    int Collect(ProbeResult* out, int maxResults) {
+        int n = 0;
+        if (m_epoll >= 0) {
+            struct epoll_event events[4];
+            int got = epoll_wait(m_epoll, events, 4, 0);
+            for (int k = 0; k < got && n < maxResults; ++k) {
+                if (events[k].data.u64 > 1) continue;   // the wake fd: its owner reads it
+                n += Drain(m_socket[events[k].data.u64], out + n, maxResults - n);
+            }
+        }
+        return n + Expire(MonoNowUs(), out + n, maxResults - n);
+    }
+
+    // ICMP errors, then responses in batches of up to kReceiveBatch per recvmmsg, with one
+    // clock pair per batch to place the kernel receive stamps
+    int Drain(Socket fd, ProbeResult* out, int maxResults) {
+        int n = 0;
+        while (n < maxResults) {
+            bool hadError = false;
+            while (n < maxResults && ReceiveError(fd, &out[n])) {
+                hadError = true;
+                if (out[n].target != kNoReply) ++n;
+            }
+            int want = maxResults - n < (int)kReceiveBatch ? maxResults - n : (int)kReceiveBatch;
+            if (want == 0) break;
+            for (int k = 0; k < want; ++k) {
+                m_recvIov[k].iov_base = m_response[k];
+                m_recvIov[k].iov_len = kDnsMaxResponse;
+                struct msghdr& h = m_recvMsgs[k].msg_hdr;
+                memset(&h, 0, sizeof(h));
+                h.msg_name = &m_recvFrom[k];
+                h.msg_namelen = sizeof(m_recvFrom[k]);
+                h.msg_iov = &m_recvIov[k];
+                h.msg_iovlen = 1;
+                h.msg_control = m_recvControl[k];
+                h.msg_controllen = sizeof(m_recvControl[k]);
+            }
+            int got = recvmmsg(fd, m_recvMsgs, (unsigned)want, MSG_DONTWAIT, nullptr);
+            if (got < 0) {
+                // A pending ICMP error fails one receive: read the queue again
+                if (errno == EAGAIN || errno == EWOULDBLOCK || !hadError) break;
+                continue;
+            }
+            uint64_t nowMono = MonoNowUs();
+            uint64_t nowReal = RealtimeNowUs();
+            for (int k = 0; k < got; ++k) {
+                uint64_t rxReal;
+                uint64_t rxUs = RxRealtimeUs(&m_recvMsgs[k].msg_hdr, &rxReal) ? RealtimeToMonoUs(rxReal, nowMono, nowReal)
+                                                                               : nowMono;
+                if (Complete(m_response[k], m_recvMsgs[k].msg_len, m_recvFrom[k], false, rxUs, &out[n])) ++n;
+            }
+            if (got < want) break;
+        }
+        return n;
+    }
+
+    // One queued ICMP error; its payload is our query. Returns false when there is none;
+    // out->target is kNoReply when it completes nothing.
+    bool ReceiveError(Socket fd, ProbeResult* out) {
+        uint8_t query[kDnsMaxQuery];
+        struct sockaddr_storage to;
+        char control[512];
+        struct iovec iov = {query, sizeof(query)};
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &to;   // the address the query went to
+        msg.msg_namelen = sizeof(to);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t len = recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+        if (len < 0) return false;
+        out->target = kNoReply;
+        Complete(query, (uint32_t)len, to, true, 0, out);
+        return true;
+    }
+#endif
+
+    // Time out pending queries once now reaches their deadline; abandoned ones (deadline 0) fail
+    int Expire(uint64_t now, ProbeResult* out, int maxResults) {
+        if (now < m_earliestUs) return 0;
+        int n = 0;
+        uint64_t next = ~0ull;
+        uint32_t i = 0;
+        for (; i < MaxTargets && n < maxResults; ++i) {
+            Slot& s = m_slots[i];
+            if (!s.pending) continue;
+            if (now < s.deadlineUs) {
+                if (s.deadlineUs < next) next = s.deadlineUs;
+                continue;
+            }
+            if (s.deadlineUs) ++m_stats.timeouts;
+            s.pending = false;
+            m_ids[i] = 0;
+            out[n].target = i;
+            out[n].seq = s.seq;
+            out[n].rttUs = kNoReply;
+            out[n].apiRttMs = kNoReply;
+            out[n].status = s.deadlineUs ? PROBE_TIMEOUT : PROBE_ERROR;
+            ++n;
+        }
+        m_earliestUs = i < MaxTargets ? 0 : next;
+        return n;
+    }
+
+#ifdef _WIN32
+    HANDLE m_event;
+    bool m_ownEvent;
+#else
+    int m_epoll;
+    int m_wakeFd;
+    struct mmsghdr m_recvMsgs[kReceiveBatch];
+    struct iovec m_recvIov[kReceiveBatch];
+    struct sockaddr_storage m_recvFrom[kReceiveBatch];
+    char m_recvControl[kReceiveBatch][64];   // SCM_TIMESTAMPNS
+#endif
+    Socket m_socket[2];      // IPv4, IPv6; opened by the first query of the family
+    uint64_t m_earliestUs;   // no pending deadline before this (0: scan on the next Collect)
+    uint32_t m_rng;
+    uint32_t m_queryLen;
+    uint8_t m_query[kDnsMaxQuery];
+    uint8_t m_response[kReceiveBatch][kDnsMaxResponse];
+    uint32_t m_ids[MaxTargets];   // kPendingId | ID while a query is pending
+    Slot m_slots[MaxTargets];
+    DnsQueryStats m_stats;
+};
+
+} // namespace lt
@@ -0,0 +1,100 @@
+// core/dns_wire.h
+// DNS message encoding shared by the probes that speak DNS over UDP (RFC 1035): query
+// encoding, address extraction from an answer section, and query IDs. No allocation; names
+// are length-prefixed labels, answers may use compression pointers.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+namespace lt {
+
+static const uint32_t kDnsHeaderSize = 12;
+static const uint32_t kDnsMaxName = 255;                              // encoded QNAME
+static const uint32_t kDnsMaxQuery = kDnsHeaderSize + kDnsMaxName + 4;  // + QTYPE, QCLASS
+static const uint32_t kDnsMaxResponse = 512;                          // no EDNS: larger ones are truncated
+static const uint16_t kDnsTypeA = 1;
+static const uint16_t kDnsTypeAAAA = 28;
+
+// Recursive query for name (class IN) into out[kDnsMaxQuery], ID 0. Returns its length, 0
+// when name is not a valid DNS name. A trailing dot is accepted.
+static inline uint32_t EncodeDnsQuery(const char* name, uint16_t qtype, uint8_t* out) {
+    if (!name) return 0;
+    memset(out, 0, kDnsHeaderSize);
+    out[2] = 0x01;   // RD
+    out[5] = 1;      // QDCOUNT
+    uint32_t len = kDnsHeaderSize;
+    const char* p = name;
+    if (p[0] == '.' && p[1] == 0) ++p;   // the root
+    while (*p) {
+        const char* dot = strchr(p, '.');
+        size_t label = dot ? (size_t)(dot - p) : strlen(p);
+        if (label == 0 || label > 63 || len + 1 + label + 1 > kDnsHeaderSize + kDnsMaxName) return 0;
+        out[len++] = (uint8_t)label;
+        memcpy(out + len, p, label);
+        len += (uint32_t)label;
+        p += label;
+        if (*p == '.') ++p;
+    }
+    out[len++] = 0;
+    out[len++] = (uint8_t)(qtype >> 8);
+    out[len++] = (uint8_t)qtype;
+    out[len++] = 0;
+    out[len++] = 1;   // class IN
+    return len;
+}
+
+// Offset just past the (possibly compressed) name at pos, 0 if it runs off the message
+static inline uint32_t SkipDnsName(const uint8_t* msg, uint32_t len, uint32_t pos) {
+    while (pos < len) {
+        uint8_t label = msg[pos];
+        if (label == 0) return pos + 1;
+        if ((label & 0xc0) == 0xc0) return pos + 2 <= len ? pos + 2 : 0;   // pointer ends the name
+        if (label & 0xc0) return 0;
+        pos += 1u + label;
+    }
+    return 0;
+}
+
+// First address of type qtype (A: 4 bytes, AAAA: 16) in the answer section of a response, copied
+// to addr. False when there is none or the message is malformed.
+static inline bool DnsAnswerAddress(const uint8_t* msg, uint32_t len, uint16_t qtype, void* addr) {
+    if (len < kDnsHeaderSize) return false;
+    uint32_t questions = (uint32_t)(msg[4] << 8 | msg[5]);
+    uint32_t answers = (uint32_t)(msg[6] << 8 | msg[7]);
+    uint32_t pos = kDnsHeaderSize;
+    for (uint32_t q = 0; q < questions; ++q) {
+        pos = SkipDnsName(msg, len, pos);
+        if (!pos || pos + 4 > len) return false;
+        pos += 4;
+    }
+    uint32_t size = qtype == kDnsTypeAAAA ? 16 : 4;
+    for (uint32_t a = 0; a < answers; ++a) {
+        pos = SkipDnsName(msg, len, pos);
+        if (!pos || pos + 10 > len) return false;
+        uint16_t type = (uint16_t)(msg[pos] << 8 | msg[pos + 1]);
+        uint16_t cls = (uint16_t)(msg[pos + 2] << 8 | msg[pos + 3]);
+        uint32_t rdlen = (uint32_t)(msg[pos + 8] << 8 | msg[pos + 9]);
+        pos += 10;
+        if (pos + rdlen > len) return false;
+        if (type == qtype && cls == 1 && rdlen == size) {   // CNAMEs before it are skipped
+            memcpy(addr, msg + pos, size);
+            return true;
+        }
+        pos += rdlen;
+    }
+    return false;
+}
+
+// Next query ID from a xorshift32 state (never 0). Unpredictable enough that a late response
+// cannot be mistaken for a fresh query; not a defence against spoofed answers.
+static inline uint16_t NextDnsId(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (uint16_t)(x >> 8);
+}
+
+} // namespace lt
@@ -0,0 +1,119 @@
+// core/file_watch.h
+// Change detection for a file edited while the program runs (the target config,
+// target_config.h). Size and modification time are polled, about once a second from the probe
+// loop, which wakes that often anyway: no notification handles or extra threads, and a poll
+// is one stat call. A change is reported once the file has held still for one poll, so a file
+// caught halfway through being saved is read after the editor is done with it.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "mapped_file.h"
+
+namespace lt {
+
+struct FileStamp {
+    bool exists;
+    uint64_t size;
+    int64_t modified;   // platform units (100 ns on Windows, ns elsewhere); only compared
+};
+
+static inline bool SameStamp(const FileStamp& a, const FileStamp& b) {
+    return a.exists == b.exists && a.size == b.size && a.modified == b.modified;
+}
+
+// Stamp of path; exists is false when it cannot be examined
+static inline FileStamp StatFile(const char* path) {
+    FileStamp s = {false, 0, 0};
+    if (!path) return s;
+#ifdef _WIN32
+    wchar_t wpath[MAX_PATH];
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, path, -1, wpath, MAX_PATH)) return s;
+    if (!GetFileAttributesExW(wpath, GetFileExInfoStandard, &data)) return s;
+    s.size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    s.modified = (int64_t)(((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime);
+#else
+    struct stat st;
+    if (stat(path, &st) != 0) return s;
+    s.size = (uint64_t)st.st_size;
+#ifdef __linux__
+    s.modified = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#else
+    s.modified = (int64_t)st.st_mtime * 1000000000;
+#endif
+#endif
+    s.exists = true;
+    return s;
+}
+
+// Read a whole file into buf without allocating. False when it cannot be read or is empty;
+// tooLarge is set when it does not fit.
+static inline bool ReadWholeFile(const char* path, char* buf, size_t capacity, size_t* length, bool* tooLarge) {
+    *length = 0;
+    *tooLarge = false;
+    MappedFile file;
+    if (!file.OpenReadOnly(path)) return false;
+    if (file.Size() > capacity) {
+        *tooLarge = true;
+        return false;
+    }
+    if (!file.Read(0, buf, (size_t)file.Size())) return false;
+    *length = (size_t)file.Size();
+    return true;
+}
+
+class FileWatch {
+public:
+    FileWatch() : m_path(nullptr), m_pending(false) {
+        memset(&m_current, 0, sizeof(m_current));
+        memset(&m_seen, 0, sizeof(m_seen));
+    }
+
+    // Watch path, taking its present state as already loaded
+    void Init(const char* path) {
+        m_path = path;
+        m_current = StatFile(path);
+        m_pending = false;
+    }
+
+    bool Watching() const { return m_path != nullptr; }
+
+    // Poll: true once per change, when the file looks the same as on the previous poll
+    // (a deleted file counts as a change too; reading it then fails)
+    bool Changed() {
+        if (!m_path) return false;
+        FileStamp now = StatFile(m_path);
+        if (SameStamp(now, m_current)) {
+            m_pending = false;
+            return false;
+        }
+        if (m_pending && SameStamp(now, m_seen)) {
+            m_current = now;
+            m_pending = false;
+            return true;
+        }
+        m_seen = now;
+        m_pending = true;
+        return false;
+    }
+
+private:
+    const char* m_path;
+    FileStamp m_current;   // state last reported (or taken at Init)
+    FileStamp m_seen;      // state at the previous poll, while a change settles
+    bool m_pending;
+};
+
+} // namespace lt
@@ -0,0 +1,236 @@
+// core/gateway_resolver.h
+// Default gateway tracking driven by route change notifications.
+// A RouteSource (route_source_win.h, route_source_netlink.h, route_source_fake.h) hands over
+// the default routes once from a full table snapshot and then only the default-route changes
+// it is notified about. The resolver keeps those few routes per address family and picks the
+// best one, so a lookup never touches the routing table and the cost of a change does not
+// depend on how many (VPN) routes the host has. A full resync only happens at start, when a
+// source loses notifications, or when interfaces change state.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "ip_address.h"
+
+namespace lt {
+
+static const uint32_t kMaxDefaultRoutes = 16;   // per family; hosts rarely have more than a few
+
+enum RouteFamily : uint8_t {
+    ROUTE_IPV4 = 0,
+    ROUTE_IPV6 = 1,
+    ROUTE_FAMILIES = 2
+};
+
+struct RouteEntry {
+    uint8_t family;        // RouteFamily
+    uint8_t prefixLen;     // 0 for default routes
+    uint8_t gateway[16];   // next hop, network order (first 4 bytes for IPv4)
+    uint32_t metric;       // effective metric, lower wins
+    uint32_t ifIndex;      // outgoing interface (IPv6 link-local scope)
+};
+
+enum RouteEventType : uint8_t {
+    ROUTE_ADD = 0,       // new route, or changed parameters of a known one
+    ROUTE_DELETE = 1,
+    ROUTE_RESYNC = 2     // notifications were lost or interfaces changed: take a new snapshot
+};
+
+struct RouteEvent {
+    uint8_t type;        // RouteEventType
+    RouteEntry route;    // unused for ROUTE_RESYNC
+};
+
+class RouteSource {
+public:
+    virtual ~RouteSource() {}
+
+    // Walk the whole routing table and copy the default routes (both families) into out[].
+    // Returns the number of routes scanned (for statistics), or -1 on failure.
+    virtual int Snapshot(RouteEntry* out, uint32_t maxOut, uint32_t* defaultCount) = 0;
+
+    // Drain queued default-route notifications without blocking. Returns the count written.
+    virtual int Poll(RouteEvent* out, int maxEvents) = 0;
+};
+
+struct GatewayResolverStats {
+    uint64_t events;          // default-route notifications applied
+    uint64_t resyncs;         // full snapshots taken (including the first)
+    uint64_t routesScanned;   // routes walked by those snapshots
+    uint64_t changes;         // times the best gateway of a family changed
+};
+
+class GatewayResolver {
+public:
+    GatewayResolver() : m_source(nullptr), m_version(0) {
+        memset(m_count, 0, sizeof(m_count));
+        memset(m_best, 0xFF, sizeof(m_best));
+        memset(&m_stats, 0, sizeof(m_stats));
+    }
+
+    bool Init(RouteSource* source) {
+        m_source = source;
+        return Resync();
+    }
+
+    // Apply pending notifications. Returns true if either family's best gateway changed.
+    bool Update() {
+        if (!m_source) return false;
+        RouteEntry before[ROUTE_FAMILIES];
+        bool had[ROUTE_FAMILIES];
+        for (int f = 0; f < ROUTE_FAMILIES; ++f) {
+            had[f] = Best((RouteFamily)f, &before[f]);
+        }
+
+        RouteEvent events[32];
+        bool resync = false;
+        int n;
+        while ((n = m_source->Poll(events, 32)) > 0) {
+            for (int k = 0; k < n; ++k) {
+                const RouteEvent& e = events[k];
+                if (e.type == ROUTE_RESYNC) {
+                    resync = true;
+                } else if (e.route.family < ROUTE_FAMILIES && e.route.prefixLen == 0) {
+                    ++m_stats.events;
+                    if (e.type == ROUTE_ADD) Insert(e.route);
+                    else Remove(e.route);
+                }
+            }
+        }
+        if (resync) Resync();
+
+        bool changed = false;
+        for (int f = 0; f < ROUTE_FAMILIES; ++f) {
+            RouteEntry now;
+            bool has = Best((RouteFamily)f, &now);
+            if (has != had[f] || (has && !SameRoute(now, before[f]))) {
+                ++m_stats.changes;
+                changed = true;
+            }
+        }
+        if (changed) ++m_version;
+        return changed;
+    }
+
+    // Full snapshot from the source, replacing everything known
+    bool Resync() {
+        if (!m_source) return false;
+        RouteEntry routes[kMaxDefaultRoutes * ROUTE_FAMILIES];
+        uint32_t count = 0;
+        int scanned = m_source->Snapshot(routes, kMaxDefaultRoutes * ROUTE_FAMILIES, &count);
+        ++m_stats.resyncs;
+        if (scanned < 0) return false;
+        m_stats.routesScanned += (uint64_t)scanned;
+        memset(m_count, 0, sizeof(m_count));
+        for (uint32_t i = 0; i < count; ++i) {
+            if (routes[i].family < ROUTE_FAMILIES && routes[i].prefixLen == 0) Insert(routes[i]);
+        }
+        for (int f = 0; f < ROUTE_FAMILIES; ++f) PickBest((RouteFamily)f);
+        return true;
+    }
+
+    // Best default route of a family (lowest metric, then lowest interface index)
+    bool Best(RouteFamily family, RouteEntry* out) const {
+        if (family >= ROUTE_FAMILIES || m_best[family] >= m_count[family]) return false;
+        if (out) *out = m_routes[family][m_best[family]];
+        return true;
+    }
+
+    // Best gateway as text: "192.168.1.1", or "fe80::1%12" for scoped IPv6 next hops
+    bool Gateway(RouteFamily family, char* out, size_t size) const {
+        RouteEntry r;
+        if (!Best(family, &r)) return false;
+        return FormatRouteAddress(r, out, size);
+    }
+
+    // Gateway to probe for the "Default Gateway" target: IPv4 when there is one, else IPv6
+    bool PreferredGateway(char* out, size_t size, bool* isIPv6) const {
+        if (Gateway(ROUTE_IPV4, out, size)) {
+            if (isIPv6) *isIPv6 = false;
+            return true;
+        }
+        if (Gateway(ROUTE_IPV6, out, size)) {
+            if (isIPv6) *isIPv6 = true;
+            return true;
+        }
+        return false;
+    }
+
+    // Incremented whenever a best gateway changes
+    uint32_t Version() const { return m_version; }
+    const GatewayResolverStats& Stats() const { return m_stats; }
+
+    static bool FormatRouteAddress(const RouteEntry& r, char* out, size_t size) {
+        IpAddress a = {};
+        a.family = r.family == ROUTE_IPV4 ? IP_V4 : IP_V6;
+        memcpy(a.bytes, r.gateway, sizeof(a.bytes));
+        // Link-local next hops are only meaningful with their interface
+        bool linkLocal = a.IsIPv6() && r.gateway[0] == 0xFE && (r.gateway[1] & 0xC0) == 0x80;
+        a.scope = linkLocal ? r.ifIndex : 0;
+        return FormatIpAddress(a, out, size);
+    }
+
+    // The reverse (ip_address.h syntax, "%<ifIndex>" zones) into family, gateway and ifIndex.
+    // Leaves the other fields alone.
+    static bool ParseRouteAddress(const char* text, RouteEntry* r) {
+        if (!r) return false;
+        IpAddress a = ParseIpAddress(text);
+        if (!a.Valid()) return false;
+        r->family = a.IsIPv6() ? ROUTE_IPV6 : ROUTE_IPV4;
+        memcpy(r->gateway, a.bytes, sizeof(r->gateway));
+        r->ifIndex = a.scope;
+        return true;
+    }
+
+private:
+    static bool SameRoute(const RouteEntry& a, const RouteEntry& b) {
+        return a.ifIndex == b.ifIndex && memcmp(a.gateway, b.gateway, sizeof(a.gateway)) == 0;
+    }
+
+    void Insert(const RouteEntry& r) {
+        RouteEntry* routes = m_routes[r.family];
+        uint32_t& count = m_count[r.family];
+        for (uint32_t i = 0; i < count; ++i) {
+            if (SameRoute(routes[i], r)) {
+                routes[i] = r;   // parameter change (metric)
+                PickBest((RouteFamily)r.family);
+                return;
+            }
+        }
+        if (count < kMaxDefaultRoutes) routes[count++] = r;
+        PickBest((RouteFamily)r.family);
+    }
+
+    void Remove(const RouteEntry& r) {
+        RouteEntry* routes = m_routes[r.family];
+        uint32_t& count = m_count[r.family];
+        for (uint32_t i = 0; i < count; ++i) {
+            if (SameRoute(routes[i], r)) {
+                routes[i] = routes[--count];
+                break;
+            }
+        }
+        PickBest((RouteFamily)r.family);
+    }
+
+    void PickBest(RouteFamily family) {
+        uint32_t best = UINT32_MAX;
+        for (uint32_t i = 0; i < m_count[family]; ++i) {
+            const RouteEntry& r = m_routes[family][i];
+            if (best == UINT32_MAX || r.metric < m_routes[family][best].metric ||
+                (r.metric == m_routes[family][best].metric && r.ifIndex < m_routes[family][best].ifIndex)) {
+                best = i;
+            }
+        }
+        m_best[family] = best;
+    }
+
+    RouteSource* m_source;
+    uint32_t m_version;
+    RouteEntry m_routes[ROUTE_FAMILIES][kMaxDefaultRoutes];
+    uint32_t m_count[ROUTE_FAMILIES];
+    uint32_t m_best[ROUTE_FAMILIES];   // index into m_routes, UINT32_MAX when empty
+    GatewayResolverStats m_stats;
+};
+
+} // namespace lt
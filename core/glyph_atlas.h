@@ -0,0 +1,170 @@
+// core/glyph_atlas.h
+// Pre-rasterized glyphs for the tray icon text ("24", "--", "1k", "?"...).
+// An atlas is built once per icon size (DPI) and holds an 8-bit coverage bitmap per glyph
+// in a regular and a condensed width; the compositor then only blits. Glyphs come either
+// from the built-in stroke font below (portable, deterministic, used for golden images) or
+// from the platform font renderer through SetGlyph (see icon_win.h).
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+namespace lt {
+
+static const char kGlyphChars[] = "0123456789-?k.<>!";
+static const uint32_t kGlyphCount = sizeof(kGlyphChars) - 1;
+
+enum GlyphStyle : uint8_t {
+    GLYPH_REGULAR = 0,
+    GLYPH_CONDENSED = 1,   // used when the regular text does not fit the icon
+    GLYPH_STYLES = 2
+};
+
+struct Glyph {
+    uint32_t offset;   // into the atlas pixel store
+    uint8_t width;     // 0 = not rasterized
+};
+
+// Built-in stroke font: polylines on a 4x8 unit grid (y down). Points with x < 0 split strokes.
+struct StrokeGlyph {
+    float width;        // advance in grid units
+    uint8_t count;
+    float pts[20][2];
+};
+
+static const StrokeGlyph kStrokeFont[kGlyphCount] = {
+    /* 0 */ {4, 9, {{1,0},{3,0},{4,1},{4,7},{3,8},{1,8},{0,7},{0,1},{1,0}}},
+    /* 1 */ {4, 6, {{1,1.5f},{2.5f,0},{2.5f,8},{-1,0},{1,8},{4,8}}},
+    /* 2 */ {4, 7, {{0,1},{1,0},{3,0},{4,1},{4,3},{0,8},{4,8}}},
+    /* 3 */ {4, 14, {{0,1},{1,0},{3,0},{4,1},{4,3},{3,4},{1,4},{-1,0},{3,4},{4,5},{4,7},{3,8},{1,8},{0,7}}},
+    /* 4 */ {4, 4, {{3,8},{3,0},{0,5.5f},{4,5.5f}}},
+    /* 5 */ {4, 8, {{4,0},{0,0},{0,4},{3,4},{4,5},{4,7},{3,8},{0,8}}},
+    /* 6 */ {4, 10, {{3,0},{1,0},{0,1},{0,7},{1,8},{3,8},{4,7},{4,5},{3,4},{0,4}}},
+    /* 7 */ {4, 3, {{0,0},{4,0},{1.5f,8}}},
+    /* 8 */ {4, 18, {{1,0},{3,0},{4,1},{4,3},{3,4},{1,4},{0,3},{0,1},{1,0},{-1,0},
+                     {1,4},{0,5},{0,7},{1,8},{3,8},{4,7},{4,5},{3,4}}},
+    /* 9 */ {4, 10, {{4,4},{1,4},{0,3},{0,1},{1,0},{3,0},{4,1},{4,7},{3,8},{1,8}}},
+    /* - */ {3, 2, {{0,4},{3,4}}},
+    /* ? */ {4, 10, {{0,1},{1,0},{3,0},{4,1},{4,3},{2,4.5f},{2,5.5f},{-1,0},{2,8},{2,8}}},
+    /* k */ {4, 8, {{0,0},{0,8},{-1,0},{4,3},{0,6},{-1,0},{1.5f,5},{4,8}}},
+    /* . */ {0, 2, {{0,8},{0,8}}},
+    /* < */ {4, 3, {{4,1},{0,4},{4,7}}},
+    /* > */ {4, 3, {{0,1},{4,4},{0,7}}},
+    /* ! */ {0, 5, {{0,0},{0,5},{-1,0},{0,8},{0,8}}},
+};
+
+template <uint32_t MaxSize>
+class GlyphAtlas {
+public:
+    GlyphAtlas() : m_size(0), m_height(0), m_used(0) {
+        memset(m_glyphs, 0, sizeof(m_glyphs));
+    }
+
+    static int IndexOf(char c) {
+        for (uint32_t i = 0; i < kGlyphCount; ++i) {
+            if (kGlyphChars[i] == c) return (int)i;
+        }
+        return -1;
+    }
+
+    // Start a new atlas for an icon of size x size pixels with glyphs glyphHeight tall
+    bool Begin(uint32_t size, uint32_t glyphHeight) {
+        if (size == 0 || size > MaxSize || glyphHeight == 0 || glyphHeight > size) return false;
+        m_size = size;
+        m_height = glyphHeight;
+        m_used = 0;
+        memset(m_glyphs, 0, sizeof(m_glyphs));
+        return true;
+    }
+
+    // Store one glyph's coverage (0 = empty, 255 = full), m_height rows of width bytes
+    bool SetGlyph(GlyphStyle style, uint32_t index, uint32_t width, const uint8_t* coverage, uint32_t stride) {
+        if (style >= GLYPH_STYLES || index >= kGlyphCount || width == 0 || width > m_size) return false;
+        if (m_used + width * m_height > sizeof(m_pixels)) return false;
+        Glyph& g = m_glyphs[style][index];
+        g.offset = m_used;
+        g.width = (uint8_t)width;
+        for (uint32_t y = 0; y < m_height; ++y) {
+            memcpy(m_pixels + m_used + y * width, coverage + y * stride, width);
+        }
+        m_used += width * m_height;
+        return true;
+    }
+
+    // Rasterize the built-in stroke font for an icon of the given size. Plain C++ with no
+    // platform font involved, so composed icons can be compared against golden images.
+    bool BuildBuiltin(uint32_t size) {
+        uint32_t glyphHeight = (uint32_t)(size * 0.7f);   // same proportion as the old GDI font
+        if (!Begin(size, glyphHeight ? glyphHeight : 1)) return false;
+        float stroke = (float)m_height / 6.0f;             // bold
+        if (stroke < 1.3f) stroke = 1.3f;
+        float scale = ((float)m_height - stroke) / 8.0f;
+        static const float kStyleWidth[GLYPH_STYLES] = {1.0f, 0.6f};
+        uint8_t cell[MaxSize * MaxSize];
+        for (uint32_t style = 0; style < GLYPH_STYLES; ++style) {
+            float sx = scale * kStyleWidth[style];
+            for (uint32_t i = 0; i < kGlyphCount; ++i) {
+                const StrokeGlyph& sg = kStrokeFont[i];
+                uint32_t width = (uint32_t)ceilf(sg.width * sx + stroke);
+                if (width > m_size) width = m_size;
+                RasterizeStrokes(sg, sx, scale, stroke, width, cell);
+                SetGlyph((GlyphStyle)style, i, width, cell, width);
+            }
+        }
+        return true;
+    }
+
+    // Condensed lookups fall back to the regular glyph if that style was not rasterized
+    const Glyph* Find(GlyphStyle style, char c) const {
+        int i = IndexOf(c);
+        if (i < 0) return nullptr;
+        if (m_glyphs[style][i].width) return &m_glyphs[style][i];
+        if (m_glyphs[GLYPH_REGULAR][i].width) return &m_glyphs[GLYPH_REGULAR][i];
+        return nullptr;
+    }
+
+    uint32_t Size() const { return m_size; }
+    uint32_t GlyphHeight() const { return m_height; }
+    const uint8_t* Coverage(const Glyph& g) const { return m_pixels + g.offset; }
+
+private:
+    void RasterizeStrokes(const StrokeGlyph& sg, float sx, float sy, float stroke,
+                          uint32_t width, uint8_t* cell) const {
+        float half = stroke * 0.5f;
+        for (uint32_t y = 0; y < m_height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                float px = (float)x + 0.5f - half;
+                float py = (float)y + 0.5f - half;
+                float best = 1e9f;
+                for (uint32_t k = 0; k + 1 < sg.count; ++k) {
+                    if (sg.pts[k][0] < 0 || sg.pts[k + 1][0] < 0) continue;
+                    float d = SegmentDistance(px, py, sg.pts[k][0] * sx, sg.pts[k][1] * sy,
+                                              sg.pts[k + 1][0] * sx, sg.pts[k + 1][1] * sy);
+                    if (d < best) best = d;
+                }
+                // Coverage falls off linearly over one pixel at the stroke edge
+                float c = half + 0.5f - best;
+                c = c < 0.0f ? 0.0f : (c > 1.0f ? 1.0f : c);
+                cell[y * width + x] = (uint8_t)(c * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    static float SegmentDistance(float px, float py, float ax, float ay, float bx, float by) {
+        float dx = bx - ax, dy = by - ay;
+        float len2 = dx * dx + dy * dy;
+        float t = len2 > 0.0f ? ((px - ax) * dx + (py - ay) * dy) / len2 : 0.0f;
+        t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+        float ex = ax + t * dx - px, ey = ay + t * dy - py;
+        return sqrtf(ex * ex + ey * ey);
+    }
+
+    uint32_t m_size;
+    uint32_t m_height;
+    uint32_t m_used;
+    Glyph m_glyphs[GLYPH_STYLES][kGlyphCount];
+    uint8_t m_pixels[GLYPH_STYLES * kGlyphCount * MaxSize * MaxSize];
+};
+
+} // namespace lt
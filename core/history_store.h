@@ -0,0 +1,595 @@
+// core/history_store.h
+// Opt-in per-sample latency history in a fixed-size ring file.
+// The file is a 64KB header region followed by 4KB blocks written in a ring (the oldest block is
+// reused once the file is full), so disk use is fixed at creation. Within a block, samples are
+// zigzag/varint encoded as deltas from the previous sample's time and the same target's previous
+// RTT: a one-per-second sample takes 4-5 bytes. Only a 64KB window of the file is mapped at a time,
+// which bounds resident memory however long the history is.
+//
+// Samples carry their target's slot index. The header keeps the slot labels in versioned sets,
+// each starting at a block: a reload that puts other targets in the slots (or a restart with
+// another target list) adds a set and continues in a new block, so data already on disk keeps
+// the labels it was recorded under.
+//
+// Crash safety: a sample's bytes are written first, then one aligned 64-bit commit word
+// (CRC-32 | used bytes | sample count) is stored in the block header. A crash can only lose
+// the sample being appended; a block whose CRC does not match its committed bytes is ignored.
+//
+// The probe thread never touches the file: it offers samples to HistoryRecorder's wait-free
+// queue, and a lower-priority thread drains them into the store.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include "probe_backend.h"
+#include "crc32.h"
+#include "mapped_file.h"
+#include "spsc_queue.h"
+
+namespace lt {
+
+static const uint32_t kHistoryVersion = 2;
+static const uint32_t kHistoryBlockSize = 4096;
+static const uint32_t kHistoryBlocksPerWindow = (uint32_t)(kMapGranularity / kHistoryBlockSize);
+static const uint64_t kHistoryDataOffset = kMapGranularity;   // blocks start after the header region
+static const uint32_t kHistoryMaxTargets = 32;
+static const uint32_t kHistoryNameSize = 48;
+static const uint32_t kHistoryMaxLabelSets = 32;                // label changes kept for the blocks on disk
+static const uint32_t kHistoryRelabel = 0xFFFFFFFF;            // HistorySample::target of a relabel marker
+static const uint32_t kHistoryDefaultMB = 64;                  // ~13M samples: weeks for 8 targets at 1/s
+static const uint32_t kHistorySyncMs = 5000;                   // background write-back cadence
+static const uint32_t kHistoryBlockMagic = 0x4B42544C;         // "LTBK"
+static const char kHistoryFileMagic[8] = {'L', 'T', 'H', 'I', 'S', 'T', '\r', '\n'};
+
+struct HistorySample {
+    int64_t timeMs;     // wall clock, ms since 1970
+    uint32_t target;
+    uint32_t rttUs;     // kNoReply unless status is PROBE_OK
+    uint8_t status;     // ProbeStatus
+};
+
+// Slot labels for the blocks from firstSequence on (up to the next set's)
+struct HistoryLabels {
+    uint64_t firstSequence;
+    uint32_t targetCount;
+    uint32_t reserved;
+    char names[kHistoryMaxTargets][kHistoryNameSize];   // slot index -> display name
+};
+
+struct HistoryFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t blockSize;
+    uint32_t blockCount;
+    uint32_t labelCount;
+    int64_t createdMs;
+    HistoryLabels labels[kHistoryMaxLabelSets];   // oldest first; older blocks have no labels
+    uint32_t crc;                                 // over everything above
+};
+
+static_assert(sizeof(HistoryFileHeader) <= kHistoryDataOffset, "the header fits its region");
+
+// The labels a block was written under; nullptr for blocks older than every set kept
+static inline const HistoryLabels* HistoryLabelsFor(const HistoryFileHeader& h, uint64_t sequence) {
+    for (uint32_t i = h.labelCount; i-- > 0;) {
+        if (sequence >= h.labels[i].firstSequence) return &h.labels[i];
+    }
+    return nullptr;
+}
+
+// Name of a slot in a block ("" when unlabelled)
+static inline const char* HistoryTargetName(const HistoryFileHeader& h, uint64_t sequence, uint32_t target) {
+    const HistoryLabels* labels = HistoryLabelsFor(h, sequence);
+    return labels && target < labels->targetCount ? labels->names[target] : "";
+}
+
+struct HistoryBlockHeader {
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t commit;     // crc << 32 | used << 16 | count; one store publishes an append
+    uint64_t sequence;   // write order, 1-based; 0 = never written
+    int64_t baseMs;      // time of the block's first sample
+};
+
+static const uint32_t kHistoryPayloadSize = kHistoryBlockSize - (uint32_t)sizeof(HistoryBlockHeader);
+static const uint32_t kHistoryMaxRecord = 5 + 10 + 5;   // target/status, time delta, RTT delta
+
+struct HistoryStoreStats {
+    uint64_t samples;      // appended since open
+    uint64_t bytes;        // encoded payload bytes appended since open
+    uint64_t blocks;       // blocks started since open
+    uint64_t recovered;    // samples found in the resumed block at open
+    uint64_t tornBlocks;   // blocks failing their checksum at open
+};
+
+// ---- Encoding helpers ----
+
+static inline uint32_t PutVarint(uint8_t* p, uint64_t v) {
+    uint32_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+// Returns bytes consumed, 0 on a truncated or overlong value
+static inline uint32_t GetVarint(const uint8_t* p, uint32_t avail, uint64_t* v) {
+    uint64_t r = 0;
+    for (uint32_t n = 0; n < avail && n < 10; ++n) {
+        r |= (uint64_t)(p[n] & 0x7F) << (7 * n);
+        if (!(p[n] & 0x80)) {
+            *v = r;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+static inline uint64_t ZigZag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static inline int64_t UnZigZag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+static inline uint64_t LoadCommit(const uint64_t* p) {
+#ifdef _WIN32
+    return (uint64_t)InterlockedCompareExchange64((volatile LONG64*)p, 0, 0);
+#else
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#endif
+}
+
+static inline void StoreCommit(uint64_t* p, uint64_t v) {
+#ifdef _WIN32
+    InterlockedExchange64((volatile LONG64*)p, (LONG64)v);   // single store even on x86
+#else
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+#endif
+}
+
+// Per-block decoder state; encoder and decoder evolve it identically
+struct HistoryBlockState {
+    int64_t lastMs;
+    uint32_t lastRttUs[kHistoryMaxTargets];
+
+    void Reset(int64_t baseMs) {
+        lastMs = baseMs;
+        memset(lastRttUs, 0, sizeof(lastRttUs));
+    }
+};
+
+// Decode a block image. Calls visit(const HistorySample&) per sample and returns the count,
+// or -1 if the block is empty, foreign or fails its checksum.
+template <typename Visitor>
+static int DecodeHistoryBlock(const uint8_t* block, Visitor& visit, uint64_t* sequence) {
+    HistoryBlockHeader h;
+    memcpy(&h, block, sizeof(h));
+    if (h.magic != kHistoryBlockMagic || !h.sequence) return -1;
+    uint32_t used = (uint32_t)(h.commit >> 16) & 0xFFFF;
+    uint32_t count = (uint32_t)h.commit & 0xFFFF;
+    uint32_t crc = (uint32_t)(h.commit >> 32);
+    if (used > kHistoryPayloadSize) return -1;
+    const uint8_t* payload = block + sizeof(HistoryBlockHeader);
+    uint32_t check = Crc32Update(Crc32(&h.sequence, 16), payload, used);
+    if (check != crc) return -1;
+    if (sequence) *sequence = h.sequence;
+
+    HistoryBlockState st;
+    st.Reset(h.baseMs);
+    uint32_t pos = 0;
+    int decoded = 0;
+    while (pos < used && (uint32_t)decoded < count) {
+        uint64_t tag, dt, drtt = 0;
+        uint32_t n = GetVarint(payload + pos, used - pos, &tag);
+        if (!n) break;
+        pos += n;
+        n = GetVarint(payload + pos, used - pos, &dt);
+        if (!n) break;
+        pos += n;
+        HistorySample s;
+        s.target = (uint32_t)(tag >> 2);
+        s.status = (uint8_t)(tag & 3);
+        if (s.target >= kHistoryMaxTargets) break;
+        st.lastMs += UnZigZag(dt);
+        s.timeMs = st.lastMs;
+        s.rttUs = kNoReply;
+        if (s.status == PROBE_OK) {
+            n = GetVarint(payload + pos, used - pos, &drtt);
+            if (!n) break;
+            pos += n;
+            st.lastRttUs[s.target] = (uint32_t)((int64_t)st.lastRttUs[s.target] + UnZigZag(drtt));
+            s.rttUs = st.lastRttUs[s.target];
+        }
+        visit(s);
+        ++decoded;
+    }
+    return decoded;
+}
+
+class HistoryStore {
+public:
+    HistoryStore() : m_blockCount(0), m_current(0), m_sequence(0), m_block(nullptr), m_crc(0),
+                     m_used(0), m_count(0), m_lastSyncMs(0) {
+        memset(&m_stats, 0, sizeof(m_stats));
+        memset(&m_header, 0, sizeof(m_header));
+    }
+
+    // Open or create the ring file. sizeMB fixes the disk use (rounded to whole 64KB windows);
+    // a file of another size or format is started over. names[i] labels slot i (Relabel).
+    bool Open(const char* path, uint32_t sizeMB, const char* const* names, uint32_t targetCount, int64_t nowMs) {
+        Close();
+        memset(&m_stats, 0, sizeof(m_stats));   // counts are per open
+        if (!sizeMB) sizeMB = kHistoryDefaultMB;
+        if (targetCount > kHistoryMaxTargets) targetCount = kHistoryMaxTargets;
+        uint64_t windows = ((uint64_t)sizeMB << 20) / kMapGranularity;
+        if (windows < 1) windows = 1;
+        m_blockCount = (uint32_t)(windows * kHistoryBlocksPerWindow);
+        uint64_t fileSize = kHistoryDataOffset + (uint64_t)m_blockCount * kHistoryBlockSize;
+
+        bool created = false;
+        if (!m_file.Open(path, fileSize, &created)) return false;
+        bool valid = !created && m_file.Read(0, &m_header, sizeof(m_header)) && HeaderValid(m_header) &&
+                     m_header.blockCount == m_blockCount;
+        if (!valid && !created && !ClearBlocks()) {
+            Close();
+            return false;
+        }
+        if (!valid) {
+            memset(&m_header, 0, sizeof(m_header));
+            memcpy(m_header.magic, kHistoryFileMagic, sizeof(m_header.magic));
+            m_header.version = kHistoryVersion;
+            m_header.blockSize = kHistoryBlockSize;
+            m_header.blockCount = m_blockCount;
+            m_header.createdMs = nowMs;
+        }
+        Resume();
+        if (!Relabel(names, targetCount)) {
+            Close();
+            return false;
+        }
+        m_lastSyncMs = nowMs;
+        return true;
+    }
+
+    // Label the slots for the samples appended from now on. Labels that differ from the
+    // current ones are added as a new set starting at the next block; the blocks written so
+    // far keep theirs. The oldest set goes once no block on disk uses it (or when all
+    // kHistoryMaxLabelSets are taken: its blocks read as unlabelled).
+    bool Relabel(const char* const* names, uint32_t targetCount) {
+        if (!IsOpen()) return false;
+        if (targetCount > kHistoryMaxTargets) targetCount = kHistoryMaxTargets;
+        HistoryLabels next;
+        memset(&next, 0, sizeof(next));
+        next.targetCount = targetCount;
+        for (uint32_t i = 0; i < targetCount && names; ++i) {
+            if (names[i]) strncpy(next.names[i], names[i], kHistoryNameSize - 1);
+        }
+        uint32_t& count = m_header.labelCount;
+        if (count && m_header.labels[count - 1].targetCount == targetCount &&
+            memcmp(m_header.labels[count - 1].names, next.names, sizeof(next.names)) == 0) {
+            return true;
+        }
+        if (m_block) {
+            m_current = (m_current + 1) % m_blockCount;
+            m_block = nullptr;
+        }
+        next.firstSequence = m_sequence + 1;
+        // A set no block was written under is replaced
+        if (count && m_header.labels[count - 1].firstSequence == next.firstSequence) --count;
+        uint64_t oldest = m_sequence >= m_blockCount ? m_sequence - m_blockCount + 1 : 1;
+        uint32_t drop = 0;
+        while (drop + 1 < count && m_header.labels[drop + 1].firstSequence <= oldest) ++drop;
+        if (count - drop == kHistoryMaxLabelSets) ++drop;
+        memmove(&m_header.labels[0], &m_header.labels[drop], (count - drop) * sizeof(HistoryLabels));
+        count -= drop;
+        m_header.labels[count++] = next;
+        return WriteHeader();
+    }
+
+    void Close() {
+        m_file.Close();
+        m_block = nullptr;
+    }
+
+    bool IsOpen() const { return m_file.IsOpen(); }
+
+    // Append one sample. Only touches the mapped window (no system call unless a new 64KB
+    // window has to be mapped, once per 16 blocks).
+    bool Append(const HistorySample& s) {
+        if (!IsOpen() || s.target >= kHistoryMaxTargets) return false;
+        if (!m_block || m_used + kHistoryMaxRecord > kHistoryPayloadSize) {
+            if (!StartBlock(m_block ? m_current + 1 : m_current, s.timeMs)) return false;
+        }
+        uint8_t rec[kHistoryMaxRecord];
+        uint8_t status = s.status == PROBE_OK && s.rttUs == kNoReply ? (uint8_t)PROBE_ERROR : s.status;
+        uint32_t n = PutVarint(rec, ((uint64_t)s.target << 2) | (status & 3));
+        n += PutVarint(rec + n, ZigZag(s.timeMs - m_state.lastMs));   // signed: clocks step back
+        if (status == PROBE_OK) {
+            n += PutVarint(rec + n, ZigZag((int64_t)s.rttUs - (int64_t)m_state.lastRttUs[s.target]));
+            m_state.lastRttUs[s.target] = s.rttUs;
+        }
+        m_state.lastMs = s.timeMs;
+
+        // Bytes first, then the commit word that makes them part of the block
+        memcpy(m_block + sizeof(HistoryBlockHeader) + m_used, rec, n);
+        m_crc = Crc32Update(m_crc, rec, n);
+        m_used += n;
+        ++m_count;
+        StoreCommit(&((HistoryBlockHeader*)m_block)->commit, Commit());
+        ++m_stats.samples;
+        m_stats.bytes += n;
+        return true;
+    }
+
+    // Schedule write-back of recent appends every kHistorySyncMs (asynchronous)
+    void Maintain(int64_t nowMs) {
+        if (!IsOpen() || nowMs - m_lastSyncMs < (int64_t)kHistorySyncMs) return;
+        m_lastSyncMs = nowMs;
+        m_file.Flush();
+    }
+
+    // Every stored sample, oldest block first. Reads through the file, not the window.
+    template <typename Visitor>
+    uint64_t ForEach(Visitor& visit) const {
+        if (!IsOpen()) return 0;
+        uint8_t block[kHistoryBlockSize];
+        uint64_t total = 0;
+        // The block after the current one is the oldest once the ring has wrapped
+        for (uint32_t k = 1; k <= m_blockCount; ++k) {
+            uint32_t i = (m_current + k) % m_blockCount;
+            if (!m_file.Read(BlockOffset(i), block, sizeof(block))) continue;
+            int n = DecodeHistoryBlock(block, visit, nullptr);
+            if (n > 0) total += (uint64_t)n;
+        }
+        return total;
+    }
+
+    const HistoryFileHeader& Header() const { return m_header; }
+    const HistoryStoreStats& Stats() const { return m_stats; }
+    uint32_t BlockCount() const { return m_blockCount; }
+
+    static bool HeaderValid(const HistoryFileHeader& h) {
+        if (memcmp(h.magic, kHistoryFileMagic, sizeof(h.magic)) != 0 || h.version != kHistoryVersion ||
+            h.blockSize != kHistoryBlockSize || !h.blockCount || h.labelCount > kHistoryMaxLabelSets) {
+            return false;
+        }
+        for (uint32_t i = 0; i < h.labelCount; ++i) {
+            if (h.labels[i].targetCount > kHistoryMaxTargets) return false;
+        }
+        return h.crc == Crc32(&h, offsetof(HistoryFileHeader, crc));
+    }
+
+    static uint64_t BlockOffset(uint32_t index) { return kHistoryDataOffset + (uint64_t)index * kHistoryBlockSize; }
+
+private:
+    uint64_t Commit() const { return ((uint64_t)m_crc << 32) | ((uint64_t)m_used << 16) | m_count; }
+
+    bool WriteHeader() {
+        m_header.crc = Crc32(&m_header, offsetof(HistoryFileHeader, crc));
+        return m_file.Write(0, &m_header, sizeof(m_header));
+    }
+
+    // Invalidate every block of a file that is being reformatted
+    bool ClearBlocks() {
+        HistoryBlockHeader empty;
+        memset(&empty, 0, sizeof(empty));
+        for (uint32_t i = 0; i < m_blockCount; ++i) {
+            if (!m_file.Write(BlockOffset(i), &empty, sizeof(empty))) return false;
+        }
+        return true;
+    }
+
+    // Find the newest valid block and keep appending to it (or after it)
+    void Resume() {
+        uint64_t bestSeq = 0;
+        uint32_t best = 0;
+        HistoryBlockHeader h;
+        for (uint32_t i = 0; i < m_blockCount; ++i) {
+            if (!m_file.Read(BlockOffset(i), &h, sizeof(h))) continue;
+            if (h.magic == kHistoryBlockMagic && h.sequence > bestSeq) {
+                bestSeq = h.sequence;
+                best = i;
+            }
+        }
+        m_sequence = bestSeq;
+        m_current = best;
+        m_block = nullptr;
+        if (!bestSeq) return;   // empty file: the first Append starts block 0
+
+        uint8_t* window = MapBlockWindow(best);
+        if (!window) return;
+        uint8_t* block = window + (best % kHistoryBlocksPerWindow) * kHistoryBlockSize;
+        uint8_t image[kHistoryBlockSize];
+        memcpy(image, block, sizeof(image));
+        HistoryBlockHeader* hdr = (HistoryBlockHeader*)image;
+        hdr->commit = LoadCommit(&((HistoryBlockHeader*)block)->commit);
+
+        // Rebuild the encoder state by decoding what is committed
+        struct Replay {
+            HistoryBlockState* st;
+            void operator()(const HistorySample& s) {
+                st->lastMs = s.timeMs;
+                if (s.status == PROBE_OK) st->lastRttUs[s.target] = s.rttUs;
+            }
+        } replay = {&m_state};
+        m_state.Reset(hdr->baseMs);
+        int n = DecodeHistoryBlock(image, replay, nullptr);
+        if (n < 0) {
+            // Torn or foreign: leave it and continue in the next block
+            ++m_stats.tornBlocks;
+            m_current = (best + 1) % m_blockCount;
+            return;
+        }
+        m_stats.recovered = (uint64_t)n;
+        m_block = block;
+        m_used = (uint32_t)(hdr->commit >> 16) & 0xFFFF;
+        m_count = (uint32_t)hdr->commit & 0xFFFF;
+        m_crc = (uint32_t)(hdr->commit >> 32);
+    }
+
+    uint8_t* MapBlockWindow(uint32_t index) {
+        uint32_t window = index / kHistoryBlocksPerWindow;
+        return m_file.Map(kHistoryDataOffset + (uint64_t)window * kMapGranularity, (size_t)kMapGranularity);
+    }
+
+    bool StartBlock(uint32_t index, int64_t baseMs) {
+        index %= m_blockCount;
+        uint8_t* window = MapBlockWindow(index);
+        if (!window) {
+            m_block = nullptr;
+            return false;
+        }
+        uint8_t* block = window + (index % kHistoryBlocksPerWindow) * kHistoryBlockSize;
+        HistoryBlockHeader* hdr = (HistoryBlockHeader*)block;
+        // Empty the block before relabelling it, so a crash in between leaves no stale samples
+        StoreCommit(&hdr->commit, 0);
+        hdr->magic = 0;
+        hdr->reserved = 0;
+        hdr->sequence = ++m_sequence;
+        hdr->baseMs = baseMs;
+        m_crc = Crc32(&hdr->sequence, 16);
+        m_used = 0;
+        m_count = 0;
+        StoreCommit(&hdr->commit, Commit());
+        hdr->magic = kHistoryBlockMagic;
+        m_state.Reset(baseMs);
+        m_current = index;
+        m_block = block;
+        ++m_stats.blocks;
+        return true;
+    }
+
+    MappedFile m_file;
+    HistoryFileHeader m_header;
+    uint32_t m_blockCount;
+    uint32_t m_current;      // block being appended to
+    uint64_t m_sequence;     // sequence of the newest block
+    uint8_t* m_block;        // current block inside the mapped window
+    HistoryBlockState m_state;
+    uint32_t m_crc;
+    uint32_t m_used;
+    uint32_t m_count;
+    int64_t m_lastSyncMs;
+    HistoryStoreStats m_stats;
+};
+
+// Hand-off from the probe thread: Offer never blocks or touches the file; Drain runs on a
+// lower-priority thread and does the encoding and writing. A relabel travels through the
+// queue as a marker, so samples offered before it keep the old labels and those after it get
+// the new ones; while the marker cannot be queued, samples are dropped rather than mislabelled.
+template <uint32_t QueueCapacity>
+class HistoryRecorder {
+public:
+    HistoryRecorder() : m_enabled(false), m_relabelPending(false), m_labelsOffered(0), m_labelsTaken(0), m_dropped(0) {}
+
+    bool Open(const char* path, uint32_t sizeMB, const char* const* names, uint32_t targetCount, int64_t nowMs) {
+        m_enabled = m_store.Open(path, sizeMB, names, targetCount, nowMs);
+        return m_enabled;
+    }
+
+    bool Enabled() const { return m_enabled; }
+
+    // Producer thread
+    void Offer(const HistorySample& s) {
+        if (!m_enabled) return;
+        if ((m_relabelPending && !QueueLabels()) || !m_queue.TryPush(s)) m_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Producer thread: the slots hold other targets from now on (config reload)
+    void Relabel(const char* const* names, uint32_t targetCount) {
+        if (!m_enabled) return;
+        memset(&m_staged, 0, sizeof(m_staged));
+        m_staged.targetCount = targetCount < kHistoryMaxTargets ? targetCount : kHistoryMaxTargets;
+        for (uint32_t i = 0; i < m_staged.targetCount && names; ++i) {
+            if (names[i]) strncpy(m_staged.names[i], names[i], kHistoryNameSize - 1);
+        }
+        m_relabelPending = true;
+        QueueLabels();
+    }
+
+    // Consumer thread. Returns the number of samples written.
+    uint32_t Drain(int64_t nowMs) {
+        if (!m_enabled) return 0;
+        uint32_t n = 0;
+        HistorySample s;
+        while (m_queue.TryPop(&s)) {
+            if (s.target == kHistoryRelabel) {
+                const HistoryLabels& labels = m_labels[s.rttUs];
+                const char* names[kHistoryMaxTargets];
+                for (uint32_t i = 0; i < labels.targetCount; ++i) names[i] = labels.names[i];
+                m_store.Relabel(names, labels.targetCount);
+                m_labelsTaken.fetch_add(1, std::memory_order_release);
+                continue;
+            }
+            m_store.Append(s);
+            ++n;
+        }
+        m_store.Maintain(nowMs);
+        return n;
+    }
+
+    // Consumer thread, after the producer has stopped
+    void Close(int64_t nowMs) {
+        Drain(nowMs);
+        m_store.Close();
+        m_enabled = false;
+    }
+
+    uint32_t Pending() const { return m_queue.SizeApprox(); }
+    uint64_t Dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    const HistoryStore& Store() const { return m_store; }
+
+private:
+    static const uint32_t kPendingLabels = 4;
+
+    // Producer thread: hand the staged labels to the consumer, if a buffer and a queue entry are free
+    bool QueueLabels() {
+        if (m_labelsOffered - m_labelsTaken.load(std::memory_order_acquire) == kPendingLabels) return false;
+        uint32_t slot = m_labelsOffered % kPendingLabels;
+        m_labels[slot] = m_staged;
+        HistorySample marker = {0, kHistoryRelabel, slot, 0};
+        if (!m_queue.TryPush(marker)) return false;
+        ++m_labelsOffered;
+        m_relabelPending = false;
+        return true;
+    }
+
+    bool m_enabled;
+    bool m_relabelPending;                  // m_staged is not queued yet
+    HistoryLabels m_staged;
+    HistoryLabels m_labels[kPendingLabels]; // handed over with a marker sample
+    uint32_t m_labelsOffered;               // producer
+    std::atomic<uint32_t> m_labelsTaken;    // consumer
+    std::atomic<uint64_t> m_dropped;        // queue full (writer fell behind), or a relabel waiting
+    SpscQueue<HistorySample, QueueCapacity> m_queue;
+    HistoryStore m_store;
+};
+
+// "--history=<file>" and optional "--history-size=<MB>" from a command line (quotes allowed)
+static inline bool ParseHistoryOptions(const char* cmdLine, char* path, size_t pathSize, uint32_t* sizeMB) {
+    if (!cmdLine || !path || !pathSize) return false;
+    *sizeMB = kHistoryDefaultMB;
+    const char* size = strstr(cmdLine, "--history-size=");
+    if (size) {
+        uint32_t mb = 0;
+        for (const char* p = size + 15; *p >= '0' && *p <= '9' && mb < 1000000; ++p) mb = mb * 10 + (uint32_t)(*p - '0');
+        if (mb) *sizeMB = mb;
+    }
+    const char* arg = strstr(cmdLine, "--history=");
+    if (!arg) return false;
+    arg += 10;
+    char end = ' ';
+    if (*arg == '"') {
+        end = '"';
+        ++arg;
+    }
+    size_t n = 0;
+    while (arg[n] && arg[n] != end && (end == '"' || arg[n] != '\t')) ++n;
+    if (!n || n >= pathSize) return false;
+    memcpy(path, arg, n);
+    path[n] = 0;
+    return true;
+}
+
+} // namespace lt
@@ -0,0 +1,978 @@
+// core/http_probe_backend.h
+// ProbeBackend that measures HTTP/1.1 time to first byte for a URL ("http://host[:port]/path"),
+// split into phases: name lookup, TCP connect, request sent, first response byte. The engine's
+// RTT for the probe is the whole time to first byte, so the usual statistics apply; the phases
+// of the last probe are kept per slot (Phases). Connections are kept alive between probes, so
+// repeated probes measure the server rather than the handshake: a reused connection has no
+// lookup or connect phase. A connection the server closed while idle is noticed and replaced;
+// one that fails on the first byte of a reused request is retried once on a fresh connection.
+// Everything is non-blocking and runs on the caller's thread: host names are resolved with a
+// query to the resolver given to SetResolver (core/system_resolver.h finds the system one),
+// sockets are multiplexed with epoll on Linux and with one shared event (WSAEventSelect) on
+// Windows. Responses are read to the end (Content-Length, chunked, or until close) and
+// discarded; status 400 and above is PROBE_ERROR. Plain HTTP only: there is no TLS here.
+// Shares the wait with an ICMP backend like TcpConnectBackend (see probe_mux.h).
+#pragma once
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>        // MUST be before windows.h
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <errno.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "probe_backend.h"
+#include "mono_clock.h"
+#include "dns_wire.h"
+
+namespace lt {
+
+// Phases of one probe in microseconds; kNoReply for a phase that did not happen
+struct HttpPhases {
+    uint32_t seq;            // probe these belong to
+    uint32_t dnsUs;          // name lookup (none for an address or a reused connection)
+    uint32_t connectUs;      // TCP handshake (none on a reused connection)
+    uint32_t sendUs;         // connected (or probe start, when reused) to request written
+    uint32_t firstByteUs;    // request written to first response byte: the server's time
+    uint16_t status;         // HTTP status code, 0 without a response
+    bool reused;             // went over a kept-alive connection
+};
+
+struct HttpProbeStats {
+    uint64_t probes;
+    uint64_t connects;       // connections opened
+    uint64_t reused;         // probes sent on a kept-alive connection
+    uint64_t retries;        // reused connections found closed, retried on a fresh one
+    uint64_t responses;      // complete responses (any status)
+    uint64_t httpErrors;     // status 400 and above
+    uint64_t dnsErrors;      // lookups that failed or found no address
+    uint64_t errors;         // connect, send, receive and protocol errors
+    uint64_t timeouts;
+};
+
+template <uint32_t MaxTargets>
+class HttpProbeBackend : public SideBackend {
+public:
+#ifdef _WIN32
+    typedef SOCKET Socket;
+    static const Socket kNoSocket = INVALID_SOCKET;
+
+    HttpProbeBackend() : m_event(NULL), m_ownEvent(false) { Reset(); }
+
+    ~HttpProbeBackend() {
+        for (uint32_t i = 0; i < MaxTargets; ++i) CloseSlot(m_slots[i]);
+        if (m_resolverSocket != kNoSocket) closesocket(m_resolverSocket);
+        if (m_ownEvent) CloseHandle(m_event);
+    }
+
+    // Event signalled by every socket event, normally the ICMP backend's wake event
+    // (auto-reset). Not owned. Without one, the backend creates its own.
+    void SetWakeEvent(HANDLE wake) { m_event = wake; }
+#else
+    typedef int Socket;
+    static const Socket kNoSocket = -1;
+
+    HttpProbeBackend() : m_epoll(-1), m_wakeFd(-1) { Reset(); }
+
+    ~HttpProbeBackend() {
+        for (uint32_t i = 0; i < MaxTargets; ++i) CloseSlot(m_slots[i]);
+        if (m_resolverSocket != kNoSocket) close(m_resolverSocket);
+        if (m_epoll >= 0) close(m_epoll);
+    }
+
+    // The epoll descriptor: readable whenever a socket needs attention (or the wake fd is
+    // readable). Give it to the ICMP backend, or the next side backend, as its wake fd.
+    int Fd() { return Epoll(); }
+
+    // Extra descriptor that ends a Poll wait when readable. Not owned.
+    void SetWakeFd(int fd) {
+        if (Epoll() < 0 || fd < 0) return;
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u64 = kWakeMarker;
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev) == 0) m_wakeFd = fd;
+    }
+#endif
+
+    const HttpProbeStats& Stats() const { return m_stats; }
+
+    // Phases of the slot's last completed probe (seq 0 before the first)
+    const HttpPhases& Phases(uint32_t target) const { return m_slots[target < MaxTargets ? target : 0].last; }
+
+    // DNS server used for host names. Without one, only URLs with an address work.
+    bool SetResolver(const char* ip, bool isIPv6, uint16_t port = 53) {
+        memset(&m_resolver, 0, sizeof(m_resolver));
+        m_resolverLen = 0;
+        if (!ip) return false;
+        if (isIPv6) {
+            struct sockaddr_in6* a6 = (struct sockaddr_in6*)&m_resolver;
+            if (inet_pton(AF_INET6, ip, &a6->sin6_addr) != 1) return false;
+            a6->sin6_family = AF_INET6;
+            a6->sin6_port = htons(port);
+            m_resolverLen = sizeof(struct sockaddr_in6);
+        } else {
+            struct sockaddr_in* a4 = (struct sockaddr_in*)&m_resolver;
+            if (inet_pton(AF_INET, ip, &a4->sin_addr) != 1) return false;
+            a4->sin_family = AF_INET;
+            a4->sin_port = htons(port);
+            m_resolverLen = sizeof(struct sockaddr_in);
+        }
+        return true;
+    }
+
+    // Binds the slot to a URL, passed in place of the address: "http://host[:port][/path]",
+    // host being a name, an IPv4 address or a bracketed IPv6 address. For a name, isIPv6 asks
+    // for its AAAA record instead of its A record. Any open connection is closed.
+    bool SetTarget(uint32_t target, const char* url, bool isIPv6) override {
+        if (target >= MaxTargets || !url) return false;
+        Slot& s = m_slots[target];
+        CloseSlot(s);
+        if (s.pending) {
+            // Reported as PROBE_ERROR by the next ExpireDue (deadline 0: abandoned)
+            s.deadlineUs = 0;
+            m_earliestUs = 0;
+        }
+        s.bound = false;
+        s.phase = PHASE_IDLE;
+        memset(&s.last, 0, sizeof(s.last));
+        memset(&s.addr, 0, sizeof(s.addr));
+        if (!ParseUrl(s, url)) return false;
+        s.wantIPv6 = isIPv6;
+        s.literal = SetAddress(s, s.host);
+        if (!s.literal && !strcmp(s.host, "localhost")) s.literal = SetAddress(s, "127.0.0.1");
+        s.bound = true;
+        return true;
+    }
+
+    // Starts the probe: on the kept-alive connection if there is one, otherwise with a lookup
+    // (names) or a connect (addresses). False when that could not even start.
+    bool Send(uint32_t target, uint32_t seq, uint32_t timeoutMs) override {
+        if (target >= MaxTargets) return false;
+        Slot& s = m_slots[target];
+        if (!s.bound || s.pending) return false;
+        ++m_stats.probes;
+        s.pending = true;
+        s.seq = seq;
+        s.startUs = MonoNowUs();
+        s.dnsDoneUs = s.connectStartUs = s.connectedUs = s.sentUs = s.firstByteUs = 0;
+        s.status = 0;
+        s.deadlineUs = s.startUs + (uint64_t)timeoutMs * 1000;
+        if (s.deadlineUs < m_earliestUs) m_earliestUs = s.deadlineUs;
+
+        s.reused = s.socket != kNoSocket && s.phase == PHASE_IDLE;
+        bool started;
+        if (s.reused) {
+            ++m_stats.reused;
+            started = Request(target);
+            if (!started) {   // closed under us: once more on a fresh connection
+                ++m_stats.retries;
+                started = Fresh(target);
+            }
+        } else {
+            started = Fresh(target);
+        }
+        if (!started) {
+            CloseSlot(s);
+            s.pending = false;
+            s.phase = PHASE_IDLE;
+            ++m_stats.errors;
+        }
+        return started;
+    }
+
+    int Poll(ProbeResult* out, int maxResults, uint32_t waitMs) override {
+        int n = Collect(out, maxResults);
+        if (n == 0 && waitMs > 0) {
+            uint32_t untilTimeout = MsUntilTimeout();
+            Wait(untilTimeout < waitMs ? untilTimeout : waitMs);
+            n = Collect(out, maxResults);
+        }
+        return n;
+    }
+
+    uint64_t NowMs() override { return MonoNowUs() / 1000; }
+
+    uint32_t MsUntilTimeout() const override {
+        if (m_earliestUs == ~0ull) return kNoReply;
+        uint64_t now = MonoNowUs();
+        if (now >= m_earliestUs) return 0;
+        uint64_t ms = (m_earliestUs - now + 999) / 1000;
+        return ms < kNoReply ? (uint32_t)ms : kNoReply - 1;
+    }
+
+private:
+    static const uint32_t kMaxHost = 256;
+    static const uint32_t kMaxRequest = 768;
+    static const uint32_t kMaxLine = 256;       // longer header lines are cut (only their start matters)
+    static const uint32_t kReceiveBuffer = 16 * 1024;
+#ifndef _WIN32
+    static const uint64_t kWakeMarker = ~0ull;
+    static const uint64_t kResolverMarker = ~0ull - 1;
+#endif
+
+    enum Phase : uint8_t {
+        PHASE_IDLE,          // no probe; the socket, if any, is a kept-alive connection
+        PHASE_RESOLVING,
+        PHASE_CONNECTING,
+        PHASE_SENDING,
+        PHASE_WAITING,       // request sent, no response byte yet
+        PHASE_READING
+    };
+
+    enum Body : uint8_t {
+        BODY_NONE,
+        BODY_LENGTH,
+        BODY_CHUNKED,
+        BODY_UNTIL_CLOSE
+    };
+
+    enum Chunk : uint8_t {
+        CHUNK_SIZE,          // chunk-size line
+        CHUNK_DATA,
+        CHUNK_DATA_END,      // CRLF after the data
+        CHUNK_TRAILER        // trailer lines up to the empty one
+    };
+
+    enum Parse { PARSE_MORE, PARSE_DONE, PARSE_ERROR };
+
+    struct Slot {
+        bool bound;
+        bool pending;
+        bool literal;           // host is an address: no lookup
+        bool wantIPv6;          // look up AAAA instead of A
+        bool isIPv6;            // family of addr
+        bool reused;
+        bool keepAlive;         // the response allows another request on the connection
+        bool inHeaders;
+        bool statusLine;        // next header line is the status line
+        Phase phase;
+        Body body;
+        Chunk chunk;
+        uint16_t port;
+        uint16_t status;
+        uint16_t dnsId;
+        uint16_t lineLen;
+        uint32_t seq;
+        uint32_t requestLen;
+        uint32_t requestSent;
+        Socket socket;
+        uint64_t bodyLeft;
+        uint64_t startUs;
+        uint64_t dnsDoneUs;
+        uint64_t connectStartUs;
+        uint64_t connectedUs;
+        uint64_t sentUs;
+        uint64_t firstByteUs;
+        uint64_t deadlineUs;
+        struct sockaddr_storage addr;
+        socklen_t addrLen;
+        HttpPhases last;
+        char host[kMaxHost];
+        char request[kMaxRequest];
+        char line[kMaxLine];
+    };
+
+    void Reset() {
+        memset(m_slots, 0, sizeof(m_slots));
+        memset(&m_stats, 0, sizeof(m_stats));
+        memset(&m_resolver, 0, sizeof(m_resolver));
+        for (uint32_t i = 0; i < MaxTargets; ++i) m_slots[i].socket = kNoSocket;
+        m_resolverSocket = kNoSocket;
+        m_resolverLen = 0;
+        m_earliestUs = ~0ull;
+        uint64_t seed = MonoNowUs() ^ RealtimeNowUs() ^ (uint64_t)(uintptr_t)this;
+        m_rng = (uint32_t)(seed ^ (seed >> 32)) | 1;
+    }
+
+    // "http://host[:port][/path]" into host, port and the request
+    bool ParseUrl(Slot& s, const char* url) {
+        if (!StartsWithNoCase(url, "http://")) return false;
+        const char* authority = url + 7;
+        size_t authorityLen = strcspn(authority, "/?#");
+        const char* path = authority + authorityLen;
+        size_t pathLen = strcspn(path, "#");
+        if (authorityLen == 0 || authorityLen >= kMaxHost) return false;
+        const char* host = authority;
+        size_t hostLen;
+        const char* portText = nullptr;
+        if (authority[0] == '[') {
+            const char* close = (const char*)memchr(authority, ']', authorityLen);
+            if (!close) return false;
+            host = authority + 1;
+            hostLen = (size_t)(close - host);
+            if (close + 1 < authority + authorityLen) {
+                if (close[1] != ':') return false;
+                portText = close + 2;
+            }
+        } else {
+            const char* colon = (const char*)memchr(authority, ':', authorityLen);
+            hostLen = colon ? (size_t)(colon - authority) : authorityLen;
+            if (colon) portText = colon + 1;
+        }
+        if (hostLen == 0) return false;
+        unsigned long port = 80;
+        if (portText) {
+            char* end = nullptr;
+            port = strtoul(portText, &end, 10);
+            if (end != authority + authorityLen || port == 0 || port > 65535) return false;
+        }
+        memcpy(s.host, host, hostLen);
+        s.host[hostLen] = 0;
+        s.port = (uint16_t)port;
+        int len = snprintf(s.request, sizeof(s.request),
+                           "GET %s%.*s HTTP/1.1\r\nHost: %.*s\r\nUser-Agent: latency-tray\r\nAccept: */*\r\n\r\n",
+                           pathLen && path[0] == '/' ? "" : "/", (int)pathLen, path, (int)authorityLen, authority);
+        if (len <= 0 || len >= (int)sizeof(s.request)) return false;
+        s.requestLen = (uint32_t)len;
+        return true;
+    }
+
+    // Address literal (or a looked-up one) into s.addr. False if ip is not an address.
+    static bool SetAddress(Slot& s, const char* ip) {
+        struct sockaddr_in6* a6 = (struct sockaddr_in6*)&s.addr;
+        struct sockaddr_in* a4 = (struct sockaddr_in*)&s.addr;
+        memset(&s.addr, 0, sizeof(s.addr));
+        if (inet_pton(AF_INET, ip, &a4->sin_addr) == 1) {
+            a4->sin_family = AF_INET;
+            a4->sin_port = htons(s.port);
+            s.addrLen = sizeof(struct sockaddr_in);
+            s.isIPv6 = false;
+            return true;
+        }
+        if (inet_pton(AF_INET6, ip, &a6->sin6_addr) == 1) {
+            a6->sin6_family = AF_INET6;
+            a6->sin6_port = htons(s.port);
+            s.addrLen = sizeof(struct sockaddr_in6);
+            s.isIPv6 = true;
+            return true;
+        }
+        return false;
+    }
+
+    static bool StartsWithNoCase(const char* text, const char* prefix) {
+        for (; *prefix; ++text, ++prefix) {
+            char c = *text;
+            if (c >= 'A' && c <= 'Z') c = (char)(c + 32);
+            if (c != *prefix) return false;
+        }
+        return true;
+    }
+
+    // Header value contains token (lowercase), ignoring case
+    static bool ContainsNoCase(const char* text, const char* token) {
+        for (; *text; ++text) {
+            if (StartsWithNoCase(text, token)) return true;
+        }
+        return false;
+    }
+
+    // A new connection for the probe: look the host up, or connect to the address
+    bool Fresh(uint32_t target) {
+        Slot& s = m_slots[target];
+        CloseSlot(s);
+        s.reused = false;
+        s.dnsDoneUs = 0;
+        if (s.literal) return Connect(target, MonoNowUs());
+        return Resolve(target);
+    }
+
+    bool Resolve(uint32_t target) {
+        Slot& s = m_slots[target];
+        if (!m_resolverLen || OpenResolver() == kNoSocket) return false;
+        uint8_t query[kDnsMaxQuery];
+        uint32_t len = EncodeDnsQuery(s.host, s.wantIPv6 ? kDnsTypeAAAA : kDnsTypeA, query);
+        if (!len) return false;
+        // IDs only need to be unique among the lookups in progress
+        uint16_t id;
+        bool used;
+        do {
+            id = NextDnsId(&m_rng);
+            used = false;
+            for (uint32_t i = 0; i < MaxTargets && !used; ++i) {
+                used = m_slots[i].phase == PHASE_RESOLVING && m_slots[i].dnsId == id;
+            }
+        } while (used);
+        query[0] = (uint8_t)(id >> 8);
+        query[1] = (uint8_t)id;
+        int rc = (int)sendto(m_resolverSocket, (const char*)query, (int)len, 0, (const struct sockaddr*)&m_resolver,
+                             (int)m_resolverLen);
+        if (rc != (int)len) return false;
+        s.dnsId = id;
+        s.phase = PHASE_RESOLVING;
+        return true;
+    }
+
+    // Start the handshake to s.addr. A handshake that completes at once goes on to the request.
+    bool Connect(uint32_t target, uint64_t now) {
+        Slot& s = m_slots[target];
+        if (!Open(s, target)) return false;
+        ++m_stats.connects;
+        s.connectStartUs = now;
+        int rc = connect(s.socket, (const struct sockaddr*)&s.addr, (int)s.addrLen);
+        if (rc == 0) {
+            s.connectedUs = MonoNowUs();
+            return Request(target);
+        }
+        if (!InProgress()) return false;
+        s.phase = PHASE_CONNECTING;
+        Watch(s, target, true);
+        return true;
+    }
+
+    // Write the request (from the start), then wait for the response
+    bool Request(uint32_t target) {
+        Slot& s = m_slots[target];
+        s.requestSent = 0;
+        s.inHeaders = true;
+        s.statusLine = true;
+        s.lineLen = 0;
+        s.body = BODY_NONE;
+        s.bodyLeft = 0;
+        s.keepAlive = false;
+        s.phase = PHASE_SENDING;
+        return WriteRequest(target);
+    }
+
+    bool WriteRequest(uint32_t target) {
+        Slot& s = m_slots[target];
+        while (s.requestSent < s.requestLen) {
+            int rc = (int)send(s.socket, s.request + s.requestSent, (int)(s.requestLen - s.requestSent), kSendFlags);
+            if (rc > 0) {
+                s.requestSent += (uint32_t)rc;
+                continue;
+            }
+            if (rc < 0 && WouldBlock()) {
+                Watch(s, target, true);
+                return true;
+            }
+            return false;
+        }
+        s.sentUs = MonoNowUs();
+        s.phase = PHASE_WAITING;
+        Watch(s, target, false);
+        return true;
+    }
+
+    // Feed received bytes to the response parser
+    Parse Consume(Slot& s, const char* data, uint32_t len) {
+        uint32_t i = 0;
+        while (i < len) {
+            if (s.inHeaders || (s.body == BODY_CHUNKED && s.chunk != CHUNK_DATA)) {
+                char c = data[i++];
+                if (c != '\n') {
+                    if (s.lineLen < kMaxLine - 1) s.line[s.lineLen++] = c;
+                    continue;
+                }
+                if (s.lineLen && s.line[s.lineLen - 1] == '\r') --s.lineLen;
+                s.line[s.lineLen] = 0;
+                s.lineLen = 0;
+                Parse p = s.inHeaders ? HeaderLine(s) : ChunkLine(s);
+                if (p == PARSE_DONE && i < len) s.keepAlive = false;   // bytes nobody asked for
+                if (p != PARSE_MORE) return p;
+                continue;
+            }
+            uint32_t take = len - i;
+            if (s.body == BODY_UNTIL_CLOSE) return PARSE_MORE;
+            if ((uint64_t)take > s.bodyLeft) take = (uint32_t)s.bodyLeft;
+            i += take;
+            s.bodyLeft -= take;
+            if (s.bodyLeft) continue;
+            if (s.body == BODY_CHUNKED) {
+                s.chunk = CHUNK_DATA_END;
+                continue;
+            }
+            if (i < len) s.keepAlive = false;
+            return PARSE_DONE;
+        }
+        return PARSE_MORE;
+    }
+
+    Parse HeaderLine(Slot& s) {
+        const char* line = s.line;
+        if (s.statusLine) {
+            // "HTTP/1.1 200 OK"; HTTP/1.0 closes unless it says otherwise
+            if (strncmp(line, "HTTP/1.", 7) != 0 || line[8] != ' ') return PARSE_ERROR;
+            if (line[9] < '1' || line[9] > '5' || line[10] < '0' || line[10] > '9' || line[11] < '0' || line[11] > '9') {
+                return PARSE_ERROR;
+            }
+            s.status = (uint16_t)((line[9] - '0') * 100 + (line[10] - '0') * 10 + (line[11] - '0'));
+            s.keepAlive = line[7] == '1';
+            s.statusLine = false;
+            s.body = BODY_NONE;
+            return PARSE_MORE;
+        }
+        if (line[0] == 0) {
+            if (s.status < 200) {   // interim response: the real one follows
+                s.statusLine = true;
+                return PARSE_MORE;
+            }
+            s.inHeaders = false;
+            if (s.status == 204 || s.status == 304) return PARSE_DONE;
+            if (s.body == BODY_CHUNKED) {
+                s.chunk = CHUNK_SIZE;
+                return PARSE_MORE;
+            }
+            if (s.body == BODY_LENGTH) return s.bodyLeft ? PARSE_MORE : PARSE_DONE;
+            s.body = BODY_UNTIL_CLOSE;
+            s.keepAlive = false;
+            return PARSE_MORE;
+        }
+        if (StartsWithNoCase(line, "content-length:")) {
+            if (s.body != BODY_CHUNKED) {
+                s.body = BODY_LENGTH;
+                s.bodyLeft = strtoull(line + 15, nullptr, 10);
+            }
+        } else if (StartsWithNoCase(line, "transfer-encoding:")) {
+            if (ContainsNoCase(line + 18, "chunked")) s.body = BODY_CHUNKED;
+        } else if (StartsWithNoCase(line, "connection:")) {
+            if (ContainsNoCase(line + 11, "close")) s.keepAlive = false;
+            else if (ContainsNoCase(line + 11, "keep-alive")) s.keepAlive = true;
+        }
+        return PARSE_MORE;
+    }
+
+    Parse ChunkLine(Slot& s) {
+        switch (s.chunk) {
+        case CHUNK_SIZE: {
+            char* end = nullptr;
+            s.bodyLeft = strtoull(s.line, &end, 16);   // extensions after ';' are ignored
+            if (end == s.line) return PARSE_ERROR;
+            s.chunk = s.bodyLeft ? CHUNK_DATA : CHUNK_TRAILER;
+            return PARSE_MORE;
+        }
+        case CHUNK_DATA_END:
+            if (s.line[0]) return PARSE_ERROR;
+            s.chunk = CHUNK_SIZE;
+            return PARSE_MORE;
+        default:   // trailer
+            return s.line[0] ? PARSE_MORE : PARSE_DONE;
+        }
+    }
+
+    // Read what the connection has. Returns whether it completed the probe (out filled).
+    bool Read(uint32_t target, ProbeResult* out) {
+        Slot& s = m_slots[target];
+        for (;;) {
+            int got = (int)recv(s.socket, m_buffer, (int)sizeof(m_buffer), 0);
+            uint64_t now = MonoNowUs();
+            if (got > 0) {
+                if (s.phase == PHASE_IDLE) {   // nothing was asked: the connection is out of step
+                    CloseSlot(s);
+                    return false;
+                }
+                if (s.phase == PHASE_WAITING) {
+                    s.firstByteUs = now;
+                    s.phase = PHASE_READING;
+                }
+                Parse p = Consume(s, m_buffer, (uint32_t)got);
+                if (p == PARSE_MORE) continue;
+                if (p == PARSE_ERROR) {
+                    Fail(target, out);
+                    return true;
+                }
+                Respond(target, out);
+                return true;
+            }
+            if (got < 0 && WouldBlock()) return false;
+            // Closed or reset
+            if (s.phase == PHASE_IDLE) {
+                CloseSlot(s);   // the server ended an idle kept-alive connection
+                return false;
+            }
+            if (got == 0 && s.phase == PHASE_READING && !s.inHeaders && s.body == BODY_UNTIL_CLOSE) {
+                Respond(target, out);
+                return true;
+            }
+            if (s.reused && s.phase == PHASE_WAITING) {
+                // The server dropped the connection just as it was reused: once more, fresh
+                ++m_stats.retries;
+                if (Fresh(target)) return false;
+            }
+            Fail(target, out);
+            return true;
+        }
+    }
+
+    // A complete response: OK below 400. The connection stays open if the response allows it.
+    void Respond(uint32_t target, ProbeResult* out) {
+        Slot& s = m_slots[target];
+        ++m_stats.responses;
+        bool ok = s.status < 400;
+        if (!ok) ++m_stats.httpErrors;
+        bool keep = s.keepAlive;
+        Finish(target, ok ? PROBE_OK : PROBE_ERROR, out);
+        if (keep && s.socket != kNoSocket) {
+            Watch(s, target, false);   // readable while idle: the server closed it
+        } else {
+            CloseSlot(s);
+        }
+    }
+
+    // Errors leave the connection in an unknown state: it is closed
+    void Fail(uint32_t target, ProbeResult* out) {
+        ++m_stats.errors;
+        CloseSlot(m_slots[target]);
+        Finish(target, PROBE_ERROR, out);
+    }
+
+    // Record the phases, fill out and end the probe (the caller decides about the connection)
+    void Finish(uint32_t target, uint8_t status, ProbeResult* out) {
+        Slot& s = m_slots[target];
+        HttpPhases& p = s.last;
+        p.seq = s.seq;
+        p.reused = s.reused;
+        p.status = s.status;
+        p.dnsUs = s.dnsDoneUs ? ElapsedUs(s.startUs, s.dnsDoneUs) : kNoReply;
+        p.connectUs = s.connectedUs && s.connectStartUs ? ElapsedUs(s.connectStartUs, s.connectedUs) : kNoReply;
+        p.sendUs = s.sentUs ? ElapsedUs(s.connectedUs ? s.connectedUs : s.startUs, s.sentUs) : kNoReply;
+        p.firstByteUs = s.firstByteUs ? ElapsedUs(s.sentUs, s.firstByteUs) : kNoReply;
+        out->target = target;
+        out->seq = s.seq;
+        out->apiRttMs = kNoReply;
+        out->rttUs = status == PROBE_OK ? ElapsedUs(s.startUs, s.firstByteUs) : kNoReply;
+        out->status = status;
+        s.pending = false;
+        s.phase = PHASE_IDLE;
+    }
+
+    // Advance the slot after a socket event. Returns whether it completed the probe.
+    bool Drive(uint32_t target, ProbeResult* out) {
+        Slot& s = m_slots[target];
+        if (s.socket == kNoSocket) return false;
+        switch (s.phase) {
+        case PHASE_CONNECTING: {
+            int error = 0;
+            if (!ConnectDone(s, &error)) return false;
+            if (error == 0) {
+                s.connectedUs = MonoNowUs();
+                if (Request(target)) return false;
+            }
+            Fail(target, out);
+            return true;
+        }
+        case PHASE_SENDING:
+            if (WriteRequest(target)) return false;
+            if (s.reused && s.requestSent == 0) {
+                ++m_stats.retries;
+                if (Fresh(target)) return false;
+            }
+            Fail(target, out);
+            return true;
+        default:
+            return Read(target, out);
+        }
+    }
+
+    // A lookup answer from the resolver. Returns whether it completed a probe (failed lookup).
+    bool Resolved(const uint8_t* msg, uint32_t len, const struct sockaddr_storage& from, uint64_t now,
+                  ProbeResult* out) {
+        if (len < kDnsHeaderSize || !(msg[2] & 0x80) || !SameAddress(from, m_resolver)) return false;
+        uint16_t id = (uint16_t)(msg[0] << 8 | msg[1]);
+        uint32_t target = 0;
+        for (; target < MaxTargets; ++target) {
+            if (m_slots[target].phase == PHASE_RESOLVING && m_slots[target].dnsId == id) break;
+        }
+        if (target == MaxTargets) return false;   // late or foreign answer
+        Slot& s = m_slots[target];
+        uint8_t addr[16];
+        uint16_t qtype = s.wantIPv6 ? kDnsTypeAAAA : kDnsTypeA;
+        if ((msg[3] & 0x0f) == 0 && DnsAnswerAddress(msg, len, qtype, addr)) {
+            s.dnsDoneUs = now;
+            memset(&s.addr, 0, sizeof(s.addr));
+            if (s.wantIPv6) {
+                struct sockaddr_in6* a6 = (struct sockaddr_in6*)&s.addr;
+                a6->sin6_family = AF_INET6;
+                a6->sin6_port = htons(s.port);
+                memcpy(&a6->sin6_addr, addr, 16);
+                s.addrLen = sizeof(struct sockaddr_in6);
+            } else {
+                struct sockaddr_in* a4 = (struct sockaddr_in*)&s.addr;
+                a4->sin_family = AF_INET;
+                a4->sin_port = htons(s.port);
+                memcpy(&a4->sin_addr, addr, 4);
+                s.addrLen = sizeof(struct sockaddr_in);
+            }
+            s.isIPv6 = s.wantIPv6;
+            s.phase = PHASE_IDLE;
+            if (Connect(target, now)) return false;
+            ++m_stats.errors;
+            CloseSlot(s);
+        } else {
+            ++m_stats.dnsErrors;   // NXDOMAIN, SERVFAIL, or no address of that family
+        }
+        s.dnsDoneUs = now;
+        Finish(target, PROBE_ERROR, out);
+        return true;
+    }
+
+    static bool SameAddress(const struct sockaddr_storage& a, const struct sockaddr_storage& b) {
+        if (a.ss_family != b.ss_family) return false;
+        if (a.ss_family == AF_INET6) {
+            const struct sockaddr_in6* x = (const struct sockaddr_in6*)&a;
+            const struct sockaddr_in6* y = (const struct sockaddr_in6*)&b;
+            return x->sin6_port == y->sin6_port && memcmp(&x->sin6_addr, &y->sin6_addr, sizeof(x->sin6_addr)) == 0;
+        }
+        const struct sockaddr_in* x = (const struct sockaddr_in*)&a;
+        const struct sockaddr_in* y = (const struct sockaddr_in*)&b;
+        return x->sin_port == y->sin_port && x->sin_addr.s_addr == y->sin_addr.s_addr;
+    }
+
+    void Expire(uint32_t target, ProbeResult* out) {
+        Slot& s = m_slots[target];
+        if (s.deadlineUs) ++m_stats.timeouts;
+        CloseSlot(s);   // the response may still be on its way: start over next time
+        Finish(target, s.deadlineUs ? PROBE_TIMEOUT : PROBE_ERROR, out);
+    }
+
+    // Time out probes once now reaches their deadline
+    int ExpireDue(uint64_t now, ProbeResult* out, int maxResults) {
+        if (now < m_earliestUs) return 0;
+        int n = 0;
+        uint64_t next = ~0ull;
+        uint32_t i = 0;
+        for (; i < MaxTargets && n < maxResults; ++i) {
+            Slot& s = m_slots[i];
+            if (!s.pending) continue;
+            if (now < s.deadlineUs) {
+                if (s.deadlineUs < next) next = s.deadlineUs;
+                continue;
+            }
+            Expire(i, &out[n++]);
+        }
+        m_earliestUs = i < MaxTargets ? 0 : next;
+        return n;
+    }
+
+    void CloseSlot(Slot& s) {
+        if (s.socket == kNoSocket) return;
+#ifdef _WIN32
+        closesocket(s.socket);
+#else
+        close(s.socket);   // also leaves the epoll set
+#endif
+        s.socket = kNoSocket;
+    }
+
+#ifdef _WIN32
+    static const int kSendFlags = 0;
+
+    static bool InProgress() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+    static bool WouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+
+    bool Event() {
+        if (!m_event) {
+            m_event = CreateEventW(NULL, FALSE, FALSE, NULL);
+            if (!m_event) return false;
+            m_ownEvent = true;
+        }
+        return true;
+    }
+
+    // Non-blocking socket whose events all signal the shared event
+    bool Open(Slot& s, uint32_t target) {
+        (void)target;
+        CloseSlot(s);
+        if (!Event()) return false;
+        s.socket = socket(s.isIPv6 ? AF_INET6 : AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (s.socket == kNoSocket) return false;
+        if (WSAEventSelect(s.socket, m_event, FD_CONNECT | FD_READ | FD_WRITE | FD_CLOSE) != 0) {
+            CloseSlot(s);
+            return false;
+        }
+        BOOL on = TRUE;
+        setsockopt(s.socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&on, sizeof(on));
+        return true;
+    }
+
+    Socket OpenResolver() {
+        if (m_resolverSocket != kNoSocket) return m_resolverSocket;
+        if (!Event()) return kNoSocket;
+        m_resolverSocket = socket(m_resolver.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+        if (m_resolverSocket == kNoSocket) return kNoSocket;
+        if (WSAEventSelect(m_resolverSocket, m_event, FD_READ) != 0) {
+            closesocket(m_resolverSocket);
+            m_resolverSocket = kNoSocket;
+        }
+        return m_resolverSocket;
+    }
+
+    // Every socket operation is retried on the next Collect, so there is nothing to change
+    void Watch(Slot&, uint32_t, bool) {}
+
+    bool ConnectDone(Slot& s, int* error) {
+        WSANETWORKEVENTS ne;
+        if (WSAEnumNetworkEvents(s.socket, NULL, &ne) != 0 || !(ne.lNetworkEvents & FD_CONNECT)) return false;
+        *error = ne.iErrorCode[FD_CONNECT_BIT];
+        return true;
+    }
+
+    void Wait(uint32_t waitMs) {
+        if (m_event) {
+            WaitForSingleObject(m_event, waitMs);
+        } else if (waitMs) {
+            Sleep(waitMs);
+        }
+    }
+
+    // Lookup answers, then every slot with a socket (the shared event only says that something
+    // happened; a non-blocking call that has nothing to do costs little), then timeouts
+    int Collect(ProbeResult* out, int maxResults) {
+        int n = 0;
+        while (m_resolverSocket != kNoSocket && n < maxResults) {
+            struct sockaddr_storage from;
+            int fromLen = sizeof(from);
+            int len = recvfrom(m_resolverSocket, m_buffer, kDnsMaxResponse, 0, (struct sockaddr*)&from, &fromLen);
+            if (len < 0) {
+                if (WSAGetLastError() == WSAEWOULDBLOCK) break;
+                continue;
+            }
+            if (Resolved((const uint8_t*)m_buffer, (uint32_t)len, from, MonoNowUs(), &out[n])) ++n;
+        }
+        for (uint32_t i = 0; i < MaxTargets && n < maxResults; ++i) {
+            if (m_slots[i].socket != kNoSocket && Drive(i, &out[n])) ++n;
+        }
+        return n + ExpireDue(MonoNowUs(), out + n, maxResults - n);
+    }
+#else
+    static const int kSendFlags = MSG_NOSIGNAL;   // a reset connection must not raise SIGPIPE
+
+    static bool InProgress() { return errno == EINPROGRESS || errno == EINTR; }
+    static bool WouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+
+    int Epoll() {
+        if (m_epoll < 0) m_epoll = epoll_create1(EPOLL_CLOEXEC);
+        return m_epoll;
+    }
+
+    bool Open(Slot& s, uint32_t target) {
+        CloseSlot(s);
+        if (Epoll() < 0) return false;
+        s.socket = socket(s.isIPv6 ? AF_INET6 : AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+        if (s.socket == kNoSocket) return false;
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLOUT;
+        ev.data.u64 = target;
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, s.socket, &ev) != 0) {
+            CloseSlot(s);
+            return false;
+        }
+        int on = 1;
+        setsockopt(s.socket, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        return true;
+    }
+
+    Socket OpenResolver() {
+        if (m_resolverSocket != kNoSocket) return m_resolverSocket;
+        if (Epoll() < 0) return kNoSocket;
+        m_resolverSocket = socket(m_resolver.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+        if (m_resolverSocket == kNoSocket) return kNoSocket;
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u64 = kResolverMarker;
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_resolverSocket, &ev) != 0) {
+            close(m_resolverSocket);
+            m_resolverSocket = kNoSocket;
+        }
+        return m_resolverSocket;
+    }
+
+    // Writable while connecting or sending, readable otherwise
+    void Watch(Slot& s, uint32_t target, bool writable) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = writable ? EPOLLOUT : EPOLLIN;
+        ev.data.u64 = target;
+        epoll_ctl(m_epoll, EPOLL_CTL_MOD, s.socket, &ev);
+    }
+
+    bool ConnectDone(Slot& s, int* error) {
+        socklen_t len = sizeof(*error);
+        if (getsockopt(s.socket, SOL_SOCKET, SO_ERROR, error, &len) != 0) *error = errno;
+        return true;   // only called once epoll reported the socket writable
+    }
+
+    void Wait(uint32_t waitMs) {
+        struct epoll_event ev;
+        if (m_epoll >= 0) {
+            // Only waits; Collect reads the events
+            int rc = epoll_wait(m_epoll, &ev, 1, (int)waitMs);
+            (void)rc;
+        } else if (waitMs) {
+            usleep((useconds_t)waitMs * 1000);
+        }
+    }
+
+    int Collect(ProbeResult* out, int maxResults) {
+        int n = 0;
+        if (m_epoll >= 0) {
+            struct epoll_event events[64];
+            while (n < maxResults) {
+                int got = epoll_wait(m_epoll, events, 64, 0);
+                if (got <= 0) break;
+                int handled = 0;
+                for (int k = 0; k < got && n < maxResults; ++k) {
+                    uint64_t data = events[k].data.u64;
+                    if (data == kWakeMarker) continue;
+                    ++handled;
+                    if (data == kResolverMarker) {
+                        n += DrainResolver(out + n, maxResults - n);
+                    } else if (data < MaxTargets && Drive((uint32_t)data, &out[n])) {
+                        ++n;
+                    }
+                }
+                // Level-triggered: whatever was not finished is reported again next time
+                if (got < 64 || !handled) break;
+            }
+        }
+        return n + ExpireDue(MonoNowUs(), out + n, maxResults - n);
+    }
+
+    int DrainResolver(ProbeResult* out, int maxResults) {
+        int n = 0;
+        while (n < maxResults) {
+            struct sockaddr_storage from;
+            socklen_t fromLen = sizeof(from);
+            ssize_t len = recvfrom(m_resolverSocket, m_buffer, kDnsMaxResponse, 0, (struct sockaddr*)&from, &fromLen);
+            if (len < 0) break;
+            if (Resolved((const uint8_t*)m_buffer, (uint32_t)len, from, MonoNowUs(), &out[n])) ++n;
+        }
+        return n;
+    }
+#endif
+
+#ifdef _WIN32
+    HANDLE m_event;
+    bool m_ownEvent;
+#else
+    int m_epoll;
+    int m_wakeFd;
+#endif
+    Socket m_resolverSocket;
+    struct sockaddr_storage m_resolver;
+    socklen_t m_resolverLen;
+    uint64_t m_earliestUs;   // no pending deadline before this (0: scan on the next Collect)
+    uint32_t m_rng;
+    char m_buffer[kReceiveBuffer];
+    Slot m_slots[MaxTargets];
+    HttpProbeStats m_stats;
+};
+
+} // namespace lt
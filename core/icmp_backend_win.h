@@ -0,0 +1,278 @@
+// core/icmp_backend_win.h
+// ProbeBackend over iphlpapi's asynchronous IcmpSendEcho2 / Icmp6SendEcho2.
+// Every target slot owns an event, a reply buffer and its pre-parsed destination; completions
+// are collected with a single WaitForMultipleObjects, so all targets are in flight at once.
+// One ICMP handle per address family lives for the whole run and is only rebuilt when the
+// API reports it invalid, so the steady state does no per-probe handle churn.
+// RTTs are timed with QueryPerformanceCounter from issue to wake-up; RoundTripTime (whole
+// milliseconds) is passed along as apiRttMs for comparison.
+#pragma once
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>        // MUST be before windows.h
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <iphlpapi.h>
+#include <icmpapi.h>
+#include <string.h>
+#include <stdlib.h>
+#include "probe_backend.h"
+#include "mono_clock.h"
+
+namespace lt {
+
+// Handle pool counters (read from the worker thread, e.g. for a benchmark or debug tooltip)
+struct IcmpBackendStats {
+    uint32_t handleCreates;       // IcmpCreateFile/Icmp6CreateFile calls, including the first two
+    uint32_t handleRecreations;   // handles thrown away after the API reported them invalid
+    uint64_t probes;              // echoes issued
+    uint64_t setupTicks;          // QueryPerformanceCounter ticks spent issuing echoes
+    uint64_t maxSetupTicks;
+    uint64_t tickFrequency;       // QueryPerformanceFrequency, for converting the above
+};
+
+template <uint32_t MaxTargets>
+class IcmpBackend : public ProbeBackend {
+    static_assert(MaxTargets < MAXIMUM_WAIT_OBJECTS, "one wait handle per target slot plus the wake event");
+
+public:
+    IcmpBackend() : m_icmp4(NULL), m_icmp6(NULL), m_wake(NULL) {
+        ZeroMemory(m_slots, sizeof(m_slots));
+        ZeroMemory(&m_stats, sizeof(m_stats));
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        m_stats.tickFrequency = (uint64_t)f.QuadPart;
+    }
+
+    ~IcmpBackend() {
+        // Closing the ICMP handles cancels outstanding requests
+        if (m_icmp4) IcmpCloseHandle(m_icmp4);
+        if (m_icmp6) IcmpCloseHandle(m_icmp6);
+        for (uint32_t i = 0; i < MaxTargets; ++i) {
+            if (m_slots[i].event) CloseHandle(m_slots[i].event);
+        }
+    }
+
+    const IcmpBackendStats& Stats() const { return m_stats; }
+
+    // Event that cuts a Poll wait short (exit, selection change). Not owned by the backend.
+    void SetWakeEvent(HANDLE wake) { m_wake = wake; }
+
+    // Average cost of issuing one echo in nanoseconds (0 before the first probe)
+    uint64_t AverageSetupNs() const {
+        if (!m_stats.probes || !m_stats.tickFrequency) return 0;
+        return m_stats.setupTicks * 1000000000ull / m_stats.tickFrequency / m_stats.probes;
+    }
+
+    // Link-local next hops carry their interface: "fe80::1%12"
+    bool SetTarget(uint32_t target, const char* ip, bool isIPv6) override {
+        (void)isIPv6;   // the address says which family it is
+        return SetTargetAddress(target, ResolveIpAddress(ip));
+    }
+
+    bool SetTargetAddress(uint32_t target, const IpAddress& address) override {
+        if (target >= MaxTargets) return false;
+        Slot& s = m_slots[target];
+        // An echo in flight cannot be called back: it completes (from the old address) as usual
+        s.bound = false;
+        if (address.IsIPv6()) {
+            ZeroMemory(&s.dest6, sizeof(s.dest6));
+            s.dest6.sin6_family = AF_INET6;
+            memcpy(&s.dest6.sin6_addr, address.bytes, 16);
+            s.dest6.sin6_scope_id = address.scope;
+        } else if (address.Valid()) {
+            memcpy(&s.dest4, address.bytes, 4); // network order
+        } else {
+            return false;
+        }
+        s.isIPv6 = address.IsIPv6();
+        s.bound = true;
+        return true;
+    }
+
+    bool Send(uint32_t target, uint32_t seq, uint32_t timeoutMs) override {
+        if (target >= MaxTargets) return false;
+        Slot& s = m_slots[target];
+        if (!s.bound || s.pending) return false;
+        if (!s.event) {
+            s.event = CreateEventW(NULL, TRUE, FALSE, NULL); // manual reset, polled in Poll
+            if (!s.event) return false;
+        }
+        ResetEvent(s.event);
+
+        LARGE_INTEGER t0, t1;
+        QueryPerformanceCounter(&t0);
+        DWORD ret = 0;
+        DWORD err = ERROR_INVALID_HANDLE;
+        // Second attempt only happens after the pooled handle was reported invalid and rebuilt
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            HANDLE icmp = AcquireHandle(s.isIPv6);
+            if (!icmp) break;
+            ret = Issue(s, icmp, timeoutMs);
+            err = ret ? ERROR_SUCCESS : GetLastError();
+            if (ret != 0 || err == ERROR_IO_PENDING) break;
+            if (err != ERROR_INVALID_HANDLE) break;
+            RecreateHandle(s.isIPv6);
+        }
+        QueryPerformanceCounter(&t1);
+
+        if (ret == 0 && err != ERROR_IO_PENDING) return false;
+        // Completed synchronously: make sure Poll still sees it
+        s.sentUs = TicksToUs((uint64_t)t0.QuadPart);
+        s.doneUs = ret != 0 ? TicksToUs((uint64_t)t1.QuadPart) : 0;
+        if (ret != 0) SetEvent(s.event);
+
+        uint64_t ticks = (uint64_t)(t1.QuadPart - t0.QuadPart);
+        ++m_stats.probes;
+        m_stats.setupTicks += ticks;
+        if (ticks > m_stats.maxSetupTicks) m_stats.maxSetupTicks = ticks;
+
+        s.pending = true;
+        s.cancelled = false;
+        s.seq = seq;
+        return true;
+    }
+
+    int Poll(ProbeResult* out, int maxResults, uint32_t waitMs) override {
+        HANDLE handles[MaxTargets + 1];
+        uint32_t slotOf[MaxTargets];
+        DWORD count = 0;
+        for (uint32_t i = 0; i < MaxTargets; ++i) {
+            if (m_slots[i].pending) {
+                handles[count] = m_slots[i].event;
+                slotOf[count] = i;
+                ++count;
+            }
+        }
+        // The wake event goes last so ready echoes win when both are signalled
+        DWORD total = count;
+        if (m_wake) handles[total++] = m_wake;
+        if (total == 0) {
+            if (waitMs) Sleep(waitMs);
+            return 0;
+        }
+        DWORD w = WaitForMultipleObjects(total, handles, FALSE, waitMs);
+        if (w == WAIT_TIMEOUT || w == WAIT_FAILED) return 0;
+        if (w == WAIT_OBJECT_0 + count) return 0;   // woken on purpose
+        // Completion time is when the wait released us (echo APIs give no receive timestamp)
+        uint64_t wokeUs = MonoNowUs();
+
+        // Harvest everything that is ready, not just the first signalled handle
+        int n = 0;
+        for (DWORD k = 0; k < count && n < maxResults; ++k) {
+            if (WaitForSingleObject(handles[k], 0) != WAIT_OBJECT_0) continue;
+            out[n++] = Complete(slotOf[k], wokeUs);
+        }
+        return n;
+    }
+
+    uint64_t NowMs() override { return GetTickCount64(); }
+
+private:
+    struct Slot {
+        bool bound;
+        bool isIPv6;
+        bool pending;
+        bool cancelled;   // outstanding on a handle that has since been closed
+        uint32_t seq;
+        uint64_t sentUs;   // MonoNowUs() clock
+        uint64_t doneUs;   // set when the echo completed inside Send
+        IPAddr dest4;
+        struct sockaddr_in6 dest6;
+        HANDLE event;
+        // Async replies also carry an IO_STATUS_BLOCK, so leave generous room
+        BYTE reply[sizeof(ICMPV6_ECHO_REPLY) + sizeof(ICMP_ECHO_REPLY) + 128];
+    };
+
+    HANDLE AcquireHandle(bool isIPv6) {
+        HANDLE& h = isIPv6 ? m_icmp6 : m_icmp4;
+        if (!h) {
+            HANDLE created = isIPv6 ? Icmp6CreateFile() : IcmpCreateFile();
+            ++m_stats.handleCreates;
+            if (created == INVALID_HANDLE_VALUE) return NULL;
+            h = created;
+        }
+        return h;
+    }
+
+    // Drop a handle the API rejected. Requests still outstanding on it are cancelled by the
+    // close and may never signal, so complete them here as errors.
+    void RecreateHandle(bool isIPv6) {
+        HANDLE& h = isIPv6 ? m_icmp6 : m_icmp4;
+        if (!h) return;
+        IcmpCloseHandle(h);
+        h = NULL;
+        ++m_stats.handleRecreations;
+        for (uint32_t i = 0; i < MaxTargets; ++i) {
+            Slot& s = m_slots[i];
+            if (s.pending && s.isIPv6 == isIPv6) {
+                s.cancelled = true;
+                SetEvent(s.event);
+            }
+        }
+    }
+
+    DWORD Issue(Slot& s, HANDLE icmp, uint32_t timeoutMs) {
+        static unsigned char sendData[8] = {0x50,0x49,0x4E,0x47,0x2D,0x54,0x45,0x53}; // "PING-TES" arbitrary payload
+        if (s.isIPv6) {
+            // Use IN6ADDR_ANY_INIT for source (let system choose)
+            struct sockaddr_in6 source;
+            ZeroMemory(&source, sizeof(source));
+            source.sin6_family = AF_INET6;
+            source.sin6_addr = in6addr_any;
+            return Icmp6SendEcho2(icmp, s.event, NULL, NULL, &source, &s.dest6,
+                                  sendData, sizeof(sendData), NULL,
+                                  s.reply, sizeof(s.reply), timeoutMs);
+        }
+        return IcmpSendEcho2(icmp, s.event, NULL, NULL, s.dest4,
+                             sendData, sizeof(sendData), NULL,
+                             s.reply, sizeof(s.reply), timeoutMs);
+    }
+
+    ProbeResult Complete(uint32_t target, uint64_t wokeUs) {
+        Slot& s = m_slots[target];
+        ProbeResult r = {target, s.seq, kNoReply, kNoReply, PROBE_ERROR};
+        s.pending = false;
+        ResetEvent(s.event);
+        if (s.cancelled) return r;
+        DWORD replies;
+        ULONG status;
+        ULONG rtt;
+        if (s.isIPv6) {
+            replies = Icmp6ParseReplies(s.reply, sizeof(s.reply));
+            PICMPV6_ECHO_REPLY pReply = (PICMPV6_ECHO_REPLY)s.reply;
+            status = pReply->Status;
+            rtt = pReply->RoundTripTime;
+        } else {
+            replies = IcmpParseReplies(s.reply, sizeof(s.reply));
+            PICMP_ECHO_REPLY pReply = (PICMP_ECHO_REPLY)s.reply;
+            status = pReply->Status;
+            rtt = pReply->RoundTripTime;
+        }
+        if (replies == 0) {
+            status = GetLastError();
+        }
+        if (replies != 0 && status == IP_SUCCESS) {
+            r.rttUs = ElapsedUs(s.sentUs, s.doneUs ? s.doneUs : wokeUs);
+            r.apiRttMs = rtt;
+            r.status = PROBE_OK;
+        } else if (status == IP_REQ_TIMED_OUT) {
+            r.status = PROBE_TIMEOUT;
+        }
+        return r;
+    }
+
+    HANDLE m_icmp4;   // pooled for the lifetime of the backend
+    HANDLE m_icmp6;
+    HANDLE m_wake;
+    IcmpBackendStats m_stats;
+    Slot m_slots[MaxTargets];
+};
+
+} // namespace lt
+
+#endif // _WIN32
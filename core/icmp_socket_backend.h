@@ -0,0 +1,444 @@
+// core/icmp_socket_backend.h
+// ProbeBackend over unprivileged ICMP datagram sockets (Linux "ping sockets": SOCK_DGRAM with
+// IPPROTO_ICMP / IPPROTO_ICMPV6, allowed for the groups in net.ipv4.ping_group_range). One
+// socket per address family carries every target; the kernel fills the echo identifier and
+// checksum and only delivers replies to our own echoes. The payload carries the slot, the
+// engine sequence and a magic value, so a reply is matched without per-probe lookups (the
+// header sequence must agree with the payload too).
+// Echoes are batched: Send only queues the packet, and the queue goes out with one sendmmsg
+// when it reaches the batch size or when Poll runs (the engine polls right after each round
+// of sends). Replies come back the same way, up to a batch per recvmmsg, so one thread keeps
+// thousands of echoes in flight at a few system calls per batch. A batch's send time is
+// spread across the sendmmsg call by position, since the kernel sends its messages in order.
+// ICMP errors (unreachable, TTL exceeded) arrive on the socket error queue (IP_RECVERR) and
+// complete the probe as PROBE_ERROR. Receive times come from the kernel (SO_TIMESTAMPNS).
+#pragma once
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/ip_icmp.h>
+#include <netinet/icmp6.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <linux/errqueue.h>
+#include "probe_backend.h"
+#include "mono_clock.h"
+
+namespace lt {
+
+struct IcmpSocketStats {
+    uint64_t sent;
+    uint64_t replies;        // matched to an outstanding echo
+    uint64_t errors;         // ICMP errors and failed sends
+    uint64_t timeouts;
+    uint64_t stale;          // replies for echoes that had already timed out or been replaced
+    uint64_t sendCalls;      // sendmmsg calls
+    uint64_t receiveCalls;   // recvmmsg/recvmsg calls that returned at least one datagram
+};
+
+template <uint32_t MaxTargets, uint32_t Batch = 64>
+class IcmpSocketBackend : public ProbeBackend {
+    static_assert(Batch >= 1 && Batch <= 1024, "sendmmsg/recvmmsg take at most UIO_MAXIOV messages");
+
+public:
+    static const uint32_t kPayloadMagic = 0x4C545031;   // "LTP1"
+    // Requested receive buffer per socket; the kernel caps it at net.core.rmem_max. Replies to
+    // a large batch arrive together and must not overflow it.
+    static const int kReceiveBuffer = 4 * 1024 * 1024;
+
+    IcmpSocketBackend() : m_wakeFd(-1), m_batch(Batch), m_earliestUs(~0ull) {
+        memset(m_family, 0, sizeof(m_family));
+        m_family[0].fd = -1;
+        m_family[1].fd = -1;
+        memset(m_slots, 0, sizeof(m_slots));
+        memset(&m_stats, 0, sizeof(m_stats));
+    }
+
+    ~IcmpSocketBackend() {
+        if (m_family[0].fd >= 0) close(m_family[0].fd);
+        if (m_family[1].fd >= 0) close(m_family[1].fd);
+    }
+
+    // Extra descriptor that ends a Poll wait when readable (route changes). Not owned.
+    void SetWakeFd(int fd) { m_wakeFd = fd; }
+
+    // Datagrams per sendmmsg/recvmmsg, 1..Batch (1: one system call per echo and per reply)
+    void SetBatch(uint32_t n) { m_batch = n < 1 ? 1 : (n > Batch ? Batch : n); }
+
+    // Whether ICMP datagram sockets can be created for the family (false: not permitted by
+    // net.ipv4.ping_group_range, or no IPv6)
+    bool Available(bool isIPv6) { return Socket(isIPv6) >= 0; }
+
+    const IcmpSocketStats& Stats() const { return m_stats; }
+
+    // Link-local next hops carry their interface: "fe80::1%eth0" or "fe80::1%2"
+    bool SetTarget(uint32_t target, const char* ip, bool isIPv6) override {
+        (void)isIPv6;   // the address says which family it is
+        return SetTargetAddress(target, ResolveIpAddress(ip));
+    }
+
+    bool SetTargetAddress(uint32_t target, const IpAddress& address) override {
+        if (target >= MaxTargets) return false;
+        Slot& s = m_slots[target];
+        // A queued echo still points at the old address: let it go rather than re-queue the slot
+        if (s.queued) Flush();
+        if (s.pending) {
+            // Its reply would come from the old address and not match: fail it at the next Collect
+            s.failed = true;
+            s.deadlineUs = 0;
+            m_earliestUs = 0;
+        }
+        s.bound = false;
+        memset(&s.addr, 0, sizeof(s.addr));
+        if (address.IsIPv6()) {
+            struct sockaddr_in6* a6 = (struct sockaddr_in6*)&s.addr;
+            memcpy(&a6->sin6_addr, address.bytes, 16);
+            a6->sin6_family = AF_INET6;
+            a6->sin6_scope_id = address.scope;
+            s.addrLen = sizeof(struct sockaddr_in6);
+        } else if (address.Valid()) {
+            struct sockaddr_in* a4 = (struct sockaddr_in*)&s.addr;
+            memcpy(&a4->sin_addr, address.bytes, 4);
+            a4->sin_family = AF_INET;
+            s.addrLen = sizeof(struct sockaddr_in);
+        } else {
+            return false;
+        }
+        s.isIPv6 = address.IsIPv6();
+        s.bound = true;
+        return true;
+    }
+
+    // Queues the echo; it goes out with the next full batch or at the next Poll/Flush. A send
+    // that fails then is reported by Poll as PROBE_ERROR.
+    bool Send(uint32_t target, uint32_t seq, uint32_t timeoutMs) override {
+        if (target >= MaxTargets) return false;
+        Slot& s = m_slots[target];
+        if (!s.bound || s.pending) return false;
+        if (Socket(s.isIPv6) < 0) return false;
+
+        EchoPacket& pkt = s.packet;
+        memset(&pkt, 0, sizeof(pkt));
+        pkt.type = s.isIPv6 ? ICMP6_ECHO_REQUEST : ICMP_ECHO;
+        pkt.sequence = htons((uint16_t)seq);
+        pkt.magic = kPayloadMagic;
+        pkt.target = target;
+        pkt.seq = seq;
+
+        s.seq = seq;
+        s.timeoutMs = timeoutMs;
+        s.deadlineUs = ~0ull;   // set when it is actually sent
+        s.pending = true;
+        s.queued = true;
+        s.failed = false;
+        Family& f = m_family[s.isIPv6 ? 1 : 0];
+        f.queue[f.queued++] = target;
+        if (f.queued >= m_batch) Transmit(s.isIPv6);
+        return true;
+    }
+
+    // Put every queued echo on the wire now
+    void Flush() {
+        if (m_family[0].queued) Transmit(false);
+        if (m_family[1].queued) Transmit(true);
+    }
+
+    int Poll(ProbeResult* out, int maxResults, uint32_t waitMs) override {
+        Flush();
+        int n = Collect(out, maxResults);
+        if (n == 0 && waitMs > 0) {
+            // Sleep until a datagram, an error, a wake-up or the earliest probe deadline
+            uint64_t now = MonoNowUs();
+            uint64_t earliest = now + (uint64_t)waitMs * 1000;
+            if (m_earliestUs < earliest) earliest = m_earliestUs;
+            int timeout = earliest > now ? (int)((earliest - now + 999) / 1000) : 0;
+            struct pollfd fds[3];
+            int nfds = 0;
+            if (m_family[0].fd >= 0) fds[nfds++] = {m_family[0].fd, POLLIN, 0};
+            if (m_family[1].fd >= 0) fds[nfds++] = {m_family[1].fd, POLLIN, 0};
+            if (m_wakeFd >= 0) fds[nfds++] = {m_wakeFd, POLLIN, 0};
+            if (nfds) {
+                poll(fds, (nfds_t)nfds, timeout);
+            } else if (timeout > 0) {
+                usleep((useconds_t)timeout * 1000);
+            }
+            n = Collect(out, maxResults);
+        }
+        return n;
+    }
+
+    uint64_t NowMs() override { return MonoNowUs() / 1000; }
+
+private:
+    // ICMP/ICMPv6 echo header (same layout for both) followed by our payload
+    struct EchoPacket {
+        uint8_t type;
+        uint8_t code;
+        uint16_t checksum;     // filled by the kernel
+        uint16_t identifier;   // replaced by the kernel with the socket's port
+        uint16_t sequence;
+        uint32_t magic;
+        uint32_t target;
+        uint32_t seq;
+        uint32_t reserved;
+    };
+
+    struct Slot {
+        bool bound;
+        bool isIPv6;
+        bool pending;    // echo outstanding (queued or on the wire)
+        bool queued;     // waiting in the family's send queue
+        bool failed;     // the send failed; reported as PROBE_ERROR by the next Collect
+        uint32_t seq;
+        uint32_t timeoutMs;
+        uint64_t sentUs;
+        uint64_t deadlineUs;
+        struct sockaddr_storage addr;
+        socklen_t addrLen;
+        EchoPacket packet;
+    };
+
+    // Per address family: the socket, echoes waiting for the next sendmmsg, and the message
+    // arrays both directions use
+    struct Family {
+        int fd;
+        uint32_t queued;
+        uint32_t queue[Batch];
+        uint32_t sending[Batch];
+        struct mmsghdr sendMsgs[Batch];
+        struct iovec sendIov[Batch];
+        struct mmsghdr recvMsgs[Batch];
+        struct iovec recvIov[Batch];
+        EchoPacket recvPackets[Batch];
+        struct sockaddr_storage recvFrom[Batch];
+        char recvControl[Batch][64];   // SCM_TIMESTAMPNS
+    };
+
+    int Socket(bool isIPv6) {
+        int& fd = m_family[isIPv6 ? 1 : 0].fd;
+        if (fd >= 0) return fd;
+        fd = socket(isIPv6 ? AF_INET6 : AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    isIPv6 ? (int)IPPROTO_ICMPV6 : (int)IPPROTO_ICMP);
+        if (fd < 0) return -1;
+        EnableRxTimestamps(fd);
+        int on = 1;
+        if (isIPv6) {
+            setsockopt(fd, IPPROTO_IPV6, IPV6_RECVERR, &on, sizeof(on));
+        } else {
+            setsockopt(fd, IPPROTO_IP, IP_RECVERR, &on, sizeof(on));
+        }
+        int size = kReceiveBuffer;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        return fd;
+    }
+
+    // Send the family's queue with as few sendmmsg calls as the kernel allows. A message the
+    // kernel refuses fails only its own slot; the rest of the batch is retried after it.
+    void Transmit(bool isIPv6) {
+        Family& f = m_family[isIPv6 ? 1 : 0];
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < f.queued; ++i) {
+            Slot& s = m_slots[f.queue[i]];
+            if (!s.queued) continue;   // re-bound since it was queued
+            f.sendIov[count].iov_base = &s.packet;
+            f.sendIov[count].iov_len = sizeof(s.packet);
+            struct msghdr& h = f.sendMsgs[count].msg_hdr;
+            memset(&h, 0, sizeof(h));
+            h.msg_name = &s.addr;
+            h.msg_namelen = s.addrLen;
+            h.msg_iov = &f.sendIov[count];
+            h.msg_iovlen = 1;
+            f.sending[count++] = f.queue[i];
+        }
+        f.queued = 0;
+
+        uint32_t done = 0;
+        while (done < count) {
+            uint64_t begin = MonoNowUs();
+            int sent = sendmmsg(f.fd, f.sendMsgs + done, count - done, 0);
+            uint64_t end = MonoNowUs();
+            ++m_stats.sendCalls;
+            if (sent <= 0) {
+                if (sent < 0 && errno == EINTR) continue;
+                // The first remaining message was refused (no route, buffer full...)
+                Slot& s = m_slots[f.sending[done++]];
+                s.queued = false;
+                s.failed = true;
+                s.deadlineUs = 0;
+                m_earliestUs = 0;
+                ++m_stats.errors;
+                continue;
+            }
+            for (int k = 0; k < sent; ++k) {
+                Slot& s = m_slots[f.sending[done + k]];
+                s.queued = false;
+                s.sentUs = begin + (end - begin) * (uint64_t)k / (uint64_t)sent;
+                s.deadlineUs = s.sentUs + (uint64_t)s.timeoutMs * 1000;
+                if (s.deadlineUs < m_earliestUs) m_earliestUs = s.deadlineUs;
+            }
+            m_stats.sent += (uint64_t)sent;
+            done += (uint32_t)sent;
+        }
+    }
+
+    // Everything that is ready now: errors, replies, then failed and expired probes
+    int Collect(ProbeResult* out, int maxResults) {
+        int n = 0;
+        if (m_family[0].fd >= 0) n += Drain(false, out + n, maxResults - n);
+        if (m_family[1].fd >= 0) n += Drain(true, out + n, maxResults - n);
+        uint64_t now = MonoNowUs();
+        if (now < m_earliestUs) return n;
+        // Something may have expired: scan, and work out the next deadline on the way
+        uint64_t next = ~0ull;
+        uint32_t i = 0;
+        for (; i < MaxTargets && n < maxResults; ++i) {
+            Slot& s = m_slots[i];
+            if (!s.pending || s.queued) continue;
+            if (now < s.deadlineUs) {
+                if (s.deadlineUs < next) next = s.deadlineUs;
+                continue;
+            }
+            s.pending = false;
+            ProbeResult& r = out[n++];
+            r.target = i;
+            r.seq = s.seq;
+            r.rttUs = kNoReply;
+            r.apiRttMs = kNoReply;
+            if (s.failed) {
+                r.status = PROBE_ERROR;
+            } else {
+                ++m_stats.timeouts;
+                r.status = PROBE_TIMEOUT;
+            }
+        }
+        m_earliestUs = i < MaxTargets ? 0 : next;   // out[] full before the end: rescan next time
+        return n;
+    }
+
+    int Drain(bool isIPv6, ProbeResult* out, int maxResults) {
+        Family& f = m_family[isIPv6 ? 1 : 0];
+        int n = 0;
+        // ICMP errors are rare: one look at the error queue per drain
+        while (n < maxResults && ReceiveError(f.fd, isIPv6, &out[n])) {
+            if (out[n].target != kNoReply) ++n;
+        }
+        while (n < maxResults) {
+            uint32_t want = (uint32_t)(maxResults - n) < m_batch ? (uint32_t)(maxResults - n) : m_batch;
+            for (uint32_t k = 0; k < want; ++k) {
+                f.recvIov[k].iov_base = &f.recvPackets[k];
+                f.recvIov[k].iov_len = sizeof(EchoPacket);
+                struct msghdr& h = f.recvMsgs[k].msg_hdr;
+                h.msg_name = &f.recvFrom[k];
+                h.msg_namelen = sizeof(f.recvFrom[k]);
+                h.msg_iov = &f.recvIov[k];
+                h.msg_iovlen = 1;
+                h.msg_control = f.recvControl[k];
+                h.msg_controllen = sizeof(f.recvControl[k]);
+                h.msg_flags = 0;
+            }
+            int got = recvmmsg(f.fd, f.recvMsgs, want, MSG_DONTWAIT, nullptr);
+            if (got <= 0) break;
+            ++m_stats.receiveCalls;
+            // One clock pair converts every kernel stamp of the batch
+            uint64_t nowMono = MonoNowUs();
+            uint64_t nowReal = RealtimeNowUs();
+            for (int k = 0; k < got; ++k) {
+                uint64_t rxReal;
+                uint64_t rxUs = RxRealtimeUs(&f.recvMsgs[k].msg_hdr, &rxReal) ? RealtimeToMonoUs(rxReal, nowMono, nowReal)
+                                                                              : nowMono;
+                if (Complete(f.recvPackets[k], f.recvMsgs[k].msg_len, f.recvFrom[k], isIPv6, false, rxUs, &out[n])) ++n;
+            }
+            if ((uint32_t)got < want) break;
+        }
+        return n;
+    }
+
+    // One queued ICMP error. Returns false when there is none; out->target is kNoReply when
+    // it completes nothing.
+    bool ReceiveError(int fd, bool isIPv6, ProbeResult* out) {
+        EchoPacket pkt;
+        struct sockaddr_storage from;
+        char control[512];
+        struct iovec iov = {&pkt, sizeof(pkt)};
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &from;
+        msg.msg_namelen = sizeof(from);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t len = recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT);
+        if (len < 0) return false;
+        ++m_stats.receiveCalls;
+        out->target = kNoReply;
+        Complete(pkt, (uint32_t)len, from, isIPv6, true, 0, out);
+        return true;
+    }
+
+    // Match a reply (or, for errors, our returned request) to its slot and fill out.
+    // Returns whether it completed an outstanding echo.
+    bool Complete(const EchoPacket& pkt, uint32_t len, const struct sockaddr_storage& from, bool isIPv6, bool error,
+                  uint64_t rxUs, ProbeResult* out) {
+        uint8_t expected = error ? (isIPv6 ? ICMP6_ECHO_REQUEST : ICMP_ECHO) : (isIPv6 ? ICMP6_ECHO_REPLY : ICMP_ECHOREPLY);
+        if (len < sizeof(pkt) || pkt.type != expected || pkt.magic != kPayloadMagic || pkt.target >= MaxTargets ||
+            pkt.sequence != htons((uint16_t)pkt.seq)) {
+            return false;
+        }
+        Slot& s = m_slots[pkt.target];
+        if (!s.pending || s.queued || s.seq != pkt.seq || (!error && !SameAddress(s, from))) {
+            ++m_stats.stale;
+            if (error || !SameAddress(s, from)) return false;
+            // The target answered an echo that was already completed: late or duplicate
+            out->target = pkt.target;
+            out->seq = pkt.seq;
+            out->rttUs = kNoReply;
+            out->apiRttMs = kNoReply;
+            out->status = PROBE_LATE;
+            return true;
+        }
+        s.pending = false;
+        out->target = pkt.target;
+        out->seq = pkt.seq;
+        out->apiRttMs = kNoReply;
+        if (error) {
+            ++m_stats.errors;
+            out->rttUs = kNoReply;
+            out->status = PROBE_ERROR;
+        } else {
+            ++m_stats.replies;
+            out->rttUs = ElapsedUs(s.sentUs, rxUs);
+            out->status = PROBE_OK;
+        }
+        return true;
+    }
+
+    static bool SameAddress(const Slot& s, const struct sockaddr_storage& from) {
+        if (s.isIPv6) {
+            const struct sockaddr_in6* a = (const struct sockaddr_in6*)&s.addr;
+            const struct sockaddr_in6* b = (const struct sockaddr_in6*)&from;
+            return b->sin6_family == AF_INET6 && memcmp(&a->sin6_addr, &b->sin6_addr, sizeof(a->sin6_addr)) == 0;
+        }
+        const struct sockaddr_in* a = (const struct sockaddr_in*)&s.addr;
+        const struct sockaddr_in* b = (const struct sockaddr_in*)&from;
+        return b->sin_family == AF_INET && a->sin_addr.s_addr == b->sin_addr.s_addr;
+    }
+
+    Family m_family[2];   // IPv4, IPv6
+    int m_wakeFd;
+    uint32_t m_batch;
+    uint64_t m_earliestUs;   // no pending deadline before this (0: scan on the next Collect)
+    Slot m_slots[MaxTargets];
+    IcmpSocketStats m_stats;
+};
+
+} // namespace lt
+
+#endif // __linux__
@@ -0,0 +1,105 @@
+// core/icon_compositor.h
+// Composes tray icon pixels from a GlyphAtlas into a reusable 32bpp buffer.
+// Pixels are top-down 0xAARRGGBB with straight (non-premultiplied) alpha, which is what a
+// 32bpp icon color bitmap expects. Composition itself runs premultiplied through the
+// runtime-selected kernels in argb_kernels.h. No allocation and no platform calls: only
+// the final HICON wrap (icon_win.h) is Windows specific.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "argb_kernels.h"
+#include "glyph_atlas.h"
+
+namespace lt {
+
+static const uint32_t kMaxIconText = 8;   // same limit CreateTextIcon enforced
+
+template <uint32_t MaxSize>
+class IconCompositor {
+public:
+    IconCompositor() : m_size(0), m_kernels(&GetArgbKernels()) {}
+
+    // Use a specific kernel set (benchmarks, comparisons against the scalar reference)
+    void SetKernels(const ArgbKernels& kernels) { m_kernels = &kernels; }
+
+    // Render text centred on a background. Returns the pixel buffer (atlas.Size() squared),
+    // or nullptr when the atlas is empty or the text is too long.
+    // fg is 0xRRGGBB; bg is 0xAARRGGBB (0 = fully transparent); tint is 0xAARRGGBB laid
+    // over the background before the text, its alpha being the strength (0 = none).
+    const uint32_t* Compose(const GlyphAtlas<MaxSize>& atlas, const char* text,
+                            uint32_t fg = 0xFFFFFF, uint32_t bg = 0, uint32_t tint = 0) {
+        uint32_t size = atlas.Size();
+        size_t len = text ? strlen(text) : 0;
+        if (size == 0 || len > kMaxIconText) return nullptr;
+        m_size = size;
+
+        m_kernels->fill(m_pixels, size * size, PremultiplyPixel(bg));
+        if (tint >> 24) m_kernels->tint(m_pixels, size * size, tint & 0xFFFFFF, (uint8_t)(tint >> 24));
+
+        // Regular glyphs with a gap if they fit, then condensed, then condensed without gaps.
+        // Anything still wider is centred and clipped, as DrawText did.
+        uint32_t gap = size >= 32 ? 2 : 1;
+        GlyphStyle style = GLYPH_REGULAR;
+        uint32_t width = MeasureText(atlas, text, len, style, gap);
+        if (width > size) {
+            style = GLYPH_CONDENSED;
+            width = MeasureText(atlas, text, len, style, gap);
+            if (width > size) {
+                gap = 0;
+                width = MeasureText(atlas, text, len, style, gap);
+            }
+        }
+
+        int x = ((int)size - (int)width) / 2;
+        int y = ((int)size - (int)atlas.GlyphHeight()) / 2;
+        for (size_t i = 0; i < len; ++i) {
+            const Glyph* g = atlas.Find(style, text[i]);
+            if (!g) continue;
+            BlitGlyph(atlas, *g, x, y, fg);
+            x += g->width + (int)gap;
+        }
+        // Opaque results are identical in both alpha conventions
+        if ((bg >> 24) != 255 && (tint >> 24) != 255) UnpremultiplyArgb(m_pixels, size * size);
+        return m_pixels;
+    }
+
+    const uint32_t* Pixels() const { return m_pixels; }
+    uint32_t Size() const { return m_size; }
+
+private:
+    static uint32_t MeasureText(const GlyphAtlas<MaxSize>& atlas, const char* text, size_t len,
+                                GlyphStyle style, uint32_t gap) {
+        uint32_t width = 0;
+        uint32_t drawn = 0;
+        for (size_t i = 0; i < len; ++i) {
+            const Glyph* g = atlas.Find(style, text[i]);
+            if (!g) continue;
+            width += g->width;
+            ++drawn;
+        }
+        return drawn ? width + gap * (drawn - 1) : 0;
+    }
+
+    // One blend kernel call per glyph row, clipped to the icon
+    void BlitGlyph(const GlyphAtlas<MaxSize>& atlas, const Glyph& g, int x0, int y0, uint32_t fg) {
+        const uint8_t* cov = atlas.Coverage(g);
+        int h = (int)atlas.GlyphHeight();
+        int size = (int)m_size;
+        int gx0 = x0 < 0 ? -x0 : 0;
+        int gx1 = x0 + (int)g.width > size ? size - x0 : (int)g.width;
+        if (gx1 <= gx0) return;
+        for (int gy = 0; gy < h; ++gy) {
+            int y = y0 + gy;
+            if (y < 0 || y >= size) continue;
+            m_kernels->blend(m_pixels + y * size + x0 + gx0, cov + gy * g.width + gx0,
+                             (size_t)(gx1 - gx0), fg & 0xFFFFFF);
+        }
+    }
+
+    uint32_t m_size;
+    const ArgbKernels* m_kernels;
+    uint32_t m_pixels[MaxSize * MaxSize];
+};
+
+} // namespace lt
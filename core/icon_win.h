@@ -0,0 +1,174 @@
+// core/icon_win.h
+// Windows side of icon rendering: wraps composed ARGB pixels in an HICON through a DIB
+// section and mask that are created once per size and reused, and optionally fills a
+// GlyphAtlas from a GDI font (once per DPI) so the tray keeps the Segoe UI look.
+#pragma once
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <string.h>
+#include "glyph_atlas.h"
+
+namespace lt {
+
+class IconSurface {
+public:
+    IconSurface() : m_size(0), m_color(NULL), m_mask(NULL), m_bits(nullptr) {}
+    ~IconSurface() { Release(); }
+
+    // Create the reusable 32bpp top-down DIB section and monochrome mask for one size
+    bool Init(uint32_t size) {
+        if (size == m_size && m_color) return true;
+        Release();
+        if (size == 0 || size > 64) return false;
+
+        BITMAPV5HEADER bi;
+        ZeroMemory(&bi, sizeof(bi));
+        bi.bV5Size = sizeof(BITMAPV5HEADER);
+        bi.bV5Width = (LONG)size;
+        bi.bV5Height = -(LONG)size; // top-down
+        bi.bV5Planes = 1;
+        bi.bV5BitCount = 32;
+        bi.bV5Compression = BI_BITFIELDS;
+        bi.bV5RedMask   = 0x00FF0000;
+        bi.bV5GreenMask = 0x0000FF00;
+        bi.bV5BlueMask  = 0x000000FF;
+        bi.bV5AlphaMask = 0xFF000000;
+
+        HDC hdcScreen = GetDC(NULL);
+        if (!hdcScreen) return false;
+        m_color = CreateDIBSection(hdcScreen, (BITMAPINFO*)&bi, DIB_RGB_COLORS, &m_bits, NULL, 0);
+        ReleaseDC(NULL, hdcScreen);
+        if (!m_color || !m_bits) {
+            Release();
+            return false;
+        }
+
+        // All-zero mask: the color bitmap's alpha channel decides transparency
+        static const BYTE zeroMask[64 * 8] = {0};
+        m_mask = CreateBitmap((int)size, (int)size, 1, 1, zeroMask);
+        if (!m_mask) {
+            Release();
+            return false;
+        }
+        m_size = size;
+        return true;
+    }
+
+    // Copy composed pixels (size*size, 0xAARRGGBB, top-down) and build an icon from them.
+    // CreateIconIndirect copies the bitmaps, so the surface can be reused right away.
+    HICON Create(const uint32_t* pixels) {
+        if (!m_color || !pixels) return NULL;
+        GdiFlush();
+        memcpy(m_bits, pixels, (size_t)m_size * m_size * sizeof(uint32_t));
+        ICONINFO ii;
+        ZeroMemory(&ii, sizeof(ii));
+        ii.fIcon = TRUE;
+        ii.hbmColor = m_color;
+        ii.hbmMask = m_mask;
+        return CreateIconIndirect(&ii);
+    }
+
+private:
+    void Release() {
+        if (m_color) DeleteObject(m_color);
+        if (m_mask) DeleteObject(m_mask);
+        m_color = NULL;
+        m_mask = NULL;
+        m_bits = nullptr;
+        m_size = 0;
+    }
+
+    uint32_t m_size;
+    HBITMAP m_color;
+    HBITMAP m_mask;
+    void* m_bits;
+};
+
+// Rasterize the atlas glyphs with a GDI font, once per icon size. Regular glyphs use the
+// same bold font CreateTextIcon used; condensed ones a narrower width of the same face.
+// Returns false (atlas untouched on early failure) so callers can fall back to BuildBuiltin.
+template <uint32_t MaxSize>
+static bool BuildAtlasFromGdi(GlyphAtlas<MaxSize>& atlas, uint32_t size, const wchar_t* face = L"Segoe UI") {
+    if (size == 0 || size > MaxSize) return false;
+    int fontHeight = (int)(size * 0.7);
+
+    BITMAPINFO bi;
+    ZeroMemory(&bi, sizeof(bi));
+    bi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bi.bmiHeader.biWidth = (LONG)size;
+    bi.bmiHeader.biHeight = -(LONG)size; // top-down
+    bi.bmiHeader.biPlanes = 1;
+    bi.bmiHeader.biBitCount = 32;
+    bi.bmiHeader.biCompression = BI_RGB;
+
+    HDC hdcScreen = GetDC(NULL);
+    if (!hdcScreen) return false;
+    void* pvBits = nullptr;
+    HBITMAP hBmp = CreateDIBSection(hdcScreen, &bi, DIB_RGB_COLORS, &pvBits, NULL, 0);
+    HDC hMem = hBmp ? CreateCompatibleDC(hdcScreen) : NULL;
+    ReleaseDC(NULL, hdcScreen);
+    if (!hMem) {
+        if (hBmp) DeleteObject(hBmp);
+        return false;
+    }
+    HBITMAP hOldBmp = (HBITMAP)SelectObject(hMem, hBmp);
+    SetBkMode(hMem, TRANSPARENT);
+    SetTextColor(hMem, RGB(255,255,255));
+
+    bool ok = false;
+    uint8_t cell[MaxSize * MaxSize];
+    for (int style = 0; style < GLYPH_STYLES; ++style) {
+        // Grayscale antialiasing: ClearType fringes have no meaning on a transparent icon
+        int width = (style == GLYPH_CONDENSED) ? fontHeight * 2 / 5 : 0;
+        HFONT hFont = CreateFontW(-fontHeight, width, 0, 0, FW_BOLD, FALSE, FALSE, FALSE,
+                                  DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
+                                  ANTIALIASED_QUALITY, VARIABLE_PITCH, face);
+        if (!hFont) break;
+        HFONT hOldFont = (HFONT)SelectObject(hMem, hFont);
+
+        TEXTMETRICW tm;
+        GetTextMetricsW(hMem, &tm);
+        uint32_t glyphHeight = (uint32_t)tm.tmHeight;
+        if (glyphHeight > size) glyphHeight = size;
+        if (style == GLYPH_REGULAR) ok = atlas.Begin(size, glyphHeight);
+
+        for (uint32_t i = 0; ok && i < kGlyphCount; ++i) {
+            wchar_t ch = (wchar_t)kGlyphChars[i];
+            SIZE extent;
+            if (!GetTextExtentPoint32W(hMem, &ch, 1, &extent)) continue;
+            uint32_t glyphWidth = extent.cx > 0 ? (uint32_t)extent.cx : 1;
+            if (glyphWidth > size) glyphWidth = size;
+
+            GdiFlush();
+            memset(pvBits, 0, (size_t)size * size * 4);
+            TextOutW(hMem, 0, 0, &ch, 1);
+            GdiFlush();
+
+            // White text on black: any channel is the coverage
+            const uint32_t* px = (const uint32_t*)pvBits;
+            for (uint32_t y = 0; y < atlas.GlyphHeight(); ++y) {
+                for (uint32_t x = 0; x < glyphWidth; ++x) {
+                    cell[y * glyphWidth + x] = (uint8_t)((px[y * size + x] >> 8) & 0xFF);
+                }
+            }
+            atlas.SetGlyph((GlyphStyle)style, i, glyphWidth, cell, glyphWidth);
+        }
+
+        SelectObject(hMem, hOldFont);
+        DeleteObject(hFont);
+    }
+
+    SelectObject(hMem, hOldBmp);
+    DeleteDC(hMem);
+    DeleteObject(hBmp);
+    return ok;
+}
+
+} // namespace lt
+
+#endif // _WIN32
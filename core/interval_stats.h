@@ -0,0 +1,99 @@
+// core/interval_stats.h
+// Aggregate of one target over one reporting interval (a minute of history, a headless
+// output period): samples, loss, min/avg/max, percentiles and jitter. Fixed memory; Add is
+// O(1), Summarize walks the histogram once. Jitter here is the mean |RTT change| between
+// consecutive replies in the interval (RollingStats' RFC 3550 value is a smoothed variant).
+#pragma once
+
+#include <stdint.h>
+#include "probe_backend.h"
+#include "latency_histogram.h"
+
+namespace lt {
+
+struct IntervalSummary {
+    uint32_t samples;
+    uint32_t lost;       // timeouts and errors
+    uint32_t minUs;      // kNoReply for every value without replies
+    uint32_t avgUs;
+    uint32_t p50Us;
+    uint32_t p90Us;
+    uint32_t p99Us;
+    uint32_t maxUs;
+    uint32_t jitterUs;   // kNoReply with fewer than two replies
+};
+
+class IntervalStats {
+public:
+    IntervalStats() { Reset(); }
+
+    void Reset() {
+        m_samples = 0;
+        m_lost = 0;
+        m_minUs = kNoReply;
+        m_sumUs = 0;
+        m_sumDiffUs = 0;
+        m_diffs = 0;
+        m_lastUs = kNoReply;
+        m_hist.Reset();
+    }
+
+    void Add(uint8_t status, uint32_t rttUs) {
+        ++m_samples;
+        if (status != PROBE_OK || rttUs == kNoReply) {
+            ++m_lost;
+            return;
+        }
+        m_hist.Add(rttUs);
+        m_sumUs += rttUs;
+        if (rttUs < m_minUs) m_minUs = rttUs;
+        if (m_lastUs != kNoReply) {
+            m_sumDiffUs += rttUs > m_lastUs ? rttUs - m_lastUs : m_lastUs - rttUs;
+            ++m_diffs;
+        }
+        m_lastUs = rttUs;
+    }
+
+    // Fold another interval in (consecutive intervals, or several targets)
+    void Merge(const IntervalStats& other) {
+        m_samples += other.m_samples;
+        m_lost += other.m_lost;
+        m_sumUs += other.m_sumUs;
+        m_sumDiffUs += other.m_sumDiffUs;
+        m_diffs += other.m_diffs;
+        if (other.m_minUs < m_minUs) m_minUs = other.m_minUs;
+        m_hist.Merge(other.m_hist);
+    }
+
+    uint64_t Samples() const { return m_samples; }
+
+    void Summarize(IntervalSummary* out) const {
+        uint64_t replies = m_samples - m_lost;
+        out->samples = (uint32_t)m_samples;
+        out->lost = (uint32_t)m_lost;
+        out->minUs = replies ? m_minUs : kNoReply;
+        out->avgUs = replies ? (uint32_t)(m_sumUs / replies) : kNoReply;
+        static const double qs[3] = {0.50, 0.90, 0.99};
+        uint32_t q[3] = {kNoReply, kNoReply, kNoReply};
+        if (replies) m_hist.Quantiles(qs, q, 3);
+        out->p50Us = q[0];
+        out->p90Us = q[1];
+        out->p99Us = q[2];
+        out->maxUs = replies ? m_hist.Max() : kNoReply;
+        out->jitterUs = m_diffs ? (uint32_t)(m_sumDiffUs / m_diffs) : kNoReply;
+    }
+
+    const LatencyHistogram& Histogram() const { return m_hist; }
+
+private:
+    uint64_t m_samples;
+    uint64_t m_lost;
+    uint32_t m_minUs;
+    uint64_t m_sumUs;
+    uint64_t m_sumDiffUs;
+    uint64_t m_diffs;
+    uint32_t m_lastUs;
+    LatencyHistogram m_hist;
+};
+
+} // namespace lt
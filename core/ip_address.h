@@ -0,0 +1,212 @@
+// core/ip_address.h
+// IPv4/IPv6 addresses in binary form, and a parser for their text form that also runs at
+// compile time (C++14 constexpr). The preset table (presets.h) holds its addresses parsed:
+// the family comes from the text instead of a hand-kept flag, a malformed literal fails the
+// build (IpLiteral), and backends fill their sockaddrs from the bytes without inet_pton.
+// Accepted: dotted quads, IPv6 with "::" and an embedded IPv4 tail ("::ffff:192.0.2.1"), and
+// an IPv6 zone "%<interface index>"; ResolveIpAddress also takes interface names ("%eth0").
+// tests/ip_address_test.cpp checks the parser at compile time.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <net/if.h>
+#endif
+
+namespace lt {
+
+enum IpFamily : uint8_t {
+    IP_NONE = 0,   // no address: not parsed, or the default gateway slot before it is known
+    IP_V4 = 4,
+    IP_V6 = 6
+};
+
+// Longest text form: a full IPv6 address with an embedded IPv4 tail and a zone
+static const size_t kIpAddressTextSize = 64;
+
+struct IpAddress {
+    uint8_t family;      // IpFamily
+    uint8_t bytes[16];   // network order, the first 4 for IPv4
+    uint32_t scope;      // IPv6 zone (interface index), 0 for none
+
+    constexpr bool Valid() const { return family != IP_NONE; }
+    constexpr bool IsIPv6() const { return family == IP_V6; }
+};
+
+namespace ip_detail {
+
+constexpr int HexDigit(char c) {
+    return c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+}
+
+// Dotted quad at p into out[0..3]. Returns the first character after it, nullptr if malformed.
+constexpr const char* ParseQuad(const char* p, uint8_t* out) {
+    for (int i = 0; i < 4; ++i) {
+        uint32_t v = 0;
+        int digits = 0;
+        const char* start = p;
+        for (; *p >= '0' && *p <= '9' && digits < 4; ++p, ++digits) v = v * 10 + (uint32_t)(*p - '0');
+        // No leading zeros: inet_pton rejects them (some parsers read them as octal)
+        if (!digits || digits > 3 || v > 255 || (digits > 1 && *start == '0')) return nullptr;
+        out[i] = (uint8_t)v;
+        if (i < 3) {
+            if (*p != '.') return nullptr;
+            ++p;
+        }
+    }
+    return p;
+}
+
+} // namespace ip_detail
+
+// Family IP_NONE when text is not an address
+constexpr IpAddress ParseIpAddress(const char* text) {
+    IpAddress none = {};
+    if (!text || !*text) return none;
+    bool colon = false;
+    for (const char* p = text; *p; ++p) colon = colon || *p == ':';
+    if (!colon) {
+        IpAddress a = {};
+        const char* end = ip_detail::ParseQuad(text, a.bytes);
+        if (!end || *end) return none;
+        a.family = IP_V4;
+        return a;
+    }
+
+    uint16_t head[8] = {}, tail[8] = {};
+    int heads = 0, tails = 0;
+    bool gap = false;
+    const char* p = text;
+    if (p[0] == ':') {
+        if (p[1] != ':') return none;
+        gap = true;
+        p += 2;
+    }
+    while (*p && *p != '%') {
+        const char* group = p;
+        uint32_t v = 0;
+        int digits = 0;
+        for (; ip_detail::HexDigit(*p) >= 0 && digits < 5; ++p, ++digits) v = (v << 4) | (uint32_t)ip_detail::HexDigit(*p);
+        if (*p == '.') {
+            // Embedded IPv4: the last two groups
+            uint8_t quad[4] = {};
+            p = ip_detail::ParseQuad(group, quad);
+            if (!p || heads + tails > 6 || (*p && *p != '%')) return none;
+            uint16_t hi = (uint16_t)((quad[0] << 8) | quad[1]);
+            uint16_t lo = (uint16_t)((quad[2] << 8) | quad[3]);
+            if (gap) {
+                tail[tails++] = hi;
+                tail[tails++] = lo;
+            } else {
+                head[heads++] = hi;
+                head[heads++] = lo;
+            }
+            break;
+        }
+        if (!digits || digits > 4 || heads + tails == 8) return none;
+        if (gap) {
+            tail[tails++] = (uint16_t)v;
+        } else {
+            head[heads++] = (uint16_t)v;
+        }
+        if (*p != ':') break;
+        if (p[1] == ':') {
+            if (gap) return none;
+            gap = true;
+            p += 2;
+        } else {
+            ++p;
+            if (!*p || *p == '%') return none;
+        }
+    }
+    if (gap ? heads + tails > 7 : heads != 8) return none;
+
+    IpAddress a = {};
+    if (*p == '%') {
+        int digits = 0;
+        for (++p; *p >= '0' && *p <= '9' && digits < 10; ++p, ++digits) a.scope = a.scope * 10 + (uint32_t)(*p - '0');
+        if (!digits || digits > 9 || !a.scope) return none;
+    }
+    if (*p) return none;
+    for (int i = 0; i < heads; ++i) {
+        a.bytes[2 * i] = (uint8_t)(head[i] >> 8);
+        a.bytes[2 * i + 1] = (uint8_t)head[i];
+    }
+    for (int i = 0; i < tails; ++i) {
+        a.bytes[16 - 2 * (tails - i)] = (uint8_t)(tail[i] >> 8);
+        a.bytes[17 - 2 * (tails - i)] = (uint8_t)tail[i];
+    }
+    a.family = IP_V6;
+    return a;
+}
+
+// Deliberately not constexpr: reaching it while a constant is evaluated is a compile error,
+// which is what IpLiteral wants for a malformed address
+inline void MalformedIpLiteral() {}
+
+// ParseIpAddress for literals in tables: initialising a constexpr object with a malformed
+// address does not compile
+constexpr IpAddress IpLiteral(const char* text) {
+    IpAddress a = ParseIpAddress(text);
+    if (!a.Valid()) MalformedIpLiteral();
+    return a;
+}
+
+// ParseIpAddress for addresses from the command line and the system: the IPv6 zone may also
+// be an interface name ("fe80::1%eth0") where the platform resolves them
+static inline IpAddress ResolveIpAddress(const char* text) {
+    IpAddress a = ParseIpAddress(text);
+#ifndef _WIN32
+    const char* pct = text && !a.Valid() ? strchr(text, '%') : nullptr;
+    if (pct && pct[1] && (size_t)(pct - text) < kIpAddressTextSize) {
+        char head[kIpAddressTextSize];
+        memcpy(head, text, (size_t)(pct - text));
+        head[pct - text] = 0;
+        a = ParseIpAddress(head);
+        a.scope = a.IsIPv6() && !a.scope ? (uint32_t)if_nametoindex(pct + 1) : 0;
+        if (!a.scope) a = IpAddress();
+    }
+#endif
+    return a;
+}
+
+// Text form: dotted quad, or RFC 5952 (lower-case hex, the longest run of two or more zero
+// groups shortened to "::") with "%<scope>" when there is a zone
+static inline bool FormatIpAddress(const IpAddress& a, char* out, size_t size) {
+    if (!out || size == 0 || !a.Valid()) return false;
+    if (a.family == IP_V4) {
+        int len = snprintf(out, size, "%u.%u.%u.%u", a.bytes[0], a.bytes[1], a.bytes[2], a.bytes[3]);
+        return len > 0 && (size_t)len < size;
+    }
+    uint16_t g[8];
+    for (int i = 0; i < 8; ++i) g[i] = (uint16_t)((a.bytes[2 * i] << 8) | a.bytes[2 * i + 1]);
+    int bestStart = -1, bestLen = 0;
+    for (int i = 0; i < 8;) {
+        if (g[i]) { ++i; continue; }
+        int j = i;
+        while (j < 8 && !g[j]) ++j;
+        if (j - i > bestLen && j - i >= 2) { bestStart = i; bestLen = j - i; }
+        i = j;
+    }
+    char buf[48];   // eight groups and seven colons
+    size_t pos = 0;
+    for (int i = 0; i < 8; ++i) {
+        if (i == bestStart) {
+            buf[pos++] = ':';
+            if (i == 0) buf[pos++] = ':';
+            i += bestLen - 1;
+            continue;
+        }
+        pos += (size_t)snprintf(buf + pos, sizeof(buf) - pos, "%x", g[i]);
+        if (i < 7) buf[pos++] = ':';
+    }
+    buf[pos] = 0;
+    int len = a.scope ? snprintf(out, size, "%s%%%u", buf, a.scope) : snprintf(out, size, "%s", buf);
+    return len > 0 && (size_t)len < size;
+}
+
+} // namespace lt
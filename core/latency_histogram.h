@@ -0,0 +1,143 @@
+// core/latency_histogram.h
+// HDR-style log-linear latency histogram in fixed memory (2.5KB) for streaming percentiles.
+// Values 0..63 get exact buckets; above that every power of two is split into 32 linear
+// sub-buckets, so any reported quantile is within ~3% of the true sample value.
+// Histograms can be added to and removed from (sliding windows driven by RollingStats
+// evictions), merged across targets or time ranges, and queried for several quantiles in
+// a single pass. Values share RollingStats' unit and saturate at kMaxTrackedValue.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "rolling_stats.h"
+
+namespace lt {
+
+class LatencyHistogram {
+public:
+    static const uint32_t kSubBucketBits = 5;
+    static const uint32_t kSubBuckets = 1u << kSubBucketBits;   // linear steps per octave
+    // Index of kMaxTrackedValue (2^24 - 1) is 639
+    static const uint32_t kBuckets = (24 - kSubBucketBits) * kSubBuckets + kSubBuckets;
+
+    LatencyHistogram() { Reset(); }
+
+    void Reset() {
+        memset(m_counts, 0, sizeof(m_counts));
+        m_total = 0;
+        m_max = 0;
+    }
+
+    void Add(uint32_t value) {
+        if (value > kMaxTrackedValue) value = kMaxTrackedValue;
+        ++m_counts[IndexOf(value)];
+        ++m_total;
+        if (value > m_max) m_max = value;
+    }
+
+    // Undo a previous Add (sliding windows). The exact maximum is not tracked backwards,
+    // Max() falls back to the highest occupied bucket.
+    void Remove(uint32_t value) {
+        if (value > kMaxTrackedValue) value = kMaxTrackedValue;
+        uint32_t i = IndexOf(value);
+        if (m_counts[i] == 0) return;
+        --m_counts[i];
+        --m_total;
+    }
+
+    // Combine another histogram (another target, another time range) into this one
+    void Merge(const LatencyHistogram& other) {
+        for (uint32_t i = 0; i < kBuckets; ++i) m_counts[i] += other.m_counts[i];
+        m_total += other.m_total;
+        if (other.m_max > m_max) m_max = other.m_max;
+    }
+
+    uint64_t Count() const { return m_total; }
+
+    // Largest recorded value: exact unless values were removed
+    uint32_t Max() const {
+        for (uint32_t i = kBuckets; i-- > 0;) {
+            if (m_counts[i]) {
+                uint32_t upper = UpperBound(i);
+                return upper < m_max ? upper : m_max;
+            }
+        }
+        return 0;
+    }
+
+    // Value at quantile q (0..1), 0 when empty
+    uint32_t Quantile(double q) const {
+        uint32_t v = 0;
+        Quantiles(&q, &v, 1);
+        return v;
+    }
+
+    // Several quantiles in one walk over the buckets. qs must be ascending.
+    void Quantiles(const double* qs, uint32_t* out, int n) const {
+        int k = 0;
+        if (m_total == 0) {
+            for (; k < n; ++k) out[k] = 0;
+            return;
+        }
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < kBuckets && k < n; ++i) {
+            if (!m_counts[i]) continue;
+            seen += m_counts[i];
+            // Nearest-rank: the smallest value with at least ceil(q * total) samples at or below it
+            while (k < n && seen >= Rank(qs[k])) {
+                uint32_t v = Representative(i);
+                out[k++] = v < m_max ? v : m_max;
+            }
+        }
+        for (; k < n; ++k) out[k] = Max();
+    }
+
+    // Bucket layout helpers (exposed for exporters that emit cumulative buckets)
+    static uint32_t IndexOf(uint32_t value) {
+        if (value < 2 * kSubBuckets) return value;
+        uint32_t msb = 31 - CountLeadingZeros(value);
+        uint32_t shift = msb - kSubBucketBits;
+        return shift * kSubBuckets + (value >> shift);
+    }
+    static uint32_t LowerBound(uint32_t index) {
+        if (index < 2 * kSubBuckets) return index;
+        uint32_t shift = index / kSubBuckets - 1;
+        return (index % kSubBuckets + kSubBuckets) << shift;
+    }
+    static uint32_t UpperBound(uint32_t index) {
+        if (index < 2 * kSubBuckets) return index;
+        uint32_t shift = index / kSubBuckets - 1;
+        return ((index % kSubBuckets + kSubBuckets + 1) << shift) - 1;
+    }
+    uint32_t BucketCount(uint32_t index) const { return m_counts[index]; }
+
+private:
+    uint64_t Rank(double q) const {
+        if (q <= 0.0) return 1;
+        if (q >= 1.0) return m_total;
+        uint64_t r = (uint64_t)(q * (double)m_total);
+        if ((double)r < q * (double)m_total) ++r;
+        return r ? r : 1;
+    }
+
+    static uint32_t Representative(uint32_t index) {
+        uint32_t lo = LowerBound(index);
+        return lo + (UpperBound(index) - lo) / 2;
+    }
+
+    static uint32_t CountLeadingZeros(uint32_t v) {
+        uint32_t n = 0;
+        if (!(v & 0xFFFF0000u)) { n += 16; v <<= 16; }
+        if (!(v & 0xFF000000u)) { n += 8; v <<= 8; }
+        if (!(v & 0xF0000000u)) { n += 4; v <<= 4; }
+        if (!(v & 0xC0000000u)) { n += 2; v <<= 2; }
+        if (!(v & 0x80000000u)) { n += 1; }
+        return n;
+    }
+
+    uint32_t m_counts[kBuckets];
+    uint64_t m_total;
+    uint32_t m_max;
+};
+
+} // namespace lt
@@ -0,0 +1,69 @@
+// core/latency_snapshot.h
+// Everything the render stage needs to draw one target, captured by the probe thread right
+// after a completion. The snapshot is a plain value: it goes through the SPSC render queue and
+// is published in a seqlock, so the UI never reads engine state the probe thread is changing.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "probe_engine.h"
+
+namespace lt {
+
+struct LatencySnapshot {
+    uint32_t sequence;      // increments with every capture, 0 = nothing captured yet
+    uint32_t target;
+    uint32_t rttUs;         // last result, kNoReply after a failed probe
+    uint32_t completed;     // 0 while still measuring
+    uint32_t samples;       // replies in the rolling window
+    uint32_t p50Us;
+    uint32_t p95Us;
+    uint32_t p99Us;
+    uint32_t avgUs;
+    uint32_t jitterUs;
+    uint32_t maxUs;         // lifetime maximum
+    uint32_t apiRttMs;      // kNoReply when the backend reports none
+    int32_t apiErrorUs;     // mean measured - API
+    uint32_t lossBp;        // lost probes among the last kLossShortWindow, in 1/100 %
+    uint32_t lostInRow;     // current run of lost probes
+    uint8_t isIPv6;
+    char address[63];       // what the target is bound to ("192.168.1.1", "fe80::1%12")
+};
+
+template <uint32_t MaxTargets, uint32_t StatsCapacity>
+void CaptureSnapshot(const ProbeEngine<MaxTargets, StatsCapacity>& engine, uint32_t target,
+                     const char* address, bool isIPv6, uint32_t sequence, LatencySnapshot* out) {
+    memset(out, 0, sizeof(*out));
+    out->sequence = sequence;
+    out->target = target;
+    out->rttUs = engine.LastRttUs(target);
+    out->isIPv6 = isIPv6 ? 1 : 0;
+    if (address) {
+        size_t len = strlen(address);
+        if (len >= sizeof(out->address)) len = sizeof(out->address) - 1;
+        memcpy(out->address, address, len);
+    }
+    if (target >= engine.Count()) return;
+
+    const typename ProbeEngine<MaxTargets, StatsCapacity>::SlotState& state = engine.State(target);
+    out->completed = state.completed;
+    out->samples = state.stats.Count();
+    if (out->samples) {
+        // All three tail percentiles in one histogram pass
+        static const double quantiles[3] = {0.50, 0.95, 0.99};
+        uint32_t pct[3];
+        state.window.Quantiles(quantiles, pct, 3);
+        out->p50Us = pct[0];
+        out->p95Us = pct[1];
+        out->p99Us = pct[2];
+        out->avgUs = state.stats.Mean();
+        out->jitterUs = state.stats.Jitter();
+        out->maxUs = state.lifetime.Max();
+    }
+    out->lossBp = state.loss.ShortLossBp();
+    out->lostInRow = state.loss.CurrentBurst();
+    out->apiRttMs = state.lastApiRttMs;
+    out->apiErrorUs = engine.ApiErrorUs(target);
+}
+
+} // namespace lt
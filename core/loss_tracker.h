@@ -0,0 +1,146 @@
+// core/loss_tracker.h
+// Per-target loss accounting by probe sequence number, O(1) per probe in fixed memory:
+//  - loss over two sliding windows (the last kLossShortWindow and kLossLongWindow probes), kept
+//    as running counts over a ring of outcome bits;
+//  - loss bursts (runs of consecutive lost probes) as a distribution over power-of-two length
+//    buckets, the longest one, and the current run, so random loss and outages can be told apart;
+//  - replies that arrive after their probe was already completed (PROBE_LATE): late replies to
+//    probes that timed out, reordered ones among them (a later probe was answered first), and
+//    duplicates of replies already counted. Only the last 64 probes are told apart; a reply to
+//    an older one counts as late.
+// A lost probe is one that did not end in PROBE_OK (timeout or error). A late reply does not
+// undo the loss: the probe failed when it mattered.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+namespace lt {
+
+static const uint32_t kLossShortWindow = 60;    // probes: a minute at the default interval
+static const uint32_t kLossLongWindow = 900;    // a quarter of an hour
+static const uint32_t kLossBurstBuckets = 8;    // lengths 1, 2, 3-4, 5-8, 9-16, 17-32, 33-64, 65+
+static const uint32_t kOutageBurstBucket = 3;   // bursts of 5 and more lost probes are outages
+
+class LossTracker {
+public:
+    LossTracker() { Reset(); }
+
+    void Reset() { memset(this, 0, sizeof(*this)); }
+
+    // Outcome of probe seq. Sequence numbers increase by one per probe.
+    void Record(uint32_t seq, bool lost) {
+        uint32_t bit = m_probes % kRingBits;
+        uint64_t mask = 1ull << (bit % 64);
+        if (m_probes >= kLossShortWindow && Bit((m_probes - kLossShortWindow) % kRingBits)) --m_shortLost;
+        if (m_probes >= kLossLongWindow && Bit((m_probes - kLossLongWindow) % kRingBits)) --m_longLost;
+        if (lost) {
+            m_ring[bit / 64] |= mask;
+            ++m_shortLost;
+            ++m_longLost;
+            ++m_lost;
+            if (++m_burst > m_maxBurst) m_maxBurst = m_burst;
+        } else {
+            m_ring[bit / 64] &= ~mask;
+            EndBurst();
+        }
+        ++m_probes;
+
+        // Recent probes by age: bit k is probe seq - k
+        uint32_t shift = m_probes > 1 ? seq - m_lastSeq : 64;
+        m_answered = shift < 64 ? m_answered << shift : 0;
+        m_timedOut = shift < 64 ? m_timedOut << shift : 0;
+        if (lost) m_timedOut |= 1;
+        else m_answered |= 1;
+        m_lastSeq = seq;
+    }
+
+    // A reply for probe seq that came after its probe had been completed. Replies to probes
+    // this tracker never saw (sent before the last Reset) are ignored.
+    void RecordLate(uint32_t seq) {
+        uint32_t age = m_lastSeq - seq;
+        if (age >= 64) {
+            if (age < m_probes) ++m_late;   // too old to tell apart
+            return;
+        }
+        uint64_t mask = 1ull << age;
+        if (!((m_answered | m_timedOut) & mask)) return;
+        if (m_answered & mask) {
+            ++m_duplicates;
+            return;
+        }
+        ++m_late;
+        if (m_answered & (mask - 1)) ++m_reordered;   // a later probe was answered first
+        // A second copy of this reply is a duplicate
+        m_timedOut &= ~mask;
+        m_answered |= mask;
+    }
+
+    uint64_t Probes() const { return m_probes; }
+    uint64_t Lost() const { return m_lost; }
+
+    // Probes in each window so far (full once that many probes were recorded) and lost among them
+    uint32_t ShortWindowProbes() const { return m_probes < kLossShortWindow ? (uint32_t)m_probes : kLossShortWindow; }
+    uint32_t LongWindowProbes() const { return m_probes < kLossLongWindow ? (uint32_t)m_probes : kLossLongWindow; }
+    uint32_t ShortWindowLost() const { return m_shortLost; }
+    uint32_t LongWindowLost() const { return m_longLost; }
+
+    // Loss in basis points (1/100 %)
+    uint32_t ShortLossBp() const { return Bp(m_shortLost, ShortWindowProbes()); }
+    uint32_t LongLossBp() const { return Bp(m_longLost, LongWindowProbes()); }
+    uint32_t LifetimeLossBp() const { return m_probes ? (uint32_t)((m_lost * 10000 + m_probes / 2) / m_probes) : 0; }
+
+    // Lost probes in a row so far (0 after a reply), and the longest run since Reset
+    uint32_t CurrentBurst() const { return m_burst; }
+    uint32_t MaxBurst() const { return m_maxBurst; }
+
+    // Finished bursts by length bucket (see BurstBucket); the current one is not included
+    uint32_t Bursts(uint32_t bucket) const { return bucket < kLossBurstBuckets ? m_bursts[bucket] : 0; }
+    uint32_t Outages() const {
+        uint32_t n = 0;
+        for (uint32_t b = kOutageBurstBucket; b < kLossBurstBuckets; ++b) n += m_bursts[b];
+        return n;
+    }
+
+    uint32_t LateReplies() const { return m_late; }
+    uint32_t Duplicates() const { return m_duplicates; }
+    uint32_t Reordered() const { return m_reordered; }
+
+    // Bucket of a burst length: 1, 2, 3-4, 5-8, ... 65+ (the bucket's upper bound is 2^bucket)
+    static uint32_t BurstBucket(uint32_t length) {
+        uint32_t bucket = 0;
+        for (uint32_t v = length - 1; v && bucket < kLossBurstBuckets - 1; v >>= 1) ++bucket;
+        return bucket;
+    }
+
+private:
+    static const uint32_t kRingBits = 1024;   // at least kLossLongWindow
+    static_assert(kLossShortWindow <= kLossLongWindow && kLossLongWindow <= kRingBits, "windows must fit the ring");
+
+    bool Bit(uint32_t bit) const { return (m_ring[bit / 64] >> (bit % 64)) & 1; }
+
+    static uint32_t Bp(uint32_t lost, uint32_t probes) { return probes ? (lost * 10000 + probes / 2) / probes : 0; }
+
+    void EndBurst() {
+        if (!m_burst) return;
+        ++m_bursts[BurstBucket(m_burst)];
+        m_burst = 0;
+    }
+
+    uint64_t m_ring[kRingBits / 64];   // outcome of probe n at bit n % kRingBits: 1 = lost
+    uint64_t m_probes;
+    uint64_t m_lost;
+    uint64_t m_answered;               // recent probes, by age: answered
+    uint64_t m_timedOut;               // ... and lost
+    uint32_t m_lastSeq;
+    uint32_t m_shortLost;
+    uint32_t m_longLost;
+    uint32_t m_burst;
+    uint32_t m_maxBurst;
+    uint32_t m_bursts[kLossBurstBuckets];
+    uint32_t m_late;
+    uint32_t m_duplicates;
+    uint32_t m_reordered;
+};
+
+} // namespace lt
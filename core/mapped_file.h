@@ -0,0 +1,228 @@
+// core/mapped_file.h
+// Fixed-size file with one movable mapped window: CreateFileMapping/MapViewOfFile on Windows,
+// mmap elsewhere. Only the window is mapped, so address space and resident memory stay bounded
+// however large the file is. Window offsets must be multiples of kMapGranularity (64KB, the
+// Windows allocation granularity, which also covers every POSIX page size in use).
+// Plain positioned reads are available for scanning the file without mapping it. Readers can
+// open an existing file read-only while a writer has it open.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace lt {
+
+static const uint64_t kMapGranularity = 65536;
+
+class MappedFile {
+public:
+    MappedFile() : m_size(0), m_view(nullptr), m_viewOffset(0), m_viewSize(0), m_readOnly(false) {
+#ifdef _WIN32
+        m_file = INVALID_HANDLE_VALUE;
+        m_mapping = NULL;
+#else
+        m_fd = -1;
+#endif
+    }
+    ~MappedFile() { Close(); }
+
+    // Open (creating if needed) and size the file to exactly `size` bytes. `path` is UTF-8.
+    // *created is set when the file was new or had a different size (its contents are zero).
+    bool Open(const char* path, uint64_t size, bool* created) {
+        Close();
+        if (!path || !size) return false;
+        uint64_t existing = 0;
+#ifdef _WIN32
+        wchar_t wpath[MAX_PATH];
+        if (!MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, path, -1, wpath, MAX_PATH)) return false;
+        // Not shared for writing: one recorder per file
+        m_file = CreateFileW(wpath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS,
+                             FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER li;
+        if (GetFileSizeEx(m_file, &li)) existing = (uint64_t)li.QuadPart;
+        if (existing != size) {
+            // Start over rather than reinterpret a file of another geometry
+            li.QuadPart = 0;
+            SetFilePointerEx(m_file, li, NULL, FILE_BEGIN);
+            SetEndOfFile(m_file);
+            li.QuadPart = (LONGLONG)size;
+            if (!SetFilePointerEx(m_file, li, NULL, FILE_BEGIN) || !SetEndOfFile(m_file)) {
+                Close();
+                return false;
+            }
+        }
+        m_mapping = CreateFileMappingW(m_file, NULL, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, NULL);
+        if (!m_mapping) {
+            Close();
+            return false;
+        }
+#else
+        m_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (m_fd < 0) return false;
+        struct stat st;
+        if (fstat(m_fd, &st) == 0) existing = (uint64_t)st.st_size;
+        if (existing != size) {
+            if (ftruncate(m_fd, 0) != 0 || ftruncate(m_fd, (off_t)size) != 0) {
+                Close();
+                return false;
+            }
+        }
+#endif
+        m_size = size;
+        m_readOnly = false;
+        if (created) *created = existing != size;
+        return true;
+    }
+
+    // Open an existing file for reading and mapping only, at whatever size it has
+    bool OpenReadOnly(const char* path) {
+        Close();
+        if (!path) return false;
+        uint64_t size = 0;
+#ifdef _WIN32
+        wchar_t wpath[MAX_PATH];
+        if (!MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, path, -1, wpath, MAX_PATH)) return false;
+        // Share writing: the recorder may still be appending
+        m_file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL, NULL);
+        if (m_file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER li;
+        if (GetFileSizeEx(m_file, &li)) size = (uint64_t)li.QuadPart;
+        m_mapping = size ? CreateFileMappingW(m_file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+        if (!m_mapping) {
+            Close();
+            return false;
+        }
+#else
+        m_fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (m_fd < 0) return false;
+        struct stat st;
+        if (fstat(m_fd, &st) == 0) size = (uint64_t)st.st_size;
+        if (!size) {
+            Close();
+            return false;
+        }
+#endif
+        m_size = size;
+        m_readOnly = true;
+        return true;
+    }
+
+    void Close() {
+        Unmap();
+#ifdef _WIN32
+        if (m_mapping) CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+        m_mapping = NULL;
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        if (m_fd >= 0) close(m_fd);
+        m_fd = -1;
+#endif
+        m_size = 0;
+        m_readOnly = false;
+    }
+
+    bool IsOpen() const { return m_size != 0; }
+    bool IsReadOnly() const { return m_readOnly; }
+    uint64_t Size() const { return m_size; }
+
+    // Map [offset, offset + size) for reading and writing (reading only after OpenReadOnly),
+    // replacing the previous window
+    uint8_t* Map(uint64_t offset, size_t size) {
+        if (m_view && offset == m_viewOffset && size == m_viewSize) return m_view;
+        Unmap();
+        if (!IsOpen() || offset % kMapGranularity || offset + size > m_size || !size) return nullptr;
+#ifdef _WIN32
+        DWORD access = m_readOnly ? FILE_MAP_READ : FILE_MAP_READ | FILE_MAP_WRITE;
+        void* v = MapViewOfFile(m_mapping, access, (DWORD)(offset >> 32), (DWORD)offset, size);
+        if (!v) return nullptr;
+#else
+        int prot = m_readOnly ? PROT_READ : PROT_READ | PROT_WRITE;
+        void* v = mmap(nullptr, size, prot, MAP_SHARED, m_fd, (off_t)offset);
+        if (v == MAP_FAILED) return nullptr;
+#endif
+        m_view = (uint8_t*)v;
+        m_viewOffset = offset;
+        m_viewSize = size;
+        return m_view;
+    }
+
+    // Write the window back. Asynchronous: schedules the writes and returns.
+    void Flush() {
+        if (!m_view || m_readOnly) return;
+#ifdef _WIN32
+        FlushViewOfFile(m_view, m_viewSize);
+#else
+        msync(m_view, m_viewSize, MS_ASYNC);
+#endif
+    }
+
+    void Unmap() {
+        if (!m_view) return;
+        Flush();
+#ifdef _WIN32
+        UnmapViewOfFile(m_view);
+#else
+        munmap(m_view, m_viewSize);
+#endif
+        m_view = nullptr;
+        m_viewSize = 0;
+    }
+
+    // Positioned read outside the window (false on a short read)
+    bool Read(uint64_t offset, void* out, size_t size) const {
+        if (!IsOpen() || offset + size > m_size) return false;
+#ifdef _WIN32
+        OVERLAPPED ov = {};
+        ov.Offset = (DWORD)offset;
+        ov.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD got = 0;
+        return ReadFile(m_file, out, (DWORD)size, &got, &ov) && got == size;
+#else
+        return pread(m_fd, out, size, (off_t)offset) == (ssize_t)size;
+#endif
+    }
+
+    // Positioned write outside the window
+    bool Write(uint64_t offset, const void* data, size_t size) {
+        if (!IsOpen() || m_readOnly || offset + size > m_size) return false;
+#ifdef _WIN32
+        OVERLAPPED ov = {};
+        ov.Offset = (DWORD)offset;
+        ov.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD put = 0;
+        return WriteFile(m_file, data, (DWORD)size, &put, &ov) && put == size;
+#else
+        return pwrite(m_fd, data, size, (off_t)offset) == (ssize_t)size;
+#endif
+    }
+
+private:
+    uint64_t m_size;
+    uint8_t* m_view;
+    uint64_t m_viewOffset;
+    size_t m_viewSize;
+    bool m_readOnly;
+#ifdef _WIN32
+    HANDLE m_file;
+    HANDLE m_mapping;
+#else
+    int m_fd;
+#endif
+};
+
+} // namespace lt
@@ -0,0 +1,400 @@
+// core/metrics_server.h
+// Minimal loopback HTTP/1.1 endpoint serving one pre-formatted page (OpenMetrics text).
+// The producer (the probe loop) formats the page body once per tick into a back buffer and
+// publishes it; the HTTP header with the final Content-Length is written right in front of the
+// body, so a scrape is a single send() of bytes that already exist. Pages move between the
+// producer and the server thread through a lock-free triple buffer (one atomic exchange per
+// side), so the producer never waits on scrapers and scrapers never see a half-written page.
+// The server thread multiplexes up to MaxClients keep-alive connections with poll/WSAPoll;
+// it only switches to a newer page while no response is being sent from the current one.
+// Only 127.0.0.1 is bound: the endpoint is not reachable from other hosts.
+#pragma once
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>        // MUST be before windows.h
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#endif
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include "text_buffer.h"
+#include "mono_clock.h"
+
+namespace lt {
+
+#ifdef _WIN32
+typedef SOCKET MetricsSocket;
+typedef WSAPOLLFD MetricsPollFd;
+static const MetricsSocket kNoSocket = INVALID_SOCKET;
+static inline void CloseMetricsSocket(MetricsSocket s) { closesocket(s); }
+static inline bool SocketWouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+static inline int PollSockets(MetricsPollFd* fds, uint32_t count, int timeoutMs) { return WSAPoll(fds, count, timeoutMs); }
+static inline bool SetNonBlocking(MetricsSocket s) {
+    u_long on = 1;
+    return ioctlsocket(s, FIONBIO, &on) == 0;
+}
+static const int kSendFlags = 0;
+#else
+typedef int MetricsSocket;
+typedef struct pollfd MetricsPollFd;
+static const MetricsSocket kNoSocket = -1;
+static inline void CloseMetricsSocket(MetricsSocket s) { close(s); }
+static inline bool SocketWouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+static inline int PollSockets(MetricsPollFd* fds, uint32_t count, int timeoutMs) { return poll(fds, count, timeoutMs); }
+static inline bool SetNonBlocking(MetricsSocket s) {
+    int flags = fcntl(s, F_GETFL, 0);
+    return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+static const int kSendFlags = MSG_NOSIGNAL;
+#endif
+
+// Written by the server thread, readable from any thread (self-metrics)
+struct MetricsServerStats {
+    std::atomic<uint64_t> accepted;
+    std::atomic<uint64_t> rejected;      // connections refused because every slot was busy
+    std::atomic<uint64_t> scrapes;       // pages sent in full
+    std::atomic<uint64_t> errors;        // bad requests, unknown paths, timed out connections
+    std::atomic<uint64_t> bytesSent;
+};
+
+template <uint32_t Capacity, uint32_t MaxClients = 8>
+class MetricsServer {
+public:
+    static const uint32_t kHeaderRoom = 192;       // status line and headers, in front of the body
+    static const uint32_t kRequestSize = 2048;     // longer request heads are refused
+    static const uint32_t kIdleTimeoutMs = 15000;  // Prometheus keeps connections open between scrapes
+
+    MetricsServer()
+        : m_listen(kNoSocket), m_port(0),
+          m_bodies{TextBuffer(m_pages[0].data + kHeaderRoom, Capacity), TextBuffer(m_pages[1].data + kHeaderRoom, Capacity),
+                   TextBuffer(m_pages[2].data + kHeaderRoom, Capacity)},
+          m_front(0), m_back(1), m_middle(2), m_sendingFront(0) {
+        for (uint32_t i = 0; i < 3; ++i) {
+            m_pages[i].headerStart = kHeaderRoom;
+            m_pages[i].length = 0;
+        }
+        for (uint32_t i = 0; i < MaxClients; ++i) m_clients[i].socket = kNoSocket;
+        m_stats.accepted.store(0, std::memory_order_relaxed);
+        m_stats.rejected.store(0, std::memory_order_relaxed);
+        m_stats.scrapes.store(0, std::memory_order_relaxed);
+        m_stats.errors.store(0, std::memory_order_relaxed);
+        m_stats.bytesSent.store(0, std::memory_order_relaxed);
+    }
+
+    ~MetricsServer() { Close(); }
+
+    // Listen on 127.0.0.1:port (0 picks a free port, see Port()). Winsock must be initialized.
+    bool Open(uint16_t port) {
+        Close();
+        MetricsSocket s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (s == kNoSocket) return false;
+        int on = 1;
+#ifdef _WIN32
+        setsockopt(s, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (const char*)&on, sizeof(on));
+#else
+        setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+#endif
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        socklen_t len = sizeof(addr);
+        if (bind(s, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, 16) != 0 || !SetNonBlocking(s) ||
+            getsockname(s, (struct sockaddr*)&addr, &len) != 0) {
+            CloseMetricsSocket(s);
+            return false;
+        }
+        m_listen = s;
+        m_port = ntohs(addr.sin_port);
+        return true;
+    }
+
+    void Close() {
+        for (uint32_t i = 0; i < MaxClients; ++i) Drop(m_clients[i]);
+        if (m_listen != kNoSocket) CloseMetricsSocket(m_listen);
+        m_listen = kNoSocket;
+    }
+
+    uint16_t Port() const { return m_port; }
+    const MetricsServerStats& Stats() const { return m_stats; }
+
+    // Producer thread: the body of the next page. Format into it, then Publish().
+    TextBuffer& Page() { return m_bodies[m_back]; }
+
+    // Producer thread: put the HTTP header in front of the body and hand the page over.
+    // Returns false if the body did not fit (the page is published truncated).
+    bool Publish() {
+        PageSlot& p = m_pages[m_back];
+        TextBuffer& body = m_bodies[m_back];
+        char header[kHeaderRoom];
+        TextBuffer h(header, kHeaderRoom);
+        h.Str("HTTP/1.1 200 OK\r\n"
+              "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+              "Content-Length: ");
+        h.U64(body.Length());
+        h.Str("\r\n\r\n");
+        p.headerStart = kHeaderRoom - h.Length();
+        memcpy(p.data + p.headerStart, header, h.Length());
+        p.length = h.Length() + body.Length();
+        bool complete = !body.Truncated();
+        m_back = m_middle.exchange(m_back | kFresh, std::memory_order_acq_rel) & kIndexMask;
+        m_bodies[m_back].Clear();
+        return complete;
+    }
+
+    // Server thread: accept, read requests and send responses, waiting up to waitMs for activity
+    void Serve(uint32_t waitMs) {
+        if (m_listen == kNoSocket) return;
+
+        MetricsPollFd fds[MaxClients + 1];
+        uint32_t slots[MaxClients + 1];
+        uint32_t n = 0;
+        fds[n].fd = m_listen;
+        fds[n].events = POLLIN;
+        fds[n].revents = 0;
+        ++n;
+        for (uint32_t i = 0; i < MaxClients; ++i) {
+            Client& c = m_clients[i];
+            if (c.socket == kNoSocket) continue;
+            fds[n].fd = c.socket;
+            fds[n].events = c.sendLength ? POLLOUT : POLLIN;
+            fds[n].revents = 0;
+            slots[n++] = i;
+        }
+        if (PollSockets(fds, n, (int)waitMs) <= 0) {
+            ExpireIdle();
+            return;
+        }
+        if (fds[0].revents & POLLIN) Accept();
+        for (uint32_t k = 1; k < n; ++k) {
+            if (!fds[k].revents) continue;
+            Client& c = m_clients[slots[k]];
+            if (c.sendLength) {
+                Send(c);
+            } else {
+                Receive(c);
+            }
+        }
+        ExpireIdle();
+    }
+
+private:
+    static const uint32_t kIndexMask = 3;
+    static const uint32_t kFresh = 4;      // middle page has not been picked up yet
+
+    struct PageSlot {
+        uint32_t headerStart;
+        uint32_t length;                   // header + body
+        char data[kHeaderRoom + Capacity];
+    };
+
+    struct Client {
+        MetricsSocket socket;
+        char request[kRequestSize];
+        uint32_t requestLength;
+        const char* send;                  // response being sent (a page or a static reply)
+        uint32_t sendLength;               // 0: reading the next request
+        uint32_t sent;
+        bool fromFront;                    // response points into the front page
+        bool page;                         // a 200 page (counts as a scrape)
+        bool closeAfter;
+        uint64_t activeUs;
+    };
+
+    void Accept() {
+        for (;;) {
+            MetricsSocket s = accept(m_listen, nullptr, nullptr);
+            if (s == kNoSocket) return;
+            Client* c = nullptr;
+            for (uint32_t i = 0; i < MaxClients && !c; ++i) {
+                if (m_clients[i].socket == kNoSocket) c = &m_clients[i];
+            }
+            if (!c || !SetNonBlocking(s)) {
+                CloseMetricsSocket(s);
+                m_stats.rejected.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            c->socket = s;
+            c->requestLength = 0;
+            c->sendLength = 0;
+            c->sent = 0;
+            c->fromFront = false;
+            c->page = false;
+            c->closeAfter = false;
+            c->activeUs = MonoNowUs();
+            m_stats.accepted.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void Receive(Client& c) {
+        int got = recv(c.socket, c.request + c.requestLength, (int)(kRequestSize - c.requestLength), 0);
+        if (got == 0 || (got < 0 && !SocketWouldBlock())) {
+            Drop(c);
+            return;
+        }
+        if (got < 0) return;
+        c.requestLength += (uint32_t)got;
+        c.activeUs = MonoNowUs();
+        Respond(c);
+    }
+
+    // Start the response to the request at the head of c.request, if it is complete
+    void Respond(Client& c) {
+        static const char kNotFound[] = "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: 10\r\n\r\nnot found\n";
+        static const char kBadRequest[] = "HTTP/1.1 400 Bad Request\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+        static const char kNotAllowed[] = "HTTP/1.1 405 Method Not Allowed\r\nAllow: GET\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+        static const char kNotReady[] = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+
+        uint32_t end = HeadEnd(c.request, c.requestLength);
+        if (!end) {
+            if (c.requestLength == kRequestSize) {
+                m_stats.errors.fetch_add(1, std::memory_order_relaxed);
+                Start(c, kBadRequest, sizeof(kBadRequest) - 1, true);
+            }
+            return;
+        }
+        const char* line = c.request;
+        bool get = end >= 4 && !memcmp(line, "GET ", 4);
+        bool metrics = get && end >= 13 && (!memcmp(line + 4, "/metrics ", 9) || !memcmp(line + 4, "/metrics?", 9));
+        // HTTP/1.0 closes unless asked otherwise; 1.1 stays open unless asked to close
+        bool http10 = FindNoCase(line, end, "HTTP/1.0\r\n");
+        bool close = http10 ? !FindNoCase(line, end, "connection: keep-alive") : FindNoCase(line, end, "connection: close");
+        // Drop the request head (pipelined requests stay queued behind it)
+        memmove(c.request, c.request + end, c.requestLength - end);
+        c.requestLength -= end;
+
+        if (!get) {
+            m_stats.errors.fetch_add(1, std::memory_order_relaxed);
+            Start(c, kNotAllowed, sizeof(kNotAllowed) - 1, true);
+        } else if (!metrics) {
+            m_stats.errors.fetch_add(1, std::memory_order_relaxed);
+            Start(c, kNotFound, sizeof(kNotFound) - 1, close);
+        } else if (!PickUpPage()) {
+            Start(c, kNotReady, sizeof(kNotReady) - 1, close);
+        } else {
+            const PageSlot& p = m_pages[m_front];
+            ++m_sendingFront;
+            c.fromFront = true;
+            c.page = true;
+            Start(c, p.data + p.headerStart, p.length, close);
+        }
+    }
+
+    // Switch to the newest published page unless responses are still going out from the
+    // current one. False while nothing has been published yet.
+    bool PickUpPage() {
+        if (m_sendingFront == 0 && (m_middle.load(std::memory_order_acquire) & kFresh)) {
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & kIndexMask;
+        }
+        return m_pages[m_front].length != 0;
+    }
+
+    void Start(Client& c, const char* data, uint32_t length, bool closeAfter) {
+        c.send = data;
+        c.sendLength = length;
+        c.sent = 0;
+        c.closeAfter = closeAfter;
+        Send(c);
+    }
+
+    void Send(Client& c) {
+        while (c.sent < c.sendLength) {
+            int n = send(c.socket, c.send + c.sent, (int)(c.sendLength - c.sent), kSendFlags);
+            if (n < 0) {
+                if (SocketWouldBlock()) return;   // rest goes out on POLLOUT
+                Drop(c);
+                return;
+            }
+            c.sent += (uint32_t)n;
+            c.activeUs = MonoNowUs();
+            m_stats.bytesSent.fetch_add((uint64_t)n, std::memory_order_relaxed);
+        }
+        Release(c);
+        if (c.page) m_stats.scrapes.fetch_add(1, std::memory_order_relaxed);
+        c.page = false;
+        c.sendLength = 0;
+        if (c.closeAfter) {
+            Drop(c);
+        } else if (c.requestLength) {
+            Respond(c);
+        }
+    }
+
+    void Release(Client& c) {
+        if (c.fromFront) --m_sendingFront;
+        c.fromFront = false;
+    }
+
+    void Drop(Client& c) {
+        if (c.socket == kNoSocket) return;
+        Release(c);
+        CloseMetricsSocket(c.socket);
+        c.socket = kNoSocket;
+        c.sendLength = 0;
+        c.page = false;
+    }
+
+    void ExpireIdle() {
+        uint64_t now = MonoNowUs();
+        for (uint32_t i = 0; i < MaxClients; ++i) {
+            Client& c = m_clients[i];
+            if (c.socket != kNoSocket && now - c.activeUs > kIdleTimeoutMs * 1000ull) {
+                if (c.sendLength || c.requestLength) m_stats.errors.fetch_add(1, std::memory_order_relaxed);
+                Drop(c);
+            }
+        }
+    }
+
+    // Length of the request head including the blank line, 0 while incomplete
+    static uint32_t HeadEnd(const char* s, uint32_t length) {
+        for (uint32_t i = 3; i < length; ++i) {
+            if (s[i] == '\n' && s[i - 1] == '\r' && s[i - 2] == '\n' && s[i - 3] == '\r') return i + 1;
+        }
+        return 0;
+    }
+
+    // ASCII case-insensitive search; needle is lower case
+    static bool FindNoCase(const char* s, uint32_t length, const char* needle) {
+        size_t n = strlen(needle);
+        for (uint32_t i = 0; i + n <= length; ++i) {
+            size_t k = 0;
+            while (k < n) {
+                char c = s[i + k];
+                if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+                char w = needle[k];
+                if (w >= 'A' && w <= 'Z') w = (char)(w - 'A' + 'a');
+                if (c != w) break;
+                ++k;
+            }
+            if (k == n) return true;
+        }
+        return false;
+    }
+
+    MetricsSocket m_listen;
+    uint16_t m_port;
+    PageSlot m_pages[3];
+    TextBuffer m_bodies[3];
+    uint32_t m_front;                      // server thread
+    uint32_t m_back;                       // producer thread
+    std::atomic<uint32_t> m_middle;        // index | kFresh
+    uint32_t m_sendingFront;               // responses in progress from the front page
+    Client m_clients[MaxClients];
+    MetricsServerStats m_stats;
+};
+
+} // namespace lt
@@ -0,0 +1,122 @@
+// core/mono_clock.h
+// Monotonic microsecond clock for RTT measurement. ICMP_ECHO_REPLY::RoundTripTime only
+// has millisecond granularity (a LAN gateway reads 0), so backends stamp send and
+// completion themselves: QueryPerformanceCounter on Windows, CLOCK_MONOTONIC elsewhere.
+// On Linux, socket backends can take the receive time from the kernel (SO_TIMESTAMPNS),
+// which leaves scheduler wake-up delay out of the measurement.
+#pragma once
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#ifdef __linux__
+#include <string.h>
+#include <sys/socket.h>
+#endif
+
+namespace lt {
+
+#ifdef _WIN32
+
+static inline uint64_t QpcFrequency() {
+    static const uint64_t frequency = [] {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return (uint64_t)f.QuadPart;
+    }();
+    return frequency;
+}
+
+// Split so that large tick counts cannot overflow the multiplication
+static inline uint64_t TicksToUs(uint64_t ticks) {
+    uint64_t f = QpcFrequency();
+    return ticks / f * 1000000ull + ticks % f * 1000000ull / f;
+}
+
+static inline uint64_t MonoNowUs() {
+    LARGE_INTEGER c;
+    QueryPerformanceCounter(&c);
+    return TicksToUs((uint64_t)c.QuadPart);
+}
+
+// Wall clock, microseconds since 1970 (FILETIME counts 100ns units since 1601)
+static inline uint64_t RealtimeNowUs() {
+    FILETIME ft;
+    GetSystemTimePreciseAsFileTime(&ft);
+    uint64_t t = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    return t / 10 - 11644473600000000ull;
+}
+
+#else
+
+static inline uint64_t MonoNowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static inline uint64_t RealtimeNowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+}
+
+#endif
+
+// Microseconds between two MonoNowUs() stamps, saturated below the kNoReply sentinel
+static inline uint32_t ElapsedUs(uint64_t fromUs, uint64_t toUs) {
+    if (toUs <= fromUs) return 0;
+    uint64_t d = toUs - fromUs;
+    return d >= 0xFFFFFFFEull ? 0xFFFFFFFEu : (uint32_t)d;
+}
+
+#ifdef __linux__
+
+// Ask the kernel to attach a receive timestamp to every datagram on fd
+static inline bool EnableRxTimestamps(int fd) {
+    int on = 1;
+    return setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0;
+}
+
+// Kernel receive stamp (CLOCK_REALTIME microseconds) of a datagram read with recvmsg/recvmmsg.
+// Returns false when the message carries none.
+static inline bool RxRealtimeUs(const struct msghdr* msg, uint64_t* realUs) {
+    for (const struct cmsghdr* c = CMSG_FIRSTHDR((struct msghdr*)msg); c;
+         c = CMSG_NXTHDR((struct msghdr*)msg, (struct cmsghdr*)c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_TIMESTAMPNS) continue;
+        struct timespec ts;
+        memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+        *realUs = (uint64_t)ts.tv_sec * 1000000ull + (uint64_t)ts.tv_nsec / 1000;
+        return true;
+    }
+    return false;
+}
+
+// Realtime stamp mapped onto the MonoNowUs() clock through a (nowMono, nowReal) pair read
+// together. Only the stamp's age is used, so wall clock steps do not leak into RTTs.
+static inline uint64_t RealtimeToMonoUs(uint64_t realUs, uint64_t nowMono, uint64_t nowReal) {
+    uint64_t age = nowReal > realUs ? nowReal - realUs : 0;
+    return nowMono > age ? nowMono - age : 0;
+}
+
+// Receive time of a datagram read with recvmsg, on the MonoNowUs() clock.
+// Returns false when the message carries no timestamp (caller falls back to MonoNowUs()).
+static inline bool RxTimestampUs(const struct msghdr* msg, uint64_t* monoUs) {
+    uint64_t rxUs;
+    if (!RxRealtimeUs(msg, &rxUs)) return false;
+    uint64_t nowMono = MonoNowUs();
+    *monoUs = RealtimeToMonoUs(rxUs, nowMono, RealtimeNowUs());
+    return true;
+}
+
+#endif // __linux__
+
+} // namespace lt
@@ -0,0 +1,136 @@
+// core/openmetrics.h
+// OpenMetrics text exposition helpers over TextBuffer, plus the per-target probe counters the
+// headless exporter keeps. Metric families are written in one pass per family (OpenMetrics
+// requires a family's samples to be contiguous) and the page ends with "# EOF".
+// RTT histograms are exported as classic cumulative buckets cut from LatencyHistogram at
+// half-octave edges (64us, 96us, 128us ... 12.6s). Every bound is a bucket edge of the
+// log-linear histogram, so the counts are exact, not interpolated. (Prometheus native/sparse
+// histograms only exist in the protobuf format; the text format has no way to carry them.)
+#pragma once
+
+#include <stdint.h>
+#include "probe_backend.h"
+#include "latency_histogram.h"
+#include "text_buffer.h"
+
+namespace lt {
+
+// Lifetime counters of one target, fed with every completed probe
+struct TargetMetrics {
+    uint64_t replies;
+    uint64_t timeouts;
+    uint64_t errors;
+    uint64_t rttSumUs;
+    LatencyHistogram rtt;    // replies only, microseconds
+
+    TargetMetrics() { Reset(); }
+
+    void Reset() {
+        replies = 0;
+        timeouts = 0;
+        errors = 0;
+        rttSumUs = 0;
+        rtt.Reset();
+    }
+
+    void Add(const ProbeResult& r) {
+        if (r.status == PROBE_OK && r.rttUs != kNoReply) {
+            ++replies;
+            rttSumUs += r.rttUs;
+            rtt.Add(r.rttUs);
+        } else if (r.status == PROBE_TIMEOUT) {
+            ++timeouts;
+        } else {
+            ++errors;
+        }
+    }
+};
+
+// "# TYPE", "# UNIT" (when unit is set) and "# HELP" lines of a family
+static inline void OpenMetricsFamily(TextBuffer& out, const char* name, const char* type, const char* unit, const char* help) {
+    out.Str("# TYPE ");
+    out.Str(name);
+    out.Char(' ');
+    out.Str(type);
+    out.Char('\n');
+    if (unit) {
+        out.Str("# UNIT ");
+        out.Str(name);
+        out.Char(' ');
+        out.Str(unit);
+        out.Char('\n');
+    }
+    out.Str("# HELP ");
+    out.Str(name);
+    out.Char(' ');
+    out.Str(help);
+    out.Char('\n');
+}
+
+// name + suffix + {labels} (labels: pre-formatted `key="value",...`, may be null or empty)
+static inline void OpenMetricsName(TextBuffer& out, const char* name, const char* suffix, const char* labels) {
+    out.Str(name);
+    if (suffix) out.Str(suffix);
+    if (labels && *labels) {
+        out.Char('{');
+        out.Str(labels);
+        out.Char('}');
+    }
+    out.Char(' ');
+}
+
+static inline void OpenMetricsValue(TextBuffer& out, const char* name, const char* suffix, const char* labels, uint64_t value) {
+    OpenMetricsName(out, name, suffix, labels);
+    out.U64(value);
+    out.Char('\n');
+}
+
+// Microseconds written as seconds
+static inline void OpenMetricsSeconds(TextBuffer& out, const char* name, const char* suffix, const char* labels, uint64_t us) {
+    OpenMetricsName(out, name, suffix, labels);
+    out.Fixed(us, 6);
+    out.Char('\n');
+}
+
+// _bucket/_count/_sum series of a histogram in microseconds, exported in seconds
+static inline void OpenMetricsHistogram(TextBuffer& out, const char* name, const char* labels,
+                                        const LatencyHistogram& h, uint64_t sumUs) {
+    uint64_t cumulative = 0;
+    uint32_t index = 0;
+    for (uint32_t octave = 6; octave < 24; ++octave) {
+        for (uint32_t half = 0; half < 2; ++half) {
+            // 2^k and 1.5 * 2^k are lower edges of histogram buckets: count everything below
+            uint32_t bound = half ? 3u << (octave - 1) : 1u << octave;
+            uint32_t end = LatencyHistogram::IndexOf(bound);
+            for (; index < end; ++index) cumulative += h.BucketCount(index);
+            out.Str(name);
+            out.Str("_bucket{");
+            if (labels && *labels) {
+                out.Str(labels);
+                out.Char(',');
+            }
+            out.Str("le=\"");
+            out.Fixed(bound, 6);
+            out.Str("\"} ");
+            out.U64(cumulative);
+            out.Char('\n');
+        }
+    }
+    out.Str(name);
+    out.Str("_bucket{");
+    if (labels && *labels) {
+        out.Str(labels);
+        out.Char(',');
+    }
+    out.Str("le=\"+Inf\"} ");
+    out.U64(h.Count());
+    out.Char('\n');
+    OpenMetricsValue(out, name, "_count", labels, h.Count());
+    OpenMetricsSeconds(out, name, "_sum", labels, sumUs);
+}
+
+static inline void OpenMetricsEnd(TextBuffer& out) {
+    out.Str("# EOF\n");
+}
+
+} // namespace lt
@@ -0,0 +1,87 @@
+// core/presets.h
+// Preset latency targets shared by the v1.0 tray build and the headless build. Slot 0 is the
+// default gateway: it has no fixed address and is bound to whatever the route tracker reports.
+// Names are plain ASCII so both narrow (console, JSON) and wide (tray) output can use them.
+// Most targets are measured by ICMP echo. TCP targets are measured by handshake time to a port
+// (for hosts and networks that drop ICMP), DNS targets by the time a resolver takes to answer a
+// query; their statistics are kept and shown the same way.
+// The table is constexpr: every address is parsed at compile time (ip_address.h) into the
+// binary form backends bind without parsing, its family follows from the text, and a malformed
+// address does not compile. Records are one cache line each; the probe and render loops only
+// carry a slot index into them.
+#pragma once
+
+#include <stdint.h>
+#include "probe_backend.h"
+
+namespace lt {
+
+struct alignas(64) PresetTarget {
+    const char* ip;         // nullptr for the default gateway slot
+    const char* name;
+    const char* location;
+    IpAddress address;      // ip, parsed; IP_NONE for the default gateway slot
+    ProbeMethod method;
+    uint16_t port;          // TCP and DNS: port probed (0 for ICMP)
+
+    constexpr bool IsIPv6() const { return address.IsIPv6(); }
+};
+
+static_assert(sizeof(PresetTarget) == 64, "one cache line per preset");
+
+constexpr PresetTarget Preset(const char* ip, const char* name, const char* location,
+                              ProbeMethod method = METHOD_ICMP, uint16_t port = 0) {
+    return PresetTarget{ip, name, location, ip ? IpLiteral(ip) : IpAddress{}, method, port};
+}
+
+static constexpr PresetTarget kPresets[] = {
+    // Default gateway (special case - detected dynamically)
+    Preset(nullptr, "Default Gateway", "Auto-detect"),
+
+    // Cloudflare DNS - Fast and reliable, global distribution
+    Preset("1.1.1.1", "Cloudflare DNS", "Global (Anycast)"),
+    Preset("1.0.0.1", "Cloudflare DNS (Alt)", "Global (Anycast)"),
+
+    // Google DNS - Global distribution
+    Preset("8.8.8.8", "Google DNS", "Global (Anycast)"),
+    Preset("8.8.4.4", "Google DNS (Alt)", "Global (Anycast)"),
+
+    // Quad9 DNS - Security-focused, global
+    Preset("9.9.9.9", "Quad9 DNS", "Global (Anycast)"),
+
+    // OpenDNS - Cisco
+    Preset("208.67.222.222", "OpenDNS", "Global"),
+
+    // US East Coast - Cloudflare edge (typically NYC area)
+    Preset("1.1.1.1", "Cloudflare (US East)", "US East"),
+
+    // US West Coast - Cloudflare edge (typically LA area)
+    Preset("1.0.0.1", "Cloudflare (US West)", "US West"),
+
+    // US Central - Google edge
+    Preset("8.8.4.4", "Google (US Central)", "US Central"),
+
+    // Netflix/Fast.com IPv6 servers (direct ISP peering)
+    Preset("2a00:86c0:2054:2054::167", "Fast.com (Pittsburgh)", "Pittsburgh, PA"),
+    Preset("2a00:86c0:2063:2063::135", "Fast.com (Ashburn)", "Ashburn, VA"),
+
+    // TCP handshake to HTTPS/DNS ports - for networks that filter ICMP
+    Preset("1.1.1.1", "Cloudflare HTTPS (TCP)", "Global (Anycast)", METHOD_TCP, 443),
+    Preset("8.8.8.8", "Google DNS (TCP)", "Global (Anycast)", METHOD_TCP, 53),
+
+    // DNS query time (UDP) - how fast each resolver actually answers
+    Preset("1.1.1.1", "Cloudflare DNS (query)", "Global (Anycast)", METHOD_DNS, 53),
+    Preset("8.8.8.8", "Google DNS (query)", "Global (Anycast)", METHOD_DNS, 53),
+    Preset("9.9.9.9", "Quad9 DNS (query)", "Global (Anycast)", METHOD_DNS, 53),
+    Preset("208.67.222.222", "OpenDNS (query)", "Global", METHOD_DNS, 53),
+};
+
+static const uint32_t kPresetCount = sizeof(kPresets) / sizeof(kPresets[0]);
+
+// Address to use for the gateway slot when no default route is known
+static const char* const kGatewayFallback = "1.1.1.1";
+
+// Name DNS targets ask for: popular enough to be cached by every public resolver
+static const char* const kDnsQueryName = "example.com";
+
+} // namespace lt
@@ -0,0 +1,84 @@
+// core/probe_backend.h
+// Probe backend interface shared by the tray builds, the simulator and any future
+// socket-based prober. A backend only knows how to put echoes on the wire and report
+// completions; scheduling, sequencing and bookkeeping live in ProbeEngine.
+#pragma once
+
+#include <stdint.h>
+#include "ip_address.h"
+
+namespace lt {
+
+// Returned in ProbeResult::rttUs / apiRttMs when there is no value (same sentinel PingOnce used)
+static const uint32_t kNoReply = 0xFFFFFFFF;
+
+enum ProbeStatus : uint8_t {
+    PROBE_OK = 0,       // echo reply received
+    PROBE_TIMEOUT = 1,  // no reply within the timeout
+    PROBE_ERROR = 2,    // send failed or an ICMP error came back (unreachable, TTL expired...)
+    PROBE_LATE = 3      // a reply to an echo that was already completed (after its timeout, or a
+                        // duplicate); seq names that echo. Counted by the engine, never returned by Run.
+};
+
+// How a target is measured. ICMP echo is the default; the others exist for targets that drop
+// or deprioritize ICMP (see tcp_connect_backend.h, dns_query_backend.h) or, for HTTP, for the
+// service rather than the host (http_probe_backend.h).
+enum ProbeMethod : uint8_t {
+    METHOD_ICMP = 0,    // echo request/reply
+    METHOD_TCP = 1,     // TCP handshake time to a port
+    METHOD_DNS = 2,     // DNS query over UDP, time to the matching response
+    METHOD_HTTP = 3     // HTTP/1.1 GET, time to the first response byte
+};
+
+struct ProbeResult {
+    uint32_t target;     // slot index passed to Send
+    uint32_t seq;        // engine sequence number passed to Send
+    uint32_t rttUs;      // measured round trip in microseconds, kNoReply unless status == PROBE_OK
+    uint32_t apiRttMs;   // round trip as reported by the platform API (RoundTripTime), kNoReply if none
+    uint8_t status;      // ProbeStatus
+};
+
+class ProbeBackend {
+public:
+    virtual ~ProbeBackend() {}
+
+    // Bind a target slot to an address. Called again when the address changes (default gateway).
+    // Returns false when the address cannot be parsed; the slot is then left unbound.
+    // An echo still outstanding for the slot is completed exactly once, under its own seq, like
+    // any other: backends that can abandon it (close its socket, forget its ID) report it as
+    // PROBE_ERROR from the next Poll, the others when its reply or timeout comes. Until then
+    // Send refuses the slot; ProbeEngine waits for that completion and drops it.
+    virtual bool SetTarget(uint32_t target, const char* ip, bool isIPv6) = 0;
+
+    // Bind a target slot to an address that is already parsed (presets.h holds them parsed at
+    // compile time). Address backends fill their sockaddr from the bytes; the default goes
+    // through the text form for backends that take something else (the simulator, URLs).
+    virtual bool SetTargetAddress(uint32_t target, const IpAddress& address) {
+        char text[kIpAddressTextSize];
+        if (!FormatIpAddress(address, text, sizeof(text))) return false;
+        return SetTarget(target, text, address.IsIPv6());
+    }
+
+    // Start one echo toward a bound slot. At most one echo per slot is outstanding at a time.
+    // Returns false if the request could not be issued (nothing will be reported for it).
+    virtual bool Send(uint32_t target, uint32_t seq, uint32_t timeoutMs) = 0;
+
+    // Collect finished echoes into out[]. Blocks up to waitMs when nothing is ready yet.
+    // Returns the number of results written (0 on timeout).
+    virtual int Poll(ProbeResult* out, int maxResults, uint32_t waitMs) = 0;
+
+    // Monotonic milliseconds on the backend's clock (virtual time for the simulator).
+    // Used for scheduling only; RTTs are measured by the backend (see mono_clock.h).
+    virtual uint64_t NowMs() = 0;
+};
+
+// Backend polled next to another one that does the waiting (probe_mux.h): Poll(..., 0) never
+// blocks, and MsUntilTimeout tells the waiting backend how long it may sleep.
+class SideBackend : public ProbeBackend {
+public:
+    // Milliseconds until the earliest pending probe times out (rounded up), 0 if one already
+    // has, kNoReply if none is pending
+    virtual uint32_t MsUntilTimeout() const = 0;
+};
+
+} // namespace lt
@@ -0,0 +1,305 @@
+// core/probe_engine.h
+// Keeps every configured target probed concurrently through a ProbeBackend.
+// Each target slot has its own schedule, sequence numbers and rolling statistics, so a dead
+// target only occupies its own slot (until its timeout) and never delays the others.
+// Deadlines come from a ProbeScheduler (fixed 1/interval by default, adaptive on request).
+// Loss is accounted per target by sequence number (LossTracker): sliding-window loss, burst
+// lengths, and late, duplicate and reordered replies reported by the backend.
+// No heap allocation: capacities are template parameters and instances are meant to be
+// static (the trimmed build runs the worker on a 32KB stack).
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include "probe_backend.h"
+#include "rolling_stats.h"
+#include "latency_histogram.h"
+#include "probe_scheduler.h"
+#include "loss_tracker.h"
+
+namespace lt {
+
+static const uint32_t kDefaultStatsWindow = 60;      // samples in the tooltip statistics
+static const uint32_t kMaxConsecutiveFailures = 5;   // clear stale averages after this many misses
+
+template <uint32_t StatsCapacity>
+struct TargetState {
+    bool bound;                 // slot has an address
+    bool inFlight;              // an echo is outstanding in the backend
+    bool discardInFlight;       // outstanding echo belongs to a previous address
+    uint32_t seq;               // sequence number of the outstanding (or last) echo
+    uint64_t sentAtMs;
+    uint32_t sent;
+    uint32_t completed;         // replies + timeouts + errors
+    uint32_t received;
+    LossTracker loss;           // by sequence number; its current burst clears stale averages
+
+    // All RTT statistics are in microseconds
+    RollingStats<StatsCapacity> stats;   // replies only; timeouts never enter the window
+    LatencyHistogram window;             // same samples as stats, for percentiles
+    LatencyHistogram lifetime;           // every reply since the slot was bound
+
+    // Measured RTT against the API's millisecond RoundTripTime, for replies that had both
+    uint32_t lastApiRttMs;
+    uint32_t apiSamples;
+    int64_t apiErrorSumUs;      // sum of (measured - API), signed
+    uint32_t apiErrorMaxUs;     // largest |measured - API|
+
+    // Published for the UI thread (menu shows every target live)
+    std::atomic<uint32_t> lastRttUs;
+    std::atomic<uint32_t> avgRttUs;
+};
+
+template <uint32_t MaxTargets, uint32_t StatsCapacity = kDefaultStatsWindow>
+class ProbeEngine {
+public:
+    typedef TargetState<StatsCapacity> SlotState;
+
+    ProbeEngine() : m_backend(nullptr), m_count(0), m_intervalMs(1000), m_timeoutMs(1000) {
+        for (uint32_t i = 0; i < MaxTargets; ++i) ResetState(m_targets[i]);
+    }
+
+    // intervalMs: per-target probe period. timeoutMs: handed to the backend for each echo.
+    // statsWindow: samples kept in each target's rolling statistics (up to StatsCapacity).
+    void Init(ProbeBackend* backend, uint32_t targetCount, uint32_t intervalMs, uint32_t timeoutMs,
+              uint32_t statsWindow = StatsCapacity) {
+        m_backend = backend;
+        m_count = targetCount < MaxTargets ? targetCount : MaxTargets;
+        m_intervalMs = intervalMs ? intervalMs : 1;
+        m_timeoutMs = timeoutMs;
+        m_scheduler.Configure(FixedCadence(m_intervalMs), m_count);
+        for (uint32_t i = 0; i < MaxTargets; ++i) {
+            m_targets[i].stats.SetWindow(statsWindow);
+            ResetState(m_targets[i]);
+        }
+    }
+
+    // Switch to another cadence (adaptive bursts/backoff, probe budget). Call after Init and
+    // before SetTarget; the base interval becomes config.intervalMs.
+    void SetCadence(const CadenceConfig& config) {
+        m_scheduler.Configure(config, m_count);
+        m_intervalMs = m_scheduler.Config().intervalMs;
+    }
+
+    // New cadence and timeout while running (config reload); bound slots keep their state
+    void SetTiming(const CadenceConfig& config, uint32_t timeoutMs) {
+        m_scheduler.Retime(config);
+        m_intervalMs = m_scheduler.Config().intervalMs;
+        m_timeoutMs = timeoutMs;
+    }
+
+    // Change the number of slots in use while running (config reload). Slots past the new
+    // count are unbound; slots added start unbound. The others keep their state.
+    void Resize(uint32_t targetCount) {
+        uint32_t count = targetCount < MaxTargets ? targetCount : MaxTargets;
+        for (uint32_t i = count; i < m_count; ++i) Unbind(i);
+        m_count = count;
+        m_scheduler.Resize(m_count);
+    }
+
+    // Keep the displayed target at the base cadence (-1: none)
+    void SetFocus(int index) { m_scheduler.SetFocus(index); }
+
+    // Bind (or re-bind) a slot. ip == nullptr unbinds it. History for the slot is reset.
+    bool SetTarget(uint32_t index, const char* ip, bool isIPv6) {
+        if (!Unbind(index)) return false;
+        if (!ip) return true;
+        if (!m_backend->SetTarget(index, ip, isIPv6)) return false;
+        Bound(index);
+        return true;
+    }
+
+    // The same with an address parsed beforehand (presets.h); IP_NONE unbinds the slot
+    bool SetTarget(uint32_t index, const IpAddress& address) {
+        if (!Unbind(index)) return false;
+        if (!address.Valid()) return true;
+        if (!m_backend->SetTargetAddress(index, address)) return false;
+        Bound(index);
+        return true;
+    }
+
+    // One engine pass: send every due echo, then wait (at most maxWaitMs, less if another
+    // send is due sooner) for completions. Results that were applied are copied to out[]
+    // so the caller can react to them; returns how many were copied.
+    int Run(uint32_t maxWaitMs, ProbeResult* out, int maxOut) {
+        if (!m_backend) return 0;
+        int produced = 0;
+        uint64_t now = m_backend->NowMs();
+        uint64_t wakeAt = now + maxWaitMs;
+
+        for (uint32_t i = 0; i < m_count; ++i) {
+            SlotState& t = m_targets[i];
+            if (t.inFlight) {
+                // Safety net: a backend that never reports a completion must not wedge the slot
+                uint64_t expireAt = t.sentAtMs + 2ull * m_timeoutMs + m_intervalMs;
+                if (now >= expireAt) {
+                    ProbeResult r = {i, t.seq, kNoReply, kNoReply, PROBE_TIMEOUT};
+                    if (Apply(r, now) && produced < maxOut) out[produced++] = r;
+                } else {
+                    if (expireAt < wakeAt) wakeAt = expireAt;
+                    continue;
+                }
+            }
+            if (!t.bound) continue;
+            // The scheduler advances the deadline on its absolute grid (or defers it when the
+            // probe budget is spent)
+            if (now >= m_scheduler.DueMs(i) && m_scheduler.Fire(i, now)) {
+                ++t.seq;
+                if (m_backend->Send(i, t.seq, m_timeoutMs)) {
+                    t.inFlight = true;
+                    t.sentAtMs = now;
+                    ++t.sent;
+                } else {
+                    ProbeResult r = {i, t.seq, kNoReply, kNoReply, PROBE_ERROR};
+                    Record(i, r, now);
+                    if (produced < maxOut) out[produced++] = r;
+                }
+            }
+            // In-flight slots can only send after their completion, which wakes Poll anyway
+            if (!t.inFlight && m_scheduler.DueMs(i) < wakeAt) wakeAt = m_scheduler.DueMs(i);
+        }
+
+        uint32_t waitMs = wakeAt > now ? (uint32_t)(wakeAt - now) : 0;
+        if (produced > 0) waitMs = 0;
+        int base = produced;
+        int n = m_backend->Poll(out + base, maxOut - base, waitMs);
+        uint64_t doneAt = n ? m_backend->NowMs() : now;
+        for (int k = 0; k < n; ++k) {
+            // Compact in place, dropping stale completions
+            ProbeResult r = out[base + k];
+            if (Apply(r, doneAt)) out[produced++] = r;
+        }
+        return produced;
+    }
+
+    uint32_t Count() const { return m_count; }
+    uint32_t IntervalMs() const { return m_intervalMs; }
+    uint32_t TimeoutMs() const { return m_timeoutMs; }
+    const SlotState& State(uint32_t index) const { return m_targets[index]; }
+    const ProbeScheduler<MaxTargets>& Scheduler() const { return m_scheduler; }
+
+    // Safe to call from any thread (microseconds, kNoReply after a failed probe)
+    uint32_t LastRttUs(uint32_t index) const {
+        return index < m_count ? m_targets[index].lastRttUs.load(std::memory_order_relaxed) : kNoReply;
+    }
+    uint32_t AverageRttUs(uint32_t index) const {
+        return index < m_count ? m_targets[index].avgRttUs.load(std::memory_order_relaxed) : 0;
+    }
+
+    // Mean of (measured - API-reported) RTT in microseconds; 0 without comparable samples
+    int32_t ApiErrorUs(uint32_t index) const {
+        if (index >= m_count || !m_targets[index].apiSamples) return 0;
+        return (int32_t)(m_targets[index].apiErrorSumUs / (int64_t)m_targets[index].apiSamples);
+    }
+
+private:
+    bool Unbind(uint32_t index) {
+        if (!m_backend || index >= m_count) return false;
+        SlotState& t = m_targets[index];
+        bool wasInFlight = t.inFlight;
+        uint32_t seq = t.seq;
+        uint64_t sentAtMs = t.sentAtMs;
+        ResetState(t);
+        // Keep sequence numbers increasing and wait for any outstanding echo to drain,
+        // so a late reply from the old address is never counted against the new one. The
+        // backend completes that echo (ProbeBackend::SetTarget); its send time keeps the
+        // safety net in Run from giving up on it early.
+        t.seq = seq;
+        t.inFlight = wasInFlight;
+        t.discardInFlight = wasInFlight;
+        t.sentAtMs = sentAtMs;
+        m_scheduler.Stop(index);
+        return true;
+    }
+
+    void Bound(uint32_t index) {
+        m_targets[index].bound = true;
+        // Spread the first probes across one interval instead of sending them in a burst
+        m_scheduler.Start(index, m_backend->NowMs() + (uint64_t)m_intervalMs * index / (m_count ? m_count : 1));
+    }
+
+    static void ResetState(SlotState& t) {
+        t.bound = false;
+        t.inFlight = false;
+        t.discardInFlight = false;
+        t.seq = 0;
+        t.sentAtMs = 0;
+        t.sent = 0;
+        t.completed = 0;
+        t.received = 0;
+        t.loss.Reset();
+        t.stats.Reset();
+        t.window.Reset();
+        t.lifetime.Reset();
+        t.lastApiRttMs = kNoReply;
+        t.apiSamples = 0;
+        t.apiErrorSumUs = 0;
+        t.apiErrorMaxUs = 0;
+        t.lastRttUs.store(kNoReply, std::memory_order_relaxed);
+        t.avgRttUs.store(0, std::memory_order_relaxed);
+    }
+
+    // Returns false for completions that no longer match an outstanding echo
+    bool Apply(const ProbeResult& r, uint64_t nowMs) {
+        if (r.target >= m_count) return false;
+        SlotState& t = m_targets[r.target];
+        if (r.status == PROBE_LATE) {
+            t.loss.RecordLate(r.seq);
+            return false;
+        }
+        if (!t.inFlight || r.seq != t.seq) {
+            // A reply the safety net already gave up on
+            if (r.status == PROBE_OK) t.loss.RecordLate(r.seq);
+            return false;
+        }
+        t.inFlight = false;
+        if (t.discardInFlight) {
+            t.discardInFlight = false;
+            return false;
+        }
+        Record(r.target, r, nowMs);
+        return true;
+    }
+
+    void Record(uint32_t index, const ProbeResult& r, uint64_t nowMs) {
+        SlotState& t = m_targets[index];
+        m_scheduler.OnResult(index, r.status, r.rttUs, nowMs);
+        ++t.completed;
+        bool ok = r.status == PROBE_OK && r.rttUs != kNoReply;
+        t.loss.Record(r.seq, !ok);
+        if (ok) {
+            ++t.received;
+            uint32_t evicted;
+            if (t.stats.Add(r.rttUs, &evicted)) t.window.Remove(evicted);
+            t.window.Add(r.rttUs);
+            t.lifetime.Add(r.rttUs);
+            t.lastApiRttMs = r.apiRttMs;
+            if (r.apiRttMs != kNoReply) {
+                int64_t err = (int64_t)r.rttUs - (int64_t)r.apiRttMs * 1000;
+                uint32_t absErr = (uint32_t)(err < 0 ? -err : err);
+                ++t.apiSamples;
+                t.apiErrorSumUs += err;
+                if (absErr > t.apiErrorMaxUs) t.apiErrorMaxUs = absErr;
+            }
+            t.lastRttUs.store(r.rttUs, std::memory_order_relaxed);
+            t.avgRttUs.store(t.stats.Mean(), std::memory_order_relaxed);
+        } else {
+            t.lastRttUs.store(kNoReply, std::memory_order_relaxed);
+            // Clear stale averages after consecutive failures to avoid misleading data
+            if (t.loss.CurrentBurst() >= kMaxConsecutiveFailures) {
+                t.stats.Reset();
+                t.window.Reset();
+                t.avgRttUs.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    ProbeBackend* m_backend;
+    uint32_t m_count;
+    uint32_t m_intervalMs;
+    uint32_t m_timeoutMs;
+    ProbeScheduler<MaxTargets> m_scheduler;
+    SlotState m_targets[MaxTargets];
+};
+
+} // namespace lt
@@ -0,0 +1,91 @@
+// core/probe_mux.h
+// ProbeBackend that routes each target slot to one of several backends: ICMP echo for most
+// targets, and side backends (TCP connect time, DNS queries) for the slots routed to them.
+// Slot indices and results pass through unchanged, so the engine, statistics and history
+// treat every kind the same way. Waiting happens in the ICMP backend, which must also be woken
+// by the side backends: on Linux the descriptors are chained (each side's epoll set holds the
+// next one's, the last holds the route socket, and the ICMP backend's wake fd is the first);
+// on Windows all of them share one wake event. The wait is cut short at the earliest side
+// timeout.
+#pragma once
+
+#include <stdint.h>
+#include "probe_backend.h"
+
+namespace lt {
+
+template <uint32_t MaxTargets, uint32_t MaxSides = 2>
+class ProbeMux : public ProbeBackend {
+public:
+    ProbeMux() : m_waiter(nullptr), m_sideCount(0) {
+        for (uint32_t i = 0; i < MaxTargets; ++i) m_route[i] = 0;
+    }
+
+    void Init(ProbeBackend* waiter) { m_waiter = waiter; }
+
+    // Register a side backend. False when MaxSides are already registered.
+    bool AddSide(SideBackend* side) {
+        if (m_sideCount >= MaxSides) return false;
+        m_sides[m_sideCount++] = side;
+        return true;
+    }
+
+    // Probe the slot with backend (the waiter or a registered side). Call before binding it.
+    void Route(uint32_t target, ProbeBackend* backend) {
+        if (target >= MaxTargets) return;
+        m_route[target] = 0;
+        for (uint32_t k = 0; k < m_sideCount; ++k) {
+            if (m_sides[k] == backend) m_route[target] = (uint8_t)(k + 1);
+        }
+    }
+
+    bool SetTarget(uint32_t target, const char* ip, bool isIPv6) override {
+        if (target >= MaxTargets) return false;
+        return Backend(target)->SetTarget(target, ip, isIPv6);
+    }
+
+    bool SetTargetAddress(uint32_t target, const IpAddress& address) override {
+        if (target >= MaxTargets) return false;
+        return Backend(target)->SetTargetAddress(target, address);
+    }
+
+    bool Send(uint32_t target, uint32_t seq, uint32_t timeoutMs) override {
+        if (target >= MaxTargets) return false;
+        return Backend(target)->Send(target, seq, timeoutMs);
+    }
+
+    int Poll(ProbeResult* out, int maxResults, uint32_t waitMs) override {
+        int n = PollSides(out, maxResults);
+        uint32_t wait = n ? 0 : waitMs;
+        for (uint32_t k = 0; k < m_sideCount && wait; ++k) {
+            uint32_t untilTimeout = m_sides[k]->MsUntilTimeout();
+            if (untilTimeout < wait) wait = untilTimeout;
+        }
+        n += m_waiter->Poll(out + n, maxResults - n, wait);
+        // The wait may have ended on a side completion
+        if (wait) n += PollSides(out + n, maxResults - n);
+        return n;
+    }
+
+    uint64_t NowMs() override { return m_waiter->NowMs(); }
+
+private:
+    ProbeBackend* Backend(uint32_t target) {
+        return m_route[target] ? (ProbeBackend*)m_sides[m_route[target] - 1] : m_waiter;
+    }
+
+    int PollSides(ProbeResult* out, int maxResults) {
+        int n = 0;
+        for (uint32_t k = 0; k < m_sideCount && n < maxResults; ++k) {
+            n += m_sides[k]->Poll(out + n, maxResults - n, 0);
+        }
+        return n;
+    }
+
+    ProbeBackend* m_waiter;
+    SideBackend* m_sides[MaxSides];
+    uint32_t m_sideCount;
+    uint8_t m_route[MaxTargets];   // 0: waiter, k: m_sides[k - 1]
+};
+
+} // namespace lt
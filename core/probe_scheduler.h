@@ -0,0 +1,277 @@
+// core/probe_scheduler.h
+// Per-target probe cadence on absolute deadlines. A target's next probe is due one interval
+// after the previous *deadline* (not after the previous reply), so the sampling rate does not
+// drift with RTT or render time; a stalled loop skips missed ticks instead of bursting.
+// The cadence adapts: a run of fast probes after the RTT changes or a target starts/stops
+// answering, a doubling interval while it stays stable, and a token bucket that keeps all
+// targets together within a probe budget. Time is always passed in, so the scheduler runs
+// on any clock (backend NowMs(), the simulator's virtual time, a test's fake counter).
+#pragma once
+
+#include <stdint.h>
+#include "probe_backend.h"
+#include "latency_histogram.h"
+
+namespace lt {
+
+struct CadenceConfig {
+    uint32_t intervalMs;        // base period
+    uint32_t minIntervalMs;     // period during a burst (== intervalMs: no bursts)
+    uint32_t maxIntervalMs;     // backoff ceiling (== intervalMs: no backoff)
+    uint32_t burstProbes;       // fast probes after a change
+    uint32_t stableProbes;      // unchanged replies before the interval doubles
+    uint32_t changePermille;    // RTT change relative to the running average that counts...
+    uint32_t changeFloorUs;     // ...provided it is also at least this large
+    uint32_t budgetPerMinute;   // probes per minute over all targets, 0 = unlimited
+};
+
+// The old behaviour: one probe per interval, nothing adaptive
+static inline CadenceConfig FixedCadence(uint32_t intervalMs) {
+    CadenceConfig c = {intervalMs, intervalMs, intervalMs, 0, 0, 0, 0, 0};
+    return c;
+}
+
+// Burst to a quarter of the interval on change, back off to 4x while stable
+static inline CadenceConfig AdaptiveCadence(uint32_t intervalMs, uint32_t budgetPerMinute) {
+    CadenceConfig c = {intervalMs, intervalMs / 4 ? intervalMs / 4 : 1, intervalMs * 4,
+                       8, 10, 250, 2000, budgetPerMinute};
+    return c;
+}
+
+struct SchedulerStats {
+    uint64_t ticks;            // probes fired
+    uint64_t skippedTicks;     // deadlines dropped after a stall
+    uint64_t deferred;         // probes postponed by the budget
+    uint32_t maxLateMs;
+    LatencyHistogram lateMs;   // how late each tick fired, in ms
+};
+
+template <uint32_t MaxTargets>
+class ProbeScheduler {
+public:
+    ProbeScheduler() : m_count(0), m_focus(-1), m_credit(0), m_creditAtMs(0) {
+        m_config = FixedCadence(1000);
+        ResetStats();
+        for (uint32_t i = 0; i < MaxTargets; ++i) Stop(i);
+    }
+
+    void Configure(const CadenceConfig& config, uint32_t targetCount) {
+        SetConfig(config);
+        m_count = targetCount < MaxTargets ? targetCount : MaxTargets;
+        m_credit = BucketCapacity();
+        m_creditAtMs = 0;
+        for (uint32_t i = 0; i < MaxTargets; ++i) Stop(i);
+    }
+
+    // Change the cadence while running: active slots keep their grid and go back to the new
+    // base interval, one interval after the deadline they last fired on
+    void Retime(const CadenceConfig& config) {
+        SetConfig(config);
+        if (m_credit > BucketCapacity()) m_credit = BucketCapacity();
+        for (uint32_t i = 0; i < m_count; ++i) {
+            Slot& s = m_slots[i];
+            if (!s.active) continue;
+            s.intervalMs = m_config.intervalMs;
+            s.burstLeft = 0;
+            s.stable = 0;
+            Reschedule(s);
+        }
+    }
+
+    // Change the number of targets while running; slots past the new count stop, the others
+    // carry on
+    void Resize(uint32_t targetCount) {
+        uint32_t count = targetCount < MaxTargets ? targetCount : MaxTargets;
+        for (uint32_t i = count; i < m_count; ++i) Stop(i);
+        m_count = count;
+    }
+
+    // The displayed target never backs off past the base interval (-1: none)
+    void SetFocus(int index) {
+        m_focus = index;
+        if (index >= 0 && (uint32_t)index < m_count && m_slots[index].intervalMs > m_config.intervalMs) {
+            Slot& s = m_slots[index];
+            s.intervalMs = m_config.intervalMs;
+            Reschedule(s);
+        }
+    }
+
+    void Start(uint32_t index, uint64_t firstDueMs) {
+        if (index >= m_count) return;
+        Slot& s = m_slots[index];
+        s.active = true;
+        s.fired = false;
+        s.dueMs = firstDueMs;
+        s.firedDueMs = 0;
+        s.intervalMs = m_config.intervalMs;
+        s.burstLeft = 0;
+        s.stable = 0;
+        s.avgUs = 0;
+        s.lastOk = false;
+        s.seen = false;
+    }
+
+    void Stop(uint32_t index) {
+        if (index >= MaxTargets) return;
+        Slot& s = m_slots[index];
+        s.active = false;
+        s.fired = false;
+        s.dueMs = UINT64_MAX;
+        s.firedDueMs = 0;
+        s.intervalMs = m_config.intervalMs;
+        s.burstLeft = 0;
+        s.stable = 0;
+        s.avgUs = 0;
+        s.lastOk = false;
+        s.seen = false;
+    }
+
+    bool Active(uint32_t index) const { return index < m_count && m_slots[index].active; }
+    uint64_t DueMs(uint32_t index) const { return index < m_count ? m_slots[index].dueMs : UINT64_MAX; }
+    uint32_t IntervalMs(uint32_t index) const { return index < m_count ? m_slots[index].intervalMs : 0; }
+
+    // Call once now >= DueMs(index). Returns true if the probe should go out now; false when
+    // the budget is spent, in which case the deadline moved to when a token will be there.
+    bool Fire(uint32_t index, uint64_t nowMs) {
+        if (index >= m_count || !m_slots[index].active) return false;
+        Slot& s = m_slots[index];
+        if (nowMs < s.dueMs) return false;
+        if (!TakeToken(nowMs)) {
+            ++m_stats.deferred;
+            s.dueMs = nowMs + TokenWaitMs();
+            return false;
+        }
+        uint64_t late = nowMs - s.dueMs;
+        uint32_t lateMs = late > kMaxTrackedValue ? kMaxTrackedValue : (uint32_t)late;
+        m_stats.lateMs.Add(lateMs);
+        if (lateMs > m_stats.maxLateMs) m_stats.maxLateMs = lateMs;
+        ++m_stats.ticks;
+
+        // Next deadline on the grid; after a stall skip forward instead of catching up
+        s.fired = true;
+        s.dueMs += s.intervalMs;
+        if (s.dueMs <= nowMs) {
+            uint64_t missed = (nowMs - s.dueMs) / s.intervalMs + 1;
+            m_stats.skippedTicks += missed;
+            s.dueMs += missed * s.intervalMs;
+        }
+        s.firedDueMs = s.dueMs - s.intervalMs;
+        return true;
+    }
+
+    // Feed a completion back (status and measured RTT) to adapt the target's interval
+    void OnResult(uint32_t index, uint8_t status, uint32_t rttUs, uint64_t nowMs) {
+        if (index >= m_count || !m_slots[index].active) return;
+        Slot& s = m_slots[index];
+        bool ok = status == PROBE_OK && rttUs != kNoReply;
+        bool changed = s.seen && ok != s.lastOk;
+        if (ok) {
+            if (s.avgUs == 0) {
+                s.avgUs = rttUs ? rttUs : 1;
+            } else {
+                uint32_t diff = rttUs > s.avgUs ? rttUs - s.avgUs : s.avgUs - rttUs;
+                if (diff >= m_config.changeFloorUs && (uint64_t)diff * 1000 > (uint64_t)s.avgUs * m_config.changePermille) {
+                    changed = true;
+                }
+                // EWMA with 1/8 gain, the same smoothing TCP uses for SRTT
+                s.avgUs = (uint32_t)((int64_t)s.avgUs + ((int64_t)rttUs - (int64_t)s.avgUs) / 8);
+                if (!s.avgUs) s.avgUs = 1;
+            }
+        }
+        s.lastOk = ok;
+        s.seen = true;
+
+        uint32_t interval = s.intervalMs;
+        if (changed && m_config.burstProbes && m_config.minIntervalMs < m_config.intervalMs) {
+            s.burstLeft = m_config.burstProbes;
+            s.stable = 0;
+            interval = m_config.minIntervalMs;
+        } else if (changed) {
+            s.stable = 0;
+            if (interval > m_config.intervalMs) interval = m_config.intervalMs;
+        } else if (s.burstLeft) {
+            if (--s.burstLeft == 0) interval = m_config.intervalMs;
+        } else if (m_config.stableProbes && ++s.stable >= m_config.stableProbes) {
+            s.stable = 0;
+            interval = interval * 2 < m_config.maxIntervalMs ? interval * 2 : m_config.maxIntervalMs;
+        }
+        if ((int)index == m_focus && interval > m_config.intervalMs) interval = m_config.intervalMs;
+        if (interval != s.intervalMs) {
+            s.intervalMs = interval;
+            Reschedule(s);
+            if (s.dueMs < nowMs) s.dueMs = nowMs;
+        }
+    }
+
+    const SchedulerStats& Stats() const { return m_stats; }
+    void ResetStats() {
+        m_stats.ticks = 0;
+        m_stats.skippedTicks = 0;
+        m_stats.deferred = 0;
+        m_stats.maxLateMs = 0;
+        m_stats.lateMs.Reset();
+    }
+    const CadenceConfig& Config() const { return m_config; }
+
+private:
+    struct Slot {
+        bool active;
+        bool fired;            // firedDueMs is valid
+        bool lastOk;
+        bool seen;
+        uint64_t dueMs;
+        uint64_t firedDueMs;   // deadline of the probe last fired
+        uint32_t intervalMs;
+        uint32_t burstLeft;
+        uint32_t stable;
+        uint32_t avgUs;        // smoothed RTT, 0 = no reply yet
+    };
+
+    void SetConfig(const CadenceConfig& config) {
+        m_config = config;
+        if (!m_config.intervalMs) m_config.intervalMs = 1;
+        if (!m_config.minIntervalMs || m_config.minIntervalMs > m_config.intervalMs) m_config.minIntervalMs = m_config.intervalMs;
+        if (m_config.maxIntervalMs < m_config.intervalMs) m_config.maxIntervalMs = m_config.intervalMs;
+    }
+
+    // A probe costs 60000 credit units; budgetPerMinute units accrue per millisecond
+    static const uint64_t kTokenCost = 60000;
+
+    // Up to ten seconds' worth of probes may be spent at once
+    uint64_t BucketCapacity() const {
+        uint64_t tokens = m_config.budgetPerMinute / 6;
+        return (tokens ? tokens : 1) * kTokenCost;
+    }
+
+    bool TakeToken(uint64_t nowMs) {
+        if (!m_config.budgetPerMinute) return true;
+        if (nowMs > m_creditAtMs) {
+            m_credit += (nowMs - m_creditAtMs) * m_config.budgetPerMinute;
+            if (m_credit > BucketCapacity()) m_credit = BucketCapacity();
+        }
+        m_creditAtMs = nowMs;
+        if (m_credit < kTokenCost) return false;
+        m_credit -= kTokenCost;
+        return true;
+    }
+
+    uint64_t TokenWaitMs() const {
+        uint64_t missing = kTokenCost - m_credit;
+        return (missing + m_config.budgetPerMinute - 1) / m_config.budgetPerMinute;
+    }
+
+    // Interval changed: the next deadline is one new interval after the last one fired
+    static void Reschedule(Slot& s) {
+        if (s.active && s.fired) s.dueMs = s.firedDueMs + s.intervalMs;
+    }
+
+    CadenceConfig m_config;
+    uint32_t m_count;
+    int m_focus;
+    uint64_t m_credit;
+    uint64_t m_creditAtMs;
+    SchedulerStats m_stats;
+    Slot m_slots[MaxTargets];
+};
+
+} // namespace lt
@@ -0,0 +1,80 @@
+// core/record_writer.h
+// Buffered text record output (JSONL/CSV lines) for the headless build. Records are formatted
+// straight into one fixed buffer (TextBuffer: hand-rolled formatting, no allocation) and the
+// buffer goes out in a single unbuffered fwrite when it fills or when the caller flushes, so a
+// steady stream costs one write system call per buffer rather than per line.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "text_buffer.h"
+
+namespace lt {
+
+template <uint32_t Capacity>
+class RecordWriter : public TextBuffer {
+    static_assert(Capacity >= 4096, "room for at least a few records");
+
+public:
+    // Longest single record the formatting calls are expected to produce
+    static const uint32_t kMaxRecord = 1024;
+
+    RecordWriter() : TextBuffer(m_storage, Capacity), m_file(nullptr), m_owned(false), m_records(0), m_writes(0), m_failed(false) {}
+    ~RecordWriter() { Close(); }
+
+    // path == nullptr or "-" writes to stdout; anything else is appended to
+    bool Open(const char* path) {
+        Close();
+        if (!path || !strcmp(path, "-")) {
+            m_file = stdout;
+            m_owned = false;
+        } else {
+            m_file = fopen(path, "ab");
+            if (!m_file) return false;
+            m_owned = true;
+        }
+        setvbuf(m_file, nullptr, _IONBF, 0);   // this buffer is the only one
+        return true;
+    }
+
+    void Close() {
+        if (!m_file) return;
+        Flush();
+        if (m_owned) fclose(m_file);
+        m_file = nullptr;
+    }
+
+    // Write out everything buffered. False once a write has failed (disk full, closed pipe).
+    bool Flush() {
+        if (m_len && m_file) {
+            if (fwrite(m_buf, 1, m_len, m_file) != m_len) m_failed = true;
+            ++m_writes;
+        }
+        Clear();
+        return !m_failed;
+    }
+
+    // Finish a line; flush if the next record might not fit
+    void EndRecord() {
+        Char('\n');
+        ++m_records;
+        if (m_len + kMaxRecord > Capacity) Flush();
+    }
+
+    uint32_t Buffered() const { return m_len; }
+    uint64_t Records() const { return m_records; }
+    uint64_t Writes() const { return m_writes; }
+    bool Failed() const { return m_failed; }
+
+private:
+    FILE* m_file;
+    bool m_owned;
+    uint64_t m_records;
+    uint64_t m_writes;
+    bool m_failed;
+    char m_storage[Capacity];
+};
+
+} // namespace lt
@@ -0,0 +1,148 @@
+// core/rolling_stats.h
+// Fixed-capacity rolling window statistics with O(1) updates and no allocation:
+//  - mean and variance from running integer sums (exact, no floating point drift)
+//  - min/max from monotonic deques (amortized O(1) per sample)
+//  - RFC 3550 interarrival-style jitter, J += (|D| - J) / 16, over consecutive samples
+// The window length can be changed at runtime up to Capacity; per-sample cost does not
+// depend on it. Values are unit-agnostic (ms or us), saturated at kMaxTrackedValue so the
+// sum of squares cannot overflow.
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+namespace lt {
+
+static const uint32_t kMaxTrackedValue = (1u << 24) - 1;  // ~16.7 s in microseconds
+
+template <uint32_t Capacity>
+class RollingStats {
+    static_assert(Capacity > 0 && Capacity <= 65535, "sum of squares must fit in 64 bits");
+
+public:
+    RollingStats() : m_window(Capacity) { Reset(); }
+
+    // Change the window length (clamped to 1..Capacity). Clears the current window.
+    void SetWindow(uint32_t window) {
+        m_window = window < 1 ? 1 : (window > Capacity ? Capacity : window);
+        Reset();
+    }
+
+    void Reset() {
+        m_head = 0;
+        m_count = 0;
+        m_seq = 0;
+        m_sum = 0;
+        m_sumSq = 0;
+        m_last = 0;
+        m_hasLast = false;
+        m_jitter16 = 0;
+        m_minHead = m_minCount = 0;
+        m_maxHead = m_maxCount = 0;
+    }
+
+    // Add one sample, evicting the oldest once the window is full.
+    // If evicted is non-null it receives the evicted value; returns true when one was evicted.
+    bool Add(uint32_t value, uint32_t* evicted = nullptr) {
+        if (value > kMaxTrackedValue) value = kMaxTrackedValue;
+        bool didEvict = false;
+        if (m_count == m_window) {
+            uint32_t oldPos = (m_head + Capacity - m_count) % Capacity;
+            uint32_t old = m_values[oldPos];
+            uint32_t oldSeq = m_seq - m_count;
+            m_sum -= old;
+            m_sumSq -= (uint64_t)old * old;
+            --m_count;
+            if (m_minCount && m_minQ[m_minHead].seq == oldSeq) PopFront(m_minHead, m_minCount);
+            if (m_maxCount && m_maxQ[m_maxHead].seq == oldSeq) PopFront(m_maxHead, m_maxCount);
+            if (evicted) *evicted = old;
+            didEvict = true;
+        }
+
+        // RFC 3550 A.8: jitter kept scaled by 16, D is the change between consecutive samples
+        if (m_hasLast) {
+            uint32_t d = value > m_last ? value - m_last : m_last - value;
+            m_jitter16 += d - ((m_jitter16 + 8) >> 4);
+        }
+
+        m_values[m_head] = value;
+        m_head = (m_head + 1) % Capacity;
+        ++m_count;
+        m_sum += value;
+        m_sumSq += (uint64_t)value * value;
+        m_last = value;
+        m_hasLast = true;
+
+        // Monotonic deques: drop entries that can never be the min/max again
+        while (m_maxCount && Back(m_maxQ, m_maxHead, m_maxCount).value <= value) --m_maxCount;
+        PushBack(m_maxQ, m_maxHead, m_maxCount, m_seq, value);
+        while (m_minCount && Back(m_minQ, m_minHead, m_minCount).value >= value) --m_minCount;
+        PushBack(m_minQ, m_minHead, m_minCount, m_seq, value);
+
+        ++m_seq;
+        return didEvict;
+    }
+
+    uint32_t Count() const { return m_count; }
+    uint32_t Window() const { return m_window; }
+    uint32_t Last() const { return m_last; }
+
+    // Rounded integer mean (0 when empty)
+    uint32_t Mean() const { return m_count ? (uint32_t)((m_sum + m_count / 2) / m_count) : 0; }
+
+    // Population variance over the window
+    double Variance() const {
+        if (m_count < 2) return 0.0;
+        // The integer sums are exact, so finishing in double cannot accumulate drift
+        double n = (double)m_count;
+        double mean = (double)m_sum / n;
+        double v = (double)m_sumSq / n - mean * mean;
+        return v > 0.0 ? v : 0.0;
+    }
+
+    uint32_t StdDev() const { return (uint32_t)(sqrt(Variance()) + 0.5); }
+
+    uint32_t Min() const { return m_minCount ? m_minQ[m_minHead].value : 0; }
+    uint32_t Max() const { return m_maxCount ? m_maxQ[m_maxHead].value : 0; }
+
+    // Smoothed jitter in the same unit as the samples
+    uint32_t Jitter() const { return m_jitter16 >> 4; }
+
+private:
+    struct Entry {
+        uint32_t seq;
+        uint32_t value;
+    };
+
+    static void PopFront(uint32_t& head, uint32_t& count) {
+        head = (head + 1) % Capacity;
+        --count;
+    }
+    static const Entry& Back(const Entry* q, uint32_t head, uint32_t count) {
+        return q[(head + count - 1) % Capacity];
+    }
+    static void PushBack(Entry* q, uint32_t head, uint32_t& count, uint32_t seq, uint32_t value) {
+        Entry& e = q[(head + count) % Capacity];
+        e.seq = seq;
+        e.value = value;
+        ++count;
+    }
+
+    uint32_t m_window;
+    uint32_t m_head;      // next write position in m_values
+    uint32_t m_count;     // samples currently in the window
+    uint32_t m_seq;       // samples added since Reset (wraps; only compared for equality)
+    uint64_t m_sum;
+    uint64_t m_sumSq;
+    uint32_t m_last;
+    bool m_hasLast;
+    uint32_t m_jitter16;
+
+    uint32_t m_values[Capacity];
+    Entry m_minQ[Capacity];
+    Entry m_maxQ[Capacity];
+    uint32_t m_minHead, m_minCount;
+    uint32_t m_maxHead, m_maxCount;
+};
+
+} // namespace lt
@@ -0,0 +1,139 @@
+// core/route_source_fake.h
+// In-memory RouteSource for exercising and benchmarking GatewayResolver without touching the
+// host. The table holds any number of procedurally generated non-default routes (nothing is
+// stored for them, yet a snapshot walks and filters every one like a real table walk) plus a
+// few explicit default routes; changes are queued as notifications exactly as the platform
+// sources deliver them.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "gateway_resolver.h"
+
+namespace lt {
+
+class FakeRouteSource : public RouteSource {
+public:
+    FakeRouteSource() : m_background(0), m_defaults(0), m_head(0), m_queued(0), m_overflow(false), m_walkSink(0) {}
+
+    // Non-default routes in the table (e.g. 100000 to model a large VPN route set)
+    void SetBackgroundRoutes(uint32_t count) { m_background = count; }
+
+    // Change a default route and queue the notification a real source would deliver
+    void AddDefault(const RouteEntry& r) {
+        for (uint32_t i = 0; i < m_defaults; ++i) {
+            if (Same(m_table[i], r)) {
+                m_table[i] = r;
+                Queue(ROUTE_ADD, r);
+                return;
+            }
+        }
+        if (m_defaults < kMaxDefaultRoutes * ROUTE_FAMILIES) m_table[m_defaults++] = r;
+        Queue(ROUTE_ADD, r);
+    }
+
+    void RemoveDefault(const RouteEntry& r) {
+        for (uint32_t i = 0; i < m_defaults; ++i) {
+            if (Same(m_table[i], r)) {
+                m_table[i] = m_table[--m_defaults];
+                break;
+            }
+        }
+        Queue(ROUTE_DELETE, r);
+    }
+
+    // Simulate an interface change (or lost notifications): the consumer must resync
+    void RequestResync() {
+        RouteEntry none;
+        memset(&none, 0, sizeof(none));
+        Queue(ROUTE_RESYNC, none);
+    }
+
+    int Snapshot(RouteEntry* out, uint32_t maxOut, uint32_t* defaultCount) override {
+        uint32_t n = 0;
+        // Walk the background table the way a real snapshot filters for 0.0.0.0/0 and ::/0
+        uint32_t walked = 0;
+        for (uint32_t i = 0; i < m_background; ++i) {
+            RouteEntry r;
+            Background(i, &r);
+            if (r.prefixLen != 0) walked += r.metric;   // read every row so the walk is not elided
+        }
+        m_walkSink = walked;
+        for (uint32_t i = 0; i < m_defaults && n < maxOut; ++i) out[n++] = m_table[i];
+        if (defaultCount) *defaultCount = n;
+        // Queued notifications are covered by the snapshot
+        m_head = 0;
+        m_queued = 0;
+        m_overflow = false;
+        return (int)(m_background + m_defaults);
+    }
+
+    int Poll(RouteEvent* out, int maxEvents) override {
+        int n = 0;
+        if (m_overflow && maxEvents > 0) {
+            memset(&out[0], 0, sizeof(out[0]));
+            out[0].type = ROUTE_RESYNC;
+            m_overflow = false;
+            m_head = 0;
+            m_queued = 0;
+            return 1;
+        }
+        while (m_queued && n < maxEvents) {
+            out[n++] = m_queue[m_head];
+            m_head = (m_head + 1) % kQueueSize;
+            --m_queued;
+        }
+        return n;
+    }
+
+    static RouteEntry MakeRoute(RouteFamily family, const uint8_t* gateway, uint32_t metric, uint32_t ifIndex) {
+        RouteEntry r;
+        memset(&r, 0, sizeof(r));
+        r.family = family;
+        r.prefixLen = 0;
+        memcpy(r.gateway, gateway, family == ROUTE_IPV4 ? 4 : 16);
+        r.metric = metric;
+        r.ifIndex = ifIndex;
+        return r;
+    }
+
+private:
+    static const uint32_t kQueueSize = 64;
+
+    static bool Same(const RouteEntry& a, const RouteEntry& b) {
+        return a.family == b.family && a.ifIndex == b.ifIndex && memcmp(a.gateway, b.gateway, sizeof(a.gateway)) == 0;
+    }
+
+    // Deterministic 10.x.y.z/24-ish routes through one VPN next hop
+    static void Background(uint32_t i, RouteEntry* r) {
+        memset(r, 0, sizeof(*r));
+        r->family = (i & 7) == 7 ? ROUTE_IPV6 : ROUTE_IPV4;
+        r->prefixLen = (uint8_t)(16 + (i % 16));
+        r->gateway[0] = 10;
+        r->gateway[3] = 1;
+        r->metric = 25 + (i & 15);
+        r->ifIndex = 100 + (i & 3);
+    }
+
+    void Queue(uint8_t type, const RouteEntry& r) {
+        if (m_queued == kQueueSize) {
+            m_overflow = true;   // like ENOBUFS on a netlink socket
+            return;
+        }
+        RouteEvent& e = m_queue[(m_head + m_queued) % kQueueSize];
+        e.type = type;
+        e.route = r;
+        ++m_queued;
+    }
+
+    uint32_t m_background;
+    RouteEntry m_table[kMaxDefaultRoutes * ROUTE_FAMILIES];
+    uint32_t m_defaults;
+    RouteEvent m_queue[kQueueSize];
+    uint32_t m_head;
+    uint32_t m_queued;
+    bool m_overflow;
+    volatile uint32_t m_walkSink;
+};
+
+} // namespace lt
@@ -0,0 +1,220 @@
+// core/route_source_netlink.h
+// Linux RouteSource over rtnetlink. Snapshots dump the main table (RTM_GETROUTE) on a
+// short-lived socket; changes arrive on a socket subscribed to the IPv4/IPv6 route and link
+// groups. Only default routes with a next hop are passed on. A receive overflow (ENOBUFS) or an
+// interface going up/down asks the resolver to resync. Fd() can be added to the caller's
+// poll/epoll set to wake exactly when something changed.
+#pragma once
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include "gateway_resolver.h"
+
+namespace lt {
+
+class NetlinkRouteSource : public RouteSource {
+public:
+    NetlinkRouteSource() : m_fd(-1), m_seq(0), m_head(0), m_queued(0), m_resync(false), m_links(0) {}
+    ~NetlinkRouteSource() {
+        if (m_fd >= 0) close(m_fd);
+    }
+
+    // Subscribe to route and link notifications. Call before the first Snapshot so no change
+    // can fall between the dump and the subscription.
+    bool Open() {
+        if (m_fd >= 0) return true;
+        m_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+        if (m_fd < 0) return false;
+        struct sockaddr_nl sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.nl_family = AF_NETLINK;
+        sa.nl_groups = RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE | RTMGRP_LINK;
+        if (bind(m_fd, (struct sockaddr*)&sa, sizeof(sa)) != 0) {
+            close(m_fd);
+            m_fd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    int Fd() const { return m_fd; }
+
+    int Snapshot(RouteEntry* out, uint32_t maxOut, uint32_t* defaultCount) override {
+        if (defaultCount) *defaultCount = 0;
+        int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+        if (fd < 0) return -1;
+
+        struct {
+            struct nlmsghdr nh;
+            struct rtmsg rt;
+        } req;
+        memset(&req, 0, sizeof(req));
+        req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+        req.nh.nlmsg_type = RTM_GETROUTE;
+        req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+        req.nh.nlmsg_seq = ++m_seq;
+        req.rt.rtm_family = AF_UNSPEC;
+        if (send(fd, &req, req.nh.nlmsg_len, 0) < 0) {
+            close(fd);
+            return -1;
+        }
+
+        // Anything queued before the dump is superseded by it
+        m_head = 0;
+        m_queued = 0;
+        m_resync = false;
+
+        int scanned = 0;
+        uint32_t n = 0;
+        bool done = false;
+        while (!done) {
+            ssize_t len = recv(fd, m_buf, sizeof(m_buf), 0);
+            if (len < 0) {
+                if (errno == EINTR) continue;
+                close(fd);
+                return -1;
+            }
+            for (struct nlmsghdr* nh = (struct nlmsghdr*)m_buf; NLMSG_OK(nh, (uint32_t)len); nh = NLMSG_NEXT(nh, len)) {
+                if (nh->nlmsg_type == NLMSG_DONE) { done = true; break; }
+                if (nh->nlmsg_type == NLMSG_ERROR) { close(fd); return -1; }
+                if (nh->nlmsg_type != RTM_NEWROUTE) continue;
+                ++scanned;
+                RouteEntry r;
+                if (ParseDefaultRoute(nh, &r) && n < maxOut) out[n++] = r;
+            }
+        }
+        close(fd);
+        if (defaultCount) *defaultCount = n;
+        return scanned;
+    }
+
+    int Poll(RouteEvent* out, int maxEvents) override {
+        if (m_fd < 0 || maxEvents <= 0) return 0;
+        if (!m_queued && !m_resync) Receive();
+        if (m_resync) {
+            memset(&out[0], 0, sizeof(out[0]));
+            out[0].type = ROUTE_RESYNC;
+            m_resync = false;
+            m_head = 0;
+            m_queued = 0;
+            return 1;
+        }
+        int n = 0;
+        while (m_queued && n < maxEvents) {
+            out[n++] = m_queue[m_head];
+            m_head = (m_head + 1) % kQueueSize;
+            --m_queued;
+        }
+        return n;
+    }
+
+private:
+    static const uint32_t kQueueSize = 64;
+    static const uint32_t kMaxLinks = 64;
+
+    // Read everything pending on the subscription socket into the queue
+    void Receive() {
+        for (;;) {
+            ssize_t len = recv(m_fd, m_buf, sizeof(m_buf), MSG_DONTWAIT);
+            if (len < 0) {
+                if (errno == EINTR) continue;
+                if (errno == ENOBUFS) m_resync = true;   // the kernel dropped notifications
+                return;
+            }
+            for (struct nlmsghdr* nh = (struct nlmsghdr*)m_buf; NLMSG_OK(nh, (uint32_t)len); nh = NLMSG_NEXT(nh, len)) {
+                if (nh->nlmsg_type == RTM_NEWROUTE || nh->nlmsg_type == RTM_DELROUTE) {
+                    RouteEntry r;
+                    if (!ParseDefaultRoute(nh, &r)) continue;
+                    Queue(nh->nlmsg_type == RTM_NEWROUTE ? ROUTE_ADD : ROUTE_DELETE, r);
+                } else if (nh->nlmsg_type == RTM_NEWLINK || nh->nlmsg_type == RTM_DELLINK) {
+                    const struct ifinfomsg* ifi = (const struct ifinfomsg*)NLMSG_DATA(nh);
+                    bool up = nh->nlmsg_type == RTM_NEWLINK && (ifi->ifi_flags & IFF_RUNNING);
+                    if (LinkChanged(ifi->ifi_index, up)) m_resync = true;
+                }
+            }
+        }
+    }
+
+    // Main-table unicast default route with a next hop
+    static bool ParseDefaultRoute(const struct nlmsghdr* nh, RouteEntry* r) {
+        const struct rtmsg* rtm = (const struct rtmsg*)NLMSG_DATA(nh);
+        if (rtm->rtm_family != AF_INET && rtm->rtm_family != AF_INET6) return false;
+        if (rtm->rtm_dst_len != 0 || rtm->rtm_type != RTN_UNICAST) return false;
+        memset(r, 0, sizeof(*r));
+        r->family = rtm->rtm_family == AF_INET ? ROUTE_IPV4 : ROUTE_IPV6;
+        r->prefixLen = 0;
+        uint32_t table = rtm->rtm_table;
+        bool hasGateway = false;
+        int attrLen = (int)RTM_PAYLOAD(nh);
+        for (const struct rtattr* a = RTM_RTA(rtm); RTA_OK(a, attrLen); a = RTA_NEXT(a, attrLen)) {
+            switch (a->rta_type) {
+            case RTA_GATEWAY:
+                if (RTA_PAYLOAD(a) == (r->family == ROUTE_IPV4 ? 4u : 16u)) {
+                    memcpy(r->gateway, RTA_DATA(a), RTA_PAYLOAD(a));
+                    hasGateway = true;
+                }
+                break;
+            case RTA_PRIORITY:
+                memcpy(&r->metric, RTA_DATA(a), sizeof(uint32_t));
+                break;
+            case RTA_OIF:
+                memcpy(&r->ifIndex, RTA_DATA(a), sizeof(uint32_t));
+                break;
+            case RTA_TABLE:
+                memcpy(&table, RTA_DATA(a), sizeof(uint32_t));
+                break;
+            }
+        }
+        return hasGateway && table == RT_TABLE_MAIN;
+    }
+
+    // Track running state per interface; only real up/down transitions matter
+    bool LinkChanged(int ifIndex, bool up) {
+        for (uint32_t i = 0; i < m_links; ++i) {
+            if (m_linkIndex[i] != ifIndex) continue;
+            bool changed = m_linkUp[i] != up;
+            m_linkUp[i] = up;
+            return changed;
+        }
+        if (m_links < kMaxLinks) {
+            m_linkIndex[m_links] = ifIndex;
+            m_linkUp[m_links] = up;
+            ++m_links;
+        }
+        return true;   // first sighting: cannot tell, be safe
+    }
+
+    void Queue(uint8_t type, const RouteEntry& r) {
+        if (m_queued == kQueueSize) {
+            m_resync = true;
+            return;
+        }
+        RouteEvent& e = m_queue[(m_head + m_queued) % kQueueSize];
+        e.type = type;
+        e.route = r;
+        ++m_queued;
+    }
+
+    int m_fd;
+    uint32_t m_seq;
+    RouteEvent m_queue[kQueueSize];
+    uint32_t m_head;
+    uint32_t m_queued;
+    bool m_resync;
+    int m_linkIndex[kMaxLinks];
+    bool m_linkUp[kMaxLinks];
+    uint32_t m_links;
+    alignas(NLMSG_ALIGNTO) char m_buf[32768];
+};
+
+} // namespace lt
+
+#endif // __linux__
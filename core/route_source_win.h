@@ -0,0 +1,183 @@
+// core/route_source_win.h
+// Windows RouteSource. Snapshots read GetIpForwardTable2 for both families; changes come from
+// NotifyRouteChange2 and NotifyIpInterfaceChange callbacks, which run on a system thread and
+// only queue the default-route part of the notification under a critical section. An optional
+// event is signalled on every queued change so the worker's wait ends right away.
+// Route metrics are made effective (route metric + interface metric), as the stack compares them.
+#pragma once
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>        // MUST be before windows.h
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <iphlpapi.h>
+#include <netioapi.h>
+#include <string.h>
+#include "gateway_resolver.h"
+
+namespace lt {
+
+class WinRouteSource : public RouteSource {
+public:
+    WinRouteSource() : m_routeNotify(NULL), m_ifNotify(NULL), m_event(NULL), m_head(0), m_queued(0), m_overflow(false) {
+        InitializeCriticalSection(&m_lock);
+    }
+
+    ~WinRouteSource() {
+        Close();
+        DeleteCriticalSection(&m_lock);
+    }
+
+    // Register for notifications. Call before the first Snapshot so no change is missed.
+    bool Open() {
+        if (m_routeNotify) return true;
+        if (NotifyRouteChange2(AF_UNSPEC, &WinRouteSource::OnRouteChange, this, FALSE, &m_routeNotify) != NO_ERROR) {
+            m_routeNotify = NULL;
+            return false;
+        }
+        // Interface state changes (link up/down, metric changes) alter the effective metrics
+        if (NotifyIpInterfaceChange(AF_UNSPEC, &WinRouteSource::OnInterfaceChange, this, FALSE, &m_ifNotify) != NO_ERROR) {
+            m_ifNotify = NULL;
+        }
+        return true;
+    }
+
+    // Blocks until running callbacks have returned
+    void Close() {
+        if (m_routeNotify) CancelMibChangeNotify2(m_routeNotify);
+        if (m_ifNotify) CancelMibChangeNotify2(m_ifNotify);
+        m_routeNotify = NULL;
+        m_ifNotify = NULL;
+    }
+
+    // Signalled whenever a notification is queued. Not owned by the source.
+    void SetNotifyEvent(HANDLE event) { m_event = event; }
+
+    int Snapshot(RouteEntry* out, uint32_t maxOut, uint32_t* defaultCount) override {
+        if (defaultCount) *defaultCount = 0;
+        // Queued notifications are covered by the snapshot taken after them
+        EnterCriticalSection(&m_lock);
+        m_head = 0;
+        m_queued = 0;
+        m_overflow = false;
+        LeaveCriticalSection(&m_lock);
+
+        PMIB_IPFORWARD_TABLE2 table = NULL;
+        if (GetIpForwardTable2(AF_UNSPEC, &table) != NO_ERROR || !table) return -1;
+        uint32_t n = 0;
+        for (ULONG i = 0; i < table->NumEntries; ++i) {
+            RouteEntry r;
+            if (Convert(table->Table[i], true, &r) && n < maxOut) out[n++] = r;
+        }
+        int scanned = (int)table->NumEntries;
+        FreeMibTable(table);
+        if (defaultCount) *defaultCount = n;
+        return scanned;
+    }
+
+    int Poll(RouteEvent* out, int maxEvents) override {
+        int n = 0;
+        EnterCriticalSection(&m_lock);
+        if (m_overflow && maxEvents > 0) {
+            memset(&out[0], 0, sizeof(out[0]));
+            out[0].type = ROUTE_RESYNC;
+            m_overflow = false;
+            m_head = 0;
+            m_queued = 0;
+            n = 1;
+        } else {
+            while (m_queued && n < maxEvents) {
+                out[n++] = m_queue[m_head];
+                m_head = (m_head + 1) % kQueueSize;
+                --m_queued;
+            }
+        }
+        LeaveCriticalSection(&m_lock);
+        return n;
+    }
+
+private:
+    static const uint32_t kQueueSize = 64;
+
+    static void NETIOAPI_API_ OnRouteChange(PVOID context, PMIB_IPFORWARD_ROW2 row, MIB_NOTIFICATION_TYPE type) {
+        WinRouteSource* self = (WinRouteSource*)context;
+        RouteEntry r;
+        if (!row) {
+            // No row means the caller has to query everything again
+            memset(&r, 0, sizeof(r));
+            self->Queue(ROUTE_RESYNC, r);
+            return;
+        }
+        if (!Convert(*row, type != MibDeleteInstance, &r)) return;
+        self->Queue(type == MibDeleteInstance ? ROUTE_DELETE : ROUTE_ADD, r);
+    }
+
+    static void NETIOAPI_API_ OnInterfaceChange(PVOID context, PMIB_IPINTERFACE_ROW row, MIB_NOTIFICATION_TYPE type) {
+        (void)row;
+        (void)type;
+        WinRouteSource* self = (WinRouteSource*)context;
+        RouteEntry none;
+        memset(&none, 0, sizeof(none));
+        self->Queue(ROUTE_RESYNC, none);
+    }
+
+    // Default route with a next hop; the interface metric is only looked up when it matters
+    static bool Convert(const MIB_IPFORWARD_ROW2& row, bool effectiveMetric, RouteEntry* r) {
+        if (row.DestinationPrefix.PrefixLength != 0) return false;
+        const SOCKADDR_INET& hop = row.NextHop;
+        memset(r, 0, sizeof(*r));
+        if (hop.si_family == AF_INET) {
+            if (hop.Ipv4.sin_addr.s_addr == 0) return false;   // on-link default, no gateway
+            r->family = ROUTE_IPV4;
+            memcpy(r->gateway, &hop.Ipv4.sin_addr, 4);
+        } else if (hop.si_family == AF_INET6) {
+            if (IN6_IS_ADDR_UNSPECIFIED(&hop.Ipv6.sin6_addr)) return false;
+            r->family = ROUTE_IPV6;
+            memcpy(r->gateway, &hop.Ipv6.sin6_addr, 16);
+        } else {
+            return false;
+        }
+        r->prefixLen = 0;
+        r->ifIndex = row.InterfaceIndex;
+        r->metric = row.Metric;
+        if (effectiveMetric) {
+            MIB_IPINTERFACE_ROW ifRow;
+            InitializeIpInterfaceEntry(&ifRow);
+            ifRow.Family = hop.si_family;
+            ifRow.InterfaceLuid = row.InterfaceLuid;
+            if (GetIpInterfaceEntry(&ifRow) == NO_ERROR) r->metric += ifRow.Metric;
+        }
+        return true;
+    }
+
+    void Queue(uint8_t type, const RouteEntry& r) {
+        EnterCriticalSection(&m_lock);
+        if (type == ROUTE_RESYNC || m_queued == kQueueSize) {
+            m_overflow = true;   // resync supersedes whatever is queued
+        } else {
+            RouteEvent& e = m_queue[(m_head + m_queued) % kQueueSize];
+            e.type = type;
+            e.route = r;
+            ++m_queued;
+        }
+        LeaveCriticalSection(&m_lock);
+        if (m_event) SetEvent(m_event);
+    }
+
+    HANDLE m_routeNotify;
+    HANDLE m_ifNotify;
+    HANDLE m_event;
+    CRITICAL_SECTION m_lock;
+    RouteEvent m_queue[kQueueSize];
+    uint32_t m_head;
+    uint32_t m_queued;
+    bool m_overflow;
+};
+
+} // namespace lt
+
+#endif // _WIN32
@@ -0,0 +1,30 @@
+// core/rtt_format.h
+// Text for microsecond RTTs in milliseconds, with decimals only where they carry meaning:
+// "0.35" below 1 ms, "2.4" below 10 ms, "24" above. Shared by tooltips, menus and the icon.
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include "probe_backend.h"
+
+namespace lt {
+
+// maxDecimals caps the precision (the 16px icon has room for one). Returns out.
+static inline char* FormatRttMs(char* out, size_t size, uint32_t us, int maxDecimals = 2) {
+    if (!out || size == 0) return out;
+    if (us == kNoReply) {
+        snprintf(out, size, "--");
+    } else if (us < 1000 && maxDecimals >= 2) {
+        uint32_t hundredths = (us + 5) / 10;
+        snprintf(out, size, "%u.%02u", hundredths / 100, hundredths % 100);
+    } else if (us < 10000 && maxDecimals >= 1) {
+        uint32_t tenths = (us + 50) / 100;
+        if (tenths >= 100) snprintf(out, size, "10");
+        else snprintf(out, size, "%u.%u", tenths / 10, tenths % 10);
+    } else {
+        snprintf(out, size, "%u", (us + 500) / 1000);
+    }
+    return out;
+}
+
+} // namespace lt
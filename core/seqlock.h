@@ -0,0 +1,68 @@
+// core/seqlock.h
+// Single-writer seqlock for publishing a "latest value" that any number of threads read without
+// locks. The writer never waits; a reader copies the value and retries only if a store ran
+// concurrently (odd or changed sequence). The value lives in atomic words (release stores,
+// acquire loads: plain moves on x86/x64) rather than plain memory, so a torn read is detected
+// instead of being a data race, without fences ThreadSanitizer cannot model.
+// T must be trivially copyable; keep it to a few cache lines.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+namespace lt {
+
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock values are copied word by word");
+
+public:
+    Seqlock() : m_seq(0) {
+        for (size_t i = 0; i < kWords; ++i) m_words[i].store(0, std::memory_order_relaxed);
+    }
+
+    // Writer thread only
+    void Store(const T& value) {
+        uint64_t buf[kWords] = {};
+        memcpy(buf, &value, sizeof(T));
+        uint32_t seq = m_seq.load(std::memory_order_relaxed);
+        m_seq.store(seq + 1, std::memory_order_relaxed);   // odd: write in progress
+        // Release on every word: a reader that sees any new word also sees the odd sequence
+        for (size_t i = 0; i < kWords; ++i) m_words[i].store(buf[i], std::memory_order_release);
+        m_seq.store(seq + 2, std::memory_order_release);
+    }
+
+    // Any thread. False if a write overlapped every attempt (the writer is busy right now).
+    bool TryLoad(T* out, int attempts = 64) const {
+        uint64_t buf[kWords];
+        for (int a = 0; a < attempts; ++a) {
+            uint32_t before = m_seq.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            // Acquire keeps the sequence re-check below after the word loads
+            for (size_t i = 0; i < kWords; ++i) buf[i] = m_words[i].load(std::memory_order_acquire);
+            if (m_seq.load(std::memory_order_relaxed) == before) {
+                memcpy(out, buf, sizeof(T));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Any thread; spins until a consistent copy is read
+    void Load(T* out) const {
+        while (!TryLoad(out)) {}
+    }
+
+    // Number of completed stores
+    uint32_t Version() const { return m_seq.load(std::memory_order_acquire) >> 1; }
+
+private:
+    static const size_t kWords = (sizeof(T) + 7) / 8;
+
+    std::atomic<uint32_t> m_seq;
+    std::atomic<uint64_t> m_words[kWords];
+};
+
+} // namespace lt
@@ -0,0 +1,276 @@
+// core/sim_backend.h
+// Deterministic simulated ProbeBackend running in virtual time.
+// Same seed + same call sequence = same results, so engine scheduling can be exercised and
+// benchmarked on any platform without a network. Poll() advances the virtual clock to the
+// next completion instead of sleeping, so hours of probing replay in milliseconds.
+// A scenario (sim_scenario.h) sets the profiles and changes them at given virtual times: spikes,
+// outages, profile changes, and default gateway changes delivered through a FakeRouteSource.
+#pragma once
+
+#include <stdint.h>
+#include "probe_backend.h"
+#include "sim_scenario.h"
+#include "route_source_fake.h"
+
+namespace lt {
+
+template <uint32_t MaxTargets>
+class SimulatedBackend : public ProbeBackend {
+public:
+    explicit SimulatedBackend(uint64_t seed = 1)
+        : m_rng(seed ? seed : 1), m_nowMs(0), m_scenario(nullptr), m_routes(nullptr), m_nextEvent(0),
+          m_startMs(0), m_hasGateway(false), m_gateway() {
+        for (uint32_t i = 0; i < MaxTargets; ++i) {
+            Slot& s = m_slots[i];
+            s.bound = false;
+            s.pending = false;
+            s.lastLost = false;
+            s.extraPending = false;
+            s.holding = false;
+            s.outageUntilMs = 0;
+            s.spikeUntilMs = 0;
+            s.spikeMs = 0;
+            s.profile.baseMs = 20;
+            s.profile.jitterMs = 5;
+            s.profile.lossPermille = 0;
+            s.profile.burstPermille = 0;
+            s.profile.latePermille = 0;
+            s.profile.duplicatePermille = 0;
+            s.profile.reorderPermille = 0;
+            s.profile.distribution = SIM_UNIFORM;
+        }
+    }
+
+    void SetProfile(uint32_t target, const SimProfile& profile) {
+        if (target < MaxTargets) m_slots[target].profile = profile;
+    }
+    const SimProfile& Profile(uint32_t target) const { return m_slots[target < MaxTargets ? target : 0].profile; }
+
+    // Play a scenario from now on; its time-0 state (profiles, gateway) is applied at once.
+    // routes (optional) receives the gateway changes as default route notifications. The
+    // scenario must outlive the backend's use of it.
+    void SetScenario(const SimScenario* scenario, FakeRouteSource* routes) {
+        m_scenario = scenario;
+        m_routes = routes;
+        m_nextEvent = 0;
+        m_startMs = m_nowMs;
+        ApplyEvents();
+    }
+
+    bool SetTarget(uint32_t target, const char* ip, bool isIPv6) override {
+        (void)isIPv6;
+        if (target >= MaxTargets || !ip || !ip[0]) return false;
+        Slot& s = m_slots[target];
+        if (s.pending) {
+            // The echo to the old address is abandoned: it fails at once
+            s.dueMs = m_nowMs;
+            s.rttUs = kNoReply;
+            s.apiRttMs = kNoReply;
+            s.status = PROBE_ERROR;
+        }
+        s.bound = true;
+        return true;
+    }
+
+    bool Send(uint32_t target, uint32_t seq, uint32_t timeoutMs) override {
+        if (target >= MaxTargets) return false;
+        Slot& s = m_slots[target];
+        if (!s.bound || s.pending) return false;
+        const SimProfile& p = s.profile;
+        uint64_t rttUs = p.baseMs * 1000ull + Delay(p);
+        if (m_nowMs < s.spikeUntilMs) rttUs += s.spikeMs * 1000ull;
+        bool lost = s.lastLost && p.burstPermille ? (Next() % 1000) < p.burstPermille
+                                                  : p.lossPermille && (Next() % 1000) < p.lossPermille;
+        bool down = m_nowMs < s.outageUntilMs;
+        s.lastLost = lost || down;
+        s.pending = true;
+        s.seq = seq;
+        s.sentMs = m_nowMs;
+        s.timeoutMs = timeoutMs;
+        bool reordered = !lost && !down && p.reorderPermille && (Next() % 1000) < p.reorderPermille;
+        if (lost || down || reordered || rttUs > timeoutMs * 1000ull) {
+            s.dueMs = m_nowMs + timeoutMs;
+            s.rttUs = kNoReply;
+            s.apiRttMs = kNoReply;
+            s.status = PROBE_TIMEOUT;
+            if (!down && !reordered && p.latePermille && !s.extraPending && (Next() % 1000) < p.latePermille) {
+                Extra(s, seq, s.dueMs + 1 + Next() % (2ull * timeoutMs + 1));
+            }
+        } else {
+            s.dueMs = m_nowMs + (rttUs + 999) / 1000;
+            s.rttUs = (uint32_t)rttUs;
+            s.apiRttMs = (uint32_t)(rttUs / 1000);
+            s.status = PROBE_OK;
+            if (p.duplicatePermille && !s.extraPending && (Next() % 1000) < p.duplicatePermille) {
+                Extra(s, seq, s.dueMs + 1);
+            }
+        }
+        // A reply held back by the previous echo follows this one's completion
+        if (s.holding && !s.extraPending) Extra(s, s.holdSeq, s.dueMs + 1);
+        s.holding = reordered;
+        s.holdSeq = seq;
+        return true;
+    }
+
+    int Poll(ProbeResult* out, int maxResults, uint32_t waitMs) override {
+        uint64_t deadline = m_nowMs + waitMs;
+        uint64_t earliest;
+        for (;;) {
+            earliest = deadline + 1;
+            for (uint32_t i = 0; i < MaxTargets; ++i) {
+                if (m_slots[i].pending && m_slots[i].dueMs < earliest) earliest = m_slots[i].dueMs;
+                if (m_slots[i].extraPending && m_slots[i].extraDueMs < earliest) earliest = m_slots[i].extraDueMs;
+            }
+            // Scenario events take effect before completions due at the same time
+            uint64_t eventAt = NextEventMs();
+            if (eventAt > deadline || eventAt > earliest) break;
+            if (eventAt > m_nowMs) m_nowMs = eventAt;
+            ApplyEvents();
+        }
+        if (earliest > deadline) {
+            m_nowMs = deadline;
+            return 0;
+        }
+        if (earliest > m_nowMs) m_nowMs = earliest;
+        int n = 0;
+        for (uint32_t i = 0; i < MaxTargets && n < maxResults; ++i) {
+            Slot& s = m_slots[i];
+            if (s.extraPending && s.extraDueMs <= m_nowMs) {
+                s.extraPending = false;
+                ProbeResult r = {i, s.extraSeq, kNoReply, kNoReply, PROBE_LATE};
+                out[n++] = r;
+                if (n == maxResults) break;
+            }
+            if (!s.pending || s.dueMs > m_nowMs) continue;
+            s.pending = false;
+            ProbeResult r = {i, s.seq, s.rttUs, s.apiRttMs, s.status};
+            out[n++] = r;
+        }
+        return n;
+    }
+
+    uint64_t NowMs() override { return m_nowMs; }
+
+    // Move virtual time forward without waiting for completions (scenario events on the way
+    // take effect)
+    void Advance(uint64_t ms) {
+        uint64_t until = m_nowMs + ms;
+        for (uint64_t at; (at = NextEventMs()) <= until;) {
+            if (at > m_nowMs) m_nowMs = at;
+            ApplyEvents();
+        }
+        m_nowMs = until;
+    }
+
+private:
+    struct Slot {
+        bool bound;
+        bool pending;
+        bool lastLost;
+        bool extraPending;      // a late or duplicate reply is on its way
+        bool holding;           // the reply to holdSeq waits for the next echo's completion
+        uint32_t holdSeq;
+        uint32_t extraSeq;
+        uint64_t extraDueMs;
+        uint32_t seq;
+        uint64_t sentMs;
+        uint32_t timeoutMs;
+        uint64_t dueMs;
+        uint32_t rttUs;
+        uint32_t apiRttMs;
+        uint8_t status;
+        uint64_t outageUntilMs; // scenario state
+        uint64_t spikeUntilMs;
+        uint32_t spikeMs;
+        SimProfile profile;
+    };
+
+    // One extra reply per slot at a time; later ones are not modelled
+    static void Extra(Slot& s, uint32_t seq, uint64_t dueMs) {
+        s.extraPending = true;
+        s.extraSeq = seq;
+        s.extraDueMs = dueMs;
+    }
+
+    // Microseconds above baseMs. The uniform draw is the one older profiles were replayed with.
+    uint64_t Delay(const SimProfile& p) {
+        if (!p.jitterMs) return 0;
+        uint64_t range = p.jitterMs * 1000ull + 1;
+        switch (p.distribution) {
+        case SIM_NORMAL:
+            return (Next() % range + Next() % range + Next() % range + Next() % range) / 4;
+        case SIM_TAIL: {
+            uint64_t bits = Next();
+            uint64_t k = 0;
+            while (k < 32 && (bits & 1)) {
+                ++k;
+                bits >>= 1;
+            }
+            return k * p.jitterMs * 1000ull + Next() % range;
+        }
+        default:
+            return Next() % range;
+        }
+    }
+
+    uint64_t NextEventMs() const {
+        if (!m_scenario || m_nextEvent >= m_scenario->eventCount) return UINT64_MAX;
+        return m_startMs + m_scenario->events[m_nextEvent].atMs;
+    }
+
+    // Everything due by now, in file order
+    void ApplyEvents() {
+        for (; m_scenario && m_nextEvent < m_scenario->eventCount; ++m_nextEvent) {
+            const SimEvent& e = m_scenario->events[m_nextEvent];
+            if (m_startMs + e.atMs > m_nowMs) break;
+            if (e.type == SIM_GATEWAY) {
+                if (m_routes && m_hasGateway) m_routes->RemoveDefault(m_gateway);
+                m_hasGateway = e.hasGateway;
+                m_gateway = e.gateway;
+                if (m_routes && m_hasGateway) m_routes->AddDefault(m_gateway);
+                continue;
+            }
+            for (uint32_t i = 0; i < MaxTargets; ++i) {
+                if (e.target != kSimAllTargets && (uint32_t)e.target != i) continue;
+                Slot& s = m_slots[i];
+                if (e.type == SIM_PROFILE) {
+                    ApplySimProfileFields(&s.profile, e.profile, e.fields);
+                } else if (e.type == SIM_SPIKE) {
+                    s.spikeMs = e.extraMs;
+                    s.spikeUntilMs = m_nowMs + e.durationMs;
+                } else if (e.type == SIM_OUTAGE) {
+                    s.outageUntilMs = m_nowMs + e.durationMs;
+                    s.holding = false;
+                    // Replies still on their way are lost too
+                    if (s.pending && s.status == PROBE_OK && s.dueMs > m_nowMs) {
+                        s.dueMs = s.sentMs + s.timeoutMs;
+                        s.rttUs = kNoReply;
+                        s.apiRttMs = kNoReply;
+                        s.status = PROBE_TIMEOUT;
+                        s.lastLost = true;
+                    }
+                }
+            }
+        }
+    }
+
+    // xorshift64*: tiny, fast and fully deterministic across compilers
+    uint64_t Next() {
+        m_rng ^= m_rng >> 12;
+        m_rng ^= m_rng << 25;
+        m_rng ^= m_rng >> 27;
+        return m_rng * 0x2545F4914F6CDD1Dull;
+    }
+
+    uint64_t m_rng;
+    uint64_t m_nowMs;
+    const SimScenario* m_scenario;
+    FakeRouteSource* m_routes;
+    uint32_t m_nextEvent;       // first event not applied yet
+    uint64_t m_startMs;         // virtual time of scenario time 0
+    bool m_hasGateway;
+    RouteEntry m_gateway;
+    Slot m_slots[MaxTargets];
+};
+
+} // namespace lt
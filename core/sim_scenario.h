@@ -0,0 +1,381 @@
+// core/sim_scenario.h
+// Scenario files for the simulated backend (sim_backend.h): a seed, per-target latency profiles,
+// and timed events in virtual time (latency spikes, outages, profile changes, default gateway
+// changes). The text is parsed strictly into fixed arrays, nothing is allocated, and a scenario
+// with its seed replays identically on every platform:
+//
+//     # office Wi-Fi with a flaky uplink
+//     seed 42
+//     start 2026-01-05T09:00
+//     gateway 192.168.1.1
+//     target * base=12 jitter=4 dist=normal loss=2 burst=300
+//     target 0 base=1 jitter=1
+//     at 10m spike 3 +180 90s
+//     at 25m outage * 45s
+//     at 40m gateway 192.168.1.254
+//     at 40m profile 0 base=2
+//
+// Directives: "seed <n>", "start <UTC time>" (record times begin there), "gateway <address|none>"
+// and "target <index|*> key=value..." set the state at time 0; "at <time> <event>" changes it
+// later, with the events "profile <index|*> key=value...", "spike <index|*> +<ms> <duration>"
+// (extra round trip), "outage <index|*> <duration>" (every echo lost) and "gateway <address|none>".
+// Times and durations are in ms, s, m or h (seconds without a unit) from the start of the run,
+// and events must be in time order. Profile keys: base, jitter (ms), dist (uniform|normal|tail),
+// loss, burst, late, duplicate, reorder (per mille; see SimProfile). '#' starts a comment.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "gateway_resolver.h"
+#include "time_format.h"
+
+namespace lt {
+
+// How the extra delay above baseMs is drawn (microsecond resolution). Integer-only, so the same
+// seed gives the same round trips with any compiler and maths library.
+enum SimDistribution : uint32_t {
+    SIM_UNIFORM = 0,   // uniform in [0, jitterMs]
+    SIM_NORMAL = 1,    // bell-shaped over [0, jitterMs] (mean of four uniform draws)
+    SIM_TAIL = 2       // long tail: uniform in [k * jitterMs, (k + 1) * jitterMs] with P(k) = 2^-(k+1)
+};
+
+// RTTs are drawn in microseconds; the "API" value is truncated to whole milliseconds the way
+// ICMP_ECHO_REPLY::RoundTripTime is, and completions are delivered on the millisecond clock.
+// Loss is a two-state (Gilbert) model when burstPermille is set: after a lost echo the next one
+// is lost with probability burstPermille, otherwise with lossPermille. Lost echoes may still be
+// answered after their timeout, and answered ones answered twice; those extra replies come back
+// as PROBE_LATE. A reordered echo's reply is held back until just after the next echo's reply:
+// the probe times out and its reply arrives late, behind a later one.
+struct SimProfile {
+    uint32_t baseMs;             // minimum round trip
+    uint32_t jitterMs;           // extra delay range, shaped by distribution
+    uint32_t lossPermille;       // probability of a lost echo, in 1/1000
+    uint32_t burstPermille;      // probability that the echo after a lost one is lost too (0: independent)
+    uint32_t latePermille;       // lost echoes answered 1-3 timeouts late
+    uint32_t duplicatePermille;  // answered echoes answered a second time
+    uint32_t reorderPermille;    // answered echoes overtaken by the next echo's reply
+    uint32_t distribution;       // SimDistribution
+};
+
+static const uint32_t kMaxSimEvents = 256;
+static const int32_t kSimAllTargets = -1;
+
+enum SimEventType : uint8_t {
+    SIM_PROFILE = 0,   // set the profile fields in SimEvent::fields
+    SIM_SPIKE = 1,     // add extraMs to every round trip for durationMs
+    SIM_OUTAGE = 2,    // lose every echo (including those in flight) for durationMs
+    SIM_GATEWAY = 3    // replace the default route
+};
+
+// Bits of SimEvent::fields, one per SimProfile member
+enum SimProfileField : uint32_t {
+    SIM_FIELD_BASE = 1u << 0,
+    SIM_FIELD_JITTER = 1u << 1,
+    SIM_FIELD_LOSS = 1u << 2,
+    SIM_FIELD_BURST = 1u << 3,
+    SIM_FIELD_LATE = 1u << 4,
+    SIM_FIELD_DUPLICATE = 1u << 5,
+    SIM_FIELD_REORDER = 1u << 6,
+    SIM_FIELD_DISTRIBUTION = 1u << 7
+};
+
+struct SimEvent {
+    uint64_t atMs;               // from the start of the run
+    uint32_t line;               // in the scenario text, for messages
+    uint8_t type;                // SimEventType
+    int32_t target;              // slot index, or kSimAllTargets
+    uint32_t fields;             // SIM_PROFILE: which members of profile to set
+    SimProfile profile;
+    uint32_t extraMs;            // SIM_SPIKE
+    uint64_t durationMs;         // SIM_SPIKE, SIM_OUTAGE
+    bool hasGateway;             // SIM_GATEWAY: false removes the default route
+    RouteEntry gateway;
+};
+
+struct SimScenario {
+    bool hasSeed;
+    uint64_t seed;
+    bool hasStart;
+    int64_t startMs;             // Unix time of virtual time 0
+    uint32_t eventCount;
+    SimEvent events[kMaxSimEvents];   // in time order; time-0 state first
+};
+
+struct SimScenarioError {
+    uint32_t line;
+    const char* message;
+};
+
+// Copy the members named in fields
+static inline void ApplySimProfileFields(SimProfile* to, const SimProfile& from, uint32_t fields) {
+    if (fields & SIM_FIELD_BASE) to->baseMs = from.baseMs;
+    if (fields & SIM_FIELD_JITTER) to->jitterMs = from.jitterMs;
+    if (fields & SIM_FIELD_LOSS) to->lossPermille = from.lossPermille;
+    if (fields & SIM_FIELD_BURST) to->burstPermille = from.burstPermille;
+    if (fields & SIM_FIELD_LATE) to->latePermille = from.latePermille;
+    if (fields & SIM_FIELD_DUPLICATE) to->duplicatePermille = from.duplicatePermille;
+    if (fields & SIM_FIELD_REORDER) to->reorderPermille = from.reorderPermille;
+    if (fields & SIM_FIELD_DISTRIBUTION) to->distribution = from.distribution;
+}
+
+namespace sim_detail {
+
+static const uint32_t kMaxTokens = 16;
+
+struct Token {
+    const char* text;
+    uint32_t len;
+};
+
+static inline bool Is(const Token& t, const char* word) {
+    return t.len == strlen(word) && memcmp(t.text, word, t.len) == 0;
+}
+
+// Decimal without sign, at most 18 digits
+static inline bool ParseNumber(const char* p, uint32_t len, uint64_t* value) {
+    if (len == 0 || len > 18) return false;
+    uint64_t v = 0;
+    for (uint32_t i = 0; i < len; ++i) {
+        if (p[i] < '0' || p[i] > '9') return false;
+        v = v * 10 + (uint64_t)(p[i] - '0');
+    }
+    *value = v;
+    return true;
+}
+
+static inline bool ParseU32(const char* p, uint32_t len, uint32_t limit, uint32_t* value) {
+    uint64_t v;
+    if (!ParseNumber(p, len, &v) || v > limit) return false;
+    *value = (uint32_t)v;
+    return true;
+}
+
+// "250ms", "90s", "90", "10m", "2h"
+static inline bool ParseDuration(const Token& t, uint64_t* ms) {
+    uint32_t digits = 0;
+    while (digits < t.len && t.text[digits] >= '0' && t.text[digits] <= '9') ++digits;
+    Token unit = {t.text + digits, t.len - digits};
+    uint64_t scale;
+    if (unit.len == 0 || Is(unit, "s")) scale = 1000;
+    else if (Is(unit, "ms")) scale = 1;
+    else if (Is(unit, "m")) scale = 60000;
+    else if (Is(unit, "h")) scale = 3600000;
+    else return false;
+    uint64_t v;
+    if (!ParseNumber(t.text, digits, &v) || v > UINT32_MAX) return false;
+    *ms = v * scale;
+    return true;
+}
+
+static inline bool ParseTarget(const Token& t, int32_t* target) {
+    if (Is(t, "*")) {
+        *target = kSimAllTargets;
+        return true;
+    }
+    uint32_t v;
+    if (!ParseU32(t.text, t.len, 65535, &v)) return false;
+    *target = (int32_t)v;
+    return true;
+}
+
+static inline const char* ParseProfile(const Token* tokens, uint32_t count, SimEvent* e) {
+    if (count == 0) return "expected key=value";
+    for (uint32_t i = 0; i < count; ++i) {
+        const char* eq = (const char*)memchr(tokens[i].text, '=', tokens[i].len);
+        if (!eq) return "expected key=value";
+        Token key = {tokens[i].text, (uint32_t)(eq - tokens[i].text)};
+        Token value = {eq + 1, tokens[i].len - key.len - 1};
+        if (Is(key, "dist")) {
+            if (Is(value, "uniform")) e->profile.distribution = SIM_UNIFORM;
+            else if (Is(value, "normal")) e->profile.distribution = SIM_NORMAL;
+            else if (Is(value, "tail")) e->profile.distribution = SIM_TAIL;
+            else return "unknown distribution";
+            e->fields |= SIM_FIELD_DISTRIBUTION;
+            continue;
+        }
+        struct Key {
+            const char* name;
+            uint32_t field;
+            uint32_t limit;
+            uint32_t SimProfile::*member;
+        };
+        static const Key keys[] = {
+            {"base", SIM_FIELD_BASE, 600000, &SimProfile::baseMs},
+            {"jitter", SIM_FIELD_JITTER, 600000, &SimProfile::jitterMs},
+            {"loss", SIM_FIELD_LOSS, 1000, &SimProfile::lossPermille},
+            {"burst", SIM_FIELD_BURST, 1000, &SimProfile::burstPermille},
+            {"late", SIM_FIELD_LATE, 1000, &SimProfile::latePermille},
+            {"duplicate", SIM_FIELD_DUPLICATE, 1000, &SimProfile::duplicatePermille},
+            {"reorder", SIM_FIELD_REORDER, 1000, &SimProfile::reorderPermille},
+        };
+        const Key* k = nullptr;
+        for (uint32_t j = 0; j < sizeof(keys) / sizeof(keys[0]) && !k; ++j) {
+            if (Is(key, keys[j].name)) k = &keys[j];
+        }
+        if (!k) return "unknown profile key";
+        if (!ParseU32(value.text, value.len, k->limit, &(e->profile.*(k->member)))) return "bad profile value";
+        e->fields |= k->field;
+    }
+    return nullptr;
+}
+
+static inline const char* ParseGateway(const Token& t, SimEvent* e) {
+    if (Is(t, "none")) {
+        e->hasGateway = false;
+        return nullptr;
+    }
+    char text[64];
+    if (t.len >= sizeof(text)) return "bad gateway address";
+    memcpy(text, t.text, t.len);
+    text[t.len] = 0;
+    if (!GatewayResolver::ParseRouteAddress(text, &e->gateway)) return "bad gateway address";
+    e->hasGateway = true;
+    return nullptr;
+}
+
+// One event from its tokens (after "at <time>" for timed ones); nullptr or a message
+static inline const char* ParseEvent(const Token* tokens, uint32_t count, SimEvent* e) {
+    const Token& verb = tokens[0];
+    if (Is(verb, "profile") || Is(verb, "target")) {
+        e->type = SIM_PROFILE;
+        if (count < 2 || !ParseTarget(tokens[1], &e->target)) return "bad target";
+        return ParseProfile(tokens + 2, count - 2, e);
+    }
+    if (Is(verb, "spike")) {
+        e->type = SIM_SPIKE;
+        if (count != 4) return "expected spike <target> +<ms> <duration>";
+        if (!ParseTarget(tokens[1], &e->target)) return "bad target";
+        Token extra = tokens[2];
+        if (extra.len && extra.text[0] == '+') {
+            ++extra.text;
+            --extra.len;
+        }
+        if (!ParseU32(extra.text, extra.len, 600000, &e->extraMs)) return "bad spike delay";
+        if (!ParseDuration(tokens[3], &e->durationMs)) return "bad duration";
+        return nullptr;
+    }
+    if (Is(verb, "outage")) {
+        e->type = SIM_OUTAGE;
+        if (count != 3) return "expected outage <target> <duration>";
+        if (!ParseTarget(tokens[1], &e->target)) return "bad target";
+        if (!ParseDuration(tokens[2], &e->durationMs)) return "bad duration";
+        return nullptr;
+    }
+    if (Is(verb, "gateway")) {
+        e->type = SIM_GATEWAY;
+        if (count != 2) return "expected gateway <address|none>";
+        return ParseGateway(tokens[1], e);
+    }
+    return "unknown directive";
+}
+
+} // namespace sim_detail
+
+// Parse length bytes of scenario text (need not be NUL-terminated). On failure error names the
+// line and problem, and out holds the lines before it.
+static inline bool ParseSimScenario(const char* text, size_t length, SimScenario* out, SimScenarioError* error) {
+    using namespace sim_detail;
+    memset(out, 0, sizeof(*out));
+    SimScenarioError none = {0, nullptr};
+    SimScenarioError& err = error ? *error : none;
+    uint64_t lastAtMs = 0;
+    uint32_t line = 0;
+    for (size_t pos = 0; pos < length;) {
+        ++line;
+        size_t end = pos;
+        while (end < length && text[end] != '\n') ++end;
+        size_t next = end + 1;
+        // Tokens up to a comment
+        Token tokens[kMaxTokens];
+        uint32_t count = 0;
+        for (size_t p = pos; p < end && text[p] != '#';) {
+            char c = text[p];
+            if (c == ' ' || c == '\t' || c == '\r') {
+                ++p;
+                continue;
+            }
+            size_t q = p;
+            while (q < end && text[q] != ' ' && text[q] != '\t' && text[q] != '\r' && text[q] != '#') ++q;
+            if (count == kMaxTokens) {
+                err.line = line;
+                err.message = "too many fields";
+                return false;
+            }
+            tokens[count].text = text + p;
+            tokens[count].len = (uint32_t)(q - p);
+            ++count;
+            p = q;
+        }
+        pos = next;
+        if (!count) continue;
+
+        err.line = line;
+        if (Is(tokens[0], "seed") || Is(tokens[0], "start")) {
+            if (count != 2) {
+                err.message = "expected one value";
+                return false;
+            }
+            if (Is(tokens[0], "seed")) {
+                if (!ParseNumber(tokens[1].text, tokens[1].len, &out->seed)) {
+                    err.message = "bad seed";
+                    return false;
+                }
+                out->hasSeed = true;
+            } else {
+                char when[32];
+                if (tokens[1].len >= sizeof(when)) {
+                    err.message = "bad start time";
+                    return false;
+                }
+                memcpy(when, tokens[1].text, tokens[1].len);
+                when[tokens[1].len] = 0;
+                if (!ParseUtcTime(when, &out->startMs)) {
+                    err.message = "bad start time";
+                    return false;
+                }
+                out->hasStart = true;
+            }
+            continue;
+        }
+        if (out->eventCount == kMaxSimEvents) {
+            err.message = "too many events";
+            return false;
+        }
+        SimEvent& e = out->events[out->eventCount];
+        memset(&e, 0, sizeof(e));
+        e.line = line;
+        const Token* rest = tokens;
+        uint32_t restCount = count;
+        if (Is(tokens[0], "at")) {
+            if (count < 3 || !ParseDuration(tokens[1], &e.atMs)) {
+                err.message = "expected at <time> <event>";
+                return false;
+            }
+            if (Is(tokens[2], "target")) {
+                err.message = "unknown directive";
+                return false;
+            }
+            rest += 2;
+            restCount -= 2;
+        } else if (Is(tokens[0], "profile") || Is(tokens[0], "spike") || Is(tokens[0], "outage")) {
+            err.message = "events need at <time>";
+            return false;
+        }
+        if (e.atMs < lastAtMs) {
+            err.message = rest == tokens ? "target and gateway lines go before the timed events" : "events out of time order";
+            return false;
+        }
+        const char* message = ParseEvent(rest, restCount, &e);
+        if (message) {
+            err.message = message;
+            return false;
+        }
+        lastAtMs = e.atMs;
+        ++out->eventCount;
+    }
+    err.line = 0;
+    err.message = nullptr;
+    return true;
+}
+
+} // namespace lt
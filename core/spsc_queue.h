@@ -0,0 +1,65 @@
+// core/spsc_queue.h
+// Bounded single-producer/single-consumer ring. TryPush and TryPop are wait-free: one relaxed
+// load of the caller's own index, at most one acquire load of the other side's index (each side
+// caches the last value it saw, so the shared line is only touched when the cache says
+// full/empty) and one release store. Head and tail sit on separate cache lines.
+// Items are copied in and out; T should be trivially copyable and small.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+namespace lt {
+
+static const size_t kCacheLineSize = 64;
+
+template <typename T, uint32_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    SpscQueue() : m_head(0), m_cachedTail(0), m_tail(0), m_cachedHead(0) {}
+
+    // Producer thread only. False when full (nothing is written).
+    bool TryPush(const T& item) {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead == Capacity) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == Capacity) return false;
+        }
+        m_items[tail & (Capacity - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only. False when empty.
+    bool TryPop(T* out) {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail) return false;
+        }
+        *out = m_items[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Either thread; exact only when the other side is idle
+    uint32_t SizeApprox() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    static uint32_t CapacityItems() { return Capacity; }
+
+private:
+    // Consumer side
+    alignas(kCacheLineSize) std::atomic<uint32_t> m_head;
+    uint32_t m_cachedTail;
+    // Producer side
+    alignas(kCacheLineSize) std::atomic<uint32_t> m_tail;
+    uint32_t m_cachedHead;
+    alignas(kCacheLineSize) T m_items[Capacity];
+};
+
+} // namespace lt
@@ -0,0 +1,61 @@
+// core/system_resolver.h
+// Address of the system's DNS resolver, for probes that resolve names themselves (without
+// blocking in getaddrinfo): the first "nameserver" line of /etc/resolv.conf on Linux, the first
+// adapter-independent DNS server of GetNetworkParams on Windows. Read once at startup; a
+// resolver that changes later (VPN up/down) is not followed.
+#pragma once
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>        // MUST be before windows.h
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <iphlpapi.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace lt {
+
+// Copies the resolver's address into ip[size]. False when none is configured.
+static inline bool SystemResolver(char* ip, size_t size, bool* isIPv6) {
+    if (!ip || size < 2) return false;
+#ifdef _WIN32
+    // FIXED_INFO is followed by its DNS server list; one page holds a typical configuration
+    union {
+        FIXED_INFO info;
+        char bytes[4096];
+    } buffer;
+    ULONG length = sizeof(buffer);
+    if (GetNetworkParams(&buffer.info, &length) != ERROR_SUCCESS) return false;
+    const char* server = buffer.info.DnsServerList.IpAddress.String;
+    if (!server[0] || strlen(server) >= size) return false;
+    memcpy(ip, server, strlen(server) + 1);
+    *isIPv6 = false;   // GetNetworkParams only lists IPv4 servers
+    return true;
+#else
+    FILE* f = fopen("/etc/resolv.conf", "r");
+    if (!f) return false;
+    char line[256];
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "nameserver", 10) != 0 || (line[10] != ' ' && line[10] != '\t')) continue;
+        char* p = line + 10;
+        while (*p == ' ' || *p == '\t') ++p;
+        size_t len = strcspn(p, " \t\r\n#;");
+        if (len == 0 || len >= size) continue;
+        memcpy(ip, p, len);
+        ip[len] = 0;
+        *isIPv6 = memchr(p, ':', len) != nullptr;
+        found = true;
+    }
+    fclose(f);
+    return found;
+#endif
+}
+
+} // namespace lt
@@ -0,0 +1,457 @@
+// core/target_config.h
+// User-defined targets from a text file, for programs that should not need recompiling to
+// probe another endpoint. The text is parsed strictly into fixed arrays in one pass, nothing is
+// allocated, and a file that fails anywhere is rejected whole (with its line number), so a
+// running program only ever switches between complete, valid target lists:
+//
+//     # datacenter endpoints
+//     interval 1s
+//     timeout 800ms
+//     thresholds 50 150
+//     target icmp gateway name="Default Gateway"
+//     target icmp 10.20.0.1 name=fra-core
+//     target tcp 203.0.113.7 port=443 name="Edge LB"
+//     target dns 10.0.0.53 name=resolver
+//
+// Directives: "interval <duration>" (probe period per target, 10ms to 60m), "timeout <duration>"
+// (1ms to 1m), "thresholds <fair ms> <poor ms>" (the tray's icon colour: green below fair,
+// amber below poor, red above), each at most once, and one
+// "target <icmp|tcp|dns> <address|gateway> [port=<n>] [name=<text>|name="<text>"]" per target.
+// Durations take ms, s or m. TCP targets need a port, DNS ones default to 53 and ICMP ones take
+// none; "gateway" is the default gateway (ICMP only). Names default to the address. '#' starts
+// a comment outside quotes.
+//
+// A target is identified by method, address and port: the same one twice is an error, and on
+// reload (TargetSlots, ApplyReload) every target whose identity did not change keeps its engine
+// slot and with it its statistics; a new name alone is applied in place.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "ip_address.h"
+#include "probe_backend.h"
+
+namespace lt {
+
+static const uint32_t kMaxTargetNameSize = 48;      // including the terminating NUL
+static const uint16_t kConfigDnsPort = 53;
+static const uint32_t kNoConfigTarget = 0xFFFFFFFF;
+
+struct ConfigTarget {
+    IpAddress address;           // family IP_NONE: the default gateway
+    uint8_t method;              // ProbeMethod
+    uint16_t port;               // TCP and DNS
+    uint32_t line;               // in the config text, for messages
+    char name[kMaxTargetNameSize];
+
+    bool IsGateway() const { return !address.Valid(); }
+};
+
+// Same method, address and port (names do not count)
+static inline bool SameTarget(const ConfigTarget& a, const ConfigTarget& b) {
+    return a.method == b.method && a.port == b.port && a.address.family == b.address.family &&
+           a.address.scope == b.address.scope && memcmp(a.address.bytes, b.address.bytes, sizeof(a.address.bytes)) == 0;
+}
+
+// Multiplicative hash over the identity, a word at a time
+static inline uint32_t TargetHash(const ConfigTarget& t) {
+    uint32_t words[4];
+    memcpy(words, t.address.bytes, sizeof(words));
+    uint32_t h = ((uint32_t)t.method | (uint32_t)t.port << 8 | (uint32_t)t.address.family << 24) ^ t.address.scope * 0x85EBCA6Bu;
+    for (int i = 0; i < 4; ++i) h = (h ^ words[i]) * 0x9E3779B1u;
+    return h ^ (h >> 15);
+}
+
+// Open-addressing index over an array of targets, by identity: at most half full, so a lookup
+// is a probe or two whatever the size of the list
+template <uint32_t MaxItems>
+class TargetIndex {
+public:
+    void Clear() { memset(m_buckets, 0, sizeof(m_buckets)); }
+
+    // Position in items[] of a target with the same identity as key, -1 if none
+    int32_t Find(const ConfigTarget* items, const ConfigTarget& key) const {
+        for (uint32_t b = TargetHash(key) & (kBuckets - 1);; b = (b + 1) & (kBuckets - 1)) {
+            if (!m_buckets[b]) return -1;
+            if (SameTarget(items[m_buckets[b] - 1], key)) return (int32_t)(m_buckets[b] - 1);
+        }
+    }
+
+    // Index items[item]; returns the position of an earlier one with the same identity instead
+    // (leaving the index as it was), -1 when there is none
+    int32_t Insert(const ConfigTarget* items, uint32_t item) {
+        uint32_t b = TargetHash(items[item]) & (kBuckets - 1);
+        for (; m_buckets[b]; b = (b + 1) & (kBuckets - 1)) {
+            if (SameTarget(items[m_buckets[b] - 1], items[item])) return (int32_t)(m_buckets[b] - 1);
+        }
+        m_buckets[b] = item + 1;
+        return -1;
+    }
+
+private:
+    static constexpr uint32_t BucketsFor(uint32_t items) {
+        uint32_t n = 16;
+        while (n < 2 * items) n *= 2;
+        return n;
+    }
+    static const uint32_t kBuckets = BucketsFor(MaxItems);
+
+    uint32_t m_buckets[kBuckets];   // item + 1, 0 = empty
+};
+
+template <uint32_t MaxTargets>
+struct TargetConfig {
+    uint32_t probeIntervalMs;    // 0 where the file does not say: the program's default applies
+    uint32_t timeoutMs;
+    uint32_t fairMs;
+    uint32_t poorMs;
+    uint32_t count;
+    ConfigTarget targets[MaxTargets];   // in file order
+    TargetIndex<MaxTargets> index;      // by identity, for duplicates and reloads
+};
+
+struct TargetConfigError {
+    uint32_t line;
+    const char* message;
+};
+
+namespace config_detail {
+
+static const uint32_t kMaxTokens = 8;
+
+struct Token {
+    const char* text;
+    uint32_t len;
+};
+
+static inline bool Is(const Token& t, const char* word) {
+    return t.len == strlen(word) && memcmp(t.text, word, t.len) == 0;
+}
+
+// Decimal without sign, at most 9 digits, at most limit
+static inline bool ParseU32(const char* p, uint32_t len, uint32_t limit, uint32_t* value) {
+    if (len == 0 || len > 9) return false;
+    uint32_t v = 0;
+    for (uint32_t i = 0; i < len; ++i) {
+        if (p[i] < '0' || p[i] > '9') return false;
+        v = v * 10 + (uint32_t)(p[i] - '0');
+    }
+    if (v > limit) return false;
+    *value = v;
+    return true;
+}
+
+// "250ms", "2s", "1m"; the unit is required
+static inline bool ParseDuration(const Token& t, uint32_t minMs, uint32_t maxMs, uint32_t* ms) {
+    uint32_t digits = 0;
+    while (digits < t.len && t.text[digits] >= '0' && t.text[digits] <= '9') ++digits;
+    Token unit = {t.text + digits, t.len - digits};
+    uint32_t scale;
+    if (Is(unit, "ms")) scale = 1;
+    else if (Is(unit, "s")) scale = 1000;
+    else if (Is(unit, "m")) scale = 60000;
+    else return false;
+    uint32_t v;
+    if (!ParseU32(t.text, digits, maxMs / scale, &v) || v * scale < minMs) return false;
+    *ms = v * scale;
+    return true;
+}
+
+// Split [pos, end) into tokens up to a comment; a quoted part ("...") may hold blanks and '#'.
+// Returns the count, or -1 with message set.
+static inline int Tokenize(const char* text, size_t pos, size_t end, Token* tokens, const char** message) {
+    int count = 0;
+    size_t p = pos;
+    while (p < end && text[p] != '#') {
+        char c = text[p];
+        if (c == ' ' || c == '\t' || c == '\r') {
+            ++p;
+            continue;
+        }
+        size_t q = p;
+        for (; q < end && text[q] != ' ' && text[q] != '\t' && text[q] != '\r' && text[q] != '#'; ++q) {
+            if (text[q] != '"') continue;
+            const char* close = (const char*)memchr(text + q + 1, '"', end - q - 1);
+            if (!close) {
+                *message = "unterminated quote";
+                return -1;
+            }
+            q = (size_t)(close - text);
+        }
+        if (count == (int)kMaxTokens) {
+            *message = "too many fields";
+            return -1;
+        }
+        tokens[count].text = text + p;
+        tokens[count].len = (uint32_t)(q - p);
+        ++count;
+        p = q;
+    }
+    return count;
+}
+
+// Printable text, or printable text in quotes; no quotes inside
+static inline bool CopyName(const Token& value, char* out) {
+    Token v = value;
+    if (v.len >= 2 && v.text[0] == '"' && v.text[v.len - 1] == '"') {
+        ++v.text;
+        v.len -= 2;
+    }
+    if (v.len == 0 || v.len >= kMaxTargetNameSize) return false;
+    for (uint32_t i = 0; i < v.len; ++i) {
+        unsigned char c = (unsigned char)v.text[i];
+        if (c < 0x20 || c == 0x7F || c == '"') return false;
+    }
+    memcpy(out, v.text, v.len);
+    out[v.len] = 0;
+    return true;
+}
+
+// "target <method> <address|gateway> [port=<n>] [name=<text>]"
+static inline const char* ParseTarget(const Token* tokens, uint32_t count, ConfigTarget* t) {
+    if (count < 3) return "expected target <icmp|tcp|dns> <address|gateway>";
+    if (Is(tokens[1], "icmp")) t->method = METHOD_ICMP;
+    else if (Is(tokens[1], "tcp")) t->method = METHOD_TCP;
+    else if (Is(tokens[1], "dns")) t->method = METHOD_DNS;
+    else return "unknown probe method";
+
+    const Token& address = tokens[2];
+    memset(&t->address, 0, sizeof(t->address));
+    if (!Is(address, "gateway")) {
+        char text[kIpAddressTextSize];
+        if (address.len >= sizeof(text)) return "bad address";
+        memcpy(text, address.text, address.len);
+        text[address.len] = 0;
+        t->address = ParseIpAddress(text);
+        if (!t->address.Valid()) return "bad address";
+    } else if (t->method != METHOD_ICMP) {
+        return "the gateway is probed with icmp only";
+    }
+
+    bool hasPort = false, hasName = false;
+    t->port = 0;
+    for (uint32_t i = 3; i < count; ++i) {
+        const char* eq = (const char*)memchr(tokens[i].text, '=', tokens[i].len);
+        if (!eq) return "expected key=value";
+        Token key = {tokens[i].text, (uint32_t)(eq - tokens[i].text)};
+        Token value = {eq + 1, tokens[i].len - key.len - 1};
+        if (Is(key, "port")) {
+            uint32_t port;
+            if (hasPort || !ParseU32(value.text, value.len, 65535, &port) || !port) return "bad port";
+            t->port = (uint16_t)port;
+            hasPort = true;
+        } else if (Is(key, "name")) {
+            if (hasName || !CopyName(value, t->name)) return "bad name";
+            hasName = true;
+        } else {
+            return "unknown target key";
+        }
+    }
+    if (t->method == METHOD_ICMP && hasPort) return "icmp targets take no port";
+    if (t->method == METHOD_TCP && !hasPort) return "tcp targets need a port";
+    if (t->method == METHOD_DNS && !hasPort) t->port = kConfigDnsPort;
+    if (!hasName && !CopyName(address, t->name)) return "bad name";
+    return nullptr;
+}
+
+} // namespace config_detail
+
+// Parse length bytes of config text (need not be NUL-terminated) into out. On failure error
+// names the line and problem, and out must not be used. Only the parts of out that the text
+// fills are written (no clearing of the whole target array), so a large capacity costs nothing
+// for a short file.
+template <uint32_t MaxTargets>
+bool ParseTargetConfig(const char* text, size_t length, TargetConfig<MaxTargets>* out, TargetConfigError* error) {
+    using namespace config_detail;
+    TargetConfigError none = {0, nullptr};
+    TargetConfigError& err = error ? *error : none;
+    out->probeIntervalMs = 0;
+    out->timeoutMs = 0;
+    out->fairMs = 0;
+    out->poorMs = 0;
+    out->count = 0;
+    out->index.Clear();
+    bool hasThresholds = false;
+    uint32_t line = 0;
+    for (size_t pos = 0; pos < length;) {
+        ++line;
+        const char* nl = (const char*)memchr(text + pos, '\n', length - pos);
+        size_t end = nl ? (size_t)(nl - text) : length;
+        Token tokens[kMaxTokens];
+        const char* message = nullptr;
+        int count = Tokenize(text, pos, end, tokens, &message);
+        pos = end + 1;
+        err.line = line;
+        if (count < 0) {
+            err.message = message;
+            return false;
+        }
+        if (!count) continue;
+
+        if (Is(tokens[0], "target")) {
+            if (out->count == MaxTargets) {
+                err.message = "too many targets";
+                return false;
+            }
+            ConfigTarget& t = out->targets[out->count];
+            t.line = line;
+            message = ParseTarget(tokens, (uint32_t)count, &t);
+            if (message) {
+                err.message = message;
+                return false;
+            }
+            if (out->index.Insert(out->targets, out->count) >= 0) {
+                err.message = "same target as an earlier line";
+                return false;
+            }
+            ++out->count;
+        } else if (Is(tokens[0], "interval") || Is(tokens[0], "timeout")) {
+            bool interval = Is(tokens[0], "interval");
+            uint32_t& ms = interval ? out->probeIntervalMs : out->timeoutMs;
+            if (ms) {
+                err.message = "set twice";
+                return false;
+            }
+            if (count != 2 || !ParseDuration(tokens[1], interval ? 10 : 1, interval ? 3600000 : 60000, &ms)) {
+                err.message = interval ? "expected interval <10ms..60m>" : "expected timeout <1ms..1m>";
+                return false;
+            }
+        } else if (Is(tokens[0], "thresholds")) {
+            if (hasThresholds) {
+                err.message = "set twice";
+                return false;
+            }
+            if (count != 3 || !ParseU32(tokens[1].text, tokens[1].len, 600000, &out->fairMs) ||
+                !ParseU32(tokens[2].text, tokens[2].len, 600000, &out->poorMs) || !out->fairMs ||
+                out->fairMs >= out->poorMs) {
+                err.message = "expected thresholds <fair ms> <poor ms>, fair below poor";
+                return false;
+            }
+            hasThresholds = true;
+        } else {
+            err.message = "unknown directive";
+            return false;
+        }
+    }
+    if (!out->count) {
+        err.line = line;
+        err.message = "no targets";
+        return false;
+    }
+    err.line = 0;
+    err.message = nullptr;
+    return true;
+}
+
+// What happens to an engine slot on reload
+enum SlotChange : uint8_t {
+    SLOT_FREE = 0,       // unused before and after
+    SLOT_KEPT = 1,       // same target: bound as it was, statistics kept
+    SLOT_RENAMED = 2,    // same target under a new name: statistics kept
+    SLOT_ADDED = 3,      // bind a target (new, or one that replaced a removed one)
+    SLOT_REMOVED = 4     // unbind; the slot stays free
+};
+
+template <uint32_t MaxTargets>
+struct ReloadPlan {
+    uint32_t slotCount;                // engine slots in use afterwards (the last used one + 1)
+    uint32_t target[MaxTargets];       // by slot: index into the config, kNoConfigTarget if free
+    uint8_t change[MaxTargets];        // by slot: SlotChange, up to the larger of both slot counts
+    uint8_t placed[MaxTargets];        // by config target: has a slot (while planning)
+    uint32_t kept;                     // kept and renamed
+    uint32_t added;
+    uint32_t removed;
+};
+
+// Which target lives in which engine slot, across reloads. Slot indices are how the engine,
+// records and metrics know a target, so an unchanged target keeps its index along with its
+// statistics; removed targets leave a free slot, and added ones take the lowest free slots.
+// Display order follows the slots, so targets added by a reload may sit before older ones.
+template <uint32_t MaxTargets>
+class TargetSlots {
+public:
+    TargetSlots() : m_count(0) { memset(m_used, 0, sizeof(m_used)); }
+
+    uint32_t Count() const { return m_count; }   // the last used slot + 1
+    bool Used(uint32_t slot) const { return slot < m_count && m_used[slot]; }
+    const ConfigTarget& Target(uint32_t slot) const { return m_targets[slot]; }
+
+    // Work out where the targets of config go. Linear in the number of targets: slots are
+    // looked up in the config's index.
+    void Plan(const TargetConfig<MaxTargets>& config, ReloadPlan<MaxTargets>* plan) const {
+        plan->kept = plan->added = plan->removed = 0;
+        plan->slotCount = 0;
+        uint32_t span = m_count > config.count ? m_count : config.count;
+        for (uint32_t s = 0; s < span; ++s) {
+            plan->target[s] = kNoConfigTarget;
+            plan->change[s] = SLOT_FREE;
+        }
+        memset(plan->placed, 0, config.count);
+        // Targets already bound stay where they are
+        for (uint32_t s = 0; s < m_count; ++s) {
+            if (!m_used[s]) continue;
+            int32_t j = config.index.Find(config.targets, m_targets[s]);
+            if (j < 0) {
+                plan->change[s] = SLOT_REMOVED;
+                ++plan->removed;
+                continue;
+            }
+            plan->target[s] = (uint32_t)j;
+            plan->change[s] = strcmp(config.targets[j].name, m_targets[s].name) ? SLOT_RENAMED : SLOT_KEPT;
+            plan->placed[j] = 1;
+            plan->slotCount = s + 1;
+            ++plan->kept;
+        }
+        // New targets, in file order, into the lowest free slots (removed ones included)
+        uint32_t next = 0;
+        for (uint32_t j = 0; j < config.count; ++j) {
+            if (plan->placed[j]) continue;
+            while (plan->target[next] != kNoConfigTarget) ++next;
+            plan->target[next] = j;
+            plan->change[next] = SLOT_ADDED;
+            plan->placed[j] = 1;
+            ++plan->added;
+            if (next + 1 > plan->slotCount) plan->slotCount = next + 1;
+        }
+    }
+
+    // Take the plan's assignment over (after ApplyReload)
+    void Commit(const TargetConfig<MaxTargets>& config, const ReloadPlan<MaxTargets>& plan) {
+        uint32_t span = m_count > plan.slotCount ? m_count : plan.slotCount;
+        for (uint32_t s = 0; s < span; ++s) {
+            m_used[s] = plan.target[s] != kNoConfigTarget;
+            if (m_used[s]) m_targets[s] = config.targets[plan.target[s]];
+        }
+        m_count = plan.slotCount;
+    }
+
+private:
+    uint32_t m_count;
+    bool m_used[MaxTargets];
+    ConfigTarget m_targets[MaxTargets];
+};
+
+// Switch a running engine (ProbeEngine) to a plan, between two Run calls on the probe thread,
+// so no probe ever sees half of it: the slot count grows first, removed slots are unbound,
+// added ones go through bind(slot, target), which routes the slot to its backend and binds
+// the address (false if it could not), and the count shrinks to the plan's last. Kept and
+// renamed slots are not touched. Returns how many targets bind refused (left unbound).
+template <typename Engine, uint32_t MaxTargets, typename Bind>
+uint32_t ApplyReload(Engine& engine, const TargetConfig<MaxTargets>& config, const ReloadPlan<MaxTargets>& plan, Bind bind) {
+    uint32_t span = engine.Count() > plan.slotCount ? engine.Count() : plan.slotCount;
+    engine.Resize(span);
+    uint32_t refused = 0;
+    for (uint32_t s = 0; s < span; ++s) {
+        if (plan.change[s] == SLOT_REMOVED) {
+            engine.SetTarget(s, IpAddress());
+        } else if (plan.change[s] == SLOT_ADDED && !bind(s, config.targets[plan.target[s]])) {
+            engine.SetTarget(s, IpAddress());
+            ++refused;
+        }
+    }
+    engine.Resize(plan.slotCount);
+    return refused;
+}
+
+} // namespace lt
@@ -0,0 +1,428 @@
+// core/tcp_connect_backend.h
+// ProbeBackend that measures TCP handshake time (non-blocking connect: SYN out, SYN-ACK back)
+// to address:port, for targets whose firewalls drop ICMP. Every slot owns at most one
+// connecting socket; completions are multiplexed with epoll on Linux and with one event
+// shared by all sockets (WSAEventSelect FD_CONNECT) on Windows, so all targets handshake
+// concurrently from one thread. The socket is reset (SO_LINGER 0) as soon as the handshake
+// completes, so probing leaves no TIME_WAIT entries and sends no data.
+// The RTT is connect() to the wake-up that saw the socket writable. A refused connection
+// (RST) is PROBE_ERROR: the host answered but nothing listens on the port.
+// To share one wait with an ICMP backend (see probe_mux.h), hand the ICMP backend this
+// backend's epoll descriptor (Fd()) as its wake fd on Linux; on Windows give both backends the
+// same wake event (SetWakeEvent), which connect completions then signal.
+#pragma once
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>        // MUST be before windows.h
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <errno.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "probe_backend.h"
+#include "mono_clock.h"
+
+namespace lt {
+
+struct TcpConnectStats {
+    uint64_t connects;       // handshakes started
+    uint64_t established;
+    uint64_t refused;        // RST: port closed
+    uint64_t errors;         // unreachable and other socket errors
+    uint64_t timeouts;
+};
+
+template <uint32_t MaxTargets>
+class TcpConnectBackend : public SideBackend {
+public:
+#ifdef _WIN32
+    typedef SOCKET Socket;
+    static const Socket kNoSocket = INVALID_SOCKET;
+
+    TcpConnectBackend() : m_event(NULL), m_ownEvent(false), m_earliestUs(~0ull) {
+        ZeroMemory(m_slots, sizeof(m_slots));
+        ZeroMemory(&m_stats, sizeof(m_stats));
+        for (uint32_t i = 0; i < MaxTargets; ++i) m_slots[i].socket = kNoSocket;
+    }
+
+    ~TcpConnectBackend() {
+        for (uint32_t i = 0; i < MaxTargets; ++i) CloseSlot(m_slots[i]);
+        if (m_ownEvent) CloseHandle(m_event);
+    }
+
+    // Event signalled by every connect completion, normally the ICMP backend's wake event
+    // (auto-reset). Not owned. Without one, the backend creates its own.
+    void SetWakeEvent(HANDLE wake) { m_event = wake; }
+#else
+    typedef int Socket;
+    static const Socket kNoSocket = -1;
+
+    TcpConnectBackend() : m_epoll(-1), m_wakeFd(-1), m_immediate(false), m_earliestUs(~0ull) {
+        memset(m_slots, 0, sizeof(m_slots));
+        memset(&m_stats, 0, sizeof(m_stats));
+        for (uint32_t i = 0; i < MaxTargets; ++i) m_slots[i].socket = kNoSocket;
+    }
+
+    ~TcpConnectBackend() {
+        for (uint32_t i = 0; i < MaxTargets; ++i) CloseSlot(m_slots[i]);
+        if (m_epoll >= 0) close(m_epoll);
+    }
+
+    // The epoll descriptor: readable whenever a handshake finished (or the wake fd is). Give it
+    // to the ICMP backend as its wake fd to wait on both at once. -1 if epoll is unavailable.
+    int Fd() { return Epoll(); }
+
+    // Extra descriptor that ends a Poll wait when readable (route changes). Not owned.
+    void SetWakeFd(int fd) {
+        if (Epoll() < 0 || fd < 0) return;
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u64 = kWakeMarker;
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev) == 0) m_wakeFd = fd;
+    }
+#endif
+
+    const TcpConnectStats& Stats() const { return m_stats; }
+
+    // Port probed for the slot. Set before SetTarget; 0 leaves the slot unusable.
+    void SetPort(uint32_t target, uint16_t port) {
+        if (target < MaxTargets) m_slots[target].port = port;
+    }
+
+    // Link-local addresses carry their interface: "fe80::1%eth0" or "fe80::1%2"
+    bool SetTarget(uint32_t target, const char* ip, bool isIPv6) override {
+        (void)isIPv6;   // the address says which family it is
+        return SetTargetAddress(target, ResolveIpAddress(ip));
+    }
+
+    bool SetTargetAddress(uint32_t target, const IpAddress& address) override {
+        if (target >= MaxTargets) return false;
+        Slot& s = m_slots[target];
+        CloseSlot(s);   // a handshake to the old address completes nothing
+        if (s.pending && !s.done) {
+            // Reported as PROBE_ERROR by the next Collect (deadline 0: abandoned)
+            s.deadlineUs = 0;
+            m_earliestUs = 0;
+        }
+        s.bound = false;
+        memset(&s.addr, 0, sizeof(s.addr));
+        if (!s.port) return false;
+        if (address.IsIPv6()) {
+            struct sockaddr_in6* a6 = (struct sockaddr_in6*)&s.addr;
+            memcpy(&a6->sin6_addr, address.bytes, 16);
+            a6->sin6_family = AF_INET6;
+            a6->sin6_port = htons(s.port);
+            a6->sin6_scope_id = address.scope;
+            s.addrLen = sizeof(struct sockaddr_in6);
+        } else if (address.Valid()) {
+            struct sockaddr_in* a4 = (struct sockaddr_in*)&s.addr;
+            memcpy(&a4->sin_addr, address.bytes, 4);
+            a4->sin_family = AF_INET;
+            a4->sin_port = htons(s.port);
+            s.addrLen = sizeof(struct sockaddr_in);
+        } else {
+            return false;
+        }
+        s.isIPv6 = address.IsIPv6();
+        s.bound = true;
+        return true;
+    }
+
+    // Starts the handshake. False when no socket could be opened or the connect failed at once
+    // (no route); a handshake that completes inside connect() is reported by the next Poll.
+    bool Send(uint32_t target, uint32_t seq, uint32_t timeoutMs) override {
+        if (target >= MaxTargets) return false;
+        Slot& s = m_slots[target];
+        if (!s.bound || s.pending) return false;
+        if (!Open(s, target, seq)) return false;
+
+        s.seq = seq;
+        s.sentUs = MonoNowUs();
+        int rc = connect(s.socket, (const struct sockaddr*)&s.addr, (int)s.addrLen);
+        if (rc != 0 && !InProgress()) {
+            CloseSlot(s);
+            ++m_stats.errors;
+            return false;
+        }
+        ++m_stats.connects;
+        s.pending = true;
+        s.done = rc == 0;   // loopback can finish immediately
+        s.doneUs = rc == 0 ? MonoNowUs() : 0;
+#ifndef _WIN32
+        if (s.done) m_immediate = true;
+#endif
+        s.deadlineUs = s.sentUs + (uint64_t)timeoutMs * 1000;
+        if (s.deadlineUs < m_earliestUs) m_earliestUs = s.deadlineUs;
+        return true;
+    }
+
+    int Poll(ProbeResult* out, int maxResults, uint32_t waitMs) override {
+        int n = Collect(out, maxResults);
+        if (n == 0 && waitMs > 0) {
+            uint32_t untilTimeout = MsUntilTimeout();
+            Wait(untilTimeout < waitMs ? untilTimeout : waitMs);
+            n = Collect(out, maxResults);
+        }
+        return n;
+    }
+
+    uint64_t NowMs() override { return MonoNowUs() / 1000; }
+
+    uint32_t MsUntilTimeout() const override {
+        if (m_earliestUs == ~0ull) return kNoReply;
+        uint64_t now = MonoNowUs();
+        if (now >= m_earliestUs) return 0;
+        uint64_t ms = (m_earliestUs - now + 999) / 1000;
+        return ms < kNoReply ? (uint32_t)ms : kNoReply - 1;
+    }
+
+private:
+#ifndef _WIN32
+    static const uint64_t kWakeMarker = ~0ull;
+#endif
+
+    struct Slot {
+        bool bound;
+        bool isIPv6;
+        bool pending;
+        bool done;          // finished inside connect(), waiting to be collected
+        uint16_t port;
+        uint32_t seq;
+        Socket socket;
+        uint64_t sentUs;
+        uint64_t doneUs;
+        uint64_t deadlineUs;
+        struct sockaddr_storage addr;
+        socklen_t addrLen;
+    };
+
+    void CloseSlot(Slot& s) {
+        if (s.socket == kNoSocket) return;
+#ifdef _WIN32
+        closesocket(s.socket);
+#else
+        close(s.socket);   // also leaves the epoll set
+#endif
+        s.socket = kNoSocket;
+    }
+
+    // Non-blocking socket registered for connect completion, reset on close
+    bool Open(Slot& s, uint32_t target, uint32_t seq) {
+        CloseSlot(s);
+#ifdef _WIN32
+        if (!m_event) {
+            m_event = CreateEventW(NULL, FALSE, FALSE, NULL);
+            if (!m_event) return false;
+            m_ownEvent = true;
+        }
+        s.socket = socket(s.isIPv6 ? AF_INET6 : AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (s.socket == kNoSocket) return false;
+        // Also makes the socket non-blocking
+        if (WSAEventSelect(s.socket, m_event, FD_CONNECT) != 0) {
+            CloseSlot(s);
+            return false;
+        }
+        (void)target;
+        (void)seq;
+#else
+        if (Epoll() < 0) return false;
+        s.socket = socket(s.isIPv6 ? AF_INET6 : AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+        if (s.socket == kNoSocket) return false;
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLOUT;   // writable: handshake done or failed
+        ev.data.u64 = ((uint64_t)seq << 32) | target;
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, s.socket, &ev) != 0) {
+            CloseSlot(s);
+            return false;
+        }
+#endif
+        struct linger reset = {1, 0};
+        setsockopt(s.socket, SOL_SOCKET, SO_LINGER, (const char*)&reset, sizeof(reset));
+        return true;
+    }
+
+    static bool InProgress() {
+#ifdef _WIN32
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+        return errno == EINPROGRESS || errno == EINTR;
+#endif
+    }
+
+    // Close the slot's socket and fill out with its outcome (error: 0 for established)
+    void Finish(uint32_t target, int error, uint64_t doneUs, ProbeResult* out) {
+        Slot& s = m_slots[target];
+        CloseSlot(s);
+        s.pending = false;
+        s.done = false;
+        out->target = target;
+        out->seq = s.seq;
+        out->apiRttMs = kNoReply;
+        if (error == 0) {
+            ++m_stats.established;
+            out->rttUs = ElapsedUs(s.sentUs, doneUs);
+            out->status = PROBE_OK;
+            return;
+        }
+#ifdef _WIN32
+        if (error == WSAECONNREFUSED) ++m_stats.refused;
+#else
+        if (error == ECONNREFUSED) ++m_stats.refused;
+#endif
+        else ++m_stats.errors;
+        out->rttUs = kNoReply;
+        out->status = PROBE_ERROR;
+    }
+
+#ifdef _WIN32
+    void Wait(uint32_t waitMs) {
+        if (m_event) {
+            WaitForSingleObject(m_event, waitMs);
+        } else if (waitMs) {
+            Sleep(waitMs);
+        }
+    }
+
+    // Completed handshakes, then expired ones. The shared event only says that something
+    // happened, so every connecting socket is asked (at most MaxTargets, all cheap).
+    int Collect(ProbeResult* out, int maxResults) {
+        int n = 0;
+        uint64_t now = MonoNowUs();
+        uint64_t next = ~0ull;
+        uint32_t i = 0;
+        for (; i < MaxTargets && n < maxResults; ++i) {
+            Slot& s = m_slots[i];
+            if (!s.pending) continue;
+            if (s.done) {
+                Finish(i, 0, s.doneUs, &out[n++]);
+                continue;
+            }
+            WSANETWORKEVENTS ne;
+            if (WSAEnumNetworkEvents(s.socket, NULL, &ne) == 0 && (ne.lNetworkEvents & FD_CONNECT)) {
+                Finish(i, ne.iErrorCode[FD_CONNECT_BIT], now, &out[n++]);
+            } else if (now >= s.deadlineUs) {
+                Expire(i, &out[n++]);
+            } else if (s.deadlineUs < next) {
+                next = s.deadlineUs;
+            }
+        }
+        m_earliestUs = i < MaxTargets ? 0 : next;
+        return n;
+    }
+#else
+    int Epoll() {
+        if (m_epoll < 0) m_epoll = epoll_create1(EPOLL_CLOEXEC);
+        return m_epoll;
+    }
+
+    void Wait(uint32_t waitMs) {
+        struct epoll_event ev;
+        if (m_epoll >= 0) {
+            // Only waits; Collect reads the events
+            int rc = epoll_wait(m_epoll, &ev, 1, (int)waitMs);
+            (void)rc;
+        } else if (waitMs) {
+            usleep((useconds_t)waitMs * 1000);
+        }
+    }
+
+    int Collect(ProbeResult* out, int maxResults) {
+        int n = 0;
+        // Handshakes that finished inside connect()
+        if (m_immediate) {
+            m_immediate = false;
+            for (uint32_t i = 0; i < MaxTargets; ++i) {
+                Slot& s = m_slots[i];
+                if (!s.pending || !s.done) continue;
+                if (n < maxResults) {
+                    Finish(i, 0, s.doneUs, &out[n++]);
+                } else {
+                    m_immediate = true;
+                }
+            }
+        }
+        if (m_epoll >= 0) {
+            struct epoll_event events[64];
+            while (n < maxResults) {
+                int want = maxResults - n < 64 ? maxResults - n : 64;
+                int got = epoll_wait(m_epoll, events, want, 0);
+                if (got <= 0) break;
+                uint64_t now = MonoNowUs();
+                int finished = 0;
+                for (int k = 0; k < got; ++k) {
+                    uint64_t data = events[k].data.u64;
+                    if (data == kWakeMarker) continue;
+                    uint32_t target = (uint32_t)data;
+                    if (target >= MaxTargets) continue;
+                    Slot& s = m_slots[target];
+                    if (!s.pending || s.seq != (uint32_t)(data >> 32) || s.socket == kNoSocket) continue;
+                    int error = 0;
+                    socklen_t len = sizeof(error);
+                    if (getsockopt(s.socket, SOL_SOCKET, SO_ERROR, &error, &len) != 0) error = errno;
+                    Finish(target, error, now, &out[n++]);
+                    ++finished;
+                }
+                // The wake fd stays readable until its owner reads it: stop once nothing else is left
+                if (got < want || !finished) break;
+            }
+        }
+        uint64_t now = MonoNowUs();
+        if (now < m_earliestUs) return n;
+        uint64_t next = ~0ull;
+        uint32_t i = 0;
+        for (; i < MaxTargets && n < maxResults; ++i) {
+            Slot& s = m_slots[i];
+            if (!s.pending) continue;
+            if (now < s.deadlineUs) {
+                if (s.deadlineUs < next) next = s.deadlineUs;
+                continue;
+            }
+            Expire(i, &out[n++]);
+        }
+        m_earliestUs = i < MaxTargets ? 0 : next;
+        return n;
+    }
+#endif
+
+    // A timed out handshake, or one abandoned by SetTargetAddress (deadline 0)
+    void Expire(uint32_t target, ProbeResult* out) {
+        Slot& s = m_slots[target];
+        CloseSlot(s);
+        if (s.deadlineUs) ++m_stats.timeouts;
+        s.pending = false;
+        s.done = false;
+        out->target = target;
+        out->seq = s.seq;
+        out->rttUs = kNoReply;
+        out->apiRttMs = kNoReply;
+        out->status = s.deadlineUs ? PROBE_TIMEOUT : PROBE_ERROR;
+    }
+
+#ifdef _WIN32
+    HANDLE m_event;
+    bool m_ownEvent;
+#else
+    int m_epoll;
+    int m_wakeFd;
+    bool m_immediate;
+#endif
+    uint64_t m_earliestUs;   // no pending deadline before this (0: scan on the next Collect)
+    Slot m_slots[MaxTargets];
+    TcpConnectStats m_stats;
+};
+
+} // namespace lt
@@ -0,0 +1,145 @@
+// core/text_buffer.h
+// Append-only text formatting into caller-owned fixed storage: strings, quoted strings,
+// integers, fixed-point values and UTC times, all hand-rolled (no printf, no locale, no
+// allocation). Output past the capacity is dropped and remembered in Truncated().
+// Used for JSONL/CSV records (record_writer.h) and the OpenMetrics page (metrics_server.h).
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "probe_backend.h"
+#include "time_format.h"
+
+namespace lt {
+
+class TextBuffer {
+public:
+    TextBuffer(char* storage, uint32_t capacity) : m_buf(storage), m_capacity(capacity), m_len(0), m_truncated(false) {}
+
+    void Clear() {
+        m_len = 0;
+        m_truncated = false;
+    }
+
+    void Char(char c) {
+        if (m_len < m_capacity) {
+            m_buf[m_len++] = c;
+        } else {
+            m_truncated = true;
+        }
+    }
+
+    void Str(const char* s) {
+        while (*s) Char(*s++);
+    }
+
+    // n bytes of s, as far as they fit
+    void Bytes(const char* s, uint32_t n) {
+        uint32_t room = m_capacity - m_len;
+        if (n > room) {
+            n = room;
+            m_truncated = true;
+        }
+        memcpy(m_buf + m_len, s, n);
+        m_len += n;
+    }
+
+    // Quoted string: JSON (and OpenMetrics label) escaping, or CSV quote doubling.
+    // Control characters are dropped.
+    void Quoted(const char* s, bool json) {
+        Char('"');
+        for (; s && *s; ++s) {
+            char c = *s;
+            if (c == '"') {
+                Str(json ? "\\\"" : "\"\"");
+            } else if (c == '\\' && json) {
+                Str("\\\\");
+            } else if ((unsigned char)c >= 0x20) {
+                Char(c);
+            }
+        }
+        Char('"');
+    }
+
+    void U64(uint64_t v) {
+        char tmp[20];
+        int n = 0;
+        do {
+            tmp[n++] = (char)('0' + v % 10);
+            v /= 10;
+        } while (v);
+        while (n) Char(tmp[--n]);
+    }
+
+    // Zero-padded to width digits
+    void Digits(uint32_t v, int width) {
+        char tmp[10];
+        int n = 0;
+        while (n < width || v) {
+            tmp[n++] = (char)('0' + v % 10);
+            v /= 10;
+            if (n == (int)sizeof(tmp)) break;
+        }
+        while (n) Char(tmp[--n]);
+    }
+
+    // Fixed point: value / 10^decimals, e.g. Fixed(12345, 3) -> "12.345"
+    void Fixed(uint64_t value, int decimals) {
+        uint64_t scale = 1;
+        for (int i = 0; i < decimals; ++i) scale *= 10;
+        U64(value / scale);
+        if (!decimals) return;
+        Char('.');
+        Digits((uint32_t)(value % scale), decimals);
+    }
+
+    // Microseconds as milliseconds with three decimals; `none` when there is no value
+    void Ms(uint32_t us, const char* none) {
+        if (us == kNoReply) {
+            Str(none);
+        } else {
+            Fixed(us, 3);
+        }
+    }
+
+    // part / whole as a percentage with two decimals
+    void Percent(uint64_t part, uint64_t whole) {
+        Fixed(whole ? (part * 10000 + whole / 2) / whole : 0, 2);
+    }
+
+    // UTC "2024-06-01T12:34:56.789Z" (same text as FormatUtcTime, without snprintf)
+    void Time(int64_t ms) {
+        int64_t seconds = FloorDivide(ms, 1000);
+        int64_t days = FloorDivide(seconds, 86400);
+        int64_t rem = seconds - days * 86400;
+        int y, m, d;
+        CivilFromDays(days, &y, &m, &d);
+        Digits((uint32_t)y, 4);
+        Char('-');
+        Digits((uint32_t)m, 2);
+        Char('-');
+        Digits((uint32_t)d, 2);
+        Char('T');
+        Digits((uint32_t)(rem / 3600), 2);
+        Char(':');
+        Digits((uint32_t)(rem / 60 % 60), 2);
+        Char(':');
+        Digits((uint32_t)(rem % 60), 2);
+        Char('.');
+        Digits((uint32_t)(ms - seconds * 1000), 3);
+        Char('Z');
+    }
+
+    const char* Data() const { return m_buf; }
+    uint32_t Length() const { return m_len; }
+    bool Truncated() const { return m_truncated; }
+
+protected:
+    char* m_buf;
+    uint32_t m_capacity;
+    uint32_t m_len;
+    bool m_truncated;
+};
+
+} // namespace lt
@@ -0,0 +1,75 @@
+// core/time_format.h
+// UTC calendar conversion for records and queries, without gmtime/strftime (no locale, no
+// shared static state, same result on every platform). Days are converted with Howard
+// Hinnant's days_from_civil / civil_from_days.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace lt {
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+static inline int64_t DaysFromCivil(int64_t y, int64_t m, int64_t d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static inline void CivilFromDays(int64_t z, int* y, int* m, int* d) {
+    z += 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int64_t doe = z - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    *d = (int)(doy - (153 * mp + 2) / 5 + 1);
+    *m = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *y = (int)(yoe + era * 400 + (*m <= 2));
+}
+
+static inline int64_t FloorDivide(int64_t a, int64_t b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// "2024-06-01T12:34:56Z", or with milliseconds "2024-06-01T12:34:56.789Z". Needs 25 bytes.
+static inline char* FormatUtcTime(char* out, size_t size, int64_t ms, bool millis) {
+    int64_t seconds = FloorDivide(ms, 1000);
+    int64_t days = FloorDivide(seconds, 86400);
+    int64_t rem = seconds - days * 86400;
+    int y, m, d;
+    CivilFromDays(days, &y, &m, &d);
+    if (millis) {
+        snprintf(out, size, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", y, m, d, (int)(rem / 3600), (int)(rem / 60 % 60),
+                 (int)(rem % 60), (int)(ms - seconds * 1000));
+    } else {
+        snprintf(out, size, "%04d-%02d-%02dT%02d:%02d:%02dZ", y, m, d, (int)(rem / 3600), (int)(rem / 60 % 60),
+                 (int)(rem % 60));
+    }
+    return out;
+}
+
+// Unix seconds, or UTC "YYYY-MM-DD[THH:MM[:SS]]" (a space works in place of the T)
+static inline bool ParseUtcTime(const char* text, int64_t* ms) {
+    int y = 0, mo = 0, d = 0, h = 0, mi = 0, sec = 0;
+    char sep = 0;
+    int fields = sscanf(text, "%d-%d-%d%c%d:%d:%d", &y, &mo, &d, &sep, &h, &mi, &sec);
+    if (fields >= 3) {
+        if (mo < 1 || mo > 12 || d < 1 || d > 31 || h > 23 || mi > 59 || sec > 60) return false;
+        if (fields > 3 && sep != 'T' && sep != ' ') return false;
+        *ms = ((DaysFromCivil(y, mo, d) * 24 + h) * 60 + mi) * 60000ll + sec * 1000ll;
+        return true;
+    }
+    char* end = nullptr;
+    long long seconds = strtoll(text, &end, 10);
+    if (end == text || *end) return false;
+    *ms = seconds * 1000;
+    return true;
+}
+
+} // namespace lt
@@ -0,0 +1,205 @@
+// core/tooltip_format.h
+// Tray tooltip text for one target from its LatencySnapshot, as UTF-8 into a TextBuffer (the
+// tray widens it once with MultiByteToWideChar). Kept out of the tray source so the text can
+// be built, checked and benchmarked on any platform. For example:
+//   "Cloudflare DNS (1.1.1.1) — 24 ms · loss 1.7%"   loss over the last minute of probes
+//   "p50 25 · p95 31 · p99 40 ms"
+//   "avg 26 · jitter 0.85 · max 52 ms"
+//   "API 24 ms (+310 µs)"            measured minus the API's whole-ms RoundTripTime
+// The text is kept within the tray's szTip (FormatTooltip's maxChars) by leaving out whole parts.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "latency_snapshot.h"
+#include "probe_backend.h"
+#include "rtt_format.h"
+#include "text_buffer.h"
+
+namespace lt {
+
+// Escaped so the narrow literals do not depend on the compiler's source charset
+#define LT_TIP_DASH "\xE2\x80\x94"   // U+2014 em dash
+#define LT_TIP_DOT "\xC2\xB7"        // U+00B7 middle dot
+#define LT_TIP_MICRO "\xC2\xB5"      // U+00B5 micro sign
+#define LT_TIP_ELLIPSIS "\xE2\x80\xA6"   // U+2026 horizontal ellipsis
+
+// NOTIFYICONDATAW::szTip: 128 UTF-16 units including the terminator
+static const uint32_t kTooltipMaxChars = 127;
+
+// Optional parts of the tooltip, in the order they are given up when the text is too long
+enum TooltipPart : uint32_t {
+    TIP_API = 1,           // "API 24 ms (+310 µs)"
+    TIP_ENDPOINT = 2,      // " (1.1.1.1)" after the name
+    TIP_SPREAD = 4,        // "avg … · jitter … · max … ms"
+    TIP_PERCENTILES = 8,   // "p50 … · p95 … · p99 … ms"
+    TIP_ALL = 15
+};
+
+namespace tooltip_detail {
+
+// Pieces after the name, in display order; the status is always shown
+enum { ENDPOINT, STATUS, PERCENTILES, SPREAD, API, PIECES };
+static const uint32_t kPartOf[PIECES] = {TIP_ENDPOINT, 0, TIP_PERCENTILES, TIP_SPREAD, TIP_API};
+static const uint32_t kPieceSize = 96;   // the longest piece is an endpoint with a 62-char address
+
+static inline void Rtt(TextBuffer& out, uint32_t us) {
+    char text[16];
+    out.Str(FormatRttMs(text, sizeof(text), us));
+}
+
+// UTF-16 units of UTF-8 text, which is what it takes up in szTip once widened
+static inline uint32_t Utf16Length(const char* s, uint32_t bytes) {
+    // Every byte but continuation bytes starts a unit; four-byte sequences are surrogate pairs
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < bytes; ++i) {
+        unsigned char c = (unsigned char)s[i];
+        n += (uint32_t)((c & 0xC0) != 0x80) + (uint32_t)(c >= 0xF0);
+    }
+    return n;
+}
+
+// The name, cut to maxChars UTF-16 units (an ellipsis included) on a character boundary
+static inline void Name(TextBuffer& out, const char* name, uint32_t bytes, uint32_t maxChars) {
+    if (Utf16Length(name, bytes) <= maxChars) {
+        out.Bytes(name, bytes);
+        return;
+    }
+    uint32_t chars = 0;
+    for (uint32_t i = 0; i < bytes;) {
+        unsigned char c = (unsigned char)name[i];
+        uint32_t length = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+        uint32_t units = length == 4 ? 2 : 1;
+        if (chars + units + 1 > maxChars) break;
+        for (uint32_t k = 0; k < length && i + k < bytes; ++k) out.Char(name[i + k]);
+        chars += units;
+        i += length;
+    }
+    if (maxChars) out.Str(LT_TIP_ELLIPSIS);
+}
+
+static inline void Piece(TextBuffer& out, uint32_t piece, const LatencySnapshot& snap, ProbeMethod method,
+                         uint16_t port, uint32_t shownRttUs) {
+    bool replied = snap.completed && shownRttUs != kNoReply;
+    switch (piece) {
+    case ENDPOINT:
+        // Brackets for IPv6
+        if (method != METHOD_ICMP) {
+            out.Str(snap.isIPv6 ? " ([" : " (");
+            out.Str(snap.address);
+            out.Str(snap.isIPv6 ? "]:" : ":");
+            out.U64(port);
+            out.Str(method == METHOD_DNS ? " DNS)" : " TCP)");
+        } else {
+            out.Str(snap.isIPv6 ? " [" : " (");
+            out.Str(snap.address);
+            out.Char(snap.isIPv6 ? ']' : ')');
+        }
+        break;
+    case STATUS:
+        out.Str(" " LT_TIP_DASH " ");
+        if (!snap.completed) {
+            out.Str("measuring...");
+            break;
+        }
+        if (shownRttUs == kNoReply) {
+            out.Str("no reply (");
+            out.U64(snap.lostInRow);
+            out.Str(" lost)");
+        } else {
+            Rtt(out, shownRttUs);
+            out.Str(" ms");
+        }
+        if (snap.lossBp) {
+            out.Str(" " LT_TIP_DOT " loss ");
+            out.U64(snap.lossBp / 100);
+            out.Char('.');
+            out.U64(snap.lossBp % 100 / 10);
+            out.Char('%');
+        }
+        break;
+    case PERCENTILES:
+        // Tail latency over the window
+        if (!replied || snap.samples <= 1) break;
+        out.Str("\np50 ");
+        Rtt(out, snap.p50Us);
+        out.Str(" " LT_TIP_DOT " p95 ");
+        Rtt(out, snap.p95Us);
+        out.Str(" " LT_TIP_DOT " p99 ");
+        Rtt(out, snap.p99Us);
+        out.Str(" ms");
+        break;
+    case SPREAD:
+        // max is the lifetime maximum
+        if (!replied || snap.samples <= 1) break;
+        out.Str("\navg ");
+        Rtt(out, snap.avgUs);
+        out.Str(" " LT_TIP_DOT " jitter ");
+        Rtt(out, snap.jitterUs);
+        out.Str(" " LT_TIP_DOT " max ");
+        Rtt(out, snap.maxUs);
+        out.Str(" ms");
+        break;
+    case API:
+        if (!replied || snap.apiRttMs == kNoReply) break;
+        out.Str("\nAPI ");
+        out.U64(snap.apiRttMs);
+        out.Str(" ms (");
+        out.Char(snap.apiErrorUs < 0 ? '-' : '+');
+        out.U64(snap.apiErrorUs < 0 ? (uint64_t)(-(int64_t)snap.apiErrorUs) : (uint64_t)snap.apiErrorUs);
+        out.Str(" " LT_TIP_MICRO "s)");
+        break;
+    }
+}
+
+} // namespace tooltip_detail
+
+// shownRttUs is the value on the icon (after DisplayHysteresis), kNoReply after a lost probe.
+// method and port add the endpoint for TCP and DNS targets. The text fits maxChars UTF-16 units
+// (the tray's szTip): when it would not, parts are left out in TooltipPart order (the API line
+// first, then the address, then the statistics lines) until it does, and any given up before
+// the last one that fits again is put back. If the first line alone is too long, the name is cut.
+static inline void FormatTooltip(TextBuffer& out, const LatencySnapshot& snap, const char* name,
+                                 ProbeMethod method, uint16_t port, uint32_t shownRttUs,
+                                 uint32_t maxChars = kTooltipMaxChars) {
+    using namespace tooltip_detail;
+    if (!name) name = "";
+    // Every piece is formatted once and measured; what fits is worked out from the lengths
+    char text[PIECES][kPieceSize];
+    uint32_t length[PIECES], chars[PIECES];
+    for (uint32_t i = 0; i < PIECES; ++i) {
+        TextBuffer piece(text[i], kPieceSize);
+        Piece(piece, i, snap, method, port, shownRttUs);
+        length[i] = piece.Length();
+        chars[i] = Utf16Length(text[i], length[i]);
+    }
+    uint32_t nameBytes = (uint32_t)strlen(name);
+    uint32_t nameChars = Utf16Length(name, nameBytes);
+    auto total = [&](uint32_t parts) {
+        uint32_t n = nameChars;
+        for (uint32_t i = 0; i < PIECES; ++i) {
+            if (!kPartOf[i] || (parts & kPartOf[i])) n += chars[i];
+        }
+        return n;
+    };
+    uint32_t parts = TIP_ALL;
+    if (total(parts) > maxChars) {
+        do {
+            parts &= parts - 1;   // the lowest part left goes first
+        } while (parts && total(parts) > maxChars);
+        // The API line usually fits again once the address is gone
+        for (uint32_t part = TIP_PERCENTILES; part; part >>= 1) {
+            if (!(parts & part) && total(parts | part) <= maxChars) parts |= part;
+        }
+        // Not even the first line fits: cut the name by the excess
+        uint32_t excess = total(parts) > maxChars ? total(parts) - maxChars : 0;
+        nameChars = nameChars > excess ? nameChars - excess : 0;
+    }
+    Name(out, name, nameBytes, nameChars);
+    for (uint32_t i = 0; i < PIECES; ++i) {
+        if (kPartOf[i] && !(parts & kPartOf[i])) continue;
+        out.Bytes(text[i], length[i]);
+    }
+}
+
+} // namespace lt
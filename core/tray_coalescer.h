@@ -0,0 +1,220 @@
+// core/tray_coalescer.h
+// Change-only, rate-limited tray updates. Every Shell_NotifyIcon call is a cross-process round
+// trip to Explorer, so the render thread stages the icon (text + tint) and tooltip it wants,
+// and the coalescer answers which fields actually differ from what was last pushed. Changes
+// arriving faster than the configured rate are merged into one later push (Flush at
+// NextDueMs()). DisplayHysteresis keeps the shown number from flickering between neighbours
+// (23 <-> 24) when the RTT sits on a rounding boundary.
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "probe_backend.h"
+
+namespace lt {
+
+enum TrayField : uint32_t {
+    TRAY_ICON = 1,
+    TRAY_TIP = 2
+};
+
+struct TrayCoalescerStats {
+    uint64_t submitted;   // Submit calls
+    uint64_t pushes;      // shell calls made
+    uint64_t iconPushes;
+    uint64_t tipPushes;
+    uint64_t unchanged;   // submissions identical to the pushed state: calls avoided
+    uint64_t coalesced;   // staged changes replaced by newer ones before the rate limit let them out
+    uint64_t failures;    // pushes the shell rejected (retried on the next Flush)
+};
+
+// Holds the displayed RTT until the measurement moves clearly past the next display step.
+// Steps follow FormatRttMs: 10us below 1 ms (two decimals), 100us below 10 ms, 1 ms above.
+class DisplayHysteresis {
+public:
+    explicit DisplayHysteresis(uint32_t bandPermille = 250, int maxDecimals = 1)
+        : m_bandPermille(bandPermille), m_maxDecimals(maxDecimals) {
+        Reset();
+    }
+
+    void Reset() {
+        m_shown = kNoReply;
+        m_valid = false;
+        m_held = 0;
+    }
+
+    // Value to display for a new measurement (kNoReply passes straight through)
+    uint32_t Filter(uint32_t us) {
+        if (!m_valid || us == kNoReply || m_shown == kNoReply) {
+            m_valid = true;
+            m_shown = Quantize(us);
+            return m_shown;
+        }
+        uint32_t step = StepUs(m_shown);
+        uint32_t diff = us > m_shown ? us - m_shown : m_shown - us;
+        // Half a step is plain rounding; the band is the extra distance required to switch
+        if ((uint64_t)diff * 1000 < (uint64_t)step * (500 + m_bandPermille)) {
+            ++m_held;
+            return m_shown;
+        }
+        m_shown = Quantize(us);
+        return m_shown;
+    }
+
+    uint32_t Shown() const { return m_shown; }
+    uint64_t Held() const { return m_held; }   // measurements that would have changed the text
+
+    uint32_t StepUs(uint32_t us) const {
+        if (us < 1000 && m_maxDecimals >= 2) return 10;
+        if (us < 10000 && m_maxDecimals >= 1) return 100;
+        return 1000;
+    }
+
+private:
+    uint32_t Quantize(uint32_t us) const {
+        if (us == kNoReply) return us;
+        uint32_t step = StepUs(us);
+        uint64_t q = ((uint64_t)us + step / 2) / step * step;
+        return q >= kNoReply ? kNoReply - 1 : (uint32_t)q;
+    }
+
+    uint32_t m_bandPermille;
+    int m_maxDecimals;
+    uint32_t m_shown;
+    bool m_valid;
+    uint64_t m_held;
+};
+
+// CharT is the tooltip character type (char for NOTIFYICONDATAA, wchar_t for ...W)
+template <typename CharT, uint32_t TipCapacity>
+class TrayCoalescer {
+public:
+    static const uint32_t kIconTextCapacity = 16;
+
+    TrayCoalescer() : m_minIntervalMs(0) {
+        memset(&m_stats, 0, sizeof(m_stats));
+        Invalidate();
+        m_pendingText[0] = 0;
+        m_pendingTint = 0;
+        m_pendingTip[0] = 0;
+    }
+
+    // At most one push per minIntervalMs (0: no limit)
+    void Configure(uint32_t minIntervalMs) { m_minIntervalMs = minIntervalMs; }
+
+    // Forget what was pushed (icon re-added, Explorer restarted): the next push sends everything
+    void Invalidate() {
+        m_pushed = false;
+        m_dirty = 0;
+        m_lastPushMs = 0;
+        m_everPushed = false;
+        m_pushedText[0] = 0;
+        m_pushedTint = 0;
+        m_pushedTip[0] = 0;
+    }
+
+    // Stage the wanted state. Returns the fields to push now (TrayField bits, 0 for none);
+    // call Commit after pushing them.
+    uint32_t Submit(const char* iconText, uint32_t tint, const CharT* tip, uint64_t nowMs) {
+        ++m_stats.submitted;
+        CopyText(m_pendingText, iconText, kIconTextCapacity);
+        m_pendingTint = tint;
+        CopyText(m_pendingTip, tip, TipCapacity);
+
+        uint32_t dirty = Diff();
+        if (!dirty) {
+            ++m_stats.unchanged;
+            m_dirty = 0;   // also drops a staged change that has been reverted
+            return 0;
+        }
+        if (m_dirty) ++m_stats.coalesced;
+        m_dirty = dirty;
+        return Flush(nowMs);
+    }
+
+    // Staged fields whose rate limit has expired (0 while limited or nothing is staged)
+    uint32_t Flush(uint64_t nowMs) const {
+        if (!m_dirty || nowMs < NextDueMs()) return 0;
+        return m_dirty;
+    }
+
+    // When staged changes may go out; UINT64_MAX when nothing is staged
+    uint64_t NextDueMs() const {
+        if (!m_dirty) return UINT64_MAX;
+        if (!m_everPushed) return 0;
+        return m_lastPushMs + m_minIntervalMs;
+    }
+
+    // Record the outcome of pushing `fields`. Failed fields stay staged.
+    void Commit(uint32_t fields, bool ok, uint64_t nowMs) {
+        if (!fields) return;
+        m_lastPushMs = nowMs;
+        m_everPushed = true;
+        if (!ok) {
+            ++m_stats.failures;
+            return;
+        }
+        ++m_stats.pushes;
+        if (fields & TRAY_ICON) {
+            ++m_stats.iconPushes;
+            CopyText(m_pushedText, m_pendingText, kIconTextCapacity);
+            m_pushedTint = m_pendingTint;
+        }
+        if (fields & TRAY_TIP) {
+            ++m_stats.tipPushes;
+            CopyText(m_pushedTip, m_pendingTip, TipCapacity);
+        }
+        m_pushed = true;
+        m_dirty = Diff();
+    }
+
+    // The staged state, for building what Flush/Submit asked to push
+    const char* IconText() const { return m_pendingText; }
+    uint32_t IconTint() const { return m_pendingTint; }
+    const CharT* Tip() const { return m_pendingTip; }
+
+    const TrayCoalescerStats& Stats() const { return m_stats; }
+
+private:
+    template <typename C>
+    static void CopyText(C* dst, const C* src, uint32_t capacity) {
+        uint32_t i = 0;
+        if (src) {
+            for (; i + 1 < capacity && src[i]; ++i) dst[i] = src[i];
+        }
+        dst[i] = 0;
+    }
+
+    template <typename C>
+    static bool SameText(const C* a, const C* b) {
+        for (;; ++a, ++b) {
+            if (*a != *b) return false;
+            if (!*a) return true;
+        }
+    }
+
+    uint32_t Diff() const {
+        if (!m_pushed) return TRAY_ICON | TRAY_TIP;
+        uint32_t fields = 0;
+        if (m_pendingTint != m_pushedTint || !SameText(m_pendingText, m_pushedText)) fields |= TRAY_ICON;
+        if (!SameText(m_pendingTip, m_pushedTip)) fields |= TRAY_TIP;
+        return fields;
+    }
+
+    uint32_t m_minIntervalMs;
+    bool m_pushed;        // m_pushed* hold what the shell shows
+    bool m_everPushed;
+    uint32_t m_dirty;     // staged fields not yet pushed
+    uint64_t m_lastPushMs;
+
+    char m_pendingText[kIconTextCapacity];
+    uint32_t m_pendingTint;
+    CharT m_pendingTip[TipCapacity];
+    char m_pushedText[kIconTextCapacity];
+    uint32_t m_pushedTint;
+    CharT m_pushedTip[TipCapacity];
+
+    TrayCoalescerStats m_stats;
+};
+
+} // namespace lt
@@ -0,0 +1,508 @@
+// latency_bench.cpp
+// Portable micro-benchmarks for the core the tray builds run on, against the deterministic
+// simulator (core/sim_backend.h), so they run anywhere and repeat between commits:
+//   tick        one probe-stage pass of the v1.0 tray over every preset (engine Run on the
+//               simulator) plus, when the displayed target completed, its render stage:
+//               snapshot, hysteresis, icon text and tint, tooltip, tray diff, icon pixels
+//   stats       one reply into a target's statistics (rolling window, window and lifetime
+//               histograms), as ProbeEngine records it
+//   snapshot    CaptureSnapshot of one target (three quantiles from the window histogram)
+//   tooltip     FormatTooltip of a full snapshot (core/tooltip_format.h)
+//   compose16/32/64   icon pixels for "188" on a tint, built-in stroke font atlas
+//   argb_<isa>_<px>  the pixel kernels of one icon (fill, tint, glyph blend, premultiply) with
+//               each kernel set the CPU runs (scalar, sse2, avx2; core/argb_kernels.h) at
+//               16, 20, 24, 32, 48 and 64 px, so the sets can be compared run against run
+//   config_parse  ParseTargetConfig of a 10000-target config file (core/target_config.h)
+//   config_reload a hot reload of that file with 1% of the targets moved and 1% renamed: parse,
+//               slot plan and the swap into a running 10000-slot engine, the probe loop's pause
+//   gateway_change  one default route change on a host with 100000 other routes (the VPN case):
+//               the notification through GatewayResolver::Update and the new preferred gateway
+//   gateway_resync  the full snapshot of that table a resync (or the old polling) pays for
+// Each reports nanoseconds and heap allocations per operation after a warm-up, counted by
+// core/alloc_counter.h (malloc on glibc, operator new elsewhere). --check-allocations fails the
+// run when any of them allocated; ctest runs it that way. --json writes one JSON document for scripts and CI to diff; the footprint
+// section has the static sizes behind the tray's memory figures and the peak resident set.
+//
+// Build:
+//    cmake -S . -B build && cmake --build build --target latency_bench
+//    g++ -std=c++14 -O2 -pthread latency_bench.cpp -o latency_bench
+//    cl /O2 /EHsc /MD latency_bench.cpp psapi.lib
+//
+// Usage:
+//    latency_bench [--json] [--filter=<substring>] [--min-time=<ms>] [--check-allocations]
+// --min-time is the measuring time per benchmark (default 300 ms).
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "core/probe_engine.h"
+#include "core/sim_backend.h"
+#include "core/presets.h"
+#include "core/latency_snapshot.h"
+#include "core/tooltip_format.h"
+#include "core/tray_coalescer.h"
+#include "core/glyph_atlas.h"
+#include "core/icon_compositor.h"
+#include "core/argb_kernels.h"
+#include "core/rtt_format.h"
+#include "core/mono_clock.h"
+#include "core/target_config.h"
+#include "core/gateway_resolver.h"
+#include "core/route_source_fake.h"
+#define LT_COUNT_ALLOCATIONS
+#include "core/alloc_counter.h"
+
+namespace {
+
+// The v1.0 tray's configuration
+const uint32_t kTargets = lt::kPresetCount;
+const uint32_t kStatsCapacity = 3600;
+const uint32_t kStatsWindow = 60;
+const uint32_t kProbeIntervalMs = 1000;
+const uint32_t kProbeBudget = 1200;
+const uint32_t kFairMs = 50;
+const uint32_t kPoorMs = 150;
+const uint32_t kShownTarget = 1;
+const uint32_t kTipCapacity = 128;   // NOTIFYICONDATA::szTip
+
+typedef lt::ProbeEngine<kTargets, kStatsCapacity> Engine;
+
+// Config benchmarks: a large deployment, with the headless build's statistics per slot
+const uint32_t kConfigTargets = 10000;
+typedef lt::ProbeEngine<kConfigTargets> ConfigEngine;
+
+// Gateway benchmarks: a large VPN route table
+const uint32_t kBackgroundRoutes = 100000;
+
+// Kernel benchmarks: every icon size the tray is asked for (100% to 400% DPI)
+const uint32_t kKernelSizes[] = {16, 20, 24, 32, 48, 64};
+const uint32_t kKernelSizeCount = sizeof(kKernelSizes) / sizeof(kKernelSizes[0]);
+
+struct BenchOptions {
+    bool json;
+    bool checkAllocations;
+    const char* filter;
+    uint32_t minTimeMs;
+};
+
+struct BenchResult {
+    const char* name;
+    uint64_t ops;
+    double nsPerOp;
+    uint64_t allocs;
+    double allocsPerOp;
+};
+
+// Large objects are static, as in the tray builds
+lt::SimulatedBackend<kTargets> g_sim(1);
+Engine g_engine;
+lt::GlyphAtlas<64> g_atlas[3];   // 16, 32 and 64 px
+lt::IconCompositor<64> g_compositor;
+lt::TrayCoalescer<char, kTipCapacity> g_tray;
+lt::DisplayHysteresis g_shown;
+lt::RollingStats<kStatsCapacity> g_stats;
+lt::LatencyHistogram g_window;
+lt::LatencyHistogram g_lifetime;
+lt::LatencySnapshot g_snapshot;
+uint32_t g_sequence = 0;
+volatile uint64_t g_sink = 0;   // keeps results observable
+
+// Two versions of one config file, and the reload state
+char g_configText[2][1024 * 1024];
+size_t g_configLength[2];
+uint32_t g_configVersion = 0;
+lt::TargetConfig<kConfigTargets> g_config;
+lt::TargetSlots<kConfigTargets> g_slots;
+lt::ReloadPlan<kConfigTargets> g_plan;
+
+// The route table, and the two default routes a change flips between
+lt::FakeRouteSource g_routes;
+lt::GatewayResolver g_gateways;
+lt::RouteEntry g_defaultRoutes[2];
+uint32_t g_defaultRoute = 0;
+
+// One icon's pixels and glyph coverage for the kernel benchmarks, and their names
+uint32_t g_kernelPixels[64 * 64];
+uint8_t g_kernelCoverage[64 * 64];
+char g_kernelNames[lt::ARGB_AVX2 + 1][kKernelSizeCount][16];
+
+BenchResult g_results[48];
+uint32_t g_resultCount = 0;
+
+const char* OptionValue(const char* arg, const char* name) {
+    size_t len = strlen(name);
+    return strncmp(arg, name, len) == 0 ? arg + len : nullptr;
+}
+
+void Usage() {
+    fputs("usage: latency_bench [--json] [--filter=<substring>] [--min-time=<ms>] [--check-allocations]\n", stderr);
+}
+
+bool ParseArgs(int argc, char** argv, BenchOptions* opt) {
+    memset(opt, 0, sizeof(*opt));
+    opt->filter = "";
+    opt->minTimeMs = 300;
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        const char* v;
+        if (!strcmp(a, "--json")) {
+            opt->json = true;
+        } else if (!strcmp(a, "--check-allocations")) {
+            opt->checkAllocations = true;
+        } else if ((v = OptionValue(a, "--filter="))) {
+            opt->filter = v;
+        } else if ((v = OptionValue(a, "--min-time="))) {
+            opt->minTimeMs = (uint32_t)strtoul(v, nullptr, 10);
+            if (!opt->minTimeMs) return false;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Warm up with one batch, then double the batch until one takes at least minTimeMs
+template <typename Op>
+void Measure(const BenchOptions& opt, const char* name, Op op, uint64_t batch = 1000) {
+    if (!strstr(name, opt.filter) || g_resultCount == sizeof(g_results) / sizeof(g_results[0])) return;
+    for (uint64_t i = 0; i < batch; ++i) op();
+    uint64_t ops = batch;
+    for (;;) {
+        uint64_t allocsBefore = lt::AllocationCount();
+        uint64_t start = lt::MonoNowUs();
+        for (uint64_t i = 0; i < ops; ++i) op();
+        uint64_t elapsedUs = lt::MonoNowUs() - start;
+        uint64_t allocs = lt::AllocationCount() - allocsBefore;
+        if (elapsedUs >= opt.minTimeMs * 1000ull || ops >= (1ull << 40)) {
+            BenchResult& r = g_results[g_resultCount++];
+            r.name = name;
+            r.ops = ops;
+            r.nsPerOp = elapsedUs * 1000.0 / (double)ops;
+            r.allocs = allocs;
+            r.allocsPerOp = (double)allocs / (double)ops;
+            return;
+        }
+        ops *= 2;
+    }
+}
+
+// Every preset on the simulator, the gateway close by and the rest spread out with a little
+// loss, on the tray's adaptive cadence
+void SetUpEngine() {
+    for (uint32_t i = 0; i < kTargets; ++i) {
+        lt::SimProfile profile = {i == 0 ? 1u : 8u + 3u * i, 2u + i % 5, 5, 300, 100, 2, 0, lt::SIM_UNIFORM};
+        g_sim.SetProfile(i, profile);
+    }
+    g_engine.Init(&g_sim, kTargets, kProbeIntervalMs, 1000, kStatsWindow);
+    g_engine.SetCadence(lt::AdaptiveCadence(kProbeIntervalMs, kProbeBudget));
+    g_engine.SetFocus((int)kShownTarget);
+    g_engine.SetTarget(0, "192.168.1.1", false);
+    for (uint32_t i = 1; i < kTargets; ++i) g_engine.SetTarget(i, lt::kPresets[i].address);
+    g_tray.Configure(250);
+}
+
+// The render stage for one snapshot of the displayed target, as RenderThread does it
+void Render(uint64_t nowMs) {
+    const lt::PresetTarget& preset = lt::kPresets[kShownTarget];
+    lt::CaptureSnapshot(g_engine, kShownTarget, preset.ip, preset.IsIPv6(), ++g_sequence, &g_snapshot);
+    uint32_t rttUs = g_shown.Filter(g_snapshot.rttUs);
+    char iconText[16];
+    lt::FormatRttMs(iconText, sizeof(iconText), rttUs, 1);
+    uint32_t tint = 0;
+    if (g_snapshot.completed) {
+        tint = 0xFF000000u | (rttUs == lt::kNoReply ? lt::kTintPoor : lt::LatencyTint(rttUs / 1000, kFairMs, kPoorMs));
+    }
+    char tip[256];
+    lt::TextBuffer text(tip, sizeof(tip) - 1);
+    lt::FormatTooltip(text, g_snapshot, preset.name, preset.method, preset.port, rttUs, kTipCapacity - 1);
+    tip[text.Length()] = 0;
+    uint32_t fields = g_tray.Submit(iconText, tint, tip, nowMs);
+    if (fields & lt::TRAY_ICON) {
+        const uint32_t* pixels = g_compositor.Compose(g_atlas[0], g_tray.IconText(), 0xFFFFFF, 0, g_tray.IconTint());
+        if (pixels) g_sink += pixels[0];
+    }
+    g_tray.Commit(fields, true, nowMs);
+}
+
+void Tick() {
+    lt::ProbeResult results[kTargets];
+    int n = g_engine.Run(60000, results, (int)kTargets);
+    bool refresh = false;
+    for (int k = 0; k < n; ++k) {
+        if (results[k].target == kShownTarget) refresh = true;
+    }
+    if (refresh) Render(g_sim.NowMs());
+}
+
+// xorshift32 RTTs around 20 ms
+uint32_t g_rng = 2463534242u;
+uint32_t NextRttUs() {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 17;
+    g_rng ^= g_rng << 5;
+    return 15000 + g_rng % 10000;
+}
+
+void RecordReply() {
+    uint32_t rttUs = NextRttUs();
+    uint32_t evicted;
+    if (g_stats.Add(rttUs, &evicted)) g_window.Remove(evicted);
+    g_window.Add(rttUs);
+    g_lifetime.Add(rttUs);
+    g_sink += g_stats.Mean();
+}
+
+// Constructed on first use: the 10000-slot engine is tens of MB, and only the config
+// benchmarks should pay for it (and after the footprint's peak RSS is taken)
+ConfigEngine& BigEngine() {
+    static ConfigEngine engine;
+    return engine;
+}
+
+lt::SimulatedBackend<kConfigTargets>& BigSim() {
+    static lt::SimulatedBackend<kConfigTargets> sim(1);
+    return sim;
+}
+
+// kConfigTargets datacenter endpoints: ICMP, TCP and DNS, IPv4 and IPv6, named and not.
+// Version 1 moves every 100th target to another address and renames the one after it.
+size_t MakeConfig(char* out, size_t size, uint32_t version) {
+    lt::TextBuffer text(out, size);
+    text.Str("# generated by latency_bench\ninterval 1s\ntimeout 800ms\nthresholds 50 150\n");
+    for (uint32_t i = 0; i < kConfigTargets; ++i) {
+        uint32_t host = i + (version && i % 100 == 0 ? 50000 : 0);
+        const char* suffix = version && i % 100 == 1 ? "-b" : "";
+        char line[128];
+        switch (i % 4) {
+        case 0:
+            snprintf(line, sizeof(line), "target icmp 10.%u.%u.%u name=dc%05u-icmp%s\n", host >> 16, (host >> 8) & 255,
+                     host & 255, i, suffix);
+            break;
+        case 1:
+            snprintf(line, sizeof(line), "target tcp 10.%u.%u.%u port=443 name=\"dc %05u https%s\"\n", host >> 16,
+                     (host >> 8) & 255, host & 255, i, suffix);
+            break;
+        case 2:
+            snprintf(line, sizeof(line), "target dns 2001:db8::%x:%x name=dc%05u-dns%s\n", host >> 16, host & 0xFFFF, i, suffix);
+            break;
+        default:
+            snprintf(line, sizeof(line), "target icmp 2001:db8:1::%x:%x   # unnamed\n", host >> 16, host & 0xFFFF);
+            break;
+        }
+        text.Str(line);
+    }
+    return text.Length();
+}
+
+// Parse, plan and swap in one version of the config, as the headless build does on a change
+bool Reload(uint32_t version) {
+    if (!lt::ParseTargetConfig(g_configText[version], g_configLength[version], &g_config, nullptr)) return false;
+    g_slots.Plan(g_config, &g_plan);
+    uint32_t refused = lt::ApplyReload(BigEngine(), g_config, g_plan, [](uint32_t slot, const lt::ConfigTarget& t) {
+        return BigEngine().SetTarget(slot, t.address);
+    });
+    g_slots.Commit(g_config, g_plan);
+    return refused == 0;
+}
+
+// Wi-Fi and wired default routes, the first one active
+bool SetUpRoutes() {
+    static const uint8_t wifi[4] = {192, 168, 1, 1};
+    static const uint8_t wired[4] = {10, 0, 0, 1};
+    g_defaultRoutes[0] = lt::FakeRouteSource::MakeRoute(lt::ROUTE_IPV4, wifi, 50, 3);
+    g_defaultRoutes[1] = lt::FakeRouteSource::MakeRoute(lt::ROUTE_IPV4, wired, 25, 2);
+    g_routes.SetBackgroundRoutes(kBackgroundRoutes);
+    g_routes.AddDefault(g_defaultRoutes[0]);
+    return g_gateways.Init(&g_routes);
+}
+
+// Switch networks: the old default route goes, the other one comes, the gateway slot is told
+void ChangeGateway() {
+    g_routes.RemoveDefault(g_defaultRoutes[g_defaultRoute]);
+    g_defaultRoute ^= 1;
+    g_routes.AddDefault(g_defaultRoutes[g_defaultRoute]);
+    if (g_gateways.Update()) {
+        char gw[64];
+        bool isIPv6;
+        if (g_gateways.PreferredGateway(gw, sizeof(gw), &isIPv6)) g_sink += (uint8_t)gw[0];
+    }
+}
+
+// The kernel work of one icon at `size` px: background fill, tint, glyph blend, premultiply
+void ComposeKernels(const lt::ArgbKernels& k, uint32_t size) {
+    size_t n = (size_t)size * size;
+    k.fill(g_kernelPixels, n, 0xC0202020u);
+    k.tint(g_kernelPixels, n, 0x2E7D32, 0x80);
+    k.blend(g_kernelPixels, g_kernelCoverage, n, 0xFFFFFF);
+    k.premultiply(g_kernelPixels, n);
+    g_sink += g_kernelPixels[n - 1];
+}
+
+uint64_t PeakResidentKB() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    pmc.cb = sizeof(pmc);
+    return GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) ? pmc.PeakWorkingSetSize / 1024 : 0;
+#else
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? (uint64_t)usage.ru_maxrss : 0;   // KB on Linux
+#endif
+}
+
+const char* CompilerName(char* out, size_t size) {
+#if defined(__clang__)
+    snprintf(out, size, "clang %d.%d.%d", __clang_major__, __clang_minor__, __clang_patchlevel__);
+#elif defined(__GNUC__)
+    snprintf(out, size, "gcc %d.%d.%d", __GNUC__, __GNUC_MINOR__, __GNUC_PATCHLEVEL__);
+#elif defined(_MSC_VER)
+    snprintf(out, size, "msvc %d", _MSC_VER);
+#else
+    snprintf(out, size, "unknown");
+#endif
+    return out;
+}
+
+struct Footprint {
+    const char* name;
+    uint64_t bytes;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    if (!ParseArgs(argc, argv, &opt)) {
+        Usage();
+        return 2;
+    }
+
+    SetUpEngine();
+    static const uint32_t sizes[3] = {16, 32, 64};
+    for (int i = 0; i < 3; ++i) {
+        if (!g_atlas[i].BuildBuiltin(sizes[i])) {
+            fputs("cannot build the icon atlas\n", stderr);
+            return 1;
+        }
+    }
+    if (!SetUpRoutes()) {
+        fputs("cannot resolve the simulated gateway\n", stderr);
+        return 1;
+    }
+    // Fill the statistics so percentiles and tooltips have a full window
+    for (int i = 0; i < 4000; ++i) Tick();
+    for (uint32_t i = 0; i < kStatsCapacity; ++i) RecordReply();
+
+    uint64_t peakKB = PeakResidentKB();   // before the config benchmarks' engine
+
+    Measure(opt, "tick", [] { Tick(); });
+    Measure(opt, "stats", [] { RecordReply(); });
+    Measure(opt, "snapshot", [] {
+        lt::CaptureSnapshot(g_engine, kShownTarget, "1.1.1.1", false, ++g_sequence, &g_snapshot);
+        g_sink += g_snapshot.p99Us;
+    });
+    Measure(opt, "tooltip", [] {
+        char tip[256];
+        lt::TextBuffer text(tip, sizeof(tip) - 1);
+        lt::FormatTooltip(text, g_snapshot, "Cloudflare DNS", lt::METHOD_ICMP, 0, g_snapshot.rttUs, kTipCapacity - 1);
+        g_sink += text.Length();
+    });
+    static const char* const composeNames[3] = {"compose16", "compose32", "compose64"};
+    for (int i = 0; i < 3; ++i) {
+        const lt::GlyphAtlas<64>& atlas = g_atlas[i];
+        Measure(opt, composeNames[i], [&atlas] {
+            const uint32_t* pixels = g_compositor.Compose(atlas, "188", 0xFFFFFF, 0, 0xFF2E7D32u);
+            g_sink += pixels ? pixels[0] : 0;
+        });
+    }
+    for (uint32_t i = 0; i < 64 * 64; ++i) g_kernelCoverage[i] = (uint8_t)(i * 37 % 251);
+    for (uint32_t isa = lt::ARGB_SCALAR; isa <= lt::ARGB_AVX2; ++isa) {
+        const lt::ArgbKernels* kernels = lt::ArgbKernelsFor((lt::ArgbIsa)isa);
+        for (uint32_t i = 0; kernels && i < kKernelSizeCount; ++i) {
+            const uint32_t size = kKernelSizes[i];
+            char* name = g_kernelNames[isa][i];
+            snprintf(name, sizeof(g_kernelNames[isa][i]), "argb_%s_%u", kernels->name, size);
+            Measure(opt, name, [kernels, size] { ComposeKernels(*kernels, size); });
+        }
+    }
+    Measure(opt, "gateway_change", [] { ChangeGateway(); });
+    Measure(opt, "gateway_resync", [] {
+        if (g_gateways.Resync()) g_sink += g_gateways.Version();
+    }, 10);
+    if (strstr("config_parse config_reload", opt.filter)) {
+        for (uint32_t v = 0; v < 2; ++v) g_configLength[v] = MakeConfig(g_configText[v], sizeof(g_configText[v]), v);
+        BigEngine().Init(&BigSim(), 0, 1000, 1000);
+        if (!Reload(0)) {
+            fputs("cannot load the generated config\n", stderr);
+            return 1;
+        }
+        Measure(opt, "config_parse", [] {
+            if (lt::ParseTargetConfig(g_configText[0], g_configLength[0], &g_config, nullptr)) g_sink += g_config.count;
+        }, 10);
+        Measure(opt, "config_reload", [] {
+            g_configVersion ^= 1;
+            if (Reload(g_configVersion)) g_sink += g_plan.added;
+        }, 10);
+    }
+
+    const Footprint footprint[] = {
+        {"engine_bytes", sizeof(g_engine)},
+        {"target_state_bytes", sizeof(Engine::SlotState)},
+        {"atlas_bytes", sizeof(g_atlas[0])},
+        {"compositor_bytes", sizeof(g_compositor)},
+        {"tray_coalescer_bytes", sizeof(g_tray)},
+        {"snapshot_bytes", sizeof(lt::LatencySnapshot)},
+        {"config_text_bytes", g_configLength[0]},
+        {"config_engine_bytes", sizeof(ConfigEngine)},
+        {"gateway_resolver_bytes", sizeof(lt::GatewayResolver)},
+        {"peak_rss_kb", peakKB},
+    };
+    const uint32_t footprintCount = sizeof(footprint) / sizeof(footprint[0]);
+    char compiler[48];
+    CompilerName(compiler, sizeof(compiler));
+    const char* kernels = lt::GetArgbKernels().name;
+
+    if (opt.json) {
+        printf("{\"suite\":\"latency_bench\",\"compiler\":\"%s\",\"pointer_bits\":%u,\"kernels\":\"%s\",\"targets\":%u,\"results\":[",
+               compiler, (unsigned)(sizeof(void*) * 8), kernels, kTargets);
+        for (uint32_t i = 0; i < g_resultCount; ++i) {
+            const BenchResult& r = g_results[i];
+            printf("%s{\"name\":\"%s\",\"ops\":%llu,\"ns_per_op\":%.1f,\"allocs_per_op\":%.3f}", i ? "," : "", r.name,
+                   (unsigned long long)r.ops, r.nsPerOp, r.allocsPerOp);
+        }
+        printf("],\"footprint\":{");
+        for (uint32_t i = 0; i < footprintCount; ++i) {
+            printf("%s\"%s\":%llu", i ? "," : "", footprint[i].name, (unsigned long long)footprint[i].bytes);
+        }
+        printf("}}\n");
+    } else {
+        printf("%s, %u-bit, %s kernels, %u targets\n", compiler, (unsigned)(sizeof(void*) * 8), kernels, kTargets);
+        for (uint32_t i = 0; i < g_resultCount; ++i) {
+            const BenchResult& r = g_results[i];
+            printf("  %-14s %12llu ops %12.1f ns/op %8.3f allocs/op\n", r.name, (unsigned long long)r.ops, r.nsPerOp,
+                   r.allocsPerOp);
+        }
+        for (uint32_t i = 0; i < footprintCount; ++i) {
+            printf("  %-22s %10llu\n", footprint[i].name, (unsigned long long)footprint[i].bytes);
+        }
+    }
+    int status = 0;
+    for (uint32_t i = 0; opt.checkAllocations && i < g_resultCount; ++i) {
+        const BenchResult& r = g_results[i];
+        if (!r.allocs) continue;
+        fprintf(stderr, "latency_bench: %s allocated %llu times in %llu operations after warm-up\n", r.name,
+                (unsigned long long)r.allocs, (unsigned long long)r.ops);
+        status = 1;
+    }
+    return status;
+}
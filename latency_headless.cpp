@@ -0,0 +1,1049 @@
+// latency_headless.cpp
+// Console/daemon build: the same ProbeEngine as the tray, without a window. Probes the preset
+// targets (core/presets.h) and/or addresses given on the command line and streams one record
+// per sample, or one per target and aggregation interval, as JSONL or CSV to stdout or a file.
+// Records are formatted into one fixed buffer (core/record_writer.h) and written at most about
+// once a second, so a busy stream costs no allocation and one write call per buffer.
+// --metrics serves the same data to Prometheus-style scrapers on 127.0.0.1 (OpenMetrics text,
+// core/metrics_server.h): the page is formatted once per second here and sent as-is by a
+// separate server thread, so scrapes never wait on the probe loop or the other way round.
+//
+// Backends: IcmpBackend (IcmpSendEcho2) on Windows, unprivileged ICMP datagram sockets on Linux
+// (net.ipv4.ping_group_range must include the user's group), or --sim for the deterministic
+// simulator in virtual time, optionally playing a --scenario file (core/sim_scenario.h: latency
+// distributions, loss bursts, reordering, spikes, outages and gateway changes). Targets given as
+// address:port ("1.1.1.1:443", "[::1]:443") or TCP presets are measured by TCP handshake time
+// instead (core/tcp_connect_backend.h), and targets given as dns:address[:port] or DNS presets by
+// the time the resolver takes to answer a query for --dns-name (core/dns_query_backend.h), and
+// http:// URLs by their time to first byte (core/http_probe_backend.h, host names looked up with
+// the system resolver), next to the ICMP targets in the same engine. JSONL samples of URL targets
+// also carry the request's phases (dns_ms, connect_ms, send_ms, ttfb_ms, http_status, reused); so
+// do CSV samples, as extra columns, when there is a URL target. The default gateway is tracked
+// from route change notifications. Built with LT_COUNT_ALLOCATIONS, --check-allocations counts
+// heap allocations per loop pass (core/alloc_counter.h) and fails the run if any pass after the
+// warm-up allocated. --config takes the targets, probe interval and timeout from a file
+// (core/target_config.h) instead, and keeps watching it: a saved change is parsed in full and
+// swapped into the running engine between two loop passes, unchanged targets keeping their slot,
+// index and statistics. A file that does not parse is reported and the current targets stay.
+//
+// Build:
+//    cl /O2 /EHsc /MD latency_headless.cpp ws2_32.lib iphlpapi.lib
+//    g++ -std=c++14 -O2 -pthread latency_headless.cpp -o latency_headless
+//    g++ -std=c++14 -O2 -pthread -DLT_COUNT_ALLOCATIONS latency_headless.cpp -o latency_headless_allocs
+//
+// Usage:
+//    latency_headless [--targets=all|<index|[dns:]address[:port]|http://url>,...] [--format=jsonl|csv] [--output=<file|->]
+//                     [--interval=<seconds>] [--duration=<seconds>] [--probe-interval=<ms>]
+//                     [--timeout=<ms>] [--dns-name=<name>] [--metrics[=<port>]] [--sim[=<seed>]]
+//                     [--scenario=<file>] [--check-allocations[=<warm-up passes>]] [--config=<file>]
+// --interval=0 (the default) writes every sample; otherwise one summary per target and interval,
+// aligned to UTC boundaries. --output=none writes no records (metrics only). --duration=0 runs
+// until SIGINT/SIGTERM (Ctrl+C). --metrics listens on 127.0.0.1:9464 unless a port is given.
+// --scenario implies --sim; --sim=<seed> overrides the scenario's seed. Simulated runs default to
+// one virtual hour and follow the scenario's gateway only, never the host's routes.
+// --check-allocations ignores the first 100 loop passes unless told otherwise and exits with
+// status 3 if a later one allocated. --config replaces --targets; the file's interval and
+// timeout, where it sets them, override --probe-interval and --timeout. It is checked for
+// changes about once a second.
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>        // MUST be before windows.h
+#include <ws2tcpip.h>
+#include <windows.h>
+#endif
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include "core/probe_engine.h"
+#include "core/sim_backend.h"
+#include "core/sim_scenario.h"
+#include "core/route_source_fake.h"
+#include "core/tcp_connect_backend.h"
+#include "core/dns_query_backend.h"
+#include "core/http_probe_backend.h"
+#include "core/system_resolver.h"
+#include "core/probe_mux.h"
+#include "core/gateway_resolver.h"
+#include "core/presets.h"
+#include "core/interval_stats.h"
+#include "core/record_writer.h"
+#include "core/metrics_server.h"
+#include "core/openmetrics.h"
+#include "core/mono_clock.h"
+#include "core/time_format.h"
+#include "core/alloc_counter.h"
+#include "core/target_config.h"
+#include "core/file_watch.h"
+#ifdef _WIN32
+#include "core/icmp_backend_win.h"
+#include "core/route_source_win.h"
+#else
+#include "core/icmp_socket_backend.h"
+#include "core/route_source_netlink.h"
+#endif
+
+namespace {
+
+const uint32_t kMaxTargets = 32;
+const uint32_t kFlushIntervalMs = 1000;   // longest a record waits in the buffer
+const uint32_t kMaxWaitMs = 1000;
+const uint32_t kMetricsRefreshMs = 1000;  // page age seen by scrapers
+const uint16_t kDefaultMetricsPort = 9464;
+const uint32_t kAllocationWarmup = 100;   // loop passes: stdio buffers, first connections
+const uint32_t kConfigCheckMs = 1000;     // how often --config is looked at
+
+enum OutputFormat { FORMAT_JSONL, FORMAT_CSV };
+
+struct HeadlessTarget {
+    bool used;                   // false for a slot a config reload freed
+    int preset;                  // index into lt::kPresets, 0 also for the config's gateway, -1 otherwise
+    const char* name;
+    lt::IpAddress ip;            // parsed beforehand (presets, config), family IP_NONE otherwise
+    char address[160];           // current address (the gateway slot follows the default route), or URL
+    char endpoint[168];          // as written out: the address, "1.1.1.1:443" / "[::1]:443" for TCP,
+                                 // "dns:1.1.1.1:53" / "dns:[::1]:53" for DNS, the URL for HTTP
+    bool isIPv6;
+    lt::ProbeMethod method;
+    uint16_t port;               // TCP and DNS: port probed (HTTP: part of the URL)
+};
+
+struct HeadlessOptions {
+    const char* targets;
+    OutputFormat format;
+    const char* output;
+    uint32_t intervalS;          // 0: one record per sample
+    uint32_t durationS;          // 0: until stopped
+    uint32_t probeIntervalMs;
+    uint32_t timeoutMs;
+    const char* dnsName;         // asked of DNS targets
+    int metricsPort;             // -1: no endpoint
+    bool sim;
+    uint64_t seed;
+    bool seedGiven;              // --sim=<seed>, over the scenario's
+    const char* scenario;        // file, or nullptr
+    bool checkAllocations;
+    uint32_t allocationWarmup;   // loop passes not checked
+    const char* config;          // target config file, or nullptr
+};
+
+volatile sig_atomic_t g_stop = 0;
+
+#ifdef _WIN32
+typedef lt::IcmpBackend<kMaxTargets> IcmpProbeBackend;
+typedef lt::WinRouteSource PlatformRouteSource;
+HANDLE g_wakeEvent = NULL;
+
+BOOL WINAPI OnConsoleControl(DWORD) {
+    g_stop = 1;
+    if (g_wakeEvent) SetEvent(g_wakeEvent);
+    return TRUE;
+}
+#else
+typedef lt::IcmpSocketBackend<kMaxTargets> IcmpProbeBackend;
+typedef lt::NetlinkRouteSource PlatformRouteSource;
+
+void OnSignal(int) { g_stop = 1; }
+#endif
+
+// Large objects are static, as in the tray builds
+IcmpProbeBackend g_icmp;
+lt::TcpConnectBackend<kMaxTargets> g_tcp;
+lt::DnsQueryBackend<kMaxTargets> g_dns;
+lt::HttpProbeBackend<kMaxTargets> g_http;
+lt::ProbeMux<kMaxTargets, 3> g_mux;
+lt::SimulatedBackend<kMaxTargets> g_sim(1);
+lt::SimScenario g_scenario;
+lt::FakeRouteSource g_simRoutes;   // the scenario's default gateway
+char g_scenarioText[64 * 1024];
+lt::TargetConfig<kMaxTargets> g_config;   // the file being loaded
+lt::TargetSlots<kMaxTargets> g_slots;     // config target in each engine slot
+lt::ReloadPlan<kMaxTargets> g_plan;
+lt::FileWatch g_configWatch;
+char g_configText[64 * 1024];
+lt::ProbeEngine<kMaxTargets> g_engine;
+PlatformRouteSource g_routeSource;
+lt::GatewayResolver g_gateways;
+lt::RecordWriter<64 * 1024> g_out;
+HeadlessTarget g_targets[kMaxTargets];
+lt::IntervalStats g_intervals[kMaxTargets];
+uint32_t g_targetCount = 0;
+bool g_httpColumns = false;   // CSV samples carry the HTTP phases
+
+// OpenMetrics endpoint: lifetime counters per target and their label sets (rebuilt when the
+// gateway address changes)
+lt::MetricsServer<256 * 1024> g_metrics;
+lt::TargetMetrics g_targetMetrics[kMaxTargets];
+char g_labels[kMaxTargets][256];
+uint64_t g_formatUs = 0;
+uint64_t g_truncatedPages = 0;
+std::atomic<bool> g_serving(false);
+
+const char* OptionValue(const char* arg, const char* name) {
+    size_t len = strlen(name);
+    return strncmp(arg, name, len) == 0 ? arg + len : nullptr;
+}
+
+const char* MethodName(lt::ProbeMethod method) {
+    switch (method) {
+    case lt::METHOD_TCP: return "tcp";
+    case lt::METHOD_DNS: return "dns";
+    case lt::METHOD_HTTP: return "http";
+    default: return "icmp";
+    }
+}
+
+void Usage() {
+    fputs("usage: latency_headless [--targets=all|<index|[dns:]address[:port]|http://url>,...] [--format=jsonl|csv]\n"
+          "                        [--output=<file|->] [--interval=<seconds>] [--duration=<seconds>]\n"
+          "                        [--probe-interval=<ms>] [--timeout=<ms>] [--dns-name=<name>]\n"
+          "                        [--metrics[=<port>]] [--sim[=<seed>]] [--scenario=<file>]\n"
+          "                        [--check-allocations[=<warm-up passes>]] [--config=<file>]\n"
+          "presets:\n",
+          stderr);
+    for (uint32_t i = 0; i < lt::kPresetCount; ++i) {
+        const lt::PresetTarget& p = lt::kPresets[i];
+        if (p.method != lt::METHOD_ICMP) {
+            fprintf(stderr, "  %2u  %-24s %s port %u (%s)\n", i, p.name, p.ip, p.port, MethodName(p.method));
+        } else {
+            fprintf(stderr, "  %2u  %-24s %s\n", i, p.name, p.ip ? p.ip : "(default gateway)");
+        }
+    }
+}
+
+bool ParseArgs(int argc, char** argv, HeadlessOptions* opt) {
+    memset(opt, 0, sizeof(*opt));
+    opt->targets = "all";
+    opt->format = FORMAT_JSONL;
+    opt->output = "-";
+    opt->probeIntervalMs = 1000;
+    opt->timeoutMs = 1000;
+    opt->dnsName = lt::kDnsQueryName;
+    opt->metricsPort = -1;
+    opt->seed = 1;
+    opt->allocationWarmup = kAllocationWarmup;
+    bool targets = false;
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        const char* v;
+        if ((v = OptionValue(a, "--targets="))) {
+            opt->targets = v;
+            targets = true;
+        } else if ((v = OptionValue(a, "--format="))) {
+            if (!strcmp(v, "jsonl")) opt->format = FORMAT_JSONL;
+            else if (!strcmp(v, "csv")) opt->format = FORMAT_CSV;
+            else return false;
+        } else if ((v = OptionValue(a, "--output="))) {
+            opt->output = v;
+        } else if ((v = OptionValue(a, "--interval="))) {
+            opt->intervalS = (uint32_t)strtoul(v, nullptr, 10);
+        } else if ((v = OptionValue(a, "--duration="))) {
+            opt->durationS = (uint32_t)strtoul(v, nullptr, 10);
+        } else if ((v = OptionValue(a, "--probe-interval="))) {
+            opt->probeIntervalMs = (uint32_t)strtoul(v, nullptr, 10);
+            if (opt->probeIntervalMs < 10) return false;
+        } else if ((v = OptionValue(a, "--timeout="))) {
+            opt->timeoutMs = (uint32_t)strtoul(v, nullptr, 10);
+            if (opt->timeoutMs == 0) return false;
+        } else if ((v = OptionValue(a, "--dns-name="))) {
+            opt->dnsName = v;
+        } else if (!strcmp(a, "--metrics")) {
+            opt->metricsPort = kDefaultMetricsPort;
+        } else if ((v = OptionValue(a, "--metrics="))) {
+            unsigned long port = strtoul(v, nullptr, 10);
+            if (port > 65535) return false;
+            opt->metricsPort = (int)port;
+        } else if (!strcmp(a, "--sim")) {
+            opt->sim = true;
+        } else if ((v = OptionValue(a, "--sim="))) {
+            opt->sim = true;
+            opt->seed = strtoull(v, nullptr, 10);
+            opt->seedGiven = true;
+        } else if ((v = OptionValue(a, "--scenario="))) {
+            opt->sim = true;
+            opt->scenario = v;
+        } else if (!strcmp(a, "--check-allocations")) {
+            opt->checkAllocations = true;
+        } else if ((v = OptionValue(a, "--check-allocations="))) {
+            opt->checkAllocations = true;
+            opt->allocationWarmup = (uint32_t)strtoul(v, nullptr, 10);
+        } else if ((v = OptionValue(a, "--config="))) {
+            opt->config = v;
+        } else {
+            return false;
+        }
+    }
+    return !(targets && opt->config);
+}
+
+void SetEndpoint(HeadlessTarget& t) {
+    if (t.method == lt::METHOD_ICMP || t.method == lt::METHOD_HTTP) {
+        memcpy(t.endpoint, t.address, strlen(t.address) + 1);   // address[160] always fits
+    } else {
+        snprintf(t.endpoint, sizeof(t.endpoint), t.isIPv6 ? "%s[%s]:%u" : "%s%s:%u",
+                 t.method == lt::METHOD_DNS ? "dns:" : "", t.address, t.port);
+    }
+}
+
+bool AddTarget(int preset, const char* address, const char* name, lt::ProbeMethod method, uint16_t port) {
+    if (g_targetCount >= kMaxTargets) return false;
+    HeadlessTarget& t = g_targets[g_targetCount++];
+    t.used = true;
+    t.preset = preset;
+    t.name = name;
+    t.ip = preset > 0 ? lt::kPresets[preset].address : lt::IpAddress();
+    t.address[0] = 0;
+    t.isIPv6 = false;
+    t.method = method;
+    t.port = port;
+    if (address) {
+        snprintf(t.address, sizeof(t.address), "%s", address);
+        // Presets are parsed already. A URL looks its host name up as IPv4; an address in it
+        // speaks for itself.
+        t.isIPv6 = preset > 0 ? lt::kPresets[preset].IsIPv6() : method != lt::METHOD_HTTP && strchr(address, ':') != nullptr;
+    }
+    SetEndpoint(t);
+    return true;
+}
+
+// "1.1.1.1" and "2606:4700::1111" probe with ICMP; "1.1.1.1:443" and "[2606:4700::1111]:443"
+// measure the TCP handshake to that port; "dns:1.1.1.1", "dns:[::1]:5353" query a resolver;
+// "http://example.com/" requests the URL
+bool AddAddress(char* item) {
+    if (!strncmp(item, "http://", 7)) {
+        if (!AddTarget(-1, item, nullptr, lt::METHOD_HTTP, 0)) return false;
+        g_targets[g_targetCount - 1].name = g_targets[g_targetCount - 1].endpoint;
+        return true;
+    }
+    lt::ProbeMethod method = lt::METHOD_ICMP;
+    if (!strncmp(item, "dns:", 4)) {
+        method = lt::METHOD_DNS;
+        item += 4;
+    }
+    unsigned long port = 0;
+    char* address = item;
+    char* colon = nullptr;
+    if (item[0] == '[') {
+        char* close = strchr(item, ']');
+        if (!close || (close[1] != ':' && close[1] != 0)) return false;
+        *close = 0;
+        address = item + 1;
+        if (close[1]) colon = close + 1;
+    } else if ((colon = strchr(item, ':')) != nullptr && strchr(colon + 1, ':')) {
+        colon = nullptr;   // bare IPv6 address
+    }
+    if (colon) {
+        *colon = 0;
+        char* end = nullptr;
+        port = strtoul(colon + 1, &end, 10);
+        if (end == colon + 1 || *end || port == 0 || port > 65535) return false;
+        if (method == lt::METHOD_ICMP) method = lt::METHOD_TCP;
+    }
+    if (method == lt::METHOD_DNS && !port) port = lt::DnsQueryBackend<kMaxTargets>::kDefaultPort;
+    if (!AddTarget(-1, address, nullptr, method, (uint16_t)port)) return false;
+    // An address is its own name
+    g_targets[g_targetCount - 1].name = g_targets[g_targetCount - 1].endpoint;
+    return true;
+}
+
+// "all", or a comma separated list of preset indices and literal addresses
+bool ParseTargets(const char* list) {
+    if (!strcmp(list, "all")) {
+        for (uint32_t i = 0; i < lt::kPresetCount; ++i) {
+            const lt::PresetTarget& p = lt::kPresets[i];
+            AddTarget((int)i, p.ip, p.name, p.method, p.port);
+        }
+        return true;
+    }
+    for (const char* p = list; *p;) {
+        const char* end = strchr(p, ',');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        char item[160];
+        if (len == 0 || len >= sizeof(item)) return false;
+        memcpy(item, p, len);
+        item[len] = 0;
+        char* last = nullptr;
+        unsigned long index = strtoul(item, &last, 10);
+        if (!*last) {
+            if (index >= lt::kPresetCount) return false;
+            const lt::PresetTarget& p = lt::kPresets[index];
+            if (!AddTarget((int)index, p.ip, p.name, p.method, p.port)) return false;
+        } else if (!AddAddress(item)) {
+            return false;
+        }
+        p = end ? end + 1 : p + len;
+    }
+    return g_targetCount > 0;
+}
+
+// Read and parse a scenario into g_scenario; complains on stderr
+bool LoadScenario(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot open scenario %s\n", path);
+        return false;
+    }
+    size_t len = fread(g_scenarioText, 1, sizeof(g_scenarioText), f);
+    bool tooLarge = len == sizeof(g_scenarioText) && fgetc(f) != EOF;
+    fclose(f);
+    if (tooLarge) {
+        fprintf(stderr, "scenario %s: larger than %u bytes\n", path, (unsigned)sizeof(g_scenarioText));
+        return false;
+    }
+    lt::SimScenarioError error;
+    if (!lt::ParseSimScenario(g_scenarioText, len, &g_scenario, &error)) {
+        fprintf(stderr, "scenario %s:%u: %s\n", path, error.line, error.message);
+        return false;
+    }
+    for (uint32_t i = 0; i < g_scenario.eventCount; ++i) {
+        const lt::SimEvent& e = g_scenario.events[i];
+        if (e.type != lt::SIM_GATEWAY && e.target != lt::kSimAllTargets && (uint32_t)e.target >= g_targetCount) {
+            fprintf(stderr, "scenario %s:%u: no target %d (%u configured)\n", path, e.line, e.target, g_targetCount);
+            return false;
+        }
+    }
+    return true;
+}
+
+// target="1",name="Cloudflare DNS",address="1.1.1.1"
+void FormatLabels(uint32_t i) {
+    lt::TextBuffer labels(g_labels[i], sizeof(g_labels[i]) - 1);
+    labels.Str("target=\"");
+    labels.U64(i);
+    labels.Str("\",name=");
+    labels.Quoted(g_targets[i].name, true);
+    labels.Str(",address=");
+    labels.Quoted(g_targets[i].endpoint, true);
+    g_labels[i][labels.Length()] = 0;
+}
+
+// The default gateway to probe (the fallback if none is known)
+void CurrentGateway(char* gw, size_t size, bool* isIPv6) {
+    if (!g_gateways.PreferredGateway(gw, size, isIPv6)) {
+        snprintf(gw, size, "%s", lt::kGatewayFallback);
+        *isIPv6 = false;
+    }
+}
+
+// Point every default-gateway target at the current gateway
+void BindGateway(bool rebind) {
+    char gw[64];
+    bool isIPv6 = false;
+    CurrentGateway(gw, sizeof(gw), &isIPv6);
+    for (uint32_t i = 0; i < g_targetCount; ++i) {
+        HeadlessTarget& t = g_targets[i];
+        if (!t.used || t.preset != 0) continue;
+        if (rebind && !strcmp(t.address, gw) && t.isIPv6 == isIPv6) continue;
+        snprintf(t.address, sizeof(t.address), "%s", gw);
+        t.isIPv6 = isIPv6;
+        SetEndpoint(t);
+        if (rebind) {
+            g_engine.SetTarget(i, t.address, t.isIPv6);
+            g_targetMetrics[i].Reset();   // a new series: the address is a label
+            FormatLabels(i);
+        }
+    }
+}
+
+// Read and parse the target config into g_config; complains on stderr
+bool LoadConfig(const char* path, bool running) {
+    const char* keeping = running ? ", keeping the current targets" : "";
+    size_t len = 0;
+    bool tooLarge = false;
+    if (!lt::ReadWholeFile(path, g_configText, sizeof(g_configText), &len, &tooLarge)) {
+        if (tooLarge) {
+            fprintf(stderr, "config %s: larger than %u bytes%s\n", path, (unsigned)sizeof(g_configText), keeping);
+        } else {
+            fprintf(stderr, "cannot read config %s%s\n", path, keeping);
+        }
+        return false;
+    }
+    lt::TargetConfigError error;
+    if (!lt::ParseTargetConfig(g_configText, len, &g_config, &error)) {
+        fprintf(stderr, "config %s:%u: %s%s\n", path, error.line, error.message, keeping);
+        return false;
+    }
+    return true;
+}
+
+// Probe interval and timeout: the config's where it sets them, the command line's otherwise
+void ConfigTiming(const HeadlessOptions& opt, uint32_t* intervalMs, uint32_t* timeoutMs) {
+    *intervalMs = g_config.probeIntervalMs ? g_config.probeIntervalMs : opt.probeIntervalMs;
+    *timeoutMs = g_config.timeoutMs ? g_config.timeoutMs : opt.timeoutMs;
+}
+
+// Slot i from a config target, not bound yet. The name lives in g_slots, which holds it from
+// the next Commit on.
+void DescribeTarget(uint32_t i, const lt::ConfigTarget& c) {
+    HeadlessTarget& t = g_targets[i];
+    t.used = true;
+    t.preset = c.IsGateway() ? 0 : -1;
+    t.name = g_slots.Target(i).name;
+    t.ip = c.address;
+    t.isIPv6 = c.address.IsIPv6();
+    t.method = (lt::ProbeMethod)c.method;
+    t.port = c.port;
+    if (c.IsGateway()) {
+        CurrentGateway(t.address, sizeof(t.address), &t.isIPv6);
+    } else {
+        lt::FormatIpAddress(c.address, t.address, sizeof(t.address));
+    }
+    SetEndpoint(t);
+}
+
+// Send slot i's probes to the backend for its method
+void RouteTarget(uint32_t i) {
+    const HeadlessTarget& t = g_targets[i];
+    if (t.method == lt::METHOD_TCP) {
+        g_tcp.SetPort(i, t.port);
+        g_mux.Route(i, &g_tcp);
+    } else if (t.method == lt::METHOD_DNS) {
+        g_dns.SetPort(i, t.port);
+        g_mux.Route(i, &g_dns);
+    } else if (t.method == lt::METHOD_HTTP) {
+        g_mux.Route(i, &g_http);
+    } else {
+        g_mux.Route(i, &g_icmp);
+    }
+}
+
+// Presets and config targets bind their parsed address, everything else its text
+bool BindTarget(uint32_t i) {
+    const HeadlessTarget& t = g_targets[i];
+    return t.ip.Valid() ? g_engine.SetTarget(i, t.ip) : g_engine.SetTarget(i, t.address, t.isIPv6);
+}
+
+// Gateway close by, the rest spread out, a little loss everywhere: mostly single probes, now
+// and then a burst, and the odd late or duplicate reply
+lt::SimProfile DefaultSimProfile(uint32_t i) {
+    lt::SimProfile profile = {g_targets[i].preset == 0 ? 1u : 8u + 3u * i, 2u + i % 5, 5, 300, 100, 2, 0, lt::SIM_UNIFORM};
+    return profile;
+}
+
+// Swap the changed config into the running engine, between two loop passes. Targets that
+// stayed keep their slot, statistics, metrics and current interval; a renamed one starts new
+// metric series under its new labels.
+void ReloadConfig(const HeadlessOptions& opt) {
+    uint64_t begin = lt::MonoNowUs();
+    if (!LoadConfig(opt.config, true)) return;
+    g_slots.Plan(g_config, &g_plan);
+    uint32_t refused = lt::ApplyReload(g_engine, g_config, g_plan, [&opt](uint32_t i, const lt::ConfigTarget& c) {
+        DescribeTarget(i, c);
+        RouteTarget(i);
+        if (opt.sim && !opt.scenario) g_sim.SetProfile(i, DefaultSimProfile(i));
+        return BindTarget(i);
+    });
+    g_slots.Commit(g_config, g_plan);
+    uint32_t span = g_targetCount > g_plan.slotCount ? g_targetCount : g_plan.slotCount;
+    for (uint32_t i = 0; i < span; ++i) {
+        uint8_t change = g_plan.change[i];
+        if (change == lt::SLOT_FREE || change == lt::SLOT_KEPT) continue;
+        g_targetMetrics[i].Reset();
+        if (change != lt::SLOT_RENAMED) g_intervals[i].Reset();
+        if (change == lt::SLOT_REMOVED) {
+            g_targets[i].used = false;
+            g_targets[i].preset = -1;
+        } else {
+            FormatLabels(i);
+        }
+    }
+    g_targetCount = g_plan.slotCount;
+    uint32_t intervalMs, timeoutMs;
+    ConfigTiming(opt, &intervalMs, &timeoutMs);
+    if (intervalMs != g_engine.IntervalMs() || timeoutMs != g_engine.TimeoutMs()) {
+        g_engine.SetTiming(lt::FixedCadence(intervalMs), timeoutMs);
+    }
+    fprintf(stderr, "config %s: %u targets (%u kept, %u added, %u removed%s) in %llu us\n", opt.config, g_config.count,
+            g_plan.kept, g_plan.added, g_plan.removed, refused ? ", some could not be bound" : "",
+            (unsigned long long)(lt::MonoNowUs() - begin));
+}
+
+const char* StatusText(uint8_t status) {
+    switch (status) {
+    case lt::PROBE_OK: return "ok";
+    case lt::PROBE_TIMEOUT: return "timeout";
+    default: return "error";
+    }
+}
+
+template <typename Writer>
+void WriteHeader(Writer& out, OutputFormat format, bool perSample) {
+    if (format != FORMAT_CSV) return;
+    out.Str(perSample ? "time,target,name,address,status,rtt_ms"
+                      : "time,target,name,address,samples,lost,loss_pct,min_ms,avg_ms,p50_ms,p90_ms,p99_ms,max_ms,jitter_ms");
+    if (perSample && g_httpColumns) out.Str(",http_status,reused,dns_ms,connect_ms,send_ms,ttfb_ms");
+    out.EndRecord();
+}
+
+template <typename Writer>
+void WriteTargetFields(Writer& out, OutputFormat format, int64_t timeMs, uint32_t target) {
+    const HeadlessTarget& t = g_targets[target];
+    bool json = format == FORMAT_JSONL;
+    if (json) {
+        out.Str("{\"time\":\"");
+        out.Time(timeMs);
+        out.Str("\",\"target\":");
+        out.U64(target);
+        out.Str(",\"name\":");
+        out.Quoted(t.name, true);
+        out.Str(",\"address\":");
+        out.Quoted(t.endpoint, true);
+    } else {
+        out.Time(timeMs);
+        out.Char(',');
+        out.U64(target);
+        out.Char(',');
+        out.Quoted(t.name, false);
+        out.Char(',');
+        if (t.method == lt::METHOD_HTTP) out.Quoted(t.endpoint, false);   // a URL may hold a comma
+        else out.Str(t.endpoint);
+    }
+}
+
+// Phases of an HTTP probe, when the backend still has those of this sample
+template <typename Writer>
+void WritePhases(Writer& out, OutputFormat format, const lt::ProbeResult& r) {
+    static const char* const keys[4] = {"dns_ms", "connect_ms", "send_ms", "ttfb_ms"};
+    bool json = format == FORMAT_JSONL;
+    const lt::HttpPhases& p = g_http.Phases(r.target);
+    if (p.seq != r.seq) {
+        if (!json) out.Str(",,,,,,");
+        return;
+    }
+    const uint32_t values[4] = {p.dnsUs, p.connectUs, p.sendUs, p.firstByteUs};
+    out.Str(json ? ",\"http_status\":" : ",");
+    if (p.status) out.U64(p.status);
+    else if (json) out.Str("null");
+    out.Str(json ? ",\"reused\":" : ",");
+    out.Str(p.reused ? "true" : "false");
+    for (int k = 0; k < 4; ++k) {
+        if (json) {
+            out.Str(",\"");
+            out.Str(keys[k]);
+            out.Str("\":");
+        } else {
+            out.Char(',');
+        }
+        out.Ms(values[k], json ? "null" : "");
+    }
+}
+
+template <typename Writer>
+void WriteSample(Writer& out, OutputFormat format, int64_t timeMs, const lt::ProbeResult& r) {
+    bool json = format == FORMAT_JSONL;
+    WriteTargetFields(out, format, timeMs, r.target);
+    out.Str(json ? ",\"status\":\"" : ",");
+    out.Str(StatusText(r.status));
+    out.Str(json ? "\",\"rtt_ms\":" : ",");
+    out.Ms(r.status == lt::PROBE_OK ? r.rttUs : lt::kNoReply, json ? "null" : "");
+    if (g_targets[r.target].method == lt::METHOD_HTTP) {
+        WritePhases(out, format, r);
+    } else if (!json && g_httpColumns) {
+        out.Str(",,,,,,");
+    }
+    if (json) out.Char('}');
+    out.EndRecord();
+}
+
+template <typename Writer>
+void WriteInterval(Writer& out, OutputFormat format, int64_t startMs, uint32_t target, const lt::IntervalSummary& m) {
+    static const char* const keys[7] = {"min_ms", "avg_ms", "p50_ms", "p90_ms", "p99_ms", "max_ms", "jitter_ms"};
+    const uint32_t values[7] = {m.minUs, m.avgUs, m.p50Us, m.p90Us, m.p99Us, m.maxUs, m.jitterUs};
+    bool json = format == FORMAT_JSONL;
+    WriteTargetFields(out, format, startMs, target);
+    out.Str(json ? ",\"samples\":" : ",");
+    out.U64(m.samples);
+    out.Str(json ? ",\"lost\":" : ",");
+    out.U64(m.lost);
+    out.Str(json ? ",\"loss_pct\":" : ",");
+    out.Percent(m.lost, m.samples);
+    for (int k = 0; k < 7; ++k) {
+        if (json) {
+            out.Str(",\"");
+            out.Str(keys[k]);
+            out.Str("\":");
+        } else {
+            out.Char(',');
+        }
+        out.Ms(values[k], json ? "null" : "");
+    }
+    if (json) out.Char('}');
+    out.EndRecord();
+}
+
+// The target's label set plus key="value"
+void ExtraLabel(char* labels, size_t size, uint32_t i, const char* key, const char* value) {
+    lt::TextBuffer text(labels, size - 1);
+    text.Str(g_labels[i]);
+    text.Char(',');
+    text.Str(key);
+    text.Str("=\"");
+    text.Str(value);
+    text.Char('"');
+    labels[text.Length()] = 0;
+}
+
+// Format the next metrics page and hand it to the server thread. Families are written one
+// after another with every target inside, as OpenMetrics requires.
+void PublishMetrics() {
+    uint64_t begin = lt::MonoNowUs();
+    lt::TextBuffer& page = g_metrics.Page();
+
+    lt::OpenMetricsFamily(page, "latency_probe_rtt_seconds", "histogram", "seconds", "Round-trip time of echo replies.");
+    for (uint32_t i = 0; i < g_targetCount; ++i) {
+        if (!g_targets[i].used) continue;
+        lt::OpenMetricsHistogram(page, "latency_probe_rtt_seconds", g_labels[i], g_targetMetrics[i].rtt,
+                                 g_targetMetrics[i].rttSumUs);
+    }
+
+    lt::OpenMetricsFamily(page, "latency_probe_results", "counter", nullptr, "Completed probes by outcome.");
+    static const char* const statuses[3] = {"ok", "timeout", "error"};
+    for (uint32_t i = 0; i < g_targetCount; ++i) {
+        if (!g_targets[i].used) continue;
+        const uint64_t counts[3] = {g_targetMetrics[i].replies, g_targetMetrics[i].timeouts, g_targetMetrics[i].errors};
+        for (int k = 0; k < 3; ++k) {
+            char labels[sizeof(g_labels[i]) + 32];
+            lt::TextBuffer text(labels, sizeof(labels) - 1);
+            text.Str(g_labels[i]);
+            text.Str(",status=\"");
+            text.Str(statuses[k]);
+            text.Char('"');
+            labels[text.Length()] = 0;
+            lt::OpenMetricsValue(page, "latency_probe_results", "_total", labels, counts[k]);
+        }
+    }
+
+    lt::OpenMetricsFamily(page, "latency_probe_last_rtt_seconds", "gauge", "seconds", "Most recent reply (absent after a lost probe).");
+    for (uint32_t i = 0; i < g_targetCount; ++i) {
+        if (!g_targets[i].used) continue;
+        uint32_t last = g_engine.LastRttUs(i);
+        if (last != lt::kNoReply) lt::OpenMetricsSeconds(page, "latency_probe_last_rtt_seconds", nullptr, g_labels[i], last);
+    }
+
+    lt::OpenMetricsFamily(page, "latency_probe_jitter_seconds", "gauge", "seconds", "RFC 3550 interarrival jitter over the rolling window.");
+    for (uint32_t i = 0; i < g_targetCount; ++i) {
+        if (!g_targets[i].used) continue;
+        const lt::RollingStats<lt::kDefaultStatsWindow>& stats = g_engine.State(i).stats;
+        if (stats.Count() > 1) lt::OpenMetricsSeconds(page, "latency_probe_jitter_seconds", nullptr, g_labels[i], stats.Jitter());
+    }
+
+    // Loss by sequence number: sliding windows, bursts, replies after the fact
+    lt::OpenMetricsFamily(page, "latency_probe_loss_ratio", "gauge", "ratio", "Lost probes among the last 60 and 900 probes.");
+    for (uint32_t i = 0; i < g_targetCount; ++i) {
+        if (!g_targets[i].used) continue;
+        const lt::LossTracker& loss = g_engine.State(i).loss;
+        if (!loss.Probes()) continue;
+        char labels[sizeof(g_labels[i]) + 32];
+        const uint32_t bp[2] = {loss.ShortLossBp(), loss.LongLossBp()};
+        static const char* const windows[2] = {"60", "900"};
+        for (int k = 0; k < 2; ++k) {
+            ExtraLabel(labels, sizeof(labels), i, "window", windows[k]);
+            lt::OpenMetricsName(page, "latency_probe_loss_ratio", nullptr, labels);
+            page.Fixed(bp[k], 4);
+            page.Char('\n');
+        }
+    }
+    lt::OpenMetricsFamily(page, "latency_probe_loss_bursts", "counter", nullptr, "Runs of consecutive lost probes, by length.");
+    static const char* const lengths[lt::kLossBurstBuckets] = {"1", "2", "3-4", "5-8", "9-16", "17-32", "33-64", "65+"};
+    for (uint32_t i = 0; i < g_targetCount; ++i) {
+        if (!g_targets[i].used) continue;
+        const lt::LossTracker& loss = g_engine.State(i).loss;
+        for (uint32_t b = 0; b < lt::kLossBurstBuckets; ++b) {
+            char labels[sizeof(g_labels[i]) + 32];
+            ExtraLabel(labels, sizeof(labels), i, "length", lengths[b]);
+            lt::OpenMetricsValue(page, "latency_probe_loss_bursts", "_total", labels, loss.Bursts(b));
+        }
+    }
+    lt::OpenMetricsFamily(page, "latency_probe_late_replies", "counter", nullptr, "Replies to probes that had already timed out.");
+    for (uint32_t i = 0; i < g_targetCount; ++i) {
+        if (!g_targets[i].used) continue;
+        lt::OpenMetricsValue(page, "latency_probe_late_replies", "_total", g_labels[i], g_engine.State(i).loss.LateReplies());
+    }
+    lt::OpenMetricsFamily(page, "latency_probe_reordered_replies", "counter", nullptr, "Late replies that came after a later probe's reply.");
+    for (uint32_t i = 0; i < g_targetCount; ++i) {
+        if (!g_targets[i].used) continue;
+        lt::OpenMetricsValue(page, "latency_probe_reordered_replies", "_total", g_labels[i], g_engine.State(i).loss.Reordered());
+    }
+    lt::OpenMetricsFamily(page, "latency_probe_duplicate_replies", "counter", nullptr, "Second replies to probes already answered.");
+    for (uint32_t i = 0; i < g_targetCount; ++i) {
+        if (!g_targets[i].used) continue;
+        lt::OpenMetricsValue(page, "latency_probe_duplicate_replies", "_total", g_labels[i], g_engine.State(i).loss.Duplicates());
+    }
+
+    // Self-metrics: scheduler, output and exporter
+    const lt::SchedulerStats& sched = g_engine.Scheduler().Stats();
+    lt::OpenMetricsFamily(page, "latency_engine_probes", "counter", nullptr, "Probes fired by the scheduler.");
+    lt::OpenMetricsValue(page, "latency_engine_probes", "_total", nullptr, sched.ticks);
+    lt::OpenMetricsFamily(page, "latency_engine_skipped_ticks", "counter", nullptr, "Probe deadlines dropped after a stall.");
+    lt::OpenMetricsValue(page, "latency_engine_skipped_ticks", "_total", nullptr, sched.skippedTicks);
+    lt::OpenMetricsFamily(page, "latency_engine_deferred_probes", "counter", nullptr, "Probes postponed by the probe budget.");
+    lt::OpenMetricsValue(page, "latency_engine_deferred_probes", "_total", nullptr, sched.deferred);
+    lt::OpenMetricsFamily(page, "latency_engine_late_max_seconds", "gauge", "seconds", "Largest delay of a probe behind its deadline.");
+    lt::OpenMetricsSeconds(page, "latency_engine_late_max_seconds", nullptr, nullptr, (uint64_t)sched.maxLateMs * 1000);
+    lt::OpenMetricsFamily(page, "latency_output_records", "counter", nullptr, "JSONL/CSV records written.");
+    lt::OpenMetricsValue(page, "latency_output_records", "_total", nullptr, g_out.Records());
+
+    const lt::MetricsServerStats& server = g_metrics.Stats();
+    lt::OpenMetricsFamily(page, "latency_exporter_scrapes", "counter", nullptr, "Metrics pages served.");
+    lt::OpenMetricsValue(page, "latency_exporter_scrapes", "_total", nullptr, server.scrapes.load(std::memory_order_relaxed));
+    lt::OpenMetricsFamily(page, "latency_exporter_errors", "counter", nullptr, "Bad requests, unknown paths and timed out connections.");
+    lt::OpenMetricsValue(page, "latency_exporter_errors", "_total", nullptr, server.errors.load(std::memory_order_relaxed));
+    lt::OpenMetricsFamily(page, "latency_exporter_rejected_connections", "counter", nullptr, "Connections refused with every slot busy.");
+    lt::OpenMetricsValue(page, "latency_exporter_rejected_connections", "_total", nullptr, server.rejected.load(std::memory_order_relaxed));
+    lt::OpenMetricsFamily(page, "latency_exporter_truncated_pages", "counter", nullptr, "Pages that did not fit the page buffer.");
+    lt::OpenMetricsValue(page, "latency_exporter_truncated_pages", "_total", nullptr, g_truncatedPages);
+    lt::OpenMetricsFamily(page, "latency_exporter_format_seconds", "gauge", "seconds", "Time spent formatting the previous page.");
+    lt::OpenMetricsSeconds(page, "latency_exporter_format_seconds", nullptr, nullptr, g_formatUs);
+    lt::OpenMetricsEnd(page);
+
+    if (!g_metrics.Publish()) ++g_truncatedPages;
+    g_formatUs = lt::MonoNowUs() - begin;
+}
+
+// One summary per target that had samples, then start over
+void FlushIntervals(OutputFormat format, int64_t startMs) {
+    for (uint32_t i = 0; i < g_targetCount; ++i) {
+        if (!g_intervals[i].Samples()) continue;
+        lt::IntervalSummary m;
+        g_intervals[i].Summarize(&m);
+        WriteInterval(g_out, format, startMs, i, m);
+        g_intervals[i].Reset();
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    HeadlessOptions opt;
+    if (!ParseArgs(argc, argv, &opt) || (!opt.config && !ParseTargets(opt.targets))) {
+        Usage();
+        return 2;
+    }
+    if (opt.checkAllocations && !lt::kAllocationCounting) {
+        fputs("--check-allocations needs a build with LT_COUNT_ALLOCATIONS defined\n", stderr);
+        return 2;
+    }
+    if (opt.config) {
+        // Watch from before the first read, so a save during it is picked up afterwards
+        g_configWatch.Init(opt.config);
+        if (!LoadConfig(opt.config, false)) return 2;
+        g_slots.Plan(g_config, &g_plan);
+        for (uint32_t i = 0; i < g_plan.slotCount; ++i) DescribeTarget(i, g_config.targets[g_plan.target[i]]);
+        g_slots.Commit(g_config, g_plan);
+        g_targetCount = g_plan.slotCount;
+    }
+    uint32_t probeIntervalMs = opt.probeIntervalMs, timeoutMs = opt.timeoutMs;
+    if (opt.config) ConfigTiming(opt, &probeIntervalMs, &timeoutMs);
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        fputs("WSAStartup failed\n", stderr);
+        return 1;
+    }
+    g_wakeEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    SetConsoleCtrlHandler(OnConsoleControl, TRUE);
+    g_routeSource.SetNotifyEvent(g_wakeEvent);
+    g_icmp.SetWakeEvent(g_wakeEvent);
+#else
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+    signal(SIGPIPE, SIG_IGN);   // a closed pipe shows up as a failed write instead
+#endif
+
+    if (opt.sim) {
+        if (opt.scenario && !LoadScenario(opt.scenario)) return 2;
+        bool seeded = opt.scenario && g_scenario.hasSeed && !opt.seedGiven;
+        g_sim = lt::SimulatedBackend<kMaxTargets>(seeded ? g_scenario.seed : opt.seed);
+        for (uint32_t i = 0; i < g_targetCount; ++i) g_sim.SetProfile(i, DefaultSimProfile(i));
+        // Scenario profiles override those, and its gateway is the only one
+        if (opt.scenario) g_sim.SetScenario(&g_scenario, &g_simRoutes);
+    }
+
+    // Subscribe before the first snapshot so no change falls in between
+    bool routes = opt.sim ? g_gateways.Init(&g_simRoutes) : g_routeSource.Open() && g_gateways.Init(&g_routeSource);
+    BindGateway(false);
+
+    lt::ProbeBackend* backend = &g_mux;
+    g_mux.Init(&g_icmp);
+    g_mux.AddSide(&g_tcp);
+    g_mux.AddSide(&g_dns);
+    g_mux.AddSide(&g_http);
+    if (!g_dns.SetQuery(opt.dnsName)) {
+        fprintf(stderr, "invalid DNS name %s\n", opt.dnsName);
+        return 2;
+    }
+    char resolver[64];
+    bool resolverIPv6 = false;
+    if (lt::SystemResolver(resolver, sizeof(resolver), &resolverIPv6)) g_http.SetResolver(resolver, resolverIPv6);
+    bool methods[4] = {false, false, false, false};   // by lt::ProbeMethod
+    for (uint32_t i = 0; i < g_targetCount; ++i) {
+        methods[g_targets[i].method] = true;
+        RouteTarget(i);
+    }
+    g_httpColumns = methods[lt::METHOD_HTTP];
+    if (opt.sim) {
+        backend = &g_sim;
+        if (!opt.durationS) opt.durationS = 3600;   // virtual time runs as fast as the CPU allows
+    } else {
+#ifdef _WIN32
+        g_tcp.SetWakeEvent(g_wakeEvent);
+        g_dns.SetWakeEvent(g_wakeEvent);
+        g_http.SetWakeEvent(g_wakeEvent);
+#else
+        // One wait for everything: the ICMP sockets, then the TCP epoll set, which holds the DNS
+        // one, which holds the HTTP one, which holds the route socket
+        g_http.SetWakeFd(g_routeSource.Fd());
+        g_dns.SetWakeFd(g_http.Fd());
+        g_tcp.SetWakeFd(g_dns.Fd());
+        g_icmp.SetWakeFd(g_tcp.Fd());
+        bool need4 = false, need6 = false;
+        for (uint32_t i = 0; i < g_targetCount; ++i) {
+            if (g_targets[i].method == lt::METHOD_ICMP) (g_targets[i].isIPv6 ? need6 : need4) = true;
+        }
+        if ((need4 && !g_icmp.Available(false)) || (need6 && !g_icmp.Available(true))) {
+            fputs("cannot open an ICMP datagram socket; allow this user's group with\n"
+                  "  sysctl net.ipv4.ping_group_range=\"0 2147483647\"\n",
+                  stderr);
+            return 1;
+        }
+#endif
+    }
+
+    g_engine.Init(backend, g_targetCount, probeIntervalMs, timeoutMs);
+    for (uint32_t i = 0; i < g_targetCount; ++i) {
+        const HeadlessTarget& t = g_targets[i];
+        if (!BindTarget(i)) {
+            fprintf(stderr, "invalid %s %s\n", t.method == lt::METHOD_HTTP ? "URL" : "address", t.endpoint);
+            return 2;
+        }
+    }
+
+    bool records = strcmp(opt.output, "none") != 0;
+    if (records && !g_out.Open(opt.output)) {
+        fprintf(stderr, "cannot open %s\n", opt.output);
+        return 1;
+    }
+    bool perSample = opt.intervalS == 0;
+    int64_t intervalMs = (int64_t)opt.intervalS * 1000;
+    if (records) {
+        WriteHeader(g_out, opt.format, perSample);
+        g_out.Flush();
+    }
+    char methodText[24] = "simulated";
+    if (!opt.sim) {
+        methodText[0] = 0;
+        for (int m = lt::METHOD_ICMP; m <= lt::METHOD_HTTP; ++m) {
+            if (!methods[m]) continue;
+            if (methodText[0]) strcat(methodText, "+");
+            strcat(methodText, MethodName((lt::ProbeMethod)m));
+        }
+    }
+    fprintf(stderr, "probing %u targets every %u ms (%s%s)\n", g_targetCount, probeIntervalMs, methodText,
+            routes || opt.sim ? "" : ", no route notifications");
+
+    std::thread server;
+    if (opt.metricsPort >= 0) {
+        if (!g_metrics.Open((uint16_t)opt.metricsPort)) {
+            fprintf(stderr, "cannot listen on 127.0.0.1:%d\n", opt.metricsPort);
+            return 1;
+        }
+        for (uint32_t i = 0; i < g_targetCount; ++i) FormatLabels(i);
+        PublishMetrics();
+        g_serving = true;
+        server = std::thread([] {
+            while (g_serving.load(std::memory_order_relaxed)) g_metrics.Serve(200);
+        });
+        fprintf(stderr, "metrics on http://127.0.0.1:%u/metrics\n", g_metrics.Port());
+    }
+
+    // Record times: the wall clock, or virtual time from the start in simulation
+    uint64_t startBackendMs = backend->NowMs();
+    int64_t startWallMs = opt.scenario && g_scenario.hasStart ? g_scenario.startMs : (int64_t)(lt::RealtimeNowUs() / 1000);
+    uint64_t lastFlushUs = lt::MonoNowUs();
+    uint64_t lastPublishUs = lastFlushUs;
+    uint64_t lastConfigCheckUs = lastFlushUs;
+    int64_t wallMs = startWallMs;
+    int64_t intervalStart = perSample ? 0 : lt::FloorDivide(wallMs, intervalMs) * intervalMs;
+    lt::ProbeResult results[kMaxTargets];
+    lt::AllocationWatch allocations(opt.allocationWarmup);
+
+    while (!g_stop) {
+        allocations.BeginTick();
+        if (routes && g_gateways.Update()) BindGateway(true);
+
+        uint32_t waitMs = kMaxWaitMs;
+        if (!perSample) {
+            int64_t untilBoundary = intervalStart + intervalMs - wallMs;
+            if (untilBoundary < (int64_t)waitMs) waitMs = untilBoundary > 0 ? (uint32_t)untilBoundary : 0;
+        }
+        int n = g_engine.Run(waitMs, results, kMaxTargets);
+
+        uint64_t elapsedMs = backend->NowMs() - startBackendMs;
+        wallMs = opt.sim ? startWallMs + (int64_t)elapsedMs : (int64_t)(lt::RealtimeNowUs() / 1000);
+        if (!perSample && wallMs >= intervalStart + intervalMs) {
+            FlushIntervals(opt.format, intervalStart);
+            intervalStart = lt::FloorDivide(wallMs, intervalMs) * intervalMs;
+        }
+        for (int k = 0; k < n; ++k) {
+            g_targetMetrics[results[k].target].Add(results[k]);
+            if (!records) continue;
+            if (perSample) {
+                WriteSample(g_out, opt.format, wallMs, results[k]);
+            } else {
+                g_intervals[results[k].target].Add(results[k].status, results[k].rttUs);
+            }
+        }
+
+        uint64_t nowUs = lt::MonoNowUs();
+        if (g_configWatch.Watching() && nowUs - lastConfigCheckUs >= kConfigCheckMs * 1000ull) {
+            lastConfigCheckUs = nowUs;
+            if (g_configWatch.Changed()) ReloadConfig(opt);
+        }
+        if (g_serving && nowUs - lastPublishUs >= kMetricsRefreshMs * 1000ull) {
+            PublishMetrics();
+            lastPublishUs = nowUs;
+        }
+        if (g_out.Buffered() && nowUs - lastFlushUs >= kFlushIntervalMs * 1000ull) {
+            g_out.Flush();
+            lastFlushUs = nowUs;
+        }
+        allocations.EndTick();
+        if (g_out.Failed()) break;   // disk full, reader went away
+        if (opt.durationS && elapsedMs >= (uint64_t)opt.durationS * 1000) break;
+    }
+
+    if (records && !perSample) FlushIntervals(opt.format, intervalStart);   // the partial last interval
+    g_out.Close();
+    if (g_serving) {
+        g_serving = false;
+        server.join();
+        g_metrics.Close();
+    }
+    fprintf(stderr, "%llu records, %llu writes%s\n", (unsigned long long)g_out.Records(),
+            (unsigned long long)g_out.Writes(), g_out.Failed() ? ", output failed" : "");
+    bool allocated = opt.checkAllocations && allocations.Allocations();
+    if (opt.checkAllocations) {
+        fprintf(stderr, "%llu allocations in %llu loop passes after the first %u", (unsigned long long)allocations.Allocations(),
+                (unsigned long long)(allocations.Ticks() > opt.allocationWarmup ? allocations.Ticks() - opt.allocationWarmup : 0),
+                opt.allocationWarmup);
+        if (allocated) {
+            fprintf(stderr, " (first in pass %llu, at most %llu in one)", (unsigned long long)allocations.FirstTick(),
+                    (unsigned long long)allocations.MaxPerTick());
+        }
+        fputc('\n', stderr);
+    }
+#ifdef _WIN32
+    g_routeSource.Close();
+    CloseHandle(g_wakeEvent);
+    WSACleanup();
+#endif
+    return g_out.Failed() ? 1 : allocated ? 3 : 0;
+}
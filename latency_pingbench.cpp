@@ -0,0 +1,725 @@
+// latency_pingbench.cpp
+// Throughput benchmark and self-check for the Linux probe backends, run against loopback so it
+// needs no external network. Every slot keeps one probe in flight and starts the next one as
+// soon as it completes; the run reports probes per second, RTT percentiles, and every probe
+// that did not succeed (timeouts, errors, stale replies).
+//  - ICMP (default): the datagram socket backend (core/icmp_socket_backend.h), with the system
+//    calls each echo cost. --batch=1 gives the one-call-per-datagram baseline.
+//  - --tcp: the handshake prober (core/tcp_connect_backend.h) against listeners this program
+//    opens on an ephemeral port of each target address and drains between polls (the kernel
+//    completes handshakes before accept). --accept-delay lets each listener accept only one
+//    connection per that many ms and --backlog sizes its accept queue: once the queue is full
+//    the kernel drops SYNs, and the handshake time shows the client's SYN retransmissions.
+//  - --dns: the query prober (core/dns_query_backend.h) against a stub resolver this program
+//    runs on an ephemeral UDP port of each target address, also between polls. It answers every
+//    query with one A record, --reply-delay=<ms> late, and ignores --drop=<percent> of them;
+//    every dropped query must come back as exactly one timeout.
+//  - --http: the HTTP prober (core/http_probe_backend.h) against a stub server this program runs
+//    on an ephemeral port of each target address, also between polls. It answers each request
+//    --reply-delay=<ms> late with a --body=<bytes> body (--chunked: chunked encoding), and with
+//    --keepalive=0 closes the connection after every response, so each probe connects again.
+//    --names requests http://bench.test:<port>/, looked up with the stub resolver (one IPv4
+//    target). Reports the mean of each request phase and how many probes reused a connection.
+// Linux only (the Windows backends are not built here).
+//
+// Build:
+//    g++ -std=c++14 -O2 latency_pingbench.cpp -o latency_pingbench
+//
+// Usage:
+//    latency_pingbench [--targets=127.0.0.1,::1] [--inflight=<n>] [--batch=64]
+//                      [--duration=<seconds>] [--timeout=<ms>]
+//    latency_pingbench --tcp [--accept-delay=<ms>] [--backlog=<n>] [other options as above]
+//    latency_pingbench --dns [--reply-delay=<ms>] [--drop=<percent>] [other options as above]
+//    latency_pingbench --http [--reply-delay=<ms>] [--body=<bytes>] [--chunked] [--keepalive=0]
+//                      [--names] [other options as above]
+// --inflight defaults to 1024 echoes or queries, or 64 handshakes or requests (each holds a
+// descriptor).
+// Exits with status 1 if any probe timed out (beyond the stub's drops), failed, or came back
+// unmatched, and with 77 if this host cannot run it: no ICMP datagram sockets for the user's
+// group, or a target address it cannot open a socket on (ctest reports that as skipped).
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "core/latency_histogram.h"
+#include "core/mono_clock.h"
+
+#ifdef __linux__
+
+#include <unistd.h>
+#include <sys/uio.h>
+#include "core/icmp_socket_backend.h"
+#include "core/tcp_connect_backend.h"
+#include "core/dns_query_backend.h"
+#include "core/http_probe_backend.h"
+
+namespace {
+
+const uint32_t kMaxInFlight = 8192;
+const uint32_t kMaxAddresses = 16;
+const uint32_t kMaxConnections = 2 * kMaxInFlight;   // closing ones may overlap their successors
+const int kExitUnavailable = 77;   // not permitted or not possible here (automake's skip status)
+const uint32_t kMaxBody = 64 * 1024;
+const uint64_t kListenerMarker = 1ull << 32;         // epoll data of a listener: marker | index
+
+struct BenchOptions {
+    char targets[256];
+    uint32_t inFlight;           // 0: the mode's default
+    uint32_t batch;
+    uint32_t durationS;
+    uint32_t timeoutMs;
+    bool tcp;
+    uint32_t acceptDelayMs;
+    int backlog;
+    bool dns;
+    uint32_t replyDelayMs;
+    uint32_t dropPercent;
+    bool http;
+    uint32_t bodyBytes;
+    bool chunked;
+    bool keepAlive;
+    bool names;
+};
+
+// Loopback listener for --tcp: accepts (late, if asked) and closes straight away
+struct Listener {
+    int fd;
+    uint16_t port;
+    uint64_t nextAcceptUs;
+};
+
+// Stub resolver for --dns: one socket per address, replies queued until due. The delay is the
+// same for every query, so the queue is in due order.
+struct StubReply {
+    uint64_t dueUs;
+    int fd;
+    struct sockaddr_storage to;
+    socklen_t toLen;
+    uint32_t len;
+    uint8_t msg[320];            // the query (at most 271 bytes) plus one answer
+};
+
+struct Stub {
+    int fd[kMaxAddresses];
+    uint32_t count;
+    uint32_t head;
+    uint32_t queued;
+    uint32_t rng;
+    uint64_t queries;
+    uint64_t dropped;
+    uint64_t overflow;           // replies that found the queue full
+    uint8_t answer[4];           // address of the A record
+    StubReply queue[kMaxInFlight];
+};
+
+// Connection to the stub HTTP server
+struct ServerConn {
+    int fd;                      // -1 once closed (the slot is freed when it leaves the due queue)
+    bool queued;                 // a request waits in the due queue
+    bool writing;                // response partly written, waiting for room
+    uint32_t matched;            // bytes of the "\r\n\r\n" ending the request seen so far
+    uint32_t sent;               // bytes of the response written
+    uint32_t headerLen;
+    char header[96];
+};
+
+// Stub HTTP server for --http: one epoll set for the listeners and connections, requests
+// answered once due. The delay is the same for every request, so the due queue is in order.
+struct Server {
+    int epoll;
+    uint32_t head;
+    uint32_t queued;
+    uint32_t freeCount;
+    uint64_t connections;
+    uint64_t requests;
+    uint32_t due[kMaxConnections];
+    uint64_t dueUs[kMaxConnections];
+    uint32_t freeList[kMaxConnections];
+    ServerConn conns[kMaxConnections];
+};
+
+lt::IcmpSocketBackend<kMaxInFlight> g_icmp;
+lt::TcpConnectBackend<kMaxInFlight> g_tcp;
+lt::DnsQueryBackend<kMaxInFlight> g_dns;
+lt::HttpProbeBackend<kMaxInFlight> g_http;
+uint32_t g_seq[kMaxInFlight];
+lt::ProbeResult g_results[kMaxInFlight];
+Listener g_listeners[kMaxAddresses];
+Stub g_stub;
+Server g_server;
+char g_body[kMaxBody];
+
+const char* OptionValue(const char* arg, const char* name) {
+    size_t len = strlen(name);
+    return strncmp(arg, name, len) == 0 ? arg + len : nullptr;
+}
+
+void Usage() {
+    fputs("usage: latency_pingbench [--targets=127.0.0.1,::1] [--inflight=<n>] [--batch=64]\n"
+          "                         [--duration=<seconds>] [--timeout=<ms>]\n"
+          "                         [--tcp [--accept-delay=<ms>] [--backlog=<n>]]\n"
+          "                         [--dns [--reply-delay=<ms>] [--drop=<percent>]]\n"
+          "                         [--http [--reply-delay=<ms>] [--body=<bytes>] [--chunked] [--keepalive=0] [--names]]\n",
+          stderr);
+}
+
+bool ParseArgs(int argc, char** argv, BenchOptions* opt) {
+    memset(opt, 0, sizeof(*opt));
+    strcpy(opt->targets, "127.0.0.1,::1");
+    opt->batch = 64;
+    opt->durationS = 5;
+    opt->timeoutMs = 1000;
+    opt->backlog = 128;
+    opt->keepAlive = true;
+    for (int i = 1; i < argc; ++i) {
+        const char* v;
+        if ((v = OptionValue(argv[i], "--targets="))) {
+            if (strlen(v) >= sizeof(opt->targets)) return false;
+            strcpy(opt->targets, v);
+        } else if ((v = OptionValue(argv[i], "--inflight="))) {
+            opt->inFlight = (uint32_t)strtoul(v, nullptr, 10);
+        } else if ((v = OptionValue(argv[i], "--batch="))) {
+            opt->batch = (uint32_t)strtoul(v, nullptr, 10);
+        } else if ((v = OptionValue(argv[i], "--duration="))) {
+            opt->durationS = (uint32_t)strtoul(v, nullptr, 10);
+        } else if ((v = OptionValue(argv[i], "--timeout="))) {
+            opt->timeoutMs = (uint32_t)strtoul(v, nullptr, 10);
+        } else if (!strcmp(argv[i], "--tcp")) {
+            opt->tcp = true;
+        } else if ((v = OptionValue(argv[i], "--accept-delay="))) {
+            opt->acceptDelayMs = (uint32_t)strtoul(v, nullptr, 10);
+        } else if ((v = OptionValue(argv[i], "--backlog="))) {
+            opt->backlog = atoi(v);
+        } else if (!strcmp(argv[i], "--dns")) {
+            opt->dns = true;
+        } else if ((v = OptionValue(argv[i], "--reply-delay="))) {
+            opt->replyDelayMs = (uint32_t)strtoul(v, nullptr, 10);
+        } else if ((v = OptionValue(argv[i], "--drop="))) {
+            opt->dropPercent = (uint32_t)strtoul(v, nullptr, 10);
+            if (opt->dropPercent > 100) return false;
+        } else if (!strcmp(argv[i], "--http")) {
+            opt->http = true;
+        } else if ((v = OptionValue(argv[i], "--body="))) {
+            opt->bodyBytes = (uint32_t)strtoul(v, nullptr, 10);
+            if (opt->bodyBytes > kMaxBody) return false;
+        } else if (!strcmp(argv[i], "--chunked")) {
+            opt->chunked = true;
+        } else if ((v = OptionValue(argv[i], "--keepalive="))) {
+            opt->keepAlive = strtoul(v, nullptr, 10) != 0;
+        } else if (!strcmp(argv[i], "--names")) {
+            opt->names = true;
+        } else {
+            return false;
+        }
+    }
+    if ((int)opt->tcp + (int)opt->dns + (int)opt->http > 1) return false;
+    if (opt->inFlight == 0) opt->inFlight = opt->tcp || opt->http ? 64 : 1024;
+    if (opt->inFlight > kMaxInFlight) opt->inFlight = kMaxInFlight;
+    return true;
+}
+
+// Empty the accept queues, or take one connection per listener and delay. Returns how long
+// the caller may wait before the next accept is due (kNoReply: no limit).
+uint32_t Accept(uint32_t count, uint32_t delayMs) {
+    uint64_t now = lt::MonoNowUs();
+    uint32_t waitMs = lt::kNoReply;
+    for (uint32_t a = 0; a < count; ++a) {
+        Listener& l = g_listeners[a];
+        if (!delayMs) {
+            int c;
+            while ((c = accept4(l.fd, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) close(c);
+            continue;
+        }
+        if (now >= l.nextAcceptUs) {
+            int c = accept4(l.fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (c >= 0) {
+                close(c);
+                l.nextAcceptUs = now + (uint64_t)delayMs * 1000;
+            }
+        }
+        if (now < l.nextAcceptUs) {
+            uint32_t ms = (uint32_t)((l.nextAcceptUs - now + 999) / 1000);
+            if (ms < waitMs) waitMs = ms;
+        } else {
+            waitMs = 1;   // nothing was queued yet: look again soon
+        }
+    }
+    return waitMs;
+}
+
+bool Listen(Listener& l, const char* ip, bool isIPv6, const BenchOptions& opt) {
+    struct sockaddr_storage addr;
+    memset(&addr, 0, sizeof(addr));
+    socklen_t len;
+    if (isIPv6) {
+        struct sockaddr_in6* a6 = (struct sockaddr_in6*)&addr;
+        a6->sin6_family = AF_INET6;
+        if (inet_pton(AF_INET6, ip, &a6->sin6_addr) != 1) return false;
+        len = sizeof(*a6);
+    } else {
+        struct sockaddr_in* a4 = (struct sockaddr_in*)&addr;
+        a4->sin_family = AF_INET;
+        if (inet_pton(AF_INET, ip, &a4->sin_addr) != 1) return false;
+        len = sizeof(*a4);
+    }
+    l.fd = socket(isIPv6 ? AF_INET6 : AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (l.fd < 0) return false;
+    l.nextAcceptUs = 0;
+    if (bind(l.fd, (struct sockaddr*)&addr, len) != 0 || listen(l.fd, opt.backlog) != 0 ||
+        getsockname(l.fd, (struct sockaddr*)&addr, &len) != 0) {
+        close(l.fd);
+        return false;
+    }
+    l.port = ntohs(isIPv6 ? ((struct sockaddr_in6*)&addr)->sin6_port : ((struct sockaddr_in*)&addr)->sin_port);
+    return true;
+}
+
+// Stub resolver socket on an ephemeral port of ip. Returns the port, 0 on failure.
+uint16_t StubOpen(const char* ip, bool isIPv6) {
+    struct sockaddr_storage addr;
+    memset(&addr, 0, sizeof(addr));
+    socklen_t len;
+    if (isIPv6) {
+        struct sockaddr_in6* a6 = (struct sockaddr_in6*)&addr;
+        a6->sin6_family = AF_INET6;
+        if (inet_pton(AF_INET6, ip, &a6->sin6_addr) != 1) return 0;
+        len = sizeof(*a6);
+    } else {
+        struct sockaddr_in* a4 = (struct sockaddr_in*)&addr;
+        a4->sin_family = AF_INET;
+        if (inet_pton(AF_INET, ip, &a4->sin_addr) != 1) return 0;
+        len = sizeof(*a4);
+    }
+    int fd = socket(isIPv6 ? AF_INET6 : AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (fd < 0) return 0;
+    int size = 4 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    if (bind(fd, (struct sockaddr*)&addr, len) != 0 || getsockname(fd, (struct sockaddr*)&addr, &len) != 0) {
+        close(fd);
+        return 0;
+    }
+    g_stub.fd[g_stub.count++] = fd;
+    return ntohs(isIPv6 ? ((struct sockaddr_in6*)&addr)->sin6_port : ((struct sockaddr_in*)&addr)->sin_port);
+}
+
+// Read every waiting query, queue the answers that are not dropped, and send the ones that are
+// due. Returns how long the caller may wait before the next one is (kNoReply: no limit).
+uint32_t StubServe(uint32_t delayMs, uint32_t dropPercent) {
+    const uint32_t capacity = kMaxInFlight;
+    for (uint32_t a = 0; a < g_stub.count; ++a) {
+        for (;;) {
+            StubReply& r = g_stub.queue[(g_stub.head + g_stub.queued) % capacity];
+            r.toLen = sizeof(r.to);
+            ssize_t len = recvfrom(g_stub.fd[a], r.msg, 272, 0, (struct sockaddr*)&r.to, &r.toLen);
+            if (len < 0) break;
+            if (len < 12 || len > 271) continue;
+            ++g_stub.queries;
+            g_stub.rng ^= g_stub.rng << 13;
+            g_stub.rng ^= g_stub.rng >> 17;
+            g_stub.rng ^= g_stub.rng << 5;
+            if (g_stub.rng % 100 < dropPercent) {
+                ++g_stub.dropped;
+                continue;
+            }
+            if (g_stub.queued == capacity) {
+                ++g_stub.overflow;
+                continue;
+            }
+            // QR and RA set, one answer: pointer to the question name, A IN, TTL 300, the address
+            static const uint8_t answer[12] = {0xc0, 12, 0, 1, 0, 1, 0, 0, 1, 44, 0, 4};
+            r.msg[2] |= 0x80;
+            r.msg[3] = 0x80;
+            r.msg[7] = 1;
+            memcpy(r.msg + len, answer, sizeof(answer));
+            memcpy(r.msg + len + sizeof(answer), g_stub.answer, 4);
+            r.len = (uint32_t)len + sizeof(answer) + 4;
+            r.fd = g_stub.fd[a];
+            r.dueUs = lt::MonoNowUs() + (uint64_t)delayMs * 1000;
+            ++g_stub.queued;
+        }
+    }
+    uint64_t now = lt::MonoNowUs();
+    while (g_stub.queued) {
+        StubReply& r = g_stub.queue[g_stub.head];
+        if (now < r.dueUs) return (uint32_t)((r.dueUs - now + 999) / 1000);
+        sendto(r.fd, r.msg, r.len, 0, (struct sockaddr*)&r.to, r.toLen);
+        g_stub.head = (g_stub.head + 1) % capacity;
+        --g_stub.queued;
+    }
+    return lt::kNoReply;
+}
+
+void ServerClose(uint32_t c) {
+    ServerConn& conn = g_server.conns[c];
+    if (conn.fd >= 0) close(conn.fd);   // also leaves the epoll set
+    conn.fd = -1;
+    if (!conn.queued) g_server.freeList[g_server.freeCount++] = c;
+}
+
+void ServerWatch(uint32_t c, uint32_t events) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.u64 = c;
+    epoll_ctl(g_server.epoll, EPOLL_CTL_MOD, g_server.conns[c].fd, &ev);
+}
+
+bool ServerOpen(uint32_t listeners) {
+    g_server.epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (g_server.epoll < 0) return false;
+    for (uint32_t c = 0; c < kMaxConnections; ++c) {
+        g_server.conns[c].fd = -1;
+        g_server.freeList[g_server.freeCount++] = kMaxConnections - 1 - c;
+    }
+    for (uint32_t a = 0; a < listeners; ++a) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u64 = kListenerMarker | a;
+        if (epoll_ctl(g_server.epoll, EPOLL_CTL_ADD, g_listeners[a].fd, &ev) != 0) return false;
+    }
+    memset(g_body, 'x', sizeof(g_body));
+    return true;
+}
+
+// Write what is left of the response. Returns false if it has to wait for room.
+bool ServerWrite(uint32_t c, const BenchOptions& opt) {
+    ServerConn& conn = g_server.conns[c];
+    static const char kLastChunk[] = "\r\n0\r\n\r\n";
+    const char* trailer = opt.chunked ? (opt.bodyBytes ? kLastChunk : kLastChunk + 2) : "";
+    uint32_t trailerLen = (uint32_t)strlen(trailer);
+    const uint32_t lengths[3] = {conn.headerLen, opt.bodyBytes, trailerLen};
+    const char* parts[3] = {conn.header, g_body, trailer};
+    for (;;) {
+        struct iovec iov[3];
+        int count = 0;
+        uint32_t skip = conn.sent;
+        for (int k = 0; k < 3; ++k) {
+            if (skip >= lengths[k]) {
+                skip -= lengths[k];
+                continue;
+            }
+            iov[count].iov_base = (void*)(parts[k] + skip);
+            iov[count].iov_len = lengths[k] - skip;
+            ++count;
+            skip = 0;
+        }
+        if (!count) break;
+        ssize_t rc = writev(conn.fd, iov, count);
+        if (rc < 0) {
+            if (errno == EAGAIN) {
+                if (!conn.writing) ServerWatch(c, EPOLLOUT);
+                conn.writing = true;
+                return false;
+            }
+            ServerClose(c);
+            return true;
+        }
+        conn.sent += (uint32_t)rc;
+    }
+    if (conn.writing) ServerWatch(c, EPOLLIN);
+    conn.writing = false;
+    if (!opt.keepAlive) ServerClose(c);
+    return true;
+}
+
+void ServerRespond(uint32_t c, const BenchOptions& opt) {
+    ServerConn& conn = g_server.conns[c];
+    int len;
+    const char* connection = opt.keepAlive ? "" : "Connection: close\r\n";
+    if (opt.chunked) {
+        len = opt.bodyBytes ? snprintf(conn.header, sizeof(conn.header),
+                                       "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n%s\r\n%x\r\n", connection,
+                                       opt.bodyBytes)
+                            : snprintf(conn.header, sizeof(conn.header),
+                                       "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n%s\r\n", connection);
+    } else {
+        len = snprintf(conn.header, sizeof(conn.header), "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n%s\r\n",
+                       opt.bodyBytes, connection);
+    }
+    conn.headerLen = (uint32_t)len;
+    conn.sent = 0;
+    ServerWrite(c, opt);
+}
+
+// Read requests off the connection; each complete one is queued for its answer
+void ServerRead(uint32_t c, uint64_t dueUs) {
+    ServerConn& conn = g_server.conns[c];
+    static const char kEnd[4] = {'\r', '\n', '\r', '\n'};
+    char buffer[4096];
+    for (;;) {
+        ssize_t got = recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (got <= 0) {
+            if (got < 0 && errno == EAGAIN) return;
+            ServerClose(c);   // the prober closed it (or reset it after a timeout)
+            return;
+        }
+        for (ssize_t i = 0; i < got; ++i) {
+            conn.matched = buffer[i] == kEnd[conn.matched] ? conn.matched + 1 : (buffer[i] == '\r' ? 1 : 0);
+            if (conn.matched < 4) continue;
+            conn.matched = 0;
+            ++g_server.requests;
+            if (conn.queued) continue;   // pipelined: the prober never does this
+            conn.queued = true;
+            uint32_t tail = (g_server.head + g_server.queued) % kMaxConnections;
+            g_server.due[tail] = c;
+            g_server.dueUs[tail] = dueUs;
+            ++g_server.queued;
+        }
+    }
+}
+
+// Accept, read and answer what is due. Returns how long the caller may wait before the next
+// answer is (kNoReply: no limit).
+uint32_t ServerServe(const BenchOptions& opt) {
+    struct epoll_event events[64];
+    uint64_t dueUs = lt::MonoNowUs() + (uint64_t)opt.replyDelayMs * 1000;
+    int got;
+    do {
+        got = epoll_wait(g_server.epoll, events, 64, 0);
+        for (int k = 0; k < got; ++k) {
+            uint64_t data = events[k].data.u64;
+            if (data & kListenerMarker) {
+                int fd;
+                while ((fd = accept4(g_listeners[data & 0xffff].fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    if (!g_server.freeCount) {
+                        close(fd);
+                        continue;
+                    }
+                    uint32_t c = g_server.freeList[--g_server.freeCount];
+                    ServerConn& conn = g_server.conns[c];
+                    memset(&conn, 0, sizeof(conn));
+                    conn.fd = fd;
+                    struct epoll_event ev;
+                    memset(&ev, 0, sizeof(ev));
+                    ev.events = EPOLLIN;
+                    ev.data.u64 = c;
+                    epoll_ctl(g_server.epoll, EPOLL_CTL_ADD, fd, &ev);
+                    ++g_server.connections;
+                }
+                continue;
+            }
+            uint32_t c = (uint32_t)data;
+            if (g_server.conns[c].fd < 0) continue;   // closed earlier in this batch
+            if (g_server.conns[c].writing) {
+                ServerWrite(c, opt);
+            } else {
+                ServerRead(c, dueUs);
+            }
+        }
+    } while (got == 64);
+    uint64_t now = lt::MonoNowUs();
+    while (g_server.queued) {
+        uint32_t c = g_server.due[g_server.head];
+        if (now < g_server.dueUs[g_server.head]) return (uint32_t)((g_server.dueUs[g_server.head] - now + 999) / 1000);
+        g_server.head = (g_server.head + 1) % kMaxConnections;
+        --g_server.queued;
+        ServerConn& conn = g_server.conns[c];
+        conn.queued = false;
+        if (conn.fd < 0) {
+            g_server.freeList[g_server.freeCount++] = c;
+        } else {
+            ServerRespond(c, opt);
+        }
+    }
+    return lt::kNoReply;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    if (!ParseArgs(argc, argv, &opt)) {
+        Usage();
+        return 2;
+    }
+    g_icmp.SetBatch(opt.batch);
+    g_dns.SetQuery("example.com");
+    g_stub.rng = 0x9e3779b9u;
+    static const uint8_t testNet[4] = {192, 0, 2, 1};
+    memcpy(g_stub.answer, testNet, 4);
+    lt::ProbeBackend* backend = opt.tcp    ? (lt::ProbeBackend*)&g_tcp
+                                : opt.dns  ? (lt::ProbeBackend*)&g_dns
+                                : opt.http ? (lt::ProbeBackend*)&g_http
+                                           : &g_icmp;
+    uint16_t stubPorts[kMaxAddresses];
+
+    // Slots are spread round-robin over the addresses
+    const char* addresses[kMaxAddresses];
+    uint32_t addressCount = 0;
+    for (char* p = strtok(opt.targets, ","); p && addressCount < kMaxAddresses; p = strtok(nullptr, ",")) {
+        bool isIPv6 = strchr(p, ':') != nullptr;
+        if (opt.tcp || opt.http) {
+            if (!Listen(g_listeners[addressCount], p, isIPv6, opt)) {
+                fprintf(stderr, "cannot listen on %s\n", p);
+                return kExitUnavailable;
+            }
+        } else if (opt.dns) {
+            if (!(stubPorts[addressCount] = StubOpen(p, isIPv6))) {
+                fprintf(stderr, "cannot open a UDP socket on %s\n", p);
+                return kExitUnavailable;
+            }
+            // Queries to the stub end the backend's wait too
+            g_dns.SetWakeFd(g_stub.fd[addressCount]);
+        } else if (!g_icmp.Available(isIPv6)) {
+            fprintf(stderr, "ICMP datagram sockets unavailable for %s (check net.ipv4.ping_group_range)\n", p);
+            return kExitUnavailable;
+        }
+        addresses[addressCount++] = p;
+    }
+    if (!addressCount || (opt.names && (addressCount != 1 || strchr(addresses[0], ':')))) {
+        Usage();
+        return 2;
+    }
+    if (opt.http) {
+        if (!ServerOpen(addressCount)) {
+            fputs("cannot start the stub server\n", stderr);
+            return 1;
+        }
+        // Requests to the stub end the backend's wait too
+        g_http.SetWakeFd(g_server.epoll);
+        if (opt.names) {
+            // The stub resolver answers every name with the target address
+            uint16_t resolverPort = StubOpen(addresses[0], false);
+            if (!resolverPort || inet_pton(AF_INET, addresses[0], g_stub.answer) != 1) {
+                fprintf(stderr, "cannot open a UDP socket on %s\n", addresses[0]);
+                return 1;
+            }
+            g_http.SetResolver(addresses[0], false, resolverPort);
+            g_http.SetWakeFd(g_stub.fd[0]);
+        }
+    }
+    for (uint32_t i = 0; i < opt.inFlight; ++i) {
+        uint32_t a = i % addressCount;
+        bool isIPv6 = strchr(addresses[a], ':') != nullptr;
+        const char* target = addresses[a];
+        char url[96];
+        if (opt.tcp) g_tcp.SetPort(i, g_listeners[a].port);
+        if (opt.dns) g_dns.SetPort(i, stubPorts[a]);
+        if (opt.http) {
+            snprintf(url, sizeof(url), isIPv6 ? "http://[%s]:%u/" : "http://%s:%u/",
+                     opt.names ? "bench.test" : addresses[a], g_listeners[a].port);
+            target = url;
+        }
+        if (!backend->SetTarget(i, target, isIPv6)) {
+            fprintf(stderr, "bad address: %s\n", target);
+            return 2;
+        }
+    }
+
+    lt::LatencyHistogram rtt;
+    uint64_t replies = 0, timeouts = 0, errors = 0, refused = 0;
+    uint64_t phaseUs[4] = {0, 0, 0, 0};   // HTTP: sums over the probes that had the phase
+    uint64_t phaseCount[4] = {0, 0, 0, 0};
+    uint64_t begin = lt::MonoNowUs();
+    uint64_t stopAt = begin + (uint64_t)opt.durationS * 1000000;
+    for (uint32_t i = 0; i < opt.inFlight; ++i) {
+        if (!backend->Send(i, ++g_seq[i], opt.timeoutMs)) ++refused;
+    }
+    bool stopping = false;
+    uint32_t outstanding = opt.inFlight - (uint32_t)refused;
+    while (outstanding) {
+        if (!stopping && lt::MonoNowUs() >= stopAt) stopping = true;   // let the last probes drain
+        uint32_t waitMs = 100;
+        if (opt.tcp) {
+            uint32_t acceptMs = Accept(addressCount, opt.acceptDelayMs);
+            if (acceptMs < waitMs) waitMs = acceptMs;
+        } else if (opt.dns) {
+            uint32_t replyMs = StubServe(opt.replyDelayMs, opt.dropPercent);
+            if (replyMs < waitMs) waitMs = replyMs;
+        } else if (opt.http) {
+            StubServe(0, 0);
+            uint32_t replyMs = ServerServe(opt);
+            if (replyMs < waitMs) waitMs = replyMs;
+        }
+        int n = backend->Poll(g_results, (int)opt.inFlight, waitMs);
+        for (int k = 0; k < n; ++k) {
+            const lt::ProbeResult& r = g_results[k];
+            if (r.status == lt::PROBE_LATE) continue;   // already counted as stale
+            --outstanding;
+            if (r.status == lt::PROBE_OK) {
+                ++replies;
+                rtt.Add(r.rttUs);
+                if (opt.http) {
+                    const lt::HttpPhases& p = g_http.Phases(r.target);
+                    const uint32_t values[4] = {p.dnsUs, p.connectUs, p.sendUs, p.firstByteUs};
+                    for (int m = 0; m < 4; ++m) {
+                        if (values[m] == lt::kNoReply) continue;
+                        phaseUs[m] += values[m];
+                        ++phaseCount[m];
+                    }
+                }
+            } else if (r.status == lt::PROBE_TIMEOUT) {
+                ++timeouts;
+            } else {
+                ++errors;
+            }
+            if (stopping) continue;
+            if (backend->Send(r.target, ++g_seq[r.target], opt.timeoutMs)) {
+                ++outstanding;
+            } else {
+                ++refused;
+            }
+        }
+    }
+    double seconds = (double)(lt::MonoNowUs() - begin) / 1e6;
+    for (uint32_t a = 0; (opt.tcp || opt.http) && a < addressCount; ++a) close(g_listeners[a].fd);
+    for (uint32_t a = 0; a < g_stub.count; ++a) close(g_stub.fd[a]);
+
+    static const double qs[3] = {0.50, 0.99, 0.999};
+    uint32_t q[3] = {0, 0, 0};
+    rtt.Quantiles(qs, q, 3);
+    uint64_t stale = 0;
+    uint64_t expectedTimeouts = 0;   // queries the stub dropped on purpose
+    printf("%u %s in flight over %u address(es), %.1fs: %llu ok (%.0f/s), %llu timeouts, %llu errors, %llu refused\n",
+           opt.inFlight, opt.tcp ? "handshakes" : opt.dns ? "queries" : opt.http ? "requests" : "echoes", addressCount, seconds, (unsigned long long)replies,
+           (double)replies / seconds, (unsigned long long)timeouts, (unsigned long long)errors,
+           (unsigned long long)refused);
+    if (opt.tcp) {
+        const lt::TcpConnectStats& st = g_tcp.Stats();
+        printf("tcp: %llu connects, %llu established, %llu reset, accept delay %u ms, backlog %d\n",
+               (unsigned long long)st.connects, (unsigned long long)st.established, (unsigned long long)st.refused,
+               opt.acceptDelayMs, opt.backlog);
+    } else if (opt.dns) {
+        const lt::DnsQueryStats& st = g_dns.Stats();
+        stale = st.stale;
+        printf("dns: %llu queries, %llu answers, %llu failures, %llu stale; stub: %llu queries, %llu dropped (%u%%), "
+               "%llu overflowed, reply delay %u ms\n",
+               (unsigned long long)st.queries, (unsigned long long)st.answers, (unsigned long long)st.failures,
+               (unsigned long long)stale, (unsigned long long)g_stub.queries, (unsigned long long)g_stub.dropped,
+               opt.dropPercent, (unsigned long long)g_stub.overflow, opt.replyDelayMs);
+        expectedTimeouts = g_stub.dropped + g_stub.overflow;
+    } else if (opt.http) {
+        const lt::HttpProbeStats& st = g_http.Stats();
+        double mean[4];
+        for (int m = 0; m < 4; ++m) mean[m] = phaseCount[m] ? (double)phaseUs[m] / (double)phaseCount[m] : 0.0;
+        printf("http: %llu probes, %llu connects, %llu reused, %llu retried, %llu responses; server: %llu connections, "
+               "%llu requests, reply delay %u ms, body %u%s%s\n",
+               (unsigned long long)st.probes, (unsigned long long)st.connects, (unsigned long long)st.reused,
+               (unsigned long long)st.retries, (unsigned long long)st.responses,
+               (unsigned long long)g_server.connections, (unsigned long long)g_server.requests, opt.replyDelayMs,
+               opt.bodyBytes, opt.chunked ? " chunked" : "", opt.keepAlive ? "" : ", no keep-alive");
+        printf("phases us (mean over ok probes that had them): dns %.0f (%llu)  connect %.0f (%llu)  send %.0f  ttfb %.0f\n",
+               mean[0], (unsigned long long)phaseCount[0], mean[1], (unsigned long long)phaseCount[1], mean[2], mean[3]);
+    } else {
+        const lt::IcmpSocketStats& st = g_icmp.Stats();
+        double echoes = (double)(replies ? replies : 1);
+        stale = st.stale;
+        printf("batch %u: %.3f send and %.3f receive calls per echo (%llu sendmmsg, %llu receive calls), %llu stale\n",
+               opt.batch, (double)st.sendCalls / echoes, (double)st.receiveCalls / echoes,
+               (unsigned long long)st.sendCalls, (unsigned long long)st.receiveCalls, (unsigned long long)stale);
+    }
+    // Loopback RTTs are a few microseconds: print them unscaled
+    printf("rtt us: p50 %u  p99 %u  p99.9 %u  max %u\n", q[0], q[1], q[2], rtt.Max());
+    return (timeouts != expectedTimeouts || errors || stale || refused || !replies) ? 1 : 0;
+}
+
+#else
+
+int main() {
+    fputs("latency_pingbench needs Linux (ICMP datagram sockets, epoll)\n", stderr);
+    return 1;
+}
+
+#endif // __linux__
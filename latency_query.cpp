@@ -0,0 +1,570 @@
+// latency_query.cpp
+// Command-line query/export over a history file recorded with --history (core/history_store.h).
+// The file is mapped read-only (it may still be recorded into) and its blocks are decoded in
+// parallel: blocks are ordered by sequence and split into one contiguous run per thread, each
+// owning a disjoint range of output intervals, so threads never share state until the merge.
+// Per interval and target: samples, loss, min/avg/p50/p90/p99/max and jitter (mean |RTT change|
+// between consecutive replies). Percentiles come from LatencyHistogram (~3% error).
+// A target is identified by its label, not its slot: each block's slots are read through the
+// label set it was recorded under, so a target a config reload moved to another slot stays one
+// series and a slot that was given another target starts a new one.
+//
+// Build:
+//    cl /O2 /EHsc /MD latency_query.cpp
+//    g++ -std=c++14 -O2 -pthread latency_query.cpp -o latency_query
+//
+// Usage:
+//    latency_query <file> [--format=table|csv|jsonl] [--target=<index|name>] [--from=<time>]
+//                  [--to=<time>] [--interval=<seconds>] [--threads=<n>]
+//    latency_query <file> --bench [--threads=<n>]       decode throughput, 1..n threads
+//    latency_query --generate=<file> --samples=<n> [--targets=<n>]   synthetic history
+// Times are Unix seconds or UTC "YYYY-MM-DD[THH:MM[:SS]]". table (the default) prints one
+// summary line per target over the range; csv and jsonl print one row per interval and target.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+#include "core/history_store.h"
+#include "core/interval_stats.h"
+#include "core/mono_clock.h"
+#include "core/rtt_format.h"
+#include "core/time_format.h"
+
+namespace {
+
+const uint32_t kMaxThreads = 64;
+// Every slot of every label set, plus the slots of blocks older than all of them
+const uint32_t kMaxSeries = (lt::kHistoryMaxLabelSets + 1) * lt::kHistoryMaxTargets;
+
+enum OutputFormat { FORMAT_TABLE, FORMAT_CSV, FORMAT_JSONL };
+
+struct QueryOptions {
+    const char* path;
+    OutputFormat format;
+    int target;          // -1: all
+    const char* targetName;
+    int64_t fromMs;
+    int64_t toMs;        // exclusive
+    int64_t intervalMs;
+    uint32_t threads;
+    bool bench;
+    const char* generatePath;
+    uint64_t generateSamples;
+    uint32_t generateTargets;
+};
+
+struct BlockRef {
+    uint64_t sequence;
+    uint32_t index;
+    int64_t baseMs;
+    const uint16_t* series;   // slot -> series under the block's labels
+};
+
+// A target across the file: a label, or a slot for samples recorded without one
+struct Series {
+    char name[lt::kHistoryNameSize];
+    uint32_t slot;            // in the newest label set that has it
+};
+
+Series g_series[kMaxSeries];
+uint32_t g_seriesCount = 0;
+uint16_t g_seriesOf[lt::kHistoryMaxLabelSets + 1][lt::kHistoryMaxTargets];   // the last row: unlabelled
+
+// One output row: one target over one interval
+struct IntervalRow {
+    int64_t startMs;
+    uint32_t series;
+    lt::IntervalSummary summary;
+};
+
+// Open interval of one target inside a worker
+struct OpenInterval {
+    int64_t startMs;     // INT64_MIN: none open
+    lt::IntervalStats stats;
+};
+
+// Intervals are aligned to the epoch, so minutes and hours fall on wall-clock boundaries
+int64_t IntervalStart(int64_t ms, int64_t intervalMs) {
+    return lt::FloorDivide(ms, intervalMs) * intervalMs;
+}
+
+class QueryWorker {
+public:
+    QueryWorker() : m_open(nullptr), m_totals(nullptr), m_rows(nullptr), m_rowCount(0), m_rowCapacity(0), m_decoded(0) {}
+    ~QueryWorker() {
+        delete[] m_open;
+        delete[] m_totals;
+        free(m_rows);
+    }
+
+    // Decode blocks[first, last) and keep samples whose interval starts in [lowMs, highMs)
+    void Run(const uint8_t* base, const BlockRef* blocks, uint32_t first, uint32_t last,
+             int64_t lowMs, int64_t highMs, const QueryOptions* opt, bool keepRows) {
+        m_opt = opt;
+        m_lowMs = lowMs;
+        m_highMs = highMs;
+        m_keepRows = keepRows;
+        m_open = new OpenInterval[g_seriesCount];
+        m_totals = new lt::IntervalStats[g_seriesCount];
+        for (uint32_t t = 0; t < g_seriesCount; ++t) m_open[t].startMs = INT64_MIN;
+        for (uint32_t i = first; i < last; ++i) {
+            const uint8_t* block = base + lt::HistoryStore::BlockOffset(blocks[i].index);
+            m_seriesOf = blocks[i].series;
+            int n = lt::DecodeHistoryBlock(block, *this, nullptr);
+            if (n > 0) m_decoded += (uint64_t)n;
+        }
+        for (uint32_t t = 0; t < g_seriesCount; ++t) Close(t);
+        std::sort(m_rows, m_rows + m_rowCount, [](const IntervalRow& a, const IntervalRow& b) {
+            return a.startMs != b.startMs ? a.startMs < b.startMs : a.series < b.series;
+        });
+    }
+
+    // Decoder callback
+    void operator()(const lt::HistorySample& s) {
+        if (s.timeMs < m_opt->fromMs || s.timeMs >= m_opt->toMs) return;
+        uint32_t series = m_seriesOf[s.target];
+        if (m_opt->target >= 0 && series != (uint32_t)m_opt->target) return;
+        OpenInterval& a = m_open[series];
+        // Consecutive samples of a target almost always share the open interval
+        if (a.startMs == INT64_MIN || s.timeMs < a.startMs || s.timeMs - a.startMs >= m_opt->intervalMs) {
+            int64_t start = IntervalStart(s.timeMs, m_opt->intervalMs);
+            if (start < m_lowMs || start >= m_highMs) return;   // another worker's interval
+            Close(series);
+            a.startMs = start;
+            a.stats.Reset();
+        }
+        a.stats.Add(s.status, s.rttUs);
+    }
+
+    const IntervalRow* Rows() const { return m_rows; }
+    uint32_t RowCount() const { return m_rowCount; }
+    const lt::IntervalStats& Totals(uint32_t series) const { return m_totals[series]; }
+    uint64_t Decoded() const { return m_decoded; }
+
+private:
+    void Close(uint32_t series) {
+        OpenInterval& a = m_open[series];
+        if (a.startMs == INT64_MIN) return;
+        int64_t start = a.startMs;
+        a.startMs = INT64_MIN;
+        m_totals[series].Merge(a.stats);
+        if (!m_keepRows) return;
+
+        if (m_rowCount == m_rowCapacity) {
+            uint32_t capacity = m_rowCapacity ? m_rowCapacity * 2 : 1024;
+            IntervalRow* rows = (IntervalRow*)realloc(m_rows, capacity * sizeof(IntervalRow));
+            if (!rows) return;
+            m_rows = rows;
+            m_rowCapacity = capacity;
+        }
+        IntervalRow& r = m_rows[m_rowCount++];
+        r.startMs = start;
+        r.series = series;
+        a.stats.Summarize(&r.summary);
+    }
+
+    const QueryOptions* m_opt;
+    int64_t m_lowMs;
+    int64_t m_highMs;
+    bool m_keepRows;
+    const uint16_t* m_seriesOf;   // of the block being decoded
+    OpenInterval* m_open;         // per series
+    lt::IntervalStats* m_totals;
+    IntervalRow* m_rows;
+    uint32_t m_rowCount;
+    uint32_t m_rowCapacity;
+    uint64_t m_decoded;
+};
+
+// ---- Output ----
+
+// Milliseconds with three decimals; empty (CSV) or null (JSON) without a value
+void PrintMs(FILE* f, uint32_t us, const char* none) {
+    if (us == lt::kNoReply) {
+        fputs(none, f);
+    } else {
+        fprintf(f, "%u.%03u", us / 1000, us % 1000);
+    }
+}
+
+// Target label, quoted for CSV/JSON (both escape '"' by context)
+void PrintName(FILE* f, uint32_t series, bool json) {
+    fputc('"', f);
+    const char* name = g_series[series].name;
+    for (size_t i = 0; i < lt::kHistoryNameSize && name[i]; ++i) {
+        char c = name[i];
+        if (c == '"') fputs(json ? "\\\"" : "\"\"", f);
+        else if (c == '\\' && json) fputs("\\\\", f);
+        else if ((unsigned char)c >= 0x20) fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+void PrintRows(FILE* f, const QueryWorker* workers, uint32_t count, OutputFormat format) {
+    if (format == FORMAT_CSV) {
+        fputs("time,target,name,samples,lost,loss_pct,min_ms,avg_ms,p50_ms,p90_ms,p99_ms,max_ms,jitter_ms\n", f);
+    }
+    static const char* const keys[7] = {"min_ms", "avg_ms", "p50_ms", "p90_ms", "p99_ms", "max_ms", "jitter_ms"};
+    char when[32];
+    const char* none = format == FORMAT_CSV ? "" : "null";
+    for (uint32_t w = 0; w < count; ++w) {
+        for (uint32_t i = 0; i < workers[w].RowCount(); ++i) {
+            const IntervalRow& r = workers[w].Rows()[i];
+            const lt::IntervalSummary& m = r.summary;
+            double loss = m.samples ? 100.0 * m.lost / m.samples : 0.0;
+            lt::FormatUtcTime(when, sizeof(when), r.startMs, false);
+            const uint32_t values[7] = {m.minUs, m.avgUs, m.p50Us, m.p90Us, m.p99Us, m.maxUs, m.jitterUs};
+            if (format == FORMAT_CSV) {
+                fprintf(f, "%s,%u,", when, g_series[r.series].slot);
+                PrintName(f, r.series, false);
+                fprintf(f, ",%u,%u,%.2f", m.samples, m.lost, loss);
+            } else {
+                fprintf(f, "{\"time\":\"%s\",\"target\":%u,\"name\":", when, g_series[r.series].slot);
+                PrintName(f, r.series, true);
+                fprintf(f, ",\"samples\":%u,\"lost\":%u,\"loss_pct\":%.2f", m.samples, m.lost, loss);
+            }
+            for (int k = 0; k < 7; ++k) {
+                if (format == FORMAT_CSV) {
+                    fputc(',', f);
+                } else {
+                    fprintf(f, ",\"%s\":", keys[k]);
+                }
+                PrintMs(f, values[k], none);
+            }
+            fputs(format == FORMAT_CSV ? "\n" : "}\n", f);
+        }
+    }
+}
+
+void PrintSummary(FILE* f, const QueryWorker* workers, uint32_t count) {
+    fprintf(f, "%-6s %-24s %10s %7s %8s %8s %8s %8s %8s %8s %8s\n", "target", "name", "samples", "loss%",
+            "min", "avg", "p50", "p99", "p99.9", "max", "jitter");
+    for (uint32_t t = 0; t < g_seriesCount; ++t) {
+        lt::IntervalStats total;
+        for (uint32_t w = 0; w < count; ++w) total.Merge(workers[w].Totals(t));
+        if (!total.Samples()) continue;
+        lt::IntervalSummary m;
+        total.Summarize(&m);
+        static const double qs[1] = {0.999};
+        uint32_t p999 = lt::kNoReply;
+        if (m.samples > m.lost) total.Histogram().Quantiles(qs, &p999, 1);
+        uint32_t values[7] = {m.minUs, m.avgUs, m.p50Us, m.p99Us, p999, m.maxUs, m.jitterUs};
+        char name[lt::kHistoryNameSize + 1] = {0};
+        memcpy(name, g_series[t].name, lt::kHistoryNameSize);
+        fprintf(f, "%-6u %-24.24s %10u %7.3f", g_series[t].slot, name, m.samples, 100.0 * (double)m.lost / (double)m.samples);
+        for (int k = 0; k < 7; ++k) {
+            char text[16];
+            fprintf(f, " %8s", values[k] == lt::kNoReply ? "-" : lt::FormatRttMs(text, sizeof(text), values[k]));
+        }
+        fputc('\n', f);
+    }
+    fputs("(ms; percentiles within ~3%; jitter = mean |change| between consecutive replies)\n", f);
+}
+
+// ---- Query ----
+
+// Valid blocks that may hold samples in [fromMs, toMs), in write order. Returns the count
+// (blocks must have room for every block of the file).
+uint32_t CollectBlocks(const uint8_t* base, const lt::HistoryFileHeader& header, int64_t fromMs, int64_t toMs,
+                       BlockRef* blocks) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < header.blockCount; ++i) {
+        lt::HistoryBlockHeader h;
+        memcpy(&h, base + lt::HistoryStore::BlockOffset(i), sizeof(h));
+        if (h.magic != lt::kHistoryBlockMagic || !h.sequence) continue;
+        blocks[n].sequence = h.sequence;
+        blocks[n].index = i;
+        blocks[n].baseMs = h.baseMs;
+        ++n;
+    }
+    std::sort(blocks, blocks + n, [](const BlockRef& a, const BlockRef& b) { return a.sequence < b.sequence; });
+    // A block's samples end where the next block starts
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        int64_t endMs = i + 1 < n ? blocks[i + 1].baseMs : INT64_MAX;
+        if (endMs >= fromMs && blocks[i].baseMs < toMs) blocks[kept++] = blocks[i];
+    }
+    return kept;
+}
+
+// The series with this label (and, unlabelled, this slot), added if new
+uint16_t SeriesFor(const char* name, uint32_t slot) {
+    for (uint32_t i = 0; i < g_seriesCount; ++i) {
+        const Series& s = g_series[i];
+        if (strncmp(s.name, name, lt::kHistoryNameSize) == 0 && (name[0] || s.slot == slot)) return (uint16_t)i;
+    }
+    Series& s = g_series[g_seriesCount];
+    memset(s.name, 0, sizeof(s.name));
+    strncpy(s.name, name, sizeof(s.name) - 1);
+    s.slot = slot;
+    return (uint16_t)g_seriesCount++;
+}
+
+// Number the targets of the file, newest label set first (so the current targets come first,
+// in slot order), and point each block at its slot -> series row
+void BuildSeries(const lt::HistoryFileHeader& header, BlockRef* blocks, uint32_t n) {
+    g_seriesCount = 0;
+    for (uint32_t k = header.labelCount; k-- > 0;) {
+        const lt::HistoryLabels& labels = header.labels[k];
+        for (uint32_t t = 0; t < lt::kHistoryMaxTargets; ++t) {
+            g_seriesOf[k][t] = SeriesFor(t < labels.targetCount ? labels.names[t] : "", t);
+        }
+    }
+    uint16_t* unlabelled = g_seriesOf[lt::kHistoryMaxLabelSets];
+    for (uint32_t t = 0; t < lt::kHistoryMaxTargets; ++t) unlabelled[t] = SeriesFor("", t);
+    for (uint32_t i = 0; i < n; ++i) {
+        const lt::HistoryLabels* labels = lt::HistoryLabelsFor(header, blocks[i].sequence);
+        blocks[i].series = labels ? g_seriesOf[labels - header.labels] : unlabelled;
+    }
+}
+
+// Split blocks[0, n) into `threads` runs and decode them concurrently into workers[0, threads).
+// Worker k owns the intervals from the one holding its first block's start to the next
+// worker's; it also decodes the preceding blocks that can reach into its first interval.
+void RunQuery(const uint8_t* base, const BlockRef* blocks, uint32_t n, uint32_t threads, const QueryOptions& opt,
+              bool keepRows, QueryWorker* workers) {
+    int64_t low[kMaxThreads + 1];
+    uint32_t start[kMaxThreads + 1];
+    for (uint32_t k = 0; k <= threads; ++k) {
+        start[k] = (uint32_t)((uint64_t)n * k / threads);
+        if (k == 0) {
+            low[k] = INT64_MIN;
+        } else if (k == threads || start[k] >= n) {
+            low[k] = INT64_MAX;
+        } else {
+            low[k] = IntervalStart(blocks[start[k]].baseMs, opt.intervalMs);
+            if (low[k] < low[k - 1]) low[k] = low[k - 1];   // clock stepped back: keep ranges ordered
+        }
+    }
+    std::thread pool[kMaxThreads];
+    for (uint32_t k = 0; k < threads; ++k) {
+        uint32_t first = start[k];
+        while (first > 0 && first < n && blocks[first].baseMs >= low[k]) --first;
+        uint32_t last = start[k + 1];
+        if (k == 0) {
+            workers[k].Run(base, blocks, first, last, low[k], low[k + 1], &opt, keepRows);
+        } else {
+            pool[k] = std::thread(&QueryWorker::Run, &workers[k], base, blocks, first, last, low[k], low[k + 1],
+                                  &opt, keepRows);
+        }
+    }
+    for (uint32_t k = 1; k < threads; ++k) pool[k].join();
+}
+
+// ---- Synthetic history ----
+
+// One sample per second per target: a slow random walk around a per-target base with
+// occasional spikes and 0.5% loss. Sized to hold every sample.
+int Generate(const QueryOptions& opt) {
+    uint32_t targets = opt.generateTargets ? opt.generateTargets : 8;
+    if (targets > lt::kHistoryMaxTargets) targets = lt::kHistoryMaxTargets;
+    uint64_t samples = opt.generateSamples;
+    uint64_t mb = samples * 6 / (1u << 20) + 1;
+    if (mb > 0xFFFFFFFFull) return 1;
+    char names[lt::kHistoryMaxTargets][16];
+    const char* labels[lt::kHistoryMaxTargets];
+    for (uint32_t t = 0; t < targets; ++t) {
+        snprintf(names[t], sizeof(names[t]), "synthetic-%u", t);
+        labels[t] = names[t];
+    }
+    int64_t nowMs = (int64_t)(lt::RealtimeNowUs() / 1000);
+    int64_t startMs = nowMs - (int64_t)(samples / targets) * 1000;
+    static lt::HistoryStore store;
+    remove(opt.generatePath);   // a fresh file, not appended to an old one
+    if (!store.Open(opt.generatePath, (uint32_t)mb, labels, targets, nowMs)) {
+        fprintf(stderr, "cannot create %s\n", opt.generatePath);
+        return 1;
+    }
+    uint32_t rtt[lt::kHistoryMaxTargets];
+    for (uint32_t t = 0; t < targets; ++t) rtt[t] = 2000 + 9000 * t;
+    uint64_t x = 0x9E3779B97F4A7C15ull;
+    uint64_t begin = lt::MonoNowUs();
+    for (uint64_t i = 0; i < samples; ++i) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        uint32_t t = (uint32_t)(i % targets);
+        uint32_t baseUs = 2000 + 9000 * t;
+        int32_t step = (int32_t)(x % 401) - 200;
+        int64_t next = (int64_t)rtt[t] + step + ((int64_t)baseUs - (int64_t)rtt[t]) / 32;
+        rtt[t] = next < 100 ? 100 : (uint32_t)next;
+        lt::HistorySample s;
+        s.timeMs = startMs + (int64_t)(i / targets) * 1000 + (int64_t)(x >> 60);
+        s.target = t;
+        s.status = (x >> 20) % 200 == 0 ? (uint8_t)lt::PROBE_TIMEOUT : (uint8_t)lt::PROBE_OK;
+        s.rttUs = s.status == lt::PROBE_OK ? rtt[t] + ((x >> 32) % 100 == 0 ? 40000u : 0u) : lt::kNoReply;
+        store.Append(s);
+    }
+    double seconds = (double)(lt::MonoNowUs() - begin) / 1e6;
+    const lt::HistoryStoreStats& st = store.Stats();
+    fprintf(stderr, "%llu samples, %u targets, %.2f bytes/sample, %llu blocks, %.2fs (%.1f M samples/s)\n",
+            (unsigned long long)st.samples, targets, st.samples ? (double)st.bytes / (double)st.samples : 0.0,
+            (unsigned long long)st.blocks, seconds, seconds > 0 ? (double)st.samples / seconds / 1e6 : 0.0);
+    store.Close();
+    return 0;
+}
+
+// ---- Command line ----
+
+const char* OptionValue(const char* arg, const char* name) {
+    size_t len = strlen(name);
+    return strncmp(arg, name, len) == 0 ? arg + len : nullptr;
+}
+
+void Usage() {
+    fputs("usage: latency_query <file> [--format=table|csv|jsonl] [--target=<index|name>]\n"
+          "                     [--from=<time>] [--to=<time>] [--interval=<seconds>] [--threads=<n>]\n"
+          "       latency_query <file> --bench [--threads=<n>]\n"
+          "       latency_query --generate=<file> --samples=<n> [--targets=<n>]\n"
+          "time: Unix seconds or UTC YYYY-MM-DD[THH:MM[:SS]]\n",
+          stderr);
+}
+
+bool ParseArgs(int argc, char** argv, QueryOptions* opt) {
+    memset(opt, 0, sizeof(*opt));
+    opt->format = FORMAT_TABLE;
+    opt->target = -1;
+    opt->fromMs = INT64_MIN;
+    opt->toMs = INT64_MAX;
+    opt->intervalMs = 60000;
+    unsigned hw = std::thread::hardware_concurrency();
+    opt->threads = hw ? (hw > kMaxThreads ? kMaxThreads : hw) : 1;
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        const char* v;
+        if ((v = OptionValue(a, "--format="))) {
+            if (!strcmp(v, "table")) opt->format = FORMAT_TABLE;
+            else if (!strcmp(v, "csv")) opt->format = FORMAT_CSV;
+            else if (!strcmp(v, "jsonl")) opt->format = FORMAT_JSONL;
+            else return false;
+        } else if ((v = OptionValue(a, "--target="))) {
+            opt->targetName = v;
+        } else if ((v = OptionValue(a, "--from="))) {
+            if (!lt::ParseUtcTime(v, &opt->fromMs)) return false;
+        } else if ((v = OptionValue(a, "--to="))) {
+            if (!lt::ParseUtcTime(v, &opt->toMs)) return false;
+        } else if ((v = OptionValue(a, "--interval="))) {
+            long seconds = strtol(v, nullptr, 10);
+            if (seconds <= 0) return false;
+            opt->intervalMs = (int64_t)seconds * 1000;
+        } else if ((v = OptionValue(a, "--threads="))) {
+            long n = strtol(v, nullptr, 10);
+            if (n <= 0) return false;
+            opt->threads = n > (long)kMaxThreads ? kMaxThreads : (uint32_t)n;
+        } else if (!strcmp(a, "--bench")) {
+            opt->bench = true;
+        } else if ((v = OptionValue(a, "--generate="))) {
+            opt->generatePath = v;
+        } else if ((v = OptionValue(a, "--samples="))) {
+            opt->generateSamples = strtoull(v, nullptr, 10);
+        } else if ((v = OptionValue(a, "--targets="))) {
+            opt->generateTargets = (uint32_t)strtoul(v, nullptr, 10);
+        } else if (a[0] == '-' && a[1] == '-') {
+            return false;
+        } else if (!opt->path) {
+            opt->path = a;
+        } else {
+            return false;
+        }
+    }
+    if (opt->generatePath) return opt->generateSamples > 0;
+    return opt->path != nullptr && opt->fromMs < opt->toMs;
+}
+
+// A slot index (the target in it now) or a label, as a series
+bool ResolveTarget(const lt::HistoryFileHeader& header, QueryOptions* opt) {
+    if (!opt->targetName) return true;
+    char* end = nullptr;
+    long index = strtol(opt->targetName, &end, 10);
+    if (end != opt->targetName && !*end) {
+        if (index < 0 || (uint32_t)index >= lt::kHistoryMaxTargets) return false;
+        uint32_t newest = header.labelCount ? header.labelCount - 1 : lt::kHistoryMaxLabelSets;
+        opt->target = g_seriesOf[newest][index];
+        return true;
+    }
+    for (uint32_t t = 0; t < g_seriesCount; ++t) {
+        if (g_series[t].name[0] && strncmp(g_series[t].name, opt->targetName, lt::kHistoryNameSize) == 0) {
+            opt->target = (int)t;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    QueryOptions opt;
+    if (!ParseArgs(argc, argv, &opt)) {
+        Usage();
+        return 2;
+    }
+    if (opt.generatePath) return Generate(opt);
+
+    static lt::MappedFile file;
+    if (!file.OpenReadOnly(opt.path) || file.Size() < lt::kHistoryDataOffset) {
+        fprintf(stderr, "cannot open %s\n", opt.path);
+        return 1;
+    }
+    if (file.Size() > (uint64_t)SIZE_MAX) {
+        fprintf(stderr, "%s is too large to map in this build\n", opt.path);
+        return 1;
+    }
+    const uint8_t* base = file.Map(0, (size_t)file.Size());
+    lt::HistoryFileHeader header;
+    if (base) memcpy(&header, base, sizeof(header));
+    if (!base || !lt::HistoryStore::HeaderValid(header) ||
+        lt::HistoryStore::BlockOffset(header.blockCount) > file.Size()) {
+        fprintf(stderr, "%s is not a latency history file\n", opt.path);
+        return 1;
+    }
+    BlockRef* blocks = new BlockRef[header.blockCount];
+    uint32_t n = CollectBlocks(base, header, opt.fromMs, opt.toMs, blocks);
+    BuildSeries(header, blocks, n);
+    if (!ResolveTarget(header, &opt)) {
+        fprintf(stderr, "unknown target %s\n", opt.targetName);
+        delete[] blocks;
+        return 2;
+    }
+    uint32_t threads = opt.threads;
+    if (threads > n) threads = n ? n : 1;
+    QueryWorker* workers = new QueryWorker[kMaxThreads];
+
+    if (opt.bench) {
+        // First pass pulls the file into the page cache; then time 1, 2, 4 ... threads
+        RunQuery(base, blocks, n, 1, opt, true, workers);
+        fprintf(stderr, "%u blocks, %llu samples\n", n, (unsigned long long)workers[0].Decoded());
+        delete[] workers;
+        for (uint32_t t = 1;; t = t * 2 > threads ? threads : t * 2) {
+            workers = new QueryWorker[kMaxThreads];
+            uint64_t begin = lt::MonoNowUs();
+            RunQuery(base, blocks, n, t, opt, true, workers);
+            double seconds = (double)(lt::MonoNowUs() - begin) / 1e6;
+            uint64_t decoded = 0;
+            uint64_t rows = 0;
+            for (uint32_t k = 0; k < t; ++k) {
+                decoded += workers[k].Decoded();
+                rows += workers[k].RowCount();
+            }
+            fprintf(stderr, "threads %2u: %8.3fs  %7.1f M samples/s  %llu rows\n", t, seconds,
+                    seconds > 0 ? (double)decoded / seconds / 1e6 : 0.0, (unsigned long long)rows);
+            delete[] workers;
+            if (t == threads) break;
+        }
+        delete[] blocks;
+        return 0;
+    }
+
+    RunQuery(base, blocks, n, threads, opt, opt.format != FORMAT_TABLE, workers);
+    if (opt.format == FORMAT_TABLE) {
+        PrintSummary(stdout, workers, threads);
+    } else {
+        PrintRows(stdout, workers, threads, opt.format);
+    }
+    delete[] workers;
+    delete[] blocks;
+    return 0;
+}
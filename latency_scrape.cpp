@@ -0,0 +1,215 @@
+// latency_scrape.cpp
+// Load test for the OpenMetrics endpoint of latency_headless (--metrics): a number of scraper
+// threads fetch /metrics back to back for a while, over keep-alive connections or a new
+// connection per scrape, and check that every page is complete (Content-Length bytes ending in
+// "# EOF"). Prints scrape throughput and latency, then the probe loop's own view from the last
+// page: how late probes fired and how long formatting the page took.
+//
+// Build:
+//    cl /O2 /EHsc /MD latency_scrape.cpp ws2_32.lib
+//    g++ -std=c++14 -O2 -pthread latency_scrape.cpp -o latency_scrape
+//
+// Usage:
+//    latency_headless --targets=127.0.0.1,::1 --probe-interval=10 --output=none --metrics &
+//    latency_scrape [--port=9464] [--clients=4] [--duration=<seconds>] [--close]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "core/metrics_server.h"
+#include "core/latency_histogram.h"
+#include "core/mono_clock.h"
+#include "core/rtt_format.h"
+
+namespace {
+
+const uint32_t kMaxClients = 64;
+const uint32_t kMaxPage = 1024 * 1024;
+
+struct ScrapeOptions {
+    uint16_t port;
+    uint32_t clients;
+    uint32_t durationS;
+    bool closeEach;
+};
+
+struct ScraperResult {
+    uint64_t scrapes;
+    uint64_t bytes;
+    uint64_t errors;          // refused/reset connections, bad status, incomplete pages
+    uint64_t connects;
+    lt::LatencyHistogram latencyUs;
+};
+
+std::atomic<bool> g_running(true);
+char g_lastPage[kMaxPage + 1];
+uint32_t g_lastPageLength = 0;
+
+const char* OptionValue(const char* arg, const char* name) {
+    size_t len = strlen(name);
+    return strncmp(arg, name, len) == 0 ? arg + len : nullptr;
+}
+
+lt::MetricsSocket Connect(uint16_t port) {
+    lt::MetricsSocket s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == lt::kNoSocket) return s;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(s, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        lt::CloseMetricsSocket(s);
+        return lt::kNoSocket;
+    }
+    return s;
+}
+
+// One request/response. Returns the body length, 0 on any failure.
+uint32_t Scrape(lt::MetricsSocket s, char* buf, uint32_t size, bool closeAfter) {
+    const char* request = closeAfter ? "GET /metrics HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n"
+                                     : "GET /metrics HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    int length = (int)strlen(request);
+    if (send(s, request, length, lt::kSendFlags) != length) return 0;
+
+    uint32_t got = 0;
+    uint32_t headEnd = 0;
+    uint32_t total = 0;   // head + body once Content-Length is known
+    while (!total || got < total) {
+        int n = recv(s, buf + got, (int)(size - got), 0);
+        if (n <= 0) return 0;
+        got += (uint32_t)n;
+        if (!headEnd) {
+            buf[got < size ? got : size - 1] = 0;
+            const char* end = strstr(buf, "\r\n\r\n");
+            if (!end) continue;
+            headEnd = (uint32_t)(end - buf) + 4;
+            if (strncmp(buf, "HTTP/1.1 200 ", 13) != 0) return 0;
+            const char* cl = strstr(buf, "Content-Length: ");
+            if (!cl || cl > end) return 0;
+            total = headEnd + (uint32_t)strtoul(cl + 16, nullptr, 10);
+            if (total > size) return 0;
+        }
+    }
+    uint32_t body = total - headEnd;
+    if (body < 6 || memcmp(buf + total - 6, "# EOF\n", 6) != 0) return 0;
+    memmove(buf, buf + headEnd, body);
+    return body;
+}
+
+void ScraperThread(const ScrapeOptions* opt, ScraperResult* result, char* buf, bool keepPage) {
+    lt::MetricsSocket s = lt::kNoSocket;
+    while (g_running.load(std::memory_order_relaxed)) {
+        if (s == lt::kNoSocket) {
+            s = Connect(opt->port);
+            if (s == lt::kNoSocket) {
+                ++result->errors;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));   // refused: every slot busy
+                continue;
+            }
+            ++result->connects;
+        }
+        uint64_t begin = lt::MonoNowUs();
+        uint32_t body = Scrape(s, buf, kMaxPage, opt->closeEach);
+        if (!body) {
+            ++result->errors;
+            lt::CloseMetricsSocket(s);
+            s = lt::kNoSocket;
+            continue;
+        }
+        result->latencyUs.Add(lt::ElapsedUs(begin, lt::MonoNowUs()));
+        ++result->scrapes;
+        result->bytes += body;
+        if (keepPage) {
+            memcpy(g_lastPage, buf, body);
+            g_lastPageLength = body;
+        }
+        if (opt->closeEach) {
+            lt::CloseMetricsSocket(s);
+            s = lt::kNoSocket;
+        }
+    }
+    if (s != lt::kNoSocket) lt::CloseMetricsSocket(s);
+}
+
+// Value of an unlabelled sample in the page, -1 if absent
+double PageValue(const char* name) {
+    size_t len = strlen(name);
+    for (const char* p = g_lastPage; (p = strstr(p, name)) != nullptr; p += len) {
+        if ((p == g_lastPage || p[-1] == '\n') && p[len] == ' ') return atof(p + len + 1);
+    }
+    return -1.0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ScrapeOptions opt = {9464, 4, 10, false};
+    for (int i = 1; i < argc; ++i) {
+        const char* v;
+        if ((v = OptionValue(argv[i], "--port="))) {
+            opt.port = (uint16_t)strtoul(v, nullptr, 10);
+        } else if ((v = OptionValue(argv[i], "--clients="))) {
+            opt.clients = (uint32_t)strtoul(v, nullptr, 10);
+        } else if ((v = OptionValue(argv[i], "--duration="))) {
+            opt.durationS = (uint32_t)strtoul(v, nullptr, 10);
+        } else if (!strcmp(argv[i], "--close")) {
+            opt.closeEach = true;
+        } else {
+            fputs("usage: latency_scrape [--port=9464] [--clients=4] [--duration=<seconds>] [--close]\n", stderr);
+            return 2;
+        }
+    }
+    if (opt.clients == 0 || opt.clients > kMaxClients) opt.clients = opt.clients ? kMaxClients : 1;
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) return 1;
+#endif
+    static ScraperResult results[kMaxClients];
+    std::thread threads[kMaxClients];
+    char* buffers = new char[(size_t)kMaxPage * opt.clients];
+    uint64_t begin = lt::MonoNowUs();
+    for (uint32_t i = 0; i < opt.clients; ++i) {
+        threads[i] = std::thread(ScraperThread, &opt, &results[i], buffers + (size_t)kMaxPage * i, i == 0);
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(opt.durationS));
+    g_running = false;
+    for (uint32_t i = 0; i < opt.clients; ++i) threads[i].join();
+    double seconds = (double)(lt::MonoNowUs() - begin) / 1e6;
+    delete[] buffers;
+
+    ScraperResult total = {};
+    for (uint32_t i = 0; i < opt.clients; ++i) {
+        total.scrapes += results[i].scrapes;
+        total.bytes += results[i].bytes;
+        total.errors += results[i].errors;
+        total.connects += results[i].connects;
+        total.latencyUs.Merge(results[i].latencyUs);
+    }
+    static const double qs[3] = {0.50, 0.99, 0.999};
+    uint32_t q[3] = {0, 0, 0};
+    total.latencyUs.Quantiles(qs, q, 3);
+    char p50[16], p99[16], p999[16], peak[16];
+    printf("%u clients%s, %.1fs: %llu scrapes (%.0f/s), %.1f MB/s, %llu connections, %llu errors\n", opt.clients,
+           opt.closeEach ? " (connection per scrape)" : "", seconds, (unsigned long long)total.scrapes,
+           (double)total.scrapes / seconds, (double)total.bytes / seconds / 1e6, (unsigned long long)total.connects,
+           (unsigned long long)total.errors);
+    printf("scrape latency ms: p50 %s  p99 %s  p99.9 %s  max %s\n", lt::FormatRttMs(p50, sizeof(p50), q[0]),
+           lt::FormatRttMs(p99, sizeof(p99), q[1]), lt::FormatRttMs(p999, sizeof(p999), q[2]),
+           lt::FormatRttMs(peak, sizeof(peak), total.latencyUs.Max()));
+    if (g_lastPageLength) {
+        g_lastPage[g_lastPageLength] = 0;
+        printf("probe loop: late max %.3f ms, skipped ticks %.0f, page format %.3f ms, %u byte page\n",
+               PageValue("latency_engine_late_max_seconds") * 1e3, PageValue("latency_engine_skipped_ticks_total"),
+               PageValue("latency_exporter_format_seconds") * 1e3, g_lastPageLength);
+    }
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return total.errors && !total.scrapes ? 1 : 0;
+}
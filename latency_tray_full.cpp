@@ -15,6 +15,16 @@
 #include <heapapi.h>
 #include <psapi.h>  // For working set functions
 
+#include "core/probe_engine.h"
+#include "core/icmp_backend_win.h"
+#include "core/icon_compositor.h"
+#include "core/icon_win.h"
+#include "core/rtt_format.h"
+#include "core/spsc_queue.h"
+#include "core/seqlock.h"
+#include "core/latency_snapshot.h"
+#include "core/tray_coalescer.h"
+
 #pragma comment(lib, "iphlpapi.lib")
 #pragma comment(lib, "ws2_32.lib")
 #pragma comment(lib, "gdi32.lib")
@@ -30,23 +40,32 @@
 #define CMD_EXIT      1
 #define CMD_SELECT_BASE 100
 
-// Minimal target structure with IPv6 support
-struct Target {
+// Minimal target record; the address is parsed at compile time (core/ip_address.h), so its
+// family follows from the text and a typo does not build. This build has no --config: the
+// file buffer, parser tables and a 32-slot engine would add about 230KB to its working set
+// (README, Custom Targets); the v1.0 tray has them.
+struct alignas(64) Target {
     const char* ip;
     const char* name;
-    bool isIPv6;  // true for IPv6, false for IPv4
+    lt::IpAddress address;
+
+    constexpr bool IsIPv6() const { return address.IsIPv6(); }
 };
 
-static const Target g_targets[] = {
-    {"1.1.1.1", "Cloudflare DNS", false},
-    {"8.8.8.8", "Google DNS", false},
-    {"9.9.9.9", "Quad9 DNS", false},
-    {"208.67.222.222", "OpenDNS", false},
-    {"1.0.0.1", "Cloudflare Alt", false},
-    {"8.8.4.4", "Google Alt", false},
+static constexpr Target MakeTarget(const char* ip, const char* name) {
+    return Target{ip, name, lt::IpLiteral(ip)};
+}
+
+static constexpr Target g_targets[] = {
+    MakeTarget("1.1.1.1", "Cloudflare DNS"),
+    MakeTarget("8.8.8.8", "Google DNS"),
+    MakeTarget("9.9.9.9", "Quad9 DNS"),
+    MakeTarget("208.67.222.222", "OpenDNS"),
+    MakeTarget("1.0.0.1", "Cloudflare Alt"),
+    MakeTarget("8.8.4.4", "Google Alt"),
     // Netflix/Fast.com IPv6 servers (direct ISP peering)
-    {"2a00:86c0:2054:2054::167", "Fast.com (Pittsburgh)", true},
-    {"2a00:86c0:2063:2063::135", "Fast.com (Ashburn)", true}
+    MakeTarget("2a00:86c0:2054:2054::167", "Fast.com (Pittsburgh)"),
+    MakeTarget("2a00:86c0:2063:2063::135", "Fast.com (Ashburn)")
 };
 static const int g_numTargets = sizeof(g_targets) / sizeof(g_targets[0]);
 
@@ -54,159 +73,35 @@ static NOTIFYICONDATAA nid;
 static HWND g_hWnd;
 static volatile BOOL g_running = TRUE;
 static volatile int g_selectedTarget = 0;  // Index into g_targets
-static char g_targetIP[46] = "1.1.1.1";  // Increased to 46 for IPv6 (INET6_ADDRSTRLEN)
 
-// Minimal icon creation - solid color square with text
-static HICON CreateMinimalIcon(const char* text) {
-    HDC hdc = GetDC(NULL);
-    if (!hdc) return NULL;
-    
-    HDC hMemDC = CreateCompatibleDC(hdc);
-    if (!hMemDC) {
-        ReleaseDC(NULL, hdc);
-        return NULL;
-    }
-    
-    // Create minimal 16x16 bitmap
-    HBITMAP hBitmap = CreateCompatibleBitmap(hdc, 16, 16);
-    if (!hBitmap) {
-        DeleteDC(hMemDC);
-        ReleaseDC(NULL, hdc);
-        return NULL;
-    }
-    
-    HBITMAP hOldBmp = (HBITMAP)SelectObject(hMemDC, hBitmap);
-    
-    // Fill with dark background
-    RECT rc = {0, 0, 16, 16};
-    FillRect(hMemDC, &rc, (HBRUSH)GetStockObject(BLACK_BRUSH));
-    
-    // Draw text in white
-    SetBkMode(hMemDC, TRANSPARENT);
-    SetTextColor(hMemDC, RGB(255, 255, 255));
-    
-    // Use DrawTextA instead of TextOutA for better compatibility
-    DrawTextA(hMemDC, text, -1, &rc, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
-    
-    SelectObject(hMemDC, hOldBmp);
-    
-    // Create mask
-    HBITMAP hMask = CreateBitmap(16, 16, 1, 1, NULL);
-    if (!hMask) {
-        DeleteObject(hBitmap);
-        DeleteDC(hMemDC);
-        ReleaseDC(NULL, hdc);
-        return NULL;
-    }
-    
-    HDC hMaskDC = CreateCompatibleDC(hdc);
-    if (!hMaskDC) {
-        DeleteObject(hBitmap);
-        DeleteObject(hMask);
-        DeleteDC(hMemDC);
-        ReleaseDC(NULL, hdc);
-        return NULL;
-    }
-    
-    HBITMAP hOldMask = (HBITMAP)SelectObject(hMaskDC, hMask);
-    FillRect(hMaskDC, &rc, (HBRUSH)GetStockObject(BLACK_BRUSH));
-    SelectObject(hMaskDC, hOldMask);
-    
-    // Create icon
-    ICONINFO ii = {0};
-    ii.fIcon = TRUE;
-    ii.hbmMask = hMask;
-    ii.hbmColor = hBitmap;
-    HICON hIcon = CreateIconIndirect(&ii);
-    
-    // Cleanup
-    DeleteDC(hMaskDC);
-    DeleteDC(hMemDC);
-    DeleteObject(hMask);
-    DeleteObject(hBitmap);
-    ReleaseDC(NULL, hdc);
-    
-    return hIcon;
-}
+// All targets probed concurrently (static: the threads only have 32KB stacks)
+static lt::IcmpBackend<g_numTargets> g_icmp;
+static lt::ProbeEngine<g_numTargets> g_engine;
 
-// IPv4 ping function
-static DWORD PingIPv4(const char* ip) {
-    HANDLE hIcmp = IcmpCreateFile();
-    if (hIcmp == INVALID_HANDLE_VALUE) return 999;
-    
-    IN_ADDR addr;
-    if (InetPtonA(AF_INET, ip, &addr) != 1) {
-        IcmpCloseHandle(hIcmp);
-        return 999;
-    }
-    unsigned long addr_long = addr.S_un.S_addr;
-    
-    char data[4] = "PNG";
-    BYTE reply[sizeof(ICMP_ECHO_REPLY) + sizeof(data)];
-    
-    DWORD ret = IcmpSendEcho(hIcmp, addr_long, data, sizeof(data), 
-                             NULL, reply, sizeof(reply), 1000);
-    
-    DWORD rtt = 999;
-    if (ret != 0) {
-        PICMP_ECHO_REPLY pReply = (PICMP_ECHO_REPLY)reply;
-        if (pReply->Status == IP_SUCCESS) {
-            rtt = pReply->RoundTripTime;
-            if (rtt == 0) rtt = 1;  // Show 1ms minimum
-        }
-    }
-    
-    IcmpCloseHandle(hIcmp);
-    return rtt;
-}
+// Probe thread waits on this instead of polling g_running (exit, selection change); auto-reset
+static HANDLE g_wakeEvent = NULL;
+// Render thread waits on this (snapshot handed over, exit); auto-reset
+static HANDLE g_renderEvent = NULL;
 
-// IPv6 ping function (minimal)
-static DWORD PingIPv6(const char* ip) {
-    HANDLE hIcmp6 = Icmp6CreateFile();
-    if (hIcmp6 == INVALID_HANDLE_VALUE) return 999;
-    
-    struct in6_addr dest6;
-    if (inet_pton(AF_INET6, ip, &dest6) != 1) {
-        IcmpCloseHandle(hIcmp6);
-        return 999;
-    }
-    
-    // Source and destination addresses
-    struct sockaddr_in6 source = {0};
-    source.sin6_family = AF_INET6;
-    source.sin6_addr = in6addr_any;
-    
-    struct sockaddr_in6 dest = {0};
-    dest.sin6_family = AF_INET6;
-    dest.sin6_addr = dest6;
-    
-    char data[4] = "PNG";
-    BYTE reply[sizeof(ICMPV6_ECHO_REPLY) + sizeof(data)];
-    
-    DWORD ret = Icmp6SendEcho2(hIcmp6, NULL, NULL, NULL,
-                               &source, &dest, data, sizeof(data), NULL,
-                               reply, sizeof(reply), 1000);
-    
-    DWORD rtt = 999;
-    if (ret != 0) {
-        PICMPV6_ECHO_REPLY pReply = (PICMPV6_ECHO_REPLY)reply;
-        if (pReply->Status == IP_SUCCESS) {
-            rtt = pReply->RoundTripTime;
-            if (rtt == 0) rtt = 1;
-        }
-    }
-    
-    IcmpCloseHandle(hIcmp6);
-    return rtt;
-}
+// Probe -> render hand-over: snapshots in order plus the newest one for any reader, lock-free
+static lt::SpscQueue<lt::LatencySnapshot, 8> g_renderQueue;
+static lt::Seqlock<lt::LatencySnapshot> g_latest;
 
-// Unified ping that handles both IPv4 and IPv6
-static DWORD SimplePing(const char* ip, bool isIPv6) {
-    if (isIPv6) {
-        return PingIPv6(ip);
-    } else {
-        return PingIPv4(ip);
-    }
+// 16x16 icon rendering: glyph atlas, pixel buffer and DIB section, all reused
+static lt::GlyphAtlas<16> g_atlas;
+static lt::IconCompositor<16> g_compositor;
+static lt::IconSurface g_iconSurface;
+
+// Minimal icon creation - solid color square with text
+// Glyphs come from the built-in stroke font, rasterized once; each call only composes
+// pixels into a static buffer and wraps them through a reused DIB section (no GDI text).
+static HICON CreateMinimalIcon(const char* text) {
+    if (g_atlas.Size() == 0 && !g_atlas.BuildBuiltin(16)) return NULL;
+    
+    // White text on an opaque black square
+    const uint32_t* pixels = g_compositor.Compose(g_atlas, text, 0xFFFFFF, 0xFF000000);
+    if (!pixels || !g_iconSurface.Init(16)) return NULL;
+    return g_iconSurface.Create(pixels);
 }
 
 // Safe memory trimming
@@ -258,7 +153,16 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             if (i == g_selectedTarget) {
                 flags |= MF_CHECKED;
             }
-            AppendMenuA(hMenu, flags, CMD_SELECT_BASE + i, g_targets[i].name);
+            // Live latency per target, right-aligned after a tab
+            char item[64];
+            char ms[16];
+            DWORD rtt = g_engine.LastRttUs(i);
+            if (rtt == lt::kNoReply) {
+                wsprintfA(item, "%s\t--", g_targets[i].name);
+            } else {
+                wsprintfA(item, "%s\t%s ms", g_targets[i].name, lt::FormatRttMs(ms, sizeof(ms), rtt));
+            }
+            AppendMenuA(hMenu, flags, CMD_SELECT_BASE + i, item);
         }
         
         AppendMenuA(hMenu, MF_SEPARATOR, 0, NULL);
@@ -270,91 +174,188 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
         
         if (cmd == CMD_EXIT) {
             g_running = FALSE;
+            if (g_wakeEvent) SetEvent(g_wakeEvent);
+            if (g_renderEvent) SetEvent(g_renderEvent);
             PostQuitMessage(0);
         } else if (cmd >= CMD_SELECT_BASE && cmd < CMD_SELECT_BASE + g_numTargets) {
             // Update selected target (supports both IPv4 and IPv6)
             g_selectedTarget = cmd - CMD_SELECT_BASE;
-            // Note: g_targetIP is no longer needed as we directly use g_targets[g_selectedTarget].ip
+            if (g_wakeEvent) SetEvent(g_wakeEvent);
         }
     } else if (msg == WM_DESTROY) {
         g_running = FALSE;
+        if (g_wakeEvent) SetEvent(g_wakeEvent);
+        if (g_renderEvent) SetEvent(g_renderEvent);
         PostQuitMessage(0);
     }
     return DefWindowProcA(hWnd, msg, wParam, lParam);
 }
 
-// Worker thread - minimal stack
-DWORD WINAPI WorkerThread(LPVOID) {
+// Probe thread - minimal stack, normal priority. Only probes and hands the displayed target's
+// snapshot to the render thread; drawing and the shell call never sit between two completions.
+DWORD WINAPI ProbeThread(LPVOID) {
+    lt::ProbeResult results[g_numTargets];
+    int shownTarget = -1;
+    uint32_t snapshots = 0;
+    
+    // Keep every target in flight; the menu selection only picks what is displayed
+    // Adaptive cadence: 250ms bursts on change, up to 4s when stable, at most 600 probes/min
+    g_engine.Init(&g_icmp, g_numTargets, 1000, 1000);
+    g_engine.SetCadence(lt::AdaptiveCadence(1000, 600));
+    g_icmp.SetWakeEvent(g_wakeEvent);
+    for (int i = 0; i < g_numTargets; i++) {
+        g_engine.SetTarget(i, g_targets[i].address);
+    }
+    
+    while (g_running) {
+        // Send due echoes, wait for completions or the next deadline (no polling)
+        int n = g_engine.Run(60000, results, g_numTargets);
+        if (!g_running) break;
+        
+        // Hand over only when the displayed target completed or the selection changed
+        int sel = g_selectedTarget;
+        if (sel < 0 || sel >= g_numTargets) sel = 0;
+        BOOL refresh = (sel != shownTarget);
+        if (refresh) g_engine.SetFocus(sel);
+        for (int k = 0; k < n; k++) {
+            if (results[k].target == (uint32_t)sel) refresh = TRUE;
+        }
+        if (!refresh) continue;
+        shownTarget = sel;
+        
+        lt::LatencySnapshot snap;
+        lt::CaptureSnapshot(g_engine, (uint32_t)sel, g_targets[sel].ip, g_targets[sel].IsIPv6(), ++snapshots, &snap);
+        g_latest.Store(snap);
+        g_renderQueue.TryPush(snap);   // full: the render thread takes the newest from g_latest
+        SetEvent(g_renderEvent);
+    }
+    return 0;
+}
+
+// Render thread - minimal stack, below normal priority. Owns nid once started; also trims
+// the working set every 10 seconds.
+DWORD WINAPI RenderThread(LPVOID) {
     char text[8];
+    char tip[128];
     HICON hIcon = NULL;
-    HICON hOldIcon = NULL;
-    int trimCounter = 0;
+    lt::LatencySnapshot snap;
+    uint32_t shownSequence = 0;
+    int shownTarget = -1;
+    ULONGLONG nextTrim = GetTickCount64() + 10000;
     
-    // Wait a moment for main thread to complete initialization
-    Sleep(100);
+    // Change-only tray updates, at most 4 per second; hysteresis keeps "23"/"24" from flickering
+    static lt::TrayCoalescer<char, sizeof(nid.szTip)> tray;
+    tray.Configure(250);
+    lt::DisplayHysteresis shownRtt;
     
     while (g_running) {
-        // Use the current target IP and IPv6 flag
-        const char* currentIP = g_targets[g_selectedTarget].ip;
-        bool isIPv6 = g_targets[g_selectedTarget].isIPv6;
-        DWORD rtt = SimplePing(currentIP, isIPv6);
+        // Wake for a snapshot, a rate-limited change coming due, or the trim
+        ULONGLONG before = GetTickCount64();
+        uint64_t wake = tray.NextDueMs() < nextTrim ? tray.NextDueMs() : nextTrim;
+        WaitForSingleObject(g_renderEvent, wake > before ? (DWORD)(wake - before) : 0);
+        if (!g_running) break;
         
-        // Format text
-        if (rtt == 999 || rtt == 0xFFFFFFFF) {
-            lstrcpyA(text, "--");
-        } else if (rtt > 999) {
-            lstrcpyA(text, "999");
-        } else {
-            wsprintfA(text, "%u", rtt);
+        // Safe memory trimming every 10 seconds
+        ULONGLONG now = GetTickCount64();
+        if (now >= nextTrim) {
+            TrimMemory();
+            nextTrim = now + 10000;
+        }
+        
+        // Newest snapshot wins; g_latest covers any the full queue dropped
+        BOOL have = FALSE;
+        while (g_renderQueue.TryPop(&snap)) have = TRUE;
+        lt::LatencySnapshot latest;
+        if (g_latest.TryLoad(&latest) && latest.sequence > (have ? snap.sequence : shownSequence)) {
+            snap = latest;
+            have = TRUE;
         }
         
-        // Create new icon
-        hOldIcon = hIcon;
-        hIcon = CreateMinimalIcon(text);
-        if (hIcon) {
-            nid.hIcon = hIcon;
+        uint32_t fields;
+        if (have && snap.sequence > shownSequence && snap.target < (uint32_t)g_numTargets) {
+            shownSequence = snap.sequence;
+            int sel = (int)snap.target;
+            if (sel != shownTarget) {
+                shownRtt.Reset();
+                shownTarget = sel;
+            }
+            DWORD rtt = shownRtt.Filter(snap.rttUs);
+            
+            // Format text: "0.4" / "2.4" / "24", capped at three digits
+            if (rtt != lt::kNoReply && rtt >= 999500) {
+                lstrcpyA(text, "999");
+            } else {
+                lt::FormatRttMs(text, sizeof(text), rtt, 1);
+            }
             
-            // Update tooltip with target name (shows IPv6 indicator for IPv6 targets)
-            if (rtt == 999 || rtt == 0xFFFFFFFF) {
-                if (g_targets[g_selectedTarget].isIPv6) {
-                    wsprintfA(nid.szTip, "%s [IPv6]: No response", g_targets[g_selectedTarget].name);
+            // Tooltip with target name (shows IPv6 indicator for IPv6 targets) and recent loss
+            char loss[24] = "";
+            if (snap.lossBp) wsprintfA(loss, ", loss %u.%u%%", snap.lossBp / 100, snap.lossBp % 100 / 10);
+            if (rtt == lt::kNoReply) {
+                if (snap.isIPv6) {
+                    wsprintfA(tip, "%s [IPv6]: No response (%u lost)%s", g_targets[sel].name, snap.lostInRow, loss);
                 } else {
-                    wsprintfA(nid.szTip, "%s: No response", g_targets[g_selectedTarget].name);
+                    wsprintfA(tip, "%s: No response (%u lost)%s", g_targets[sel].name, snap.lostInRow, loss);
                 }
             } else {
-                if (g_targets[g_selectedTarget].isIPv6) {
-                    wsprintfA(nid.szTip, "%s [IPv6]: %s ms", g_targets[g_selectedTarget].name, text);
+                // Window statistics captured by the probe thread: mean, RFC 3550 jitter, tail (us)
+                char cur[16], avg[16], p95[16], p99[16], jitter[16];
+                lt::FormatRttMs(cur, sizeof(cur), rtt);
+                lt::FormatRttMs(avg, sizeof(avg), snap.avgUs);
+                lt::FormatRttMs(p95, sizeof(p95), snap.p95Us);
+                lt::FormatRttMs(p99, sizeof(p99), snap.p99Us);
+                lt::FormatRttMs(jitter, sizeof(jitter), snap.jitterUs);
+                if (snap.isIPv6) {
+                    wsprintfA(tip, "%s [IPv6]: %s ms%s\navg %s, p95 %s, p99 %s, jitter %s", g_targets[sel].name, cur,
+                              loss, avg, p95, p99, jitter);
                 } else {
-                    wsprintfA(nid.szTip, "%s: %s ms", g_targets[g_selectedTarget].name, text);
+                    wsprintfA(tip, "%s: %s ms%s\navg %s, p95 %s, p99 %s, jitter %s", g_targets[sel].name, cur,
+                              loss, avg, p95, p99, jitter);
                 }
             }
-            
-            // Update tray - check if still running
-            if (g_running && g_hWnd) {
-                Shell_NotifyIconA(NIM_MODIFY, &nid);
-            }
-            
-            // Delete old icon after successful update
-            if (hOldIcon) {
-                DestroyIcon(hOldIcon);
-                hOldIcon = NULL;
-            }
+            fields = tray.Submit(text, 0, tip, GetTickCount64());
+        } else {
+            fields = tray.Flush(GetTickCount64());
         }
+        if (!fields || !g_running || !g_hWnd) continue;
         
-        // Safe memory trimming every 10 seconds
-        if (++trimCounter >= 10) {
-            TrimMemory();
-            trimCounter = 0;
+        // Build a new icon only when its text changed
+        HICON hOldIcon = NULL;
+        if (fields & lt::TRAY_ICON) {
+            HICON hNewIcon = CreateMinimalIcon(tray.IconText());
+            if (hNewIcon) {
+                hOldIcon = hIcon;
+                hIcon = hNewIcon;
+                nid.hIcon = hIcon;
+            } else {
+                fields &= ~(uint32_t)lt::TRAY_ICON;
+            }
         }
+        if (fields & lt::TRAY_TIP) {
+            lstrcpynA(nid.szTip, tray.Tip(), sizeof(nid.szTip));
+        }
+        if (!fields) continue;
+        
+        // Send only the changed fields
+        nid.uFlags = ((fields & lt::TRAY_ICON) ? NIF_ICON : 0) | ((fields & lt::TRAY_TIP) ? NIF_TIP : 0);
+        BOOL ok = Shell_NotifyIconA(NIM_MODIFY, &nid);
+        tray.Commit(fields, ok != FALSE, GetTickCount64());
         
-        // Check if still running before sleep
-        if (g_running) {
-            Sleep(1000);
+        // Delete old icon after successful update
+        if (hOldIcon) {
+            if (ok) {
+                DestroyIcon(hOldIcon);
+            } else {
+                // Explorer still shows the old icon
+                DestroyIcon(hIcon);
+                hIcon = hOldIcon;
+                nid.hIcon = hIcon;
+            }
         }
     }
     
     // Cleanup
-    if (hIcon) {
+    if (hIcon && hIcon != nid.hIcon) {
         DestroyIcon(hIcon);
     }
     return 0;
@@ -407,11 +408,29 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
         return 1;
     }
     
-    // Create worker thread with minimal stack (32KB is safer than 16KB)
-    HANDLE hThread = CreateThread(NULL, 32768, WorkerThread, NULL, 
-                                 STACK_SIZE_PARAM_IS_A_RESERVATION, NULL);
+    // Probe and render threads with minimal stacks (32KB is safer than 16KB), created
+    // suspended so their priorities are in place before they run
+    g_wakeEvent = CreateEventA(NULL, FALSE, FALSE, NULL);
+    g_renderEvent = CreateEventA(NULL, FALSE, FALSE, NULL);
+    HANDLE hProbe = NULL, hRender = NULL;
+    if (g_wakeEvent && g_renderEvent) {
+        hProbe = CreateThread(NULL, 32768, ProbeThread, NULL,
+                              STACK_SIZE_PARAM_IS_A_RESERVATION | CREATE_SUSPENDED, NULL);
+        hRender = CreateThread(NULL, 32768, RenderThread, NULL,
+                               STACK_SIZE_PARAM_IS_A_RESERVATION | CREATE_SUSPENDED, NULL);
+    }
     
-    if (!hThread) {
+    if (!hProbe || !hRender) {
+        // Let whichever thread exists run straight to its exit
+        g_running = FALSE;
+        HANDLE created = hProbe ? hProbe : hRender;
+        if (created) {
+            ResumeThread(created);
+            WaitForSingleObject(created, 1000);
+            CloseHandle(created);
+        }
+        if (g_wakeEvent) CloseHandle(g_wakeEvent);
+        if (g_renderEvent) CloseHandle(g_renderEvent);
         Shell_NotifyIconA(NIM_DELETE, &nid);
         if (nid.hIcon) DestroyIcon(nid.hIcon);
         DestroyWindow(g_hWnd);
@@ -419,9 +438,13 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
         return 1;
     }
     
-    // Set thread and process priority to reduce resource usage
-    SetThreadPriority(hThread, THREAD_PRIORITY_BELOW_NORMAL);
+    // The process stays below normal to keep its footprint small, but the probe thread is
+    // raised back to normal-equivalent priority: a lowered probe thread inflates measured RTT
     SetPriorityClass(GetCurrentProcess(), BELOW_NORMAL_PRIORITY_CLASS);
+    SetThreadPriority(hProbe, THREAD_PRIORITY_HIGHEST);
+    SetThreadPriority(hRender, THREAD_PRIORITY_BELOW_NORMAL);
+    ResumeThread(hRender);
+    ResumeThread(hProbe);
     
     // Message loop
     MSG msg;
@@ -432,8 +455,14 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int) {
     
     // Cleanup
     g_running = FALSE;
-    WaitForSingleObject(hThread, 1000);
-    CloseHandle(hThread);
+    SetEvent(g_wakeEvent);
+    SetEvent(g_renderEvent);
+    HANDLE threads[2] = {hProbe, hRender};
+    WaitForMultipleObjects(2, threads, TRUE, 1000);
+    CloseHandle(hProbe);
+    CloseHandle(hRender);
+    CloseHandle(g_wakeEvent);
+    CloseHandle(g_renderEvent);
     Shell_NotifyIconA(NIM_DELETE, &nid);
     if (nid.hIcon) DestroyIcon(nid.hIcon);
     DestroyWindow(g_hWnd);
@@ -10,7 +10,18 @@
 //    For x86:
 //    cl /O2 /Oi /Gy /GL /MT /EHsc /guard:cf /Qspectre /GS /sdl /W4 /SAFESEH latency_tray_full.cpp /link /LTCG /OPT:REF /OPT:ICF /NXCOMPAT /DYNAMICBASE iphlpapi.lib ws2_32.lib gdi32.lib user32.lib shell32.lib /MANIFESTFILE:latency_tray_full.manifest
 //
+//    Allocation check (debug CRT; per-pass heap allocations of the probe loop are reported to
+//    the debugger output at exit, core/alloc_counter.h):
+//    cl /Od /MDd /EHsc /DLT_COUNT_ALLOCATIONS latency_tray_full.cpp /link iphlpapi.lib ws2_32.lib
+//
 // Tested with Visual Studio toolchain. Should also compile with mingw-w64 (adjust link flags).
+//
+// Usage: latency_tray_full.exe [--config=<file>] [--history=<file> [--history-size=<MB>]]
+//    --config takes the targets, probe interval, timeout and icon colour thresholds from a file
+//    (core/target_config.h) instead of the presets. The file is checked about once a second; a
+//    saved change is swapped into the running engine, and targets that stayed keep their
+//    statistics. A file that does not parse at startup is reported and the tray exits; later,
+//    the error goes to the debugger output and the current targets stay.
 
 #define WIN32_LEAN_AND_MEAN  // Prevent windows.h from including winsock.h
 #include <winsock2.h>        // MUST be before windows.h
@@ -21,12 +32,32 @@
 #include <icmpapi.h>
 #include <processthreadsapi.h>  // For SetProcessMitigationPolicy
 #include <heapapi.h>            // For HeapSetInformation
-#include <string>
-#include <vector>
 #include <atomic>
 #include <cstdio>
 #include <cstring>
 
+#include "core/probe_engine.h"
+#include "core/icmp_backend_win.h"
+#include "core/tcp_connect_backend.h"
+#include "core/dns_query_backend.h"
+#include "core/probe_mux.h"
+#include "core/icon_compositor.h"
+#include "core/icon_win.h"
+#include "core/rtt_format.h"
+#include "core/gateway_resolver.h"
+#include "core/presets.h"
+#include "core/route_source_win.h"
+#include "core/spsc_queue.h"
+#include "core/seqlock.h"
+#include "core/latency_snapshot.h"
+#include "core/tooltip_format.h"
+#include "core/tray_coalescer.h"
+#include "core/history_store.h"
+#include "core/mono_clock.h"
+#include "core/alloc_counter.h"
+#include "core/target_config.h"
+#include "core/file_watch.h"
+
 #pragma comment(lib, "iphlpapi.lib")
 #pragma comment(lib, "ws2_32.lib")
 #pragma comment(lib, "gdi32.lib")     // For GDI functions (CreateCompatibleDC, CreateFont, DrawText, etc.)
@@ -40,286 +71,140 @@
 #define CMD_EXIT          1
 #define CMD_SELECT_BASE   100  // IP selection starts at 100
 
-// Preset IP targets for latency testing
-struct IPTarget {
-    const char* ip;
-    const wchar_t* name;
-    const wchar_t* location;
-    bool isIPv6;  // true for IPv6, false for IPv4
-};
-
-static const IPTarget g_presets[] = {
-    // Default gateway (special case - detected dynamically)
-    {nullptr, L"Default Gateway", L"Auto-detect", false},
-    
-    // Cloudflare DNS - Fast and reliable, global distribution
-    {"1.1.1.1", L"Cloudflare DNS", L"Global (Anycast)", false},
-    {"1.0.0.1", L"Cloudflare DNS (Alt)", L"Global (Anycast)", false},
-    
-    // Google DNS - Global distribution
-    {"8.8.8.8", L"Google DNS", L"Global (Anycast)", false},
-    {"8.8.4.4", L"Google DNS (Alt)", L"Global (Anycast)", false},
-    
-    // Quad9 DNS - Security-focused, global
-    {"9.9.9.9", L"Quad9 DNS", L"Global (Anycast)", false},
-    
-    // OpenDNS - Cisco
-    {"208.67.222.222", L"OpenDNS", L"Global", false},
-    
-    // US East Coast - Cloudflare edge (typically NYC area)
-    {"1.1.1.1", L"Cloudflare (US East)", L"US East", false},
-    
-    // US West Coast - Cloudflare edge (typically LA area)  
-    {"1.0.0.1", L"Cloudflare (US West)", L"US West", false},
-    
-    // US Central - Google edge
-    {"8.8.4.4", L"Google (US Central)", L"US Central", false},
-    
-    // Netflix/Fast.com IPv6 servers (direct ISP peering)
-    {"2a00:86c0:2054:2054::167", L"Fast.com (Pittsburgh)", L"Pittsburgh, PA", true},
-    {"2a00:86c0:2063:2063::135", L"Fast.com (Ashburn)", L"Ashburn, VA", true},
-};
-
-static const int g_numPresets = sizeof(g_presets) / sizeof(g_presets[0]);
+// Targets: the presets (core/presets.h, shared with the headless build), or the ones from
+// --config=<file> (core/target_config.h), which may change while running
+static const uint32_t kMaxTargets = 32;
+static_assert(kMaxTargets >= lt::kPresetCount, "every preset needs a slot");
 
 static NOTIFYICONDATAW nid;
 static HINSTANCE g_hInst;
 static HWND g_hWnd;
 static std::atomic_bool g_running(true);
-static std::atomic<int> g_selectedPreset(0); // 0 = Default Gateway, 1+ = preset index
-static char g_targetIP[64] = {0}; // Thread-safe target IP string
-
-// ---------- Utilities ----------
-static std::string IPv4ToString(DWORD ip) {
-    // ip is in network byte order in many iphlpapi structures; treat as uint32_t containing IPv4 address in
-    // network order. inet_ntop expects pointer to struct in_addr (s_addr in network order).
-    struct in_addr a;
-    a.s_addr = ip;
-    char buf[INET_ADDRSTRLEN] = {0};
-    if (inet_ntop(AF_INET, &a, buf, INET_ADDRSTRLEN) == nullptr) {
-        return std::string();
-    }
-    return std::string(buf);
-}
-
-// Attempt to find default IPv4 gateway by scanning the IPv4 routing table for 0.0.0.0/0
-// Returns gateway IP in network byte order (DWORD). On failure returns 0.
-static DWORD GetDefaultGatewayIPv4() {
-    PMIB_IPFORWARDTABLE pTable = nullptr;
-    DWORD dwSize = 0;
-    DWORD dwRes = GetIpForwardTable(nullptr, &dwSize, FALSE);
-    if (dwRes != ERROR_INSUFFICIENT_BUFFER) {
-        // unexpected
-        return 0;
-    }
-    if (dwSize == 0) return 0; // Bounds check
-    pTable = (PMIB_IPFORWARDTABLE)malloc(dwSize);
-    if (!pTable) return 0;
-    dwRes = GetIpForwardTable(pTable, &dwSize, FALSE);
-    DWORD gateway = 0;
-    if (dwRes == NO_ERROR && pTable->dwNumEntries > 0) {
-        // Look for the route with destination 0.0.0.0 and mask 0.0.0.0 and best metric
-        DWORD bestMetric = 0xFFFFFFFF;
-        for (DWORD i = 0; i < pTable->dwNumEntries; ++i) {
-            MIB_IPFORWARDROW &r = pTable->table[i];
-            if (r.dwForwardDest == 0 && r.dwForwardMask == 0) {
-                // Validate: gateway must be non-zero and reasonable (not 0.0.0.0 or 255.255.255.255)
-                if (r.dwForwardNextHop != 0 && r.dwForwardNextHop != 0xFFFFFFFF) {
-                    // choose lowest metric
-                    if (r.dwForwardMetric1 < bestMetric) {
-                        bestMetric = r.dwForwardMetric1;
-                        gateway = r.dwForwardNextHop; // DWORD in network byte order
-                    }
-                }
-            }
-        }
-    }
-    free(pTable);
-    return gateway;
+static std::atomic<int> g_selectedTarget(0); // engine slot displayed (0 = Default Gateway for the presets)
+
+// Probe engine: every target is kept in flight, the selection only picks what is displayed.
+// TCP targets go to the handshake prober, DNS targets to the query prober, the rest to ICMP echo.
+static lt::IcmpBackend<kMaxTargets> g_icmp;
+static lt::TcpConnectBackend<kMaxTargets> g_tcp;
+static lt::DnsQueryBackend<kMaxTargets> g_dns;
+static lt::ProbeMux<kMaxTargets> g_mux;
+// Rolling statistics hold up to an hour per target; the tooltip looks at the last minute
+static const uint32_t kStatsCapacity = 3600;
+static const uint32_t kStatsWindow = 60;
+
+// Icon background colour thresholds (green below kFairMs, amber below kPoorMs, red above);
+// a config file may set its own
+static const uint32_t kFairMs = 50;
+static const uint32_t kPoorMs = 150;
+
+// Probe cadence: 1s base, bursts of 250ms probes when a target's latency changes, up to 4s
+// while it is stable; never more than kProbeBudget probes per minute over all targets. A config
+// file may set another base interval and timeout.
+static const uint32_t kProbeIntervalMs = 1000;
+static const uint32_t kProbeTimeoutMs = 1000;
+static const uint32_t kProbeBudget = 1200;
+// How often the probe stage looks at the config file
+static const uint32_t kConfigCheckMs = 1000;
+// Longest single wait; probe deadlines and g_wakeEvent normally end it much sooner
+static const uint32_t kIdleWaitMs = 60000;
+// Probe loop passes before allocations count against the steady state (allocation check builds)
+static const uint32_t kAllocationWarmup = 100;
+
+// At most this many tray updates per second; faster changes are merged into the next one
+static const uint32_t kTrayMaxUpdatesPerSec = 4;
+
+// Wakes the probe thread out of its wait (exit, target selection, route change); auto-reset
+static HANDLE g_wakeEvent = NULL;
+// Wakes the render thread: a snapshot was handed over, or exit; auto-reset
+static HANDLE g_renderEvent = NULL;
+
+static void WakeWorker() {
+    if (g_wakeEvent) SetEvent(g_wakeEvent);
+    if (g_renderEvent) SetEvent(g_renderEvent);
 }
 
-// Create a small square icon (16x16 or 32x32 depending on scale) with white text on transparent background.
-// text should be ASCII-ish short (like "24" or "--")
-// Returns NULL on failure
-static HICON CreateTextIcon(const std::wstring &text, int size = 16) {
-    // Validate text length (prevent excessive memory usage)
-    if (text.length() > 8 || size <= 0 || size > 64) {
-        return NULL;
-    }
-    const int w = size;
-    const int h = size;
-
-    // Create 32bpp ARGB DIB section
-    BITMAPV5HEADER bi;
-    ZeroMemory(&bi, sizeof(bi));
-    bi.bV5Size = sizeof(BITMAPV5HEADER);
-    bi.bV5Width = w;
-    bi.bV5Height = -h; // top-down
-    bi.bV5Planes = 1;
-    bi.bV5BitCount = 32;
-    bi.bV5Compression = BI_BITFIELDS;
-    bi.bV5RedMask   = 0x00FF0000;
-    bi.bV5GreenMask = 0x0000FF00;
-    bi.bV5BlueMask  = 0x000000FF;
-    bi.bV5AlphaMask = 0xFF000000;
-
-    HDC hdcScreen = GetDC(NULL);
-    if (!hdcScreen) return NULL;
-    void *pvBits = nullptr;
-    HBITMAP hBmp = CreateDIBSection(hdcScreen, (BITMAPINFO*)&bi, DIB_RGB_COLORS, &pvBits, NULL, 0);
-    if (!hBmp) {
-        ReleaseDC(NULL, hdcScreen);
-        return NULL;
-    }
-    HDC hMem = CreateCompatibleDC(hdcScreen);
-    if (!hMem) {
-        ReleaseDC(NULL, hdcScreen);
-        DeleteObject(hBmp);
-        return NULL;
-    }
-    HBITMAP hOldBmp = (HBITMAP)SelectObject(hMem, hBmp);
-
-    // Clear to fully transparent (alpha = 0)
-    if (pvBits) {
-        DWORD *p = (DWORD*)pvBits;
-        for (int i = 0; i < w*h; ++i) p[i] = 0x00000000;
-    }
+// Probe stage -> render stage: snapshots of the displayed target, in order, and the newest one
+// published for any other reader. Neither side ever blocks on the other.
+static lt::SpscQueue<lt::LatencySnapshot, 16> g_renderQueue;
+static lt::Seqlock<lt::LatencySnapshot> g_latest;
+static lt::ProbeEngine<kMaxTargets, kStatsCapacity> g_engine;
+
+// Target config: parsed on the probe thread (at startup on the main thread, before it runs);
+// g_slots knows which target sits in which engine slot
+static char g_configPath[MAX_PATH * 3];
+static char g_configText[64 * 1024];
+static lt::TargetConfig<kMaxTargets> g_config;
+static lt::TargetSlots<kMaxTargets> g_slots;
+static lt::ReloadPlan<kMaxTargets> g_plan;
+static lt::FileWatch g_configWatch;
+
+// What the menu and the tooltip show of each engine slot. Written by the probe stage whenever
+// the targets change, read by the menu and the render stage.
+struct TrayTarget {
+    bool used;
+    bool isIPv6;
+    uint8_t method;                    // lt::ProbeMethod
+    uint16_t port;                     // TCP and DNS
+    char ip[lt::kIpAddressTextSize];   // empty for the default gateway
+    char name[lt::kMaxTargetNameSize];
+};
 
-    // Draw text (white) centered
-    SetBkMode(hMem, TRANSPARENT);
-    SetTextColor(hMem, RGB(255,255,255));
-    // Slightly bold small font - system UI font
-    int fontHeight = (int)(size * 0.7);
-    HFONT hFont = CreateFontW(-fontHeight, 0, 0, 0, FW_BOLD, FALSE, FALSE, FALSE,
-                              DEFAULT_CHARSET, OUT_DEFAULT_PRECIS, CLIP_DEFAULT_PRECIS,
-                              CLEARTYPE_QUALITY, VARIABLE_PITCH, L"Segoe UI");
-    HFONT hOldFont = (HFONT)SelectObject(hMem, hFont);
+struct TrayTargets {
+    uint32_t count;                    // the last used slot + 1
+    uint32_t fairMs;                   // icon colour thresholds
+    uint32_t poorMs;
+    TrayTarget slot[kMaxTargets];
+};
 
-    RECT rc = {0,0,w,h};
-    DrawTextW(hMem, text.c_str(), -1, &rc, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
+static lt::Seqlock<TrayTargets> g_targets;
 
-    SelectObject(hMem, hOldFont);
-    if (hFont) DeleteObject(hFont);
+// Why the last edit of the config file was rejected ("config <file>:<line>: <message>"), shown
+// by the render stage in a balloon; the version says a new one arrived
+struct ConfigRejection {
+    char text[256];                    // szInfo holds 255 characters
+};
 
-    // Create Alpha icon via ICONINFO with both color and mask bitmaps using same ARGB bitmap.
-    ICONINFO ii;
-    ZeroMemory(&ii, sizeof(ii));
-    ii.fIcon = TRUE;
-    ii.hbmColor = hBmp;
-    // For mask use a monochrome mask (NULL will work with hbmColor having alpha on modern Windows)
-    ii.hbmMask = hBmp;
+static lt::Seqlock<ConfigRejection> g_configRejection;
 
-    HICON hIcon = CreateIconIndirect(&ii);
+// Default gateway, kept current by route/interface change notifications (no table polling)
+static lt::WinRouteSource g_routeSource;
+static lt::GatewayResolver g_gateways;
 
-    // Clean up resources (Windows makes its own copy of bitmap data for the icon)
-    SelectObject(hMem, hOldBmp);
-    DeleteDC(hMem);
-    ReleaseDC(NULL, hdcScreen);
-    DeleteObject(hBmp);
+// Opt-in sample history (--history=<file> [--history-size=<MB>]): the probe stage only queues
+// results; the render stage encodes and appends them to the ring file
+static lt::HistoryRecorder<1024> g_history;
+static char g_historyLabels[kMaxTargets][lt::kHistoryNameSize];
+static const char* g_historyNames[kMaxTargets];
 
-    // Return icon handle (NULL on failure, handled by caller)
-    return hIcon;
-}
+// Icon rendering: glyph atlas for the current size, reusable pixel buffer and DIB section
+static lt::GlyphAtlas<64> g_atlas;
+static lt::IconCompositor<64> g_compositor;
+static lt::IconSurface g_iconSurface;
 
-// Send single ICMP echo to IPv4 address given in dotted ASCII, return RTT ms, or 0xFFFFFFFF on failure
-static DWORD PingOnceIPv4(const char* ipStr, DWORD timeoutMs = 1000) {
-    if (!ipStr) return 0xFFFFFFFF;
-    // Validate input string length (prevent buffer overflows)
-    size_t len = strlen(ipStr);
-    if (len == 0 || len >= INET_ADDRSTRLEN) return 0xFFFFFFFF;
-
-    // Use iphlpapi's Icmp* APIs (these do not open listening sockets).
-    HANDLE hIcmp = IcmpCreateFile();
-    if (hIcmp == INVALID_HANDLE_VALUE) return 0xFFFFFFFF;
-
-    unsigned char sendData[8] = {0x50,0x49,0x4E,0x47,0x2D,0x54,0x45,0x53}; // "PING-TES" arbitrary payload
-    BYTE replyBuffer[128] = {0};
-    DWORD replySize = sizeof(replyBuffer);
-
-    struct in_addr a;
-    if (inet_pton(AF_INET, ipStr, &a) != 1) {
-        IcmpCloseHandle(hIcmp);
-        return 0xFFFFFFFF;
-    }
-    IPAddr dest = a.s_addr; // network order
-
-    DWORD ret = IcmpSendEcho(hIcmp, dest, sendData, sizeof(sendData), NULL, replyBuffer, replySize, timeoutMs);
-    DWORD rtt = 0xFFFFFFFF;
-    if (ret != 0) {
-        PICMP_ECHO_REPLY pReply = (PICMP_ECHO_REPLY)replyBuffer;
-        // if status == IP_SUCCESS
-        if (pReply->Status == IP_SUCCESS) {
-            rtt = pReply->RoundTripTime;
-        } else {
-            rtt = 0xFFFFFFFF;
-        }
+// ---------- Utilities ----------
+// Create a small square icon (16x16 or 32x32 depending on scale) with white text on transparent background.
+// text should be ASCII-ish short (like "24" or "--")
+// Glyphs are rasterized once per size into g_atlas; each call only composes pixels into a reused
+// buffer and wraps them in an HICON through a reused DIB section.
+// Returns NULL on failure
+// tint is 0xAARRGGBB for the background (0 = transparent, as before)
+static HICON CreateTextIcon(const char* text, int size = 16, uint32_t tint = 0) {
+    // Validate text length (prevent excessive memory usage)
+    if (!text || strlen(text) > lt::kMaxIconText || size <= 0 || size > 64) {
+        return NULL;
     }
-
-    IcmpCloseHandle(hIcmp);
-    return rtt;
-}
-
-// Send single ICMP echo to IPv6 address given as string, return RTT ms, or 0xFFFFFFFF on failure
-static DWORD PingOnceIPv6(const char* ipStr, DWORD timeoutMs = 1000) {
-    if (!ipStr) return 0xFFFFFFFF;
-    // Validate input string length
-    size_t len = strlen(ipStr);
-    if (len == 0 || len >= INET6_ADDRSTRLEN) return 0xFFFFFFFF;
-
-    // Use iphlpapi's Icmp6* APIs for IPv6
-    HANDLE hIcmp6 = Icmp6CreateFile();
-    if (hIcmp6 == INVALID_HANDLE_VALUE) return 0xFFFFFFFF;
-
-    unsigned char sendData[8] = {0x50,0x49,0x4E,0x47,0x2D,0x54,0x45,0x53}; // "PING-TES" arbitrary payload
-    
-    struct in6_addr dest6;
-    if (inet_pton(AF_INET6, ipStr, &dest6) != 1) {
-        IcmpCloseHandle(hIcmp6);
-        return 0xFFFFFFFF;
-    }
-
-    // For IPv6, we need source and destination addresses
-    // Use IN6ADDR_ANY_INIT for source (let system choose)
-    struct sockaddr_in6 sourceSockAddr;
-    ZeroMemory(&sourceSockAddr, sizeof(sourceSockAddr));
-    sourceSockAddr.sin6_family = AF_INET6;
-    sourceSockAddr.sin6_addr = in6addr_any;
-
-    struct sockaddr_in6 destSockAddr;
-    ZeroMemory(&destSockAddr, sizeof(destSockAddr));
-    destSockAddr.sin6_family = AF_INET6;
-    destSockAddr.sin6_addr = dest6;
-
-    BYTE replyBuffer[sizeof(ICMPV6_ECHO_REPLY) + 8] = {0};
-    DWORD replySize = sizeof(replyBuffer);
-
-    DWORD ret = Icmp6SendEcho2(hIcmp6, NULL, NULL, NULL,
-                                &sourceSockAddr,
-                                &destSockAddr,
-                                sendData, sizeof(sendData), NULL,
-                                replyBuffer, replySize, timeoutMs);
-
-    DWORD rtt = 0xFFFFFFFF;
-    if (ret != 0) {
-        PICMPV6_ECHO_REPLY pReply = (PICMPV6_ECHO_REPLY)replyBuffer;
-        if (pReply->Status == IP_SUCCESS) {
-            rtt = pReply->RoundTripTime;
-        } else {
-            rtt = 0xFFFFFFFF;
+    if (g_atlas.Size() != (uint32_t)size) {
+        // Segoe UI through GDI once per size; built-in stroke font if that fails
+        if (!lt::BuildAtlasFromGdi(g_atlas, (uint32_t)size) && !g_atlas.BuildBuiltin((uint32_t)size)) {
+            return NULL;
         }
     }
-
-    IcmpCloseHandle(hIcmp6);
-    return rtt;
-}
-
-// Unified ping function that detects IP version and calls appropriate function
-static DWORD PingOnce(const char* ipStr, bool isIPv6, DWORD timeoutMs = 1000) {
-    if (isIPv6) {
-        return PingOnceIPv6(ipStr, timeoutMs);
-    } else {
-        return PingOnceIPv4(ipStr, timeoutMs);
+    const uint32_t* pixels = g_compositor.Compose(g_atlas, text, 0xFFFFFF, 0, tint);
+    if (!pixels || !g_iconSurface.Init((uint32_t)size)) {
+        return NULL;
     }
+    // Return icon handle (NULL on failure, handled by caller)
+    return g_iconSurface.Create(pixels);
 }
 
 // Apply Windows runtime process mitigation policies for security hardening
@@ -393,23 +278,41 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             AppendMenuW(hMenu, MF_STRING | MF_GRAYED, 0, L"Target:");
             AppendMenuW(hMenu, MF_SEPARATOR, 0, NULL);
             
-            // Add preset targets
-            int currentPreset = g_selectedPreset.load();
-            for (int i = 0; i < g_numPresets; ++i) {
+            // Add the targets, in slot order (free slots left by a config reload are skipped)
+            static TrayTargets targets;
+            g_targets.Load(&targets);
+            int currentTarget = g_selectedTarget.load();
+            for (int i = 0; i < (int)targets.count; ++i) {
+                const TrayTarget& target = targets.slot[i];
+                if (!target.used) continue;
+                // Live latency of each target, right-aligned after a tab
+                wchar_t live[32] = {0};
+                uint32_t rttUs = g_engine.LastRttUs(i);
+                char ms[16];
+                lt::FormatRttMs(ms, sizeof(ms), rttUs);
+                if (rttUs == lt::kNoReply) {
+                    wcscpy_s(live, _countof(live), L"--");
+                } else {
+                    swprintf_s(live, _countof(live), L"%S ms", ms);
+                }
+
                 wchar_t menuText[256] = {0};
-                if (g_presets[i].ip == nullptr) {
+                if (!target.ip[0]) {
                     // Default Gateway
-                    wcscpy_s(menuText, _countof(menuText), g_presets[i].name);
+                    swprintf_s(menuText, _countof(menuText), L"%S\t%s", target.name, live);
                 } else {
                     // Show IPv6 addresses in brackets for clarity
-                    if (g_presets[i].isIPv6) {
-                        swprintf_s(menuText, _countof(menuText), L"%s [%S]", g_presets[i].name, g_presets[i].ip);
+                    if (target.method != lt::METHOD_ICMP) {
+                        swprintf_s(menuText, _countof(menuText), target.isIPv6 ? L"%S ([%S]:%u)\t%s" : L"%S (%S:%u)\t%s",
+                                   target.name, target.ip, (unsigned)target.port, live);
+                    } else if (target.isIPv6) {
+                        swprintf_s(menuText, _countof(menuText), L"%S [%S]\t%s", target.name, target.ip, live);
                     } else {
-                        swprintf_s(menuText, _countof(menuText), L"%s (%S)", g_presets[i].name, g_presets[i].ip);
+                        swprintf_s(menuText, _countof(menuText), L"%S (%S)\t%s", target.name, target.ip, live);
                     }
                 }
                 UINT flags = MF_STRING;
-                if (i == currentPreset) {
+                if (i == currentTarget) {
                     flags |= MF_CHECKED;
                 }
                 AppendMenuW(hMenu, flags, CMD_SELECT_BASE + i, menuText);
@@ -424,229 +327,472 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
             
             if (cmd == CMD_EXIT) {
                 g_running = false;
+                WakeWorker();
                 PostQuitMessage(0);
-            } else if (cmd >= CMD_SELECT_BASE && cmd < CMD_SELECT_BASE + g_numPresets) {
-                // Update selected preset
-                int newPreset = cmd - CMD_SELECT_BASE;
-                g_selectedPreset.store(newPreset);
-                
-                // Update target IP immediately if it's a fixed IP
-                if (g_presets[newPreset].ip != nullptr) {
-                    strncpy_s(g_targetIP, sizeof(g_targetIP), g_presets[newPreset].ip, _TRUNCATE);
-                }
-                // Otherwise (default gateway), it will be updated in the worker thread
+            } else if (cmd >= CMD_SELECT_BASE && cmd < CMD_SELECT_BASE + (int)kMaxTargets) {
+                // Update selected target
+                int newTarget = cmd - CMD_SELECT_BASE;
+                g_selectedTarget.store(newTarget);
+                WakeWorker();
             }
         } else if (lParam == WM_LBUTTONUP) {
             // optional: show tooltip manually or bounce icon - keep minimal (no action)
         }
     } else if (msg == WM_DESTROY) {
         g_running = false;
-        Shell_NotifyIconW(NIM_DELETE, &nid);
+        WakeWorker();
+        // nid belongs to the render thread; removal only needs the identity fields
+        NOTIFYICONDATAW del = {0};
+        del.cbSize = sizeof(del);
+        del.hWnd = hWnd;
+        del.uID = TRAY_UID;
+        Shell_NotifyIconW(NIM_DELETE, &del);
         PostQuitMessage(0);
     }
     return DefWindowProcW(hWnd, msg, wParam, lParam);
 }
 
-// Worker thread: find gateway, ping, update icon & tooltip
-DWORD WINAPI WorkerThread(LPVOID) {
-    // Initialize target IP based on current selection
-    char targetCStr[64] = {0};
-    
-    // Get current preset selection
-    int selectedPreset = g_selectedPreset.load();
-    
-    if (selectedPreset == 0) {
-        // Default Gateway mode
-        DWORD gw = GetDefaultGatewayIPv4();
-        std::string gwStr;
-        if (gw != 0) {
-            gwStr = IPv4ToString(gw);
-            if (gwStr.empty()) {
-                gwStr = "1.1.1.1"; // fallback if conversion failed
-            }
-        } else {
-            gwStr = "1.1.1.1"; // fallback public resolver
-        }
-        strncpy_s(targetCStr, sizeof(targetCStr), gwStr.c_str(), _TRUNCATE);
-    } else if (selectedPreset > 0 && selectedPreset < g_numPresets && g_presets[selectedPreset].ip != nullptr) {
-        // Fixed IP preset (IPv4 or IPv6)
-        size_t ipLen = strlen(g_presets[selectedPreset].ip);
-        if (ipLen < sizeof(targetCStr)) {
-            strncpy_s(targetCStr, sizeof(targetCStr), g_presets[selectedPreset].ip, _TRUNCATE);
+// ---------- Targets ----------
+// "--config=<file>" from a command line (quotes allowed), into g_configPath
+static bool ParseConfigOption(const char* cmdLine) {
+    const char* arg = strstr(cmdLine, "--config=");
+    if (!arg) return false;
+    arg += 9;
+    char end = ' ';
+    if (*arg == '"') {
+        end = '"';
+        ++arg;
+    }
+    size_t n = 0;
+    while (arg[n] && arg[n] != end && (end == '"' || arg[n] != '\t')) ++n;
+    if (!n || n >= sizeof(g_configPath)) return false;
+    memcpy(g_configPath, arg, n);
+    g_configPath[n] = 0;
+    return true;
+}
+
+// Read and parse the config file into g_config; on failure message says why
+static bool LoadConfig(char* message, size_t size) {
+    size_t len = 0;
+    bool tooLarge = false;
+    if (!lt::ReadWholeFile(g_configPath, g_configText, sizeof(g_configText), &len, &tooLarge)) {
+        if (tooLarge) {
+            _snprintf_s(message, size, _TRUNCATE, "config %s: larger than %u bytes", g_configPath, (unsigned)sizeof(g_configText));
         } else {
-            strncpy_s(targetCStr, sizeof(targetCStr), "1.1.1.1", _TRUNCATE);
+            _snprintf_s(message, size, _TRUNCATE, "cannot read config %s", g_configPath);
         }
+        return false;
+    }
+    lt::TargetConfigError error;
+    if (!lt::ParseTargetConfig(g_configText, len, &g_config, &error)) {
+        _snprintf_s(message, size, _TRUNCATE, "config %s:%u: %s", g_configPath, error.line, error.message);
+        return false;
+    }
+    return true;
+}
+
+// The presets as a config, so they reach the engine the same way a file's targets do. Some
+// share an address under another label, which a file may not; they are never reloaded, so the
+// identity index stays empty.
+static void PresetConfig() {
+    g_config.probeIntervalMs = 0;
+    g_config.timeoutMs = 0;
+    g_config.fairMs = 0;
+    g_config.poorMs = 0;
+    g_config.index.Clear();
+    for (uint32_t i = 0; i < lt::kPresetCount; ++i) {
+        lt::ConfigTarget& t = g_config.targets[i];
+        t.address = lt::kPresets[i].address;   // IP_NONE for the default gateway
+        t.method = lt::kPresets[i].method;
+        t.port = lt::kPresets[i].port;
+        t.line = 0;
+        strncpy_s(t.name, sizeof(t.name), lt::kPresets[i].name, _TRUNCATE);
+    }
+    g_config.count = lt::kPresetCount;
+}
+
+// Probe stage's copy of what it last published to g_targets
+static TrayTargets g_probeTargets;
+
+// Describe the slots for the menu and the render stage (after g_slots.Commit)
+static void PublishTargets() {
+    TrayTargets& targets = g_probeTargets;
+    memset(&targets, 0, sizeof(targets));
+    targets.count = g_slots.Count();
+    targets.fairMs = g_config.fairMs ? g_config.fairMs : kFairMs;
+    targets.poorMs = g_config.poorMs ? g_config.poorMs : kPoorMs;
+    for (uint32_t i = 0; i < targets.count; ++i) {
+        if (!g_slots.Used(i)) continue;
+        const lt::ConfigTarget& t = g_slots.Target(i);
+        TrayTarget& out = targets.slot[i];
+        out.used = true;
+        out.isIPv6 = t.address.IsIPv6();
+        out.method = t.method;
+        out.port = t.port;
+        if (!t.IsGateway()) lt::FormatIpAddress(t.address, out.ip, sizeof(out.ip));
+        memcpy(out.name, t.name, sizeof(out.name));
+    }
+    g_targets.Store(targets);
+}
+
+// Send slot's probes to the backend for the target's method and bind its address (the current
+// gateway for the default gateway)
+static bool BindTarget(uint32_t slot, const lt::ConfigTarget& t, const char* gateway, bool gatewayIPv6) {
+    if (t.method == lt::METHOD_TCP) {
+        g_tcp.SetPort(slot, t.port);
+        g_mux.Route(slot, &g_tcp);
+    } else if (t.method == lt::METHOD_DNS) {
+        g_dns.SetPort(slot, t.port);
+        g_mux.Route(slot, &g_dns);
     } else {
-        // Invalid selection, fallback to Cloudflare
-        strncpy_s(targetCStr, sizeof(targetCStr), "1.1.1.1", _TRUNCATE);
+        g_mux.Route(slot, &g_icmp);
     }
-    
-    // Copy to shared buffer for thread-safe access
-    strncpy_s(g_targetIP, sizeof(g_targetIP), targetCStr, _TRUNCATE);
+    return t.IsGateway() ? g_engine.SetTarget(slot, gateway, gatewayIPv6) : g_engine.SetTarget(slot, t.address);
+}
 
-    // Decide icon size (choose 16; on high DPI Windows will scale it)
-    const int iconSize = 16;
+// Probe interval and timeout: the config's where it sets them, the defaults otherwise
+static void ConfigTiming(uint32_t* intervalMs, uint32_t* timeoutMs) {
+    *intervalMs = g_config.probeIntervalMs ? g_config.probeIntervalMs : kProbeIntervalMs;
+    *timeoutMs = g_config.timeoutMs ? g_config.timeoutMs : kProbeTimeoutMs;
+}
 
-    // keep a tiny rolling average if desired (simple)
-    const int MAX_SAMPLES = 10;
-    std::vector<DWORD> samples;
-    samples.reserve(MAX_SAMPLES);
-    
-    // Track consecutive failures to clear stale averages
-    int consecutiveFailures = 0;
-    const int MAX_CONSECUTIVE_FAILURES = 5; // Clear after 5 consecutive failures
+// A target's label in the history file: its address ("gateway" for the default gateway), with
+// the port for TCP and DNS, so two probes of one host stay apart
+static void SetHistoryLabel(uint32_t slot, const lt::ConfigTarget& t) {
+    char ip[lt::kIpAddressTextSize] = "gateway";
+    if (!t.IsGateway()) lt::FormatIpAddress(t.address, ip, sizeof(ip));
+    char* out = g_historyLabels[slot];
+    if (t.method == lt::METHOD_ICMP) {
+        _snprintf_s(out, lt::kHistoryNameSize, _TRUNCATE, "%s", ip);
+    } else {
+        _snprintf_s(out, lt::kHistoryNameSize, _TRUNCATE, t.address.IsIPv6() ? "%s[%s]:%u" : "%s%s:%u",
+                    t.method == lt::METHOD_DNS ? "dns:" : "", ip, t.port);
+    }
+    g_historyNames[slot] = out;
+}
+
+// Move the engine over to g_config, between two Run calls: at startup every target is added,
+// on reload only what changed is touched, and targets that stayed keep their slot and statistics
+static void ApplyConfig(const char* gateway, bool gatewayIPv6) {
+    g_slots.Plan(g_config, &g_plan);
+    uint32_t refused = lt::ApplyReload(g_engine, g_config, g_plan, [gateway, gatewayIPv6](uint32_t slot, const lt::ConfigTarget& t) {
+        return BindTarget(slot, t, gateway, gatewayIPv6);
+    });
+    g_slots.Commit(g_config, g_plan);
+    // Samples from here on are recorded under the new slot labels, earlier ones keep theirs
+    if (g_history.Enabled() && (g_plan.added || g_plan.removed)) {
+        for (uint32_t i = 0; i < g_slots.Count(); ++i) {
+            g_historyNames[i] = nullptr;
+            if (g_slots.Used(i)) SetHistoryLabel(i, g_slots.Target(i));
+        }
+        g_history.Relabel(g_historyNames, g_slots.Count());
+    }
+    uint32_t intervalMs, timeoutMs;
+    ConfigTiming(&intervalMs, &timeoutMs);
+    if (intervalMs != g_engine.IntervalMs() || timeoutMs != g_engine.TimeoutMs()) {
+        g_engine.SetTiming(lt::AdaptiveCadence(intervalMs, kProbeBudget), timeoutMs);
+    }
+    if (refused) {
+        char report[96];
+        _snprintf_s(report, sizeof(report), _TRUNCATE, "latency_tray: %u targets could not be bound\n", refused);
+        OutputDebugStringA(report);
+    }
+    PublishTargets();
+}
 
-    // Cache previous icon text to avoid unnecessary recreations
-    wchar_t prevIconText[16] = {0};
+// Lowest slot in use (the selection moves there when its target is removed)
+static int FirstTarget() {
+    for (uint32_t i = 0; i < g_slots.Count(); ++i) {
+        if (g_slots.Used(i)) return (int)i;
+    }
+    return 0;
+}
 
-    // Track last successfully pushed icon handle for safe destruction
-    // (only destroy after successful Shell_NotifyIconW to ensure Explorer has taken ownership)
-    static HICON lastPushedIconHandle = NULL;
+// Probe stage (above normal priority): track the gateway, keep every target probed and hand a
+// snapshot of the displayed target to the render stage. Nothing here formats text or calls
+// into the shell, so drawing never delays a completion and inflates the measured RTT.
+DWORD WINAPI ProbeThread(LPVOID) {
+    // Default Gateway slot: fall back to public resolver if detection fails
+    // Notifications are registered before the first snapshot so no change falls in between;
+    // each one signals g_wakeEvent, so a new gateway is picked up without waiting for a probe.
+    char gatewayCStr[64] = {0};
+    bool gatewayIPv6 = false;
+    g_routeSource.SetNotifyEvent(g_wakeEvent);
+    g_routeSource.Open();
+    g_gateways.Init(&g_routeSource);
+    if (!g_gateways.PreferredGateway(gatewayCStr, sizeof(gatewayCStr), &gatewayIPv6)) {
+        strncpy_s(gatewayCStr, sizeof(gatewayCStr), lt::kGatewayFallback, _TRUNCATE);
+        gatewayIPv6 = false;
+    }
+
+    // Bind every target so all of them are measured concurrently; selecting another
+    // target in the menu only changes which history is displayed.
+    // Connect completions and DNS responses signal the same event the ICMP wait already watches
+    g_mux.Init(&g_icmp);
+    g_mux.AddSide(&g_tcp);
+    g_mux.AddSide(&g_dns);
+    g_dns.SetQuery(lt::kDnsQueryName);
+    uint32_t intervalMs, timeoutMs;
+    ConfigTiming(&intervalMs, &timeoutMs);
+    g_engine.Init(&g_mux, 0, intervalMs, timeoutMs, kStatsWindow);
+    g_engine.SetCadence(lt::AdaptiveCadence(intervalMs, kProbeBudget));
+    g_icmp.SetWakeEvent(g_wakeEvent);
+    g_tcp.SetWakeEvent(g_wakeEvent);
+    g_dns.SetWakeEvent(g_wakeEvent);
+    ApplyConfig(gatewayCStr, gatewayIPv6);
+
+    lt::ProbeResult results[kMaxTargets];
+    int shownTarget = -1;
+    uint32_t snapshots = 0;
+    ULONGLONG lastConfigCheck = GetTickCount64();
+    lt::AllocationWatch allocations(kAllocationWarmup);
 
     while (g_running) {
-        // Check if target has changed
-        int currentPreset = g_selectedPreset.load();
-        
-        if (currentPreset == 0) {
-            // Default Gateway mode - re-check gateway occasionally (every 10s)
-            static int counter = 0;
-            if (counter++ % 10 == 0) {
-                DWORD gw2 = GetDefaultGatewayIPv4();
-                if (gw2 != 0) {
-                    std::string s = IPv4ToString(gw2);
-                    if (!s.empty() && s.length() < sizeof(targetCStr)) {
-                        strncpy_s(targetCStr, sizeof(targetCStr), s.c_str(), _TRUNCATE);
-                        strncpy_s(g_targetIP, sizeof(g_targetIP), targetCStr, _TRUNCATE);
+        allocations.BeginTick();
+        // Re-resolve only when a default route or interface actually changed
+        if (g_gateways.Update()) {
+            char gw[64] = {0};
+            bool gwIPv6 = false;
+            if (g_gateways.PreferredGateway(gw, sizeof(gw), &gwIPv6) && (strcmp(gw, gatewayCStr) != 0 || gwIPv6 != gatewayIPv6)) {
+                strncpy_s(gatewayCStr, sizeof(gatewayCStr), gw, _TRUNCATE);
+                gatewayIPv6 = gwIPv6;
+                for (uint32_t i = 0; i < g_slots.Count(); ++i) {
+                    if (!g_slots.Used(i) || !g_slots.Target(i).IsGateway()) continue;
+                    g_engine.SetTarget(i, gatewayCStr, gatewayIPv6);
+                    if (g_selectedTarget.load() == (int)i) {
+                        shownTarget = -1;   // redraw the tooltip with the new address
                     }
                 }
             }
-        } else if (currentPreset > 0 && currentPreset < g_numPresets && g_presets[currentPreset].ip != nullptr) {
-            // Fixed IP preset - update if changed
-            if (strcmp(targetCStr, g_presets[currentPreset].ip) != 0) {
-                strncpy_s(targetCStr, sizeof(targetCStr), g_presets[currentPreset].ip, _TRUNCATE);
-                strncpy_s(g_targetIP, sizeof(g_targetIP), targetCStr, _TRUNCATE);
+        }
+
+        // A saved config is swapped in between two passes; the tooltip is redrawn, and a
+        // selection whose target went away moves to the first target
+        if (g_configWatch.Watching() && GetTickCount64() - lastConfigCheck >= kConfigCheckMs) {
+            lastConfigCheck = GetTickCount64();
+            if (g_configWatch.Changed()) {
+                char message[sizeof(g_configPath) + 160];
+                if (LoadConfig(message, sizeof(message))) {
+                    ApplyConfig(gatewayCStr, gatewayIPv6);
+                    int selected = g_selectedTarget.load();
+                    if (selected < 0 || !g_slots.Used((uint32_t)selected)) g_selectedTarget.store(FirstTarget());
+                    shownTarget = -1;
+                } else {
+                    ConfigRejection rejection;
+                    strncpy_s(rejection.text, sizeof(rejection.text), message, _TRUNCATE);
+                    g_configRejection.Store(rejection);
+                    SetEvent(g_renderEvent);
+                    strncat_s(message, sizeof(message), ", keeping the current targets\n", _TRUNCATE);
+                    OutputDebugStringA(message);
+                }
             }
         }
 
-        // Use the current target
-        char* currentTarget = targetCStr;
-        if (g_targetIP[0] != 0) {
-            currentTarget = g_targetIP;
+        // Send due echoes and wait for completions or the next deadline. Exit, selection
+        // changes and route changes signal g_wakeEvent; only a watched config file adds a
+        // periodic wake-up.
+        int n = g_engine.Run(g_configWatch.Watching() ? kConfigCheckMs : kIdleWaitMs, results, kMaxTargets);
+        if (!g_running) break;
+
+        if (g_history.Enabled() && n > 0) {
+            lt::HistorySample sample;
+            sample.timeMs = (int64_t)(lt::RealtimeNowUs() / 1000);
+            for (int k = 0; k < n; ++k) {
+                sample.target = results[k].target;
+                sample.rttUs = results[k].rttUs;
+                sample.status = results[k].status;
+                g_history.Offer(sample);
+            }
         }
 
-        // Determine if current target is IPv6
-        bool isIPv6 = false;
-        if (currentPreset == 0) {
-            // Default Gateway is always IPv4
-            isIPv6 = false;
-        } else if (currentPreset > 0 && currentPreset < g_numPresets) {
-            // Use the preset's IPv6 flag
-            isIPv6 = g_presets[currentPreset].isIPv6;
-        } else {
-            // Fallback: Auto-detect by checking if string contains colons (IPv6 indicator)
-            isIPv6 = (strchr(currentTarget, ':') != nullptr);
+        // Only the selected target drives the icon; redraw when it completed or selection changed
+        int currentTarget = g_selectedTarget.load();
+        if (currentTarget < 0 || !g_slots.Used((uint32_t)currentTarget)) currentTarget = FirstTarget();
+        bool refresh = (currentTarget != shownTarget);
+        if (refresh) g_engine.SetFocus(currentTarget);
+        for (int k = 0; k < n; ++k) {
+            if (results[k].target == (uint32_t)currentTarget) refresh = true;
         }
+        if (!refresh) {
+            // Results of other targets only reach the file when the render stage runs
+            if (g_history.Enabled() && g_history.Pending() >= 512) SetEvent(g_renderEvent);
+            allocations.EndTick();
+            continue;
+        }
+        shownTarget = currentTarget;
+
+        const TrayTarget& target = g_probeTargets.slot[currentTarget];
+        const char* address = target.ip[0] ? target.ip : gatewayCStr;
+        bool isIPv6 = target.ip[0] ? target.isIPv6 : gatewayIPv6;
+        lt::LatencySnapshot snap;
+        lt::CaptureSnapshot(g_engine, (uint32_t)currentTarget, address, isIPv6, ++snapshots, &snap);
+        g_latest.Store(snap);
+        // A full queue means the render stage is behind; it picks the newest up from g_latest
+        g_renderQueue.TryPush(snap);
+        SetEvent(g_renderEvent);
+        allocations.EndTick();
+    }
 
-        DWORD rtt = PingOnce(currentTarget, isIPv6, 1000 /*timeout*/);
+#ifdef LT_COUNT_ALLOCATIONS
+    {
+        // Process-wide: the render thread's allocations land in the pass they fall into
+        char report[160];
+        _snprintf_s(report, sizeof(report), _TRUNCATE,
+                    "latency_tray: %llu allocations in %llu probe passes after the first %u (at most %llu in one)\n",
+                    (unsigned long long)allocations.Allocations(),
+                    (unsigned long long)(allocations.Ticks() > kAllocationWarmup ? allocations.Ticks() - kAllocationWarmup : 0),
+                    kAllocationWarmup, (unsigned long long)allocations.MaxPerTick());
+        OutputDebugStringA(report);
+    }
+#endif
 
-        // update rolling samples
-        if (rtt != 0xFFFFFFFF) {
-            consecutiveFailures = 0; // Reset failure counter on success
-            if ((int)samples.size() >= MAX_SAMPLES) samples.erase(samples.begin());
-            samples.push_back(rtt);
+    // No more notifications once the probe thread is gone (they signal g_wakeEvent)
+    g_routeSource.Close();
+    return 0;
+}
+
+// Send the fields the coalescer asked for. The icon is only rendered when it is one of them;
+// the previous icon is destroyed once Explorer has taken the new one.
+template <typename Tray>
+static void PushTray(Tray& tray, int iconSize, HICON& lastPushedIconHandle, uint32_t fields) {
+    if (!fields) return;
+    if (fields & lt::TRAY_ICON) {
+        HICON hIcon = CreateTextIcon(tray.IconText(), iconSize, tray.IconTint());
+        if (hIcon) {
+            nid.hIcon = hIcon;
         } else {
-            // treat as missing; don't add
-            consecutiveFailures++;
-            // Clear stale averages after consecutive failures to avoid misleading data
-            if (consecutiveFailures >= MAX_CONSECUTIVE_FAILURES) {
-                samples.clear();
-            }
+            fields &= ~(uint32_t)lt::TRAY_ICON;   // keep it staged, retry on the next flush
         }
+    }
+    if (fields & lt::TRAY_TIP) {
+        // Copy tooltip safely into nid.szTip (128 wchar)
+        wcsncpy_s(nid.szTip, _countof(nid.szTip), tray.Tip(), _TRUNCATE);
+    }
+    if (!fields) return;
+
+    nid.uFlags = ((fields & lt::TRAY_ICON) ? NIF_ICON : 0) | ((fields & lt::TRAY_TIP) ? NIF_TIP : 0);
+    BOOL notifySuccess = Shell_NotifyIconW(NIM_MODIFY, &nid);
+    if (!notifySuccess) {
+        // If modify fails, try to re-add with everything (icon may have been lost)
+        nid.uFlags = NIF_MESSAGE | NIF_ICON | NIF_TIP;
+        if (!(fields & lt::TRAY_TIP)) wcsncpy_s(nid.szTip, _countof(nid.szTip), tray.Tip(), _TRUNCATE);
+        notifySuccess = Shell_NotifyIconW(NIM_ADD, &nid);
+    }
+    tray.Commit(fields, notifySuccess != FALSE, GetTickCount64());
 
-        // compute simple average for tooltip
-        DWORD avg = 0;
-        if (!samples.empty()) {
-            uint64_t sum = 0;
-            for (auto v : samples) sum += v;
-            avg = (DWORD)(sum / samples.size());
+    // Only destroy previous icon handle after successful push
+    // This ensures Explorer has taken ownership of the new icon before we free the old one
+    if (notifySuccess && (fields & lt::TRAY_ICON)) {
+        if (lastPushedIconHandle && lastPushedIconHandle != nid.hIcon) {
+            DestroyIcon(lastPushedIconHandle);
         }
+        lastPushedIconHandle = nid.hIcon;
+    }
+}
 
-        // prepare text for icon: short number or "--"
-        wchar_t iconText[16] = {0};
-        if (rtt == 0xFFFFFFFF) {
-            wcscpy_s(iconText, _countof(iconText), L"--");
-        } else {
-            swprintf_s(iconText, _countof(iconText), L"%u", (unsigned)rtt);
-        }
-        
-        // Only recreate icon if text changed (optimization)
-        HICON hIcon = NULL;
-        if (wcscmp(iconText, prevIconText) != 0) {
-            wcscpy_s(prevIconText, _countof(prevIconText), iconText);
-            hIcon = CreateTextIcon(iconText, iconSize);
-            if (hIcon) {
-                // Replace icon in notification structure
-                // The old icon handle is tracked in lastPushedIconHandle and will be
-                // safely destroyed after the next successful Shell_NotifyIconW call
-                nid.hIcon = hIcon;
-            }
-        }
+// A rejected config edit, in a warning balloon; the targets it would have replaced keep running.
+// The info fields only count in this one call: PushTray never sets NIF_INFO.
+static void ShowConfigRejection(const ConfigRejection& rejection) {
+    nid.uFlags = NIF_INFO;
+    nid.dwInfoFlags = NIIF_WARNING;
+    wcsncpy_s(nid.szInfoTitle, _countof(nid.szInfoTitle), L"Config not applied, keeping the current targets", _TRUNCATE);
+    if (!MultiByteToWideChar(CP_UTF8, 0, rejection.text, -1, nid.szInfo, _countof(nid.szInfo))) {
+        wcsncpy_s(nid.szInfo, _countof(nid.szInfo), L"The edited config file has an error", _TRUNCATE);
+    }
+    Shell_NotifyIconW(NIM_MODIFY, &nid);
+}
 
-        // tooltip text: e.g. "Cloudflare DNS (1.1.1.1) — 24 ms (avg 26 ms)"
-        wchar_t tip[256] = {0};
-        const wchar_t* targetName = L"Target";
-        if (currentPreset >= 0 && currentPreset < g_numPresets) {
-            targetName = g_presets[currentPreset].name;
+// Render stage (below normal priority): owns nid from here on. Draws the newest snapshot the
+// probe stage handed over and pushes it to the shell.
+DWORD WINAPI RenderThread(LPVOID) {
+    // Decide icon size (choose 16; on high DPI Windows will scale it)
+    const int iconSize = 16;
+
+    // Only changed fields are sent, at a bounded rate; the number holds still near a rounding edge
+    static lt::TrayCoalescer<wchar_t, _countof(nid.szTip)> tray;
+    tray.Configure(1000 / kTrayMaxUpdatesPerSec);
+    lt::DisplayHysteresis shownRtt;
+    int shownTarget = -1;
+
+    // Track last successfully pushed icon handle for safe destruction
+    // (only destroy after successful Shell_NotifyIconW to ensure Explorer has taken ownership)
+    static HICON lastPushedIconHandle = NULL;
+
+    lt::LatencySnapshot snap;
+    uint32_t shownSequence = 0;
+    // Names and thresholds, reloaded when the probe stage publishes a change
+    static TrayTargets targets;
+    uint32_t targetsVersion = 0;
+    uint32_t rejectionVersion = 0;
+
+    while (g_running) {
+        // Sleep until a snapshot arrives or a rate-limited change is due
+        ULONGLONG before = GetTickCount64();
+        uint64_t due = tray.NextDueMs();
+        DWORD waitMs = due == UINT64_MAX ? INFINITE : (due > before ? (DWORD)(due - before) : 0);
+        WaitForSingleObject(g_renderEvent, waitMs);
+        if (!g_running) break;
+        g_history.Drain((int64_t)(lt::RealtimeNowUs() / 1000));
+
+        // Only the newest snapshot matters; g_latest covers snapshots the full queue dropped
+        bool have = false;
+        while (g_renderQueue.TryPop(&snap)) have = true;
+        lt::LatencySnapshot latest;
+        if (g_latest.TryLoad(&latest) && latest.sequence > (have ? snap.sequence : shownSequence)) {
+            snap = latest;
+            have = true;
         }
-        
-        // Format IP display: use brackets for IPv6
-        wchar_t ipDisplay[128] = {0};
-        if (isIPv6) {
-            swprintf_s(ipDisplay, _countof(ipDisplay), L"[%S]", currentTarget);
-        } else {
-            swprintf_s(ipDisplay, _countof(ipDisplay), L"(%S)", currentTarget);
+        if (g_targets.Version() != targetsVersion) {
+            targetsVersion = g_targets.Version();
+            g_targets.Load(&targets);
         }
-        
-        if (rtt == 0xFFFFFFFF) {
-            swprintf_s(tip, _countof(tip), L"%s %s — no reply", targetName, ipDisplay);
-        } else {
-            if (avg != 0) {
-                swprintf_s(tip, _countof(tip), L"%s %s — %u ms (avg %u ms)", targetName, ipDisplay, (unsigned)rtt, (unsigned)avg);
-            } else {
-                swprintf_s(tip, _countof(tip), L"%s %s — %u ms", targetName, ipDisplay, (unsigned)rtt);
-            }
+        if (g_configRejection.Version() != rejectionVersion) {
+            rejectionVersion = g_configRejection.Version();
+            static ConfigRejection rejection;
+            g_configRejection.Load(&rejection);
+            ShowConfigRejection(rejection);
         }
+        if (!have || snap.sequence <= shownSequence || snap.target >= targets.count || !targets.slot[snap.target].used) {
+            PushTray(tray, iconSize, lastPushedIconHandle, tray.Flush(GetTickCount64()));
+            continue;
+        }
+        shownSequence = snap.sequence;
 
-        // Copy tooltip safely into nid.szTip (128 wchar)
-        wcsncpy_s(nid.szTip, _countof(nid.szTip), tip, _TRUNCATE);
-
-        // Update the tray (check return value)
-        BOOL notifySuccess = Shell_NotifyIconW(NIM_MODIFY, &nid);
-        if (!notifySuccess) {
-            // If modify fails, try to re-add (icon may have been lost)
-            notifySuccess = Shell_NotifyIconW(NIM_ADD, &nid);
+        // A new target starts without the previous one's held value
+        if ((int)snap.target != shownTarget) {
+            shownRtt.Reset();
+            shownTarget = (int)snap.target;
         }
+        uint32_t rttUs = shownRtt.Filter(snap.rttUs);
+        bool measured = snap.completed > 0;
+
+        // prepare text for icon: "0.4", "2.4", "24" or "--"
+        char iconText[16] = {0};
+        lt::FormatRttMs(iconText, sizeof(iconText), rttUs, 1);
         
-        // Only destroy previous icon handle after successful push
-        // This ensures Explorer has taken ownership of the new icon before we free the old one
-        if (notifySuccess) {
-            // Destroy the previously tracked icon (the one that was successfully pushed before)
-            // This is safe because Explorer has taken ownership of the new icon in nid.hIcon
-            if (lastPushedIconHandle && lastPushedIconHandle != nid.hIcon) {
-                DestroyIcon(lastPushedIconHandle);
-            }
-            // Update tracked handle to the icon we just successfully pushed
-            // (This is the icon that will be destroyed after the NEXT successful push)
-            lastPushedIconHandle = nid.hIcon;
+        // Background colour by latency; no colour until the first probe completes
+        uint32_t tint = 0;
+        if (measured) {
+            tint = 0xFF000000u | (rttUs == lt::kNoReply ? lt::kTintPoor : lt::LatencyTint(rttUs / 1000, targets.fairMs, targets.poorMs));
         }
 
-        // Sleep 1 second total (keep low-duty)
-        for (int i = 0; i < 10 && g_running; ++i) Sleep(100); // wake every 100ms to be responsive to exit
+        // tooltip text (core/tooltip_format.h): target, RTT and loss, tail percentiles, API error.
+        // Built as UTF-8 and widened once; FormatTooltip leaves out whole lines to stay within
+        // szTip, so the coalescer never has to cut it.
+        char tipText[256];
+        lt::TextBuffer text(tipText, sizeof(tipText) - 1);
+        const TrayTarget& target = targets.slot[snap.target];
+        lt::FormatTooltip(text, snap, target.name, target.method, target.port, rttUs, _countof(nid.szTip) - 1);
+        tipText[text.Length()] = 0;
+        wchar_t tip[256] = {0};
+        MultiByteToWideChar(CP_UTF8, 0, tipText, -1, tip, _countof(tip));
+
+        PushTray(tray, iconSize, lastPushedIconHandle, tray.Submit(iconText, tint, tip, GetTickCount64()));
     }
 
     // Cleanup: destroy last pushed icon handle on thread exit
     // (the icon in nid.hIcon will be cleaned up in main thread)
-    if (lastPushedIconHandle) {
+    if (lastPushedIconHandle && lastPushedIconHandle != nid.hIcon) {
         DestroyIcon(lastPushedIconHandle);
         lastPushedIconHandle = NULL;
     }
@@ -654,6 +800,28 @@ DWORD WINAPI WorkerThread(LPVOID) {
     return 0;
 }
 
+// Targets from the file given with --config, or the presets (path converted to UTF-8). False
+// with the reason in message when the file cannot be used.
+static bool LoadTargets(const char* cmdLine, char* message, size_t size) {
+    if (!ParseConfigOption(cmdLine)) {
+        PresetConfig();
+        return true;
+    }
+    // Watch from before the first read, so a save during it is picked up afterwards
+    g_configWatch.Init(g_configPath);
+    return LoadConfig(message, size);
+}
+
+// Open the history file if the command line asks for one, labelled with the slots the config's
+// targets are about to take (in file order: no slot is taken yet). ApplyConfig relabels on reload.
+static void OpenHistory(const char* cmdLine) {
+    char path[MAX_PATH * 3];
+    uint32_t sizeMB = 0;
+    if (!lt::ParseHistoryOptions(cmdLine, path, sizeof(path), &sizeMB)) return;
+    for (uint32_t i = 0; i < g_config.count; ++i) SetHistoryLabel(i, g_config.targets[i]);
+    g_history.Open(path, sizeMB, g_historyNames, g_config.count, (int64_t)(lt::RealtimeNowUs() / 1000));
+}
+
 int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR, int) {
     g_hInst = hInstance;
 
@@ -666,6 +834,18 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR, int) {
     // Apply runtime process mitigation policies for security hardening
     HardenProcess();
 
+    // Targets before anything is shown: a config that does not parse is reported and ends it
+    char cmdLine[1024];
+    if (!WideCharToMultiByte(CP_UTF8, 0, GetCommandLineW(), -1, cmdLine, sizeof(cmdLine), NULL, NULL)) cmdLine[0] = 0;
+    char message[sizeof(g_configPath) + 160];
+    if (!LoadTargets(cmdLine, message, sizeof(message))) {
+        wchar_t text[_countof(message)];
+        MultiByteToWideChar(CP_UTF8, 0, message, -1, text, _countof(text));
+        MessageBoxW(NULL, text, L"Latency Tray", MB_OK | MB_ICONERROR);
+        WSACleanup();
+        return 1;
+    }
+
     // Register a message-only window to receive tray callbacks
     WNDCLASSW wc = {0};
     wc.lpfnWndProc = WndProc;
@@ -696,10 +876,10 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR, int) {
     nid.uID = TRAY_UID;
     nid.uFlags = NIF_MESSAGE | NIF_ICON | NIF_TIP;
     nid.uCallbackMessage = WM_TRAYICON;
-    nid.hIcon = CreateTextIcon(L"--", 16);
+    nid.hIcon = CreateTextIcon("--", 16);
     if (!nid.hIcon) {
         // If icon creation fails, try with a simpler fallback
-        nid.hIcon = CreateTextIcon(L"??", 16);
+        nid.hIcon = CreateTextIcon("??", 16);
     }
     wcscpy_s(nid.szTip, _countof(nid.szTip), L"Latency Tray (starting...)");
 
@@ -711,10 +891,28 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR, int) {
         return 1;
     }
 
-    // Spawn worker thread
-    HANDLE hThread = CreateThread(NULL, 0, WorkerThread, NULL, 0, NULL);
-    if (!hThread) {
-        // Failed to create thread
+    OpenHistory(cmdLine);
+
+    // Spawn the probe and render threads (suspended, to set priorities before they run)
+    g_wakeEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    g_renderEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    HANDLE hProbe = NULL;
+    HANDLE hRender = NULL;
+    if (g_wakeEvent && g_renderEvent) {
+        hProbe = CreateThread(NULL, 0, ProbeThread, NULL, CREATE_SUSPENDED, NULL);
+        hRender = CreateThread(NULL, 0, RenderThread, NULL, CREATE_SUSPENDED, NULL);
+    }
+    if (!hProbe || !hRender) {
+        // Failed to create threads: let the one that exists run straight to its exit
+        g_running = false;
+        HANDLE created = hProbe ? hProbe : hRender;
+        if (created) {
+            ResumeThread(created);
+            WaitForSingleObject(created, 2000);
+            CloseHandle(created);
+        }
+        if (g_wakeEvent) CloseHandle(g_wakeEvent);
+        if (g_renderEvent) CloseHandle(g_renderEvent);
         Shell_NotifyIconW(NIM_DELETE, &nid);
         if (nid.hIcon) DestroyIcon(nid.hIcon);
         DestroyWindow(g_hWnd);
@@ -722,6 +920,12 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR, int) {
         return 1;
     }
 
+    // Timing runs above the UI, drawing below it
+    SetThreadPriority(hProbe, THREAD_PRIORITY_ABOVE_NORMAL);
+    SetThreadPriority(hRender, THREAD_PRIORITY_BELOW_NORMAL);
+    ResumeThread(hRender);
+    ResumeThread(hProbe);
+
     // Message loop (minimal)
     MSG msg;
     while (GetMessageW(&msg, NULL, 0, 0)) {
@@ -731,10 +935,16 @@ int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE, LPWSTR, int) {
 
     // Clean up
     g_running = false;
-    if (hThread) {
-        WaitForSingleObject(hThread, 2000);
-        CloseHandle(hThread);
-    }
+    WakeWorker();
+    HANDLE threads[2] = {hProbe, hRender};
+    WaitForMultipleObjects(2, threads, TRUE, 2000);
+    CloseHandle(hProbe);
+    CloseHandle(hRender);
+    g_history.Close((int64_t)(lt::RealtimeNowUs() / 1000));   // both stages are gone
+    CloseHandle(g_wakeEvent);
+    g_wakeEvent = NULL;
+    CloseHandle(g_renderEvent);
+    g_renderEvent = NULL;
     Shell_NotifyIconW(NIM_DELETE, &nid);
     if (nid.hIcon) {
         DestroyIcon(nid.hIcon);
@@ -0,0 +1,116 @@
+// tests/argb_kernels_test.cpp
+// Every kernel set this build and CPU can run (ArgbKernelsFor) against ARGB_SCALAR, byte for
+// byte: fill, premultiply, blend and tint over pseudo-random pixels, coverage and colours, at
+// every length up to a few vectors (the tails), the icon sizes, and unaligned starts.
+
+#include <stdio.h>
+#include <string.h>
+#include "core/argb_kernels.h"
+#include "check.h"
+
+namespace {
+
+const uint32_t kMaxPixels = 64 * 64 + 8;
+
+uint32_t g_source[kMaxPixels];
+uint8_t g_coverage[kMaxPixels];
+uint32_t g_expected[kMaxPixels];
+uint32_t g_actual[kMaxPixels];
+uint32_t g_random = 12345;
+
+uint32_t Random() {
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 17;
+    g_random ^= g_random << 5;
+    return g_random;
+}
+
+// Fresh inputs; every few pixels gets an edge value (alpha or coverage 0 and 255)
+void FillInputs() {
+    for (uint32_t i = 0; i < kMaxPixels; ++i) {
+        uint32_t p = Random();
+        if (i % 7 == 0) p |= 0xFF000000u;
+        if (i % 11 == 0) p &= 0x00FFFFFFu;
+        g_source[i] = p;
+        uint8_t c = (uint8_t)Random();
+        g_coverage[i] = i % 5 == 0 ? 255 : i % 13 == 0 ? 0 : c;
+    }
+}
+
+// Index of the first pixel that differs, -1 if none
+long long FirstDifference(uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        if (g_expected[i] != g_actual[i]) return i;
+    }
+    return -1;
+}
+
+// One kernel set against the scalar reference over n pixels starting `offset` pixels in
+void Compare(const lt::ArgbKernels& scalar, const lt::ArgbKernels& k, uint32_t offset, uint32_t n) {
+    uint32_t* expected = g_expected + offset;
+    uint32_t* actual = g_actual + offset;
+    const uint8_t* cov = g_coverage + offset;
+    uint32_t rgb = Random() & 0xFFFFFF;
+    uint8_t strength = (uint8_t)Random();
+    uint32_t color = Random();
+
+    // Each kernel leaves the pixels around the range alone
+    memcpy(g_expected, g_source, sizeof(g_source));
+    memcpy(g_actual, g_source, sizeof(g_source));
+    scalar.fill(expected, n, color);
+    k.fill(actual, n, color);
+    CHECK_EQ(FirstDifference(kMaxPixels), -1);
+
+    memcpy(g_expected, g_source, sizeof(g_source));
+    memcpy(g_actual, g_source, sizeof(g_source));
+    scalar.premultiply(expected, n);
+    k.premultiply(actual, n);
+    CHECK_EQ(FirstDifference(kMaxPixels), -1);
+
+    // Blend and tint take premultiplied pixels
+    scalar.premultiply(g_expected, kMaxPixels);
+    memcpy(g_actual, g_expected, sizeof(g_expected));
+    scalar.blend(expected, cov, n, rgb);
+    k.blend(actual, cov, n, rgb);
+    CHECK_EQ(FirstDifference(kMaxPixels), -1);
+
+    scalar.tint(expected, n, rgb, strength);
+    k.tint(actual, n, rgb, strength);
+    CHECK_EQ(FirstDifference(kMaxPixels), -1);
+}
+
+void TestMatchesScalar(lt::ArgbIsa isa) {
+    const lt::ArgbKernels* scalar = lt::ArgbKernelsFor(lt::ARGB_SCALAR);
+    const lt::ArgbKernels* k = lt::ArgbKernelsFor(isa);
+    CHECK(scalar != nullptr);
+    if (!scalar || !k) {
+        printf("argb_kernels_test: isa %u not available here, skipped\n", (unsigned)isa);
+        return;
+    }
+    CHECK_EQ(k->isa, isa);
+    static const uint32_t kIconSizes[] = {16, 20, 24, 32, 48, 64};
+    for (uint32_t round = 0; round < 4; ++round) {
+        FillInputs();
+        for (uint32_t offset = 0; offset < 4; ++offset) {
+            for (uint32_t n = 0; n <= 70; ++n) Compare(*scalar, *k, offset, n);
+            for (uint32_t size : kIconSizes) Compare(*scalar, *k, offset, size * size);
+        }
+    }
+}
+
+// GetArgbKernels picks the highest set that is available
+void TestBestIsAvailable() {
+    const lt::ArgbKernels& best = lt::GetArgbKernels();
+    CHECK(lt::ArgbKernelsFor(best.isa) == &best);
+    for (uint32_t isa = best.isa + 1; isa <= lt::ARGB_AVX2; ++isa) CHECK(lt::ArgbKernelsFor((lt::ArgbIsa)isa) == nullptr);
+}
+
+} // namespace
+
+int main() {
+    TestMatchesScalar(lt::ARGB_SCALAR);
+    TestMatchesScalar(lt::ARGB_SSE2);
+    TestMatchesScalar(lt::ARGB_AVX2);
+    TestBestIsAvailable();
+    return lt_test::TestResult("argb_kernels_test");
+}
@@ -0,0 +1,59 @@
+// tests/check.h
+// Assertions for the unit tests (tests/*_test.cpp, run by ctest). A failed check prints the
+// file, line and values and the test carries on; TestResult() turns the count of failures
+// into the exit status.
+#pragma once
+
+#include <stdio.h>
+#include <string.h>
+
+namespace lt_test {
+
+inline int& Failures() {
+    static int failures = 0;
+    return failures;
+}
+
+inline void Fail(const char* file, int line, const char* what) {
+    ++Failures();
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+}
+
+inline void FailEq(const char* file, int line, const char* what, long long a, long long b) {
+    ++Failures();
+    fprintf(stderr, "%s:%d: check failed: %s (%lld vs %lld)\n", file, line, what, a, b);
+}
+
+inline void FailStr(const char* file, int line, const char* what, const char* a, const char* b) {
+    ++Failures();
+    fprintf(stderr, "%s:%d: check failed: %s (\"%s\" vs \"%s\")\n", file, line, what, a, b);
+}
+
+inline int TestResult(const char* name) {
+    if (Failures()) {
+        fprintf(stderr, "%s: %d checks failed\n", name, Failures());
+        return 1;
+    }
+    printf("%s: ok\n", name);
+    return 0;
+}
+
+} // namespace lt_test
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) lt_test::Fail(__FILE__, __LINE__, #cond); \
+    } while (0)
+
+// Integers only (both sides are printed as long long)
+#define CHECK_EQ(a, b) \
+    do { \
+        long long checkA_ = (long long)(a), checkB_ = (long long)(b); \
+        if (checkA_ != checkB_) lt_test::FailEq(__FILE__, __LINE__, #a " == " #b, checkA_, checkB_); \
+    } while (0)
+
+#define CHECK_STR(a, b) \
+    do { \
+        const char *checkA_ = (a), *checkB_ = (b); \
+        if (strcmp(checkA_, checkB_) != 0) lt_test::FailStr(__FILE__, __LINE__, #a " == " #b, checkA_, checkB_); \
+    } while (0)
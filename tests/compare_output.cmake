@@ -0,0 +1,17 @@
+# tests/compare_output.cmake
+# Runs a tool that writes a file and compares the file with a checked-in copy, byte for byte.
+# When a change to the output is intended, copy the written file over the expected one.
+#
+#    cmake -DTOOL=<executable> "-DARGS=<arguments>" -DOUTPUT=<file it writes> -DEXPECTED=<file>
+#          -P compare_output.cmake
+
+separate_arguments(args UNIX_COMMAND "${ARGS}")
+file(REMOVE ${OUTPUT})
+execute_process(COMMAND ${TOOL} ${args} RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${TOOL} exited with ${result}")
+endif()
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${OUTPUT} ${EXPECTED} RESULT_VARIABLE differs)
+if(differs)
+    message(FATAL_ERROR "${OUTPUT} differs from ${EXPECTED}")
+endif()
@@ -0,0 +1,387 @@
+// tests/history_store_test.cpp
+// HistoryStore and HistoryRecorder on a scratch file in the working directory: slot labels are
+// versioned per block, so a relabel (config reload, restart with other targets) never changes
+// what samples already on disk are labelled with. The ring wraps and resumes where it left off
+// after a reopen; a block whose commit word no longer matches its bytes is skipped, bytes
+// beyond the commit are ignored, and a file of another size or format is started over.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "core/history_store.h"
+#include "check.h"
+
+namespace {
+
+const char kPath[] = "history_store_test.hist";
+
+lt::HistoryStore g_store;
+lt::HistoryRecorder<16> g_recorder;
+
+// Every sample in the file with the label its block gives its slot
+struct LabelledSample {
+    int64_t timeMs;
+    uint32_t rttUs;
+    char name[lt::kHistoryNameSize];
+};
+
+LabelledSample g_samples[1024];
+uint32_t g_sampleCount = 0;
+
+void Scan(const lt::HistoryFileHeader& header) {
+    g_sampleCount = 0;
+    FILE* f = fopen(kPath, "rb");
+    CHECK(f != nullptr);
+    if (!f) return;
+    lt::HistoryFileHeader onDisk;
+    CHECK(fread(&onDisk, sizeof(onDisk), 1, f) == 1 && lt::HistoryStore::HeaderValid(onDisk));
+    CHECK(memcmp(&onDisk, &header, sizeof(header)) == 0);
+    static uint8_t block[lt::kHistoryBlockSize];
+    uint64_t sequence = 0;
+    struct Collect {
+        const lt::HistoryFileHeader* header;
+        const uint64_t* sequence;
+        void operator()(const lt::HistorySample& s) {
+            if (g_sampleCount == sizeof(g_samples) / sizeof(g_samples[0])) return;
+            LabelledSample& out = g_samples[g_sampleCount++];
+            out.timeMs = s.timeMs;
+            out.rttUs = s.rttUs;
+            strncpy(out.name, lt::HistoryTargetName(*header, *sequence, s.target), sizeof(out.name) - 1);
+            out.name[sizeof(out.name) - 1] = 0;
+        }
+    } collect = {&header, &sequence};
+    for (uint32_t i = 0; i < header.blockCount; ++i) {
+        if (fseek(f, (long)lt::HistoryStore::BlockOffset(i), SEEK_SET) != 0 || fread(block, sizeof(block), 1, f) != 1) break;
+        lt::DecodeHistoryBlock(block, collect, &sequence);
+    }
+    fclose(f);
+}
+
+// Label of the sample recorded at timeMs, nullptr if there is none
+const char* NameAt(int64_t timeMs) {
+    for (uint32_t i = 0; i < g_sampleCount; ++i) {
+        if (g_samples[i].timeMs == timeMs) return g_samples[i].name;
+    }
+    return nullptr;
+}
+
+#define CHECK_NAME_AT(timeMs, name) \
+    do { \
+        const char* found_ = NameAt(timeMs); \
+        CHECK(found_ != nullptr); \
+        if (found_) CHECK_STR(found_, name); \
+    } while (0)
+
+lt::HistorySample Sample(int64_t timeMs, uint32_t target) {
+    lt::HistorySample s = {timeMs, target, 10000 + target, lt::PROBE_OK};
+    return s;
+}
+
+// Samples read back in ring order (ForEach): how many, the first and last time, and whether
+// each is one second after the one before
+struct Timeline {
+    uint64_t count;
+    int64_t firstMs;
+    int64_t lastMs;
+    uint64_t gaps;
+    void operator()(const lt::HistorySample& s) {
+        if (count && s.timeMs != lastMs + 1000) ++gaps;
+        if (!count) firstMs = s.timeMs;
+        lastMs = s.timeMs;
+        ++count;
+    }
+};
+
+Timeline ReadTimeline() {
+    Timeline t = {0, 0, 0, 0};
+    g_store.ForEach(t);
+    return t;
+}
+
+// Overwrite bytes of the (closed) file in place, as a crash or a bad sector would
+void PatchFile(uint64_t offset, const void* bytes, size_t n) {
+    FILE* f = fopen(kPath, "r+b");
+    CHECK(f != nullptr);
+    if (!f) return;
+    CHECK(fseek(f, (long)offset, SEEK_SET) == 0 && fwrite(bytes, 1, n, f) == n);
+    fclose(f);
+}
+
+uint64_t ReadCommit(uint32_t block) {
+    uint64_t commit = 0;
+    FILE* f = fopen(kPath, "rb");
+    CHECK(f != nullptr);
+    if (!f) return 0;
+    CHECK(fseek(f, (long)(lt::HistoryStore::BlockOffset(block) + offsetof(lt::HistoryBlockHeader, commit)), SEEK_SET) == 0 &&
+          fread(&commit, sizeof(commit), 1, f) == 1);
+    fclose(f);
+    return commit;
+}
+
+const char* const kOneTarget[1] = {"192.0.2.1"};
+
+// One sample a second from startMs
+int64_t AppendSeconds(int64_t startMs, uint32_t count) {
+    int64_t t = startMs;
+    for (uint32_t i = 0; i < count; ++i, t += 1000) CHECK(g_store.Append(Sample(t, 0)));
+    return t;
+}
+
+void TestWraparound() {
+    remove(kPath);
+    CHECK(g_store.Open(kPath, 1, kOneTarget, 1, 0));
+    const uint32_t blocks = g_store.BlockCount();
+    CHECK_EQ(blocks, 256);   // 1 MB of 4 KB blocks
+
+    // Fill most of the ring: nothing is lost yet
+    int64_t next = AppendSeconds(1000, 100000);
+    Timeline t = ReadTimeline();
+    CHECK_EQ(t.count, 100000);
+    CHECK_EQ(t.firstMs, 1000);
+    CHECK_EQ(t.gaps, 0);
+    uint64_t perBlock = 100000 / g_store.Stats().blocks;
+
+    // Well past capacity: the oldest blocks are reused, and what is left reads in order up to
+    // the last sample, one block short of the ring (the one being written replaced the oldest)
+    next = AppendSeconds(next, 400000);
+    t = ReadTimeline();
+    CHECK_EQ(t.lastMs, next - 1000);
+    CHECK_EQ(t.gaps, 0);
+    CHECK(t.count >= (blocks - 1) * perBlock && t.count <= blocks * (perBlock + 1));
+    CHECK_EQ(t.firstMs, t.lastMs - (int64_t)(t.count - 1) * 1000);
+
+    // Reopened, it carries on in the block it stopped in
+    g_store.Close();
+    CHECK(g_store.Open(kPath, 1, kOneTarget, 1, 0));
+    CHECK(g_store.Stats().recovered > 0);
+    CHECK_EQ(g_store.Stats().tornBlocks, 0);
+    CHECK_EQ(ReadTimeline().lastMs, next - 1000);
+    next = AppendSeconds(next, 10);
+    CHECK_EQ(g_store.Stats().blocks, 0);
+    t = ReadTimeline();
+    CHECK_EQ(t.lastMs, next - 1000);
+    CHECK_EQ(t.gaps, 0);
+    g_store.Close();
+}
+
+void TestDamagedBlocks() {
+    remove(kPath);
+    CHECK(g_store.Open(kPath, 1, kOneTarget, 1, 0));
+    // Blocks 0..3 full, block 4 in progress
+    int64_t next = 1000;
+    while (g_store.Stats().blocks < 5) next = AppendSeconds(next, 1);
+    next = AppendSeconds(next, 10);
+    const uint64_t written = g_store.Stats().samples;
+    g_store.Close();
+
+    // A flipped bit in block 1's checksum: the block is skipped, the rest still read
+    uint64_t commit = ReadCommit(1);
+    uint32_t lost = (uint32_t)(commit & 0xFFFF);
+    CHECK(lost > 0);
+    commit ^= 1ull << 40;
+    PatchFile(lt::HistoryStore::BlockOffset(1) + offsetof(lt::HistoryBlockHeader, commit), &commit, sizeof(commit));
+    // Block 2's commit word claims one more sample and byte than its checksum covers (an append
+    // torn between its bytes and its commit would instead leave the old word, still valid)
+    uint64_t longer = ReadCommit(2) + (1ull << 16) + 1;
+    PatchFile(lt::HistoryStore::BlockOffset(2) + offsetof(lt::HistoryBlockHeader, commit), &longer, sizeof(longer));
+    uint32_t lost2 = (uint32_t)((longer - 1) & 0xFFFF);
+    // A crash after the bytes of the next append but before its commit: garbage past `used`
+    // in the block being written is ignored
+    uint64_t current = ReadCommit(4);
+    const uint8_t garbage[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x7F};
+    PatchFile(lt::HistoryStore::BlockOffset(4) + sizeof(lt::HistoryBlockHeader) + ((current >> 16) & 0xFFFF), garbage,
+              sizeof(garbage));
+
+    CHECK(g_store.Open(kPath, 1, kOneTarget, 1, 0));
+    CHECK_EQ(g_store.Stats().tornBlocks, 0);
+    CHECK_EQ(g_store.Stats().recovered, current & 0xFFFF);
+    Timeline t = ReadTimeline();
+    CHECK_EQ(t.count, written - lost - lost2);
+    CHECK_EQ(t.gaps, 1);   // where blocks 1 and 2 were
+    CHECK_EQ(t.lastMs, next - 1000);
+    // Appending resumes over the garbage
+    next = AppendSeconds(next, 3);
+    CHECK_EQ(ReadTimeline().count, written - lost - lost2 + 3);
+    g_store.Close();
+
+    // The block being written fails its checksum: reopening starts the next block and keeps
+    // the older ones
+    uint64_t bad = ReadCommit(4) ^ (1ull << 63);
+    PatchFile(lt::HistoryStore::BlockOffset(4) + offsetof(lt::HistoryBlockHeader, commit), &bad, sizeof(bad));
+    CHECK(g_store.Open(kPath, 1, kOneTarget, 1, 0));
+    CHECK_EQ(g_store.Stats().tornBlocks, 1);
+    CHECK_EQ(g_store.Stats().recovered, 0);
+    uint64_t before = ReadTimeline().count;
+    CHECK(before > 0);
+    next = AppendSeconds(next, 5);
+    CHECK_EQ(g_store.Stats().blocks, 1);
+    t = ReadTimeline();
+    CHECK_EQ(t.count, before + 5);
+    CHECK_EQ(t.lastMs, next - 1000);
+    g_store.Close();
+}
+
+void TestReopenAfterSizeOrFormatChange() {
+    remove(kPath);
+    CHECK(g_store.Open(kPath, 1, kOneTarget, 1, 0));
+    AppendSeconds(1000, 5000);
+    g_store.Close();
+
+    // Same size and format: everything is still there
+    CHECK(g_store.Open(kPath, 1, kOneTarget, 1, 0));
+    CHECK_EQ(ReadTimeline().count, 5000);
+    g_store.Close();
+
+    // Another size: the ring is laid out anew, so the file starts over
+    CHECK(g_store.Open(kPath, 2, kOneTarget, 1, 0));
+    CHECK_EQ(g_store.BlockCount(), 512);
+    CHECK_EQ(g_store.Header().blockCount, 512);
+    CHECK_EQ(ReadTimeline().count, 0);
+    AppendSeconds(1000, 5000);
+    g_store.Close();
+    CHECK(g_store.Open(kPath, 2, kOneTarget, 1, 0));
+    CHECK_EQ(ReadTimeline().count, 5000);
+    g_store.Close();
+
+    // Another format version (or a damaged header) starts over too
+    const uint32_t oldVersion = lt::kHistoryVersion - 1;
+    PatchFile(offsetof(lt::HistoryFileHeader, version), &oldVersion, sizeof(oldVersion));
+    CHECK(g_store.Open(kPath, 2, kOneTarget, 1, 0));
+    CHECK_EQ(g_store.Header().version, lt::kHistoryVersion);
+    CHECK_EQ(ReadTimeline().count, 0);
+    AppendSeconds(1000, 10);
+    g_store.Close();
+    const char notMagic = 'X';
+    PatchFile(0, &notMagic, 1);
+    CHECK(g_store.Open(kPath, 2, kOneTarget, 1, 0));
+    CHECK_EQ(ReadTimeline().count, 0);
+    CHECK(lt::HistoryStore::HeaderValid(g_store.Header()));
+    g_store.Close();
+}
+
+void TestRelabelKeepsRecordedLabels() {
+    remove(kPath);
+    const char* const first[2] = {"192.0.2.1", "gateway"};
+    CHECK(g_store.Open(kPath, 1, first, 2, 0));
+    CHECK(g_store.Append(Sample(1000, 0)));
+    CHECK(g_store.Append(Sample(2000, 1)));
+
+    // A reload puts another target in slot 0
+    const char* const second[2] = {"192.0.2.9:443", "gateway"};
+    CHECK(g_store.Relabel(second, 2));
+    CHECK(g_store.Append(Sample(3000, 0)));
+    CHECK(g_store.Append(Sample(4000, 1)));
+    CHECK_EQ(g_store.Header().labelCount, 2);
+    Scan(g_store.Header());
+    CHECK_NAME_AT(1000, "192.0.2.1");
+    CHECK_NAME_AT(2000, "gateway");
+    CHECK_NAME_AT(3000, "192.0.2.9:443");
+    CHECK_NAME_AT(4000, "gateway");
+
+    // The same labels again add nothing, on a relabel or a restart
+    CHECK(g_store.Relabel(second, 2));
+    g_store.Close();
+    CHECK(g_store.Open(kPath, 1, second, 2, 0));
+    CHECK_EQ(g_store.Header().labelCount, 2);
+    CHECK(g_store.Append(Sample(5000, 0)));
+
+    // A restart with another target list
+    const char* const third[1] = {"2001:db8::1"};
+    g_store.Close();
+    CHECK(g_store.Open(kPath, 1, third, 1, 0));
+    CHECK_EQ(g_store.Header().labelCount, 3);
+    CHECK(g_store.Append(Sample(6000, 0)));
+
+    // Labels nothing was recorded under are replaced, not kept
+    const char* const fourth[1] = {"198.51.100.1"};
+    const char* const fifth[1] = {"198.51.100.2"};
+    CHECK(g_store.Relabel(fourth, 1));
+    CHECK(g_store.Relabel(fifth, 1));
+    CHECK_EQ(g_store.Header().labelCount, 4);
+    CHECK(g_store.Append(Sample(7000, 0)));
+
+    Scan(g_store.Header());
+    CHECK_EQ(g_sampleCount, 7);
+    CHECK_NAME_AT(1000, "192.0.2.1");
+    CHECK_NAME_AT(3000, "192.0.2.9:443");
+    CHECK_NAME_AT(5000, "192.0.2.9:443");
+    CHECK_NAME_AT(6000, "2001:db8::1");
+    CHECK_NAME_AT(7000, "198.51.100.2");
+    g_store.Close();
+}
+
+void TestLabelSetsArePruned() {
+    remove(kPath);
+    const char* const start[1] = {"start"};
+    CHECK(g_store.Open(kPath, 1, start, 1, 0));
+    char label[16];
+    const char* names[1] = {label};
+    // More relabels than the header keeps: the oldest sets go and their blocks read unlabelled
+    for (uint32_t k = 0; k < 40; ++k) {
+        snprintf(label, sizeof(label), "n%u", k);
+        CHECK(g_store.Relabel(names, 1));
+        CHECK(g_store.Append(Sample(1000 * (k + 1), 0)));
+    }
+    CHECK_EQ(g_store.Header().labelCount, lt::kHistoryMaxLabelSets);
+    Scan(g_store.Header());
+    CHECK_NAME_AT(1000, "");      // n0
+    CHECK_NAME_AT(8000, "");      // n7
+    CHECK_NAME_AT(9000, "n8");
+    CHECK_NAME_AT(40000, "n39");
+
+    // Once the ring has wrapped, only the set the blocks on disk use is kept
+    int64_t t = 100000;
+    for (uint32_t i = 0; i < 2 * g_store.BlockCount() * 1000; ++i) CHECK(g_store.Append(Sample(t += 1000, 0)));
+    const char* const last[1] = {"last"};
+    CHECK(g_store.Relabel(last, 1));
+    CHECK_EQ(g_store.Header().labelCount, 2);
+    CHECK_STR(g_store.Header().labels[0].names[0], "n39");
+    CHECK_STR(g_store.Header().labels[1].names[0], "last");
+    g_store.Close();
+}
+
+void TestRecorderRelabelsInOrder() {
+    remove(kPath);
+    const char* const before[1] = {"before"};
+    const char* const after[1] = {"after"};
+    const char* const late[1] = {"late"};
+    CHECK(g_recorder.Open(kPath, 1, before, 1, 0));
+    g_recorder.Offer(Sample(1000, 0));
+    g_recorder.Relabel(after, 1);
+    g_recorder.Offer(Sample(2000, 0));
+    CHECK_EQ(g_recorder.Drain(0), 2);
+    Scan(g_recorder.Store().Header());
+    CHECK_NAME_AT(1000, "before");
+    CHECK_NAME_AT(2000, "after");
+
+    // The writer falls behind: the relabel waits for room, and samples offered meanwhile are
+    // dropped rather than recorded under the old labels
+    for (int i = 0; i < 20; ++i) g_recorder.Offer(Sample(3000 + i, 0));
+    uint64_t dropped = g_recorder.Dropped();
+    CHECK_EQ(dropped, 4);
+    g_recorder.Relabel(late, 1);
+    g_recorder.Offer(Sample(9000, 0));
+    CHECK_EQ(g_recorder.Dropped(), dropped + 1);
+    CHECK_EQ(g_recorder.Drain(0), 16);
+    g_recorder.Offer(Sample(10000, 0));
+    CHECK_EQ(g_recorder.Drain(0), 1);
+    Scan(g_recorder.Store().Header());
+    CHECK_NAME_AT(3015, "after");
+    CHECK(NameAt(9000) == nullptr);
+    CHECK_NAME_AT(10000, "late");
+    g_recorder.Close(0);
+    remove(kPath);
+}
+
+} // namespace
+
+int main() {
+    TestRelabelKeepsRecordedLabels();
+    TestLabelSetsArePruned();
+    TestRecorderRelabelsInOrder();
+    TestWraparound();
+    TestDamagedBlocks();
+    TestReopenAfterSizeOrFormatChange();
+    remove(kPath);
+    return lt_test::TestResult("history_store_test");
+}
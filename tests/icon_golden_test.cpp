@@ -0,0 +1,134 @@
+// tests/icon_golden_test.cpp
+// Icons composed from the built-in stroke font (GlyphAtlas::BuildBuiltin) at every icon size,
+// compared byte for byte with the images checked in under tests/golden. Each golden is a PAM
+// (P7, RGB_ALPHA, straight alpha) with the cases below stacked top to bottom; every kernel set
+// the CPU runs must produce it. A mismatch writes icon_<size>.actual.pam to the working
+// directory for a look with any image viewer. The rasterizer is plain float arithmetic, so
+// the goldens hold for builds with IEEE single precision and no -ffast-math.
+//
+//    icon_golden_test [<golden dir>] [--update]    (--update rewrites the goldens)
+
+#include <stdio.h>
+#include <string.h>
+#include "core/argb_kernels.h"
+#include "core/glyph_atlas.h"
+#include "core/icon_compositor.h"
+#include "check.h"
+
+#ifndef LT_GOLDEN_DIR
+#define LT_GOLDEN_DIR "tests/golden"
+#endif
+
+namespace {
+
+struct IconCase {
+    const char* text;
+    uint32_t fg;
+    uint32_t bg;
+    uint32_t tint;
+};
+
+// The trimmed build's opaque icon, the v1.0 tray's tinted transparent icon, a half-strength
+// tint (straight alpha on the way out), and text that only fits condensed or clipped
+const IconCase kCases[] = {
+    {"42", 0xFFFFFF, 0xFF000000u, 0},
+    {"188", 0xFFFFFF, 0, 0xFF2E7D32u},
+    {"999", 0xFFFFFF, 0, 0x80C62828u},
+    {"1234", 0x000000, 0xFFF9A825u, 0},
+    {"<1", 0xFFFFFF, 0x40000000u, 0},
+};
+const uint32_t kCaseCount = sizeof(kCases) / sizeof(kCases[0]);
+const uint32_t kSizes[] = {16, 20, 24, 32, 48, 64};
+
+lt::GlyphAtlas<64> g_atlas;
+lt::IconCompositor<64> g_compositor;
+uint8_t g_image[64 * 64 * 4 * kCaseCount];
+uint8_t g_golden[sizeof(g_image) + 128];
+
+// RGBA bytes of every case stacked, with the given kernels; the length in bytes
+size_t Render(const lt::ArgbKernels& kernels, uint32_t size) {
+    g_compositor.SetKernels(kernels);
+    uint8_t* out = g_image;
+    for (const IconCase& c : kCases) {
+        const uint32_t* pixels = g_compositor.Compose(g_atlas, c.text, c.fg, c.bg, c.tint);
+        CHECK(pixels != nullptr);
+        if (!pixels) return 0;
+        for (uint32_t i = 0; i < size * size; ++i) {
+            *out++ = (uint8_t)(pixels[i] >> 16);
+            *out++ = (uint8_t)(pixels[i] >> 8);
+            *out++ = (uint8_t)pixels[i];
+            *out++ = (uint8_t)(pixels[i] >> 24);
+        }
+    }
+    return (size_t)(out - g_image);
+}
+
+int Header(char* out, size_t space, uint32_t size) {
+    return snprintf(out, space, "P7\nWIDTH %u\nHEIGHT %u\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n",
+                    size, size * kCaseCount);
+}
+
+bool WriteImage(const char* path, uint32_t size, size_t length) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    char header[128];
+    int n = Header(header, sizeof(header), size);
+    bool ok = fwrite(header, 1, (size_t)n, f) == (size_t)n && fwrite(g_image, 1, length, f) == length;
+    return fclose(f) == 0 && ok;
+}
+
+// The whole file, header included; 0 if it cannot be read
+size_t ReadGolden(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    size_t n = fread(g_golden, 1, sizeof(g_golden), f);
+    fclose(f);
+    return n;
+}
+
+void TestSize(const char* dir, uint32_t size, bool update) {
+    CHECK(g_atlas.BuildBuiltin(size));
+    const lt::ArgbKernels* scalar = lt::ArgbKernelsFor(lt::ARGB_SCALAR);
+    size_t length = Render(*scalar, size);
+    char path[512];
+    snprintf(path, sizeof(path), "%s/icon_%u.pam", dir, size);
+    if (update) {
+        CHECK(WriteImage(path, size, length));
+        printf("icon_golden_test: wrote %s\n", path);
+        return;
+    }
+
+    char header[128];
+    size_t headerLength = (size_t)Header(header, sizeof(header), size);
+    size_t goldenLength = ReadGolden(path);
+    if (!goldenLength) fprintf(stderr, "icon_golden_test: cannot read %s\n", path);
+    CHECK_EQ(goldenLength, headerLength + length);
+    for (uint32_t isa = lt::ARGB_SCALAR; isa <= lt::ARGB_AVX2; ++isa) {
+        const lt::ArgbKernels* kernels = lt::ArgbKernelsFor((lt::ArgbIsa)isa);
+        if (!kernels) continue;
+        length = Render(*kernels, size);
+        bool same = goldenLength == headerLength + length && memcmp(g_golden, header, headerLength) == 0 &&
+                    memcmp(g_golden + headerLength, g_image, length) == 0;
+        if (!same) {
+            char actual[64];
+            snprintf(actual, sizeof(actual), "icon_%u.actual.pam", size);
+            WriteImage(actual, size, length);
+            fprintf(stderr, "icon_golden_test: %u px with %s kernels differs from %s, see %s\n", size,
+                    kernels->name, path, actual);
+        }
+        CHECK(same);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* dir = LT_GOLDEN_DIR;
+    bool update = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--update")) update = true;
+        else dir = argv[i];
+    }
+    for (uint32_t size : kSizes) TestSize(dir, size, update);
+    return lt_test::TestResult("icon_golden_test");
+}
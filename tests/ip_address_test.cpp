@@ -0,0 +1,148 @@
+// tests/ip_address_test.cpp
+// ParseIpAddress and IpLiteral at compile time: every case below is a static_assert, so a
+// parser regression fails the build of this test before it runs. Valid dotted quads, full and
+// "::"-compressed IPv6, embedded IPv4 tails and zones parse to the expected bytes; malformed
+// literals parse to IP_NONE. That IpLiteral refuses to compile them is checked by CMake building
+// tests/ip_literal_malformed.cpp, which must fail. At run time, FormatIpAddress prints what the
+// parser read back in RFC 5952 form.
+
+#include "core/ip_address.h"
+#include "check.h"
+
+namespace {
+
+using lt::IpAddress;
+using lt::ParseIpAddress;
+
+constexpr bool V4(const IpAddress& a, uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3) {
+    if (a.family != lt::IP_V4 || a.scope) return false;
+    if (a.bytes[0] != b0 || a.bytes[1] != b1 || a.bytes[2] != b2 || a.bytes[3] != b3) return false;
+    for (int i = 4; i < 16; ++i) {
+        if (a.bytes[i]) return false;
+    }
+    return true;
+}
+
+constexpr bool V6(const IpAddress& a, uint16_t g0, uint16_t g1, uint16_t g2, uint16_t g3, uint16_t g4,
+                  uint16_t g5, uint16_t g6, uint16_t g7, uint32_t scope = 0) {
+    const uint16_t g[8] = {g0, g1, g2, g3, g4, g5, g6, g7};
+    if (a.family != lt::IP_V6 || a.scope != scope) return false;
+    for (int i = 0; i < 8; ++i) {
+        if (a.bytes[2 * i] != (uint8_t)(g[i] >> 8) || a.bytes[2 * i + 1] != (uint8_t)g[i]) return false;
+    }
+    return true;
+}
+
+constexpr bool Rejected(const char* text) { return !ParseIpAddress(text).Valid(); }
+
+// Dotted quads
+static_assert(V4(ParseIpAddress("1.1.1.1"), 1, 1, 1, 1), "");
+static_assert(V4(ParseIpAddress("0.0.0.0"), 0, 0, 0, 0), "");
+static_assert(V4(ParseIpAddress("255.255.255.255"), 255, 255, 255, 255), "");
+static_assert(V4(ParseIpAddress("192.0.2.10"), 192, 0, 2, 10), "");
+static_assert(!ParseIpAddress("10.0.0.1").IsIPv6(), "");
+
+// Full IPv6, either case
+static_assert(V6(ParseIpAddress("2001:db8:0:0:0:0:0:1"), 0x2001, 0xdb8, 0, 0, 0, 0, 0, 1), "");
+static_assert(V6(ParseIpAddress("2606:4700:4700:0000:0000:0000:0000:1111"), 0x2606, 0x4700, 0x4700, 0, 0, 0, 0, 0x1111), "");
+static_assert(V6(ParseIpAddress("FFFF:ABCD:ef01:2345:6789:aBcD:EF01:0"), 0xffff, 0xabcd, 0xef01, 0x2345, 0x6789, 0xabcd, 0xef01, 0), "");
+static_assert(ParseIpAddress("::1").IsIPv6(), "");
+
+// "::" at the start, in the middle and at the end, for one group or all of them
+static_assert(V6(ParseIpAddress("::"), 0, 0, 0, 0, 0, 0, 0, 0), "");
+static_assert(V6(ParseIpAddress("::1"), 0, 0, 0, 0, 0, 0, 0, 1), "");
+static_assert(V6(ParseIpAddress("fe80::"), 0xfe80, 0, 0, 0, 0, 0, 0, 0), "");
+static_assert(V6(ParseIpAddress("2606:4700:4700::1111"), 0x2606, 0x4700, 0x4700, 0, 0, 0, 0, 0x1111), "");
+static_assert(V6(ParseIpAddress("1:2:3:4:5:6:7::"), 1, 2, 3, 4, 5, 6, 7, 0), "");
+static_assert(V6(ParseIpAddress("::2:3:4:5:6:7:8"), 0, 2, 3, 4, 5, 6, 7, 8), "");
+static_assert(V6(ParseIpAddress("1:2:3::6:7:8"), 1, 2, 3, 0, 0, 6, 7, 8), "");
+
+// Embedded IPv4 tails: mapped, compatible, after a full head, and after "::" with groups
+static_assert(V6(ParseIpAddress("::ffff:192.0.2.1"), 0, 0, 0, 0, 0, 0xffff, 0xc000, 0x0201), "");
+static_assert(V6(ParseIpAddress("::10.0.0.1"), 0, 0, 0, 0, 0, 0, 0x0a00, 0x0001), "");
+static_assert(V6(ParseIpAddress("64:ff9b:0:0:0:0:1.2.3.4"), 0x64, 0xff9b, 0, 0, 0, 0, 0x0102, 0x0304), "");
+static_assert(V6(ParseIpAddress("64:ff9b::255.255.255.255"), 0x64, 0xff9b, 0, 0, 0, 0, 0xffff, 0xffff), "");
+static_assert(V6(ParseIpAddress("1:2:3:4:5::6.7.8.9"), 1, 2, 3, 4, 5, 0, 0x0607, 0x0809), "");
+
+// Zones: a numeric interface index after '%'
+static_assert(V6(ParseIpAddress("fe80::1%12"), 0xfe80, 0, 0, 0, 0, 0, 0, 1, 12), "");
+static_assert(V6(ParseIpAddress("fe80::%1"), 0xfe80, 0, 0, 0, 0, 0, 0, 0, 1), "");
+static_assert(V6(ParseIpAddress("::ffff:1.2.3.4%999999999"), 0, 0, 0, 0, 0, 0xffff, 0x0102, 0x0304, 999999999), "");
+
+// IpLiteral is ParseIpAddress for tables
+constexpr IpAddress kLiteral = lt::IpLiteral("2001:db8::53");
+static_assert(V6(kLiteral, 0x2001, 0xdb8, 0, 0, 0, 0, 0, 0x53), "");
+static_assert(V4(lt::IpLiteral("9.9.9.9"), 9, 9, 9, 9), "");
+
+// Malformed dotted quads
+static_assert(Rejected(nullptr), "");
+static_assert(Rejected(""), "");
+static_assert(Rejected("1.2.3"), "");
+static_assert(Rejected("1.2.3.4.5"), "");
+static_assert(Rejected("256.0.0.1"), "");
+static_assert(Rejected("1.2.3.1000"), "");
+static_assert(Rejected("01.2.3.4"), "");        // leading zero: octal to some parsers
+static_assert(Rejected("1.2.3.4 "), "");
+static_assert(Rejected(" 1.2.3.4"), "");
+static_assert(Rejected("1..2.3"), "");
+static_assert(Rejected("1.2.3."), "");
+static_assert(Rejected("a.b.c.d"), "");
+static_assert(Rejected("1.2.3.4%1"), "");       // zones are IPv6 only
+static_assert(Rejected("gateway"), "");
+
+// Malformed IPv6
+static_assert(Rejected(":"), "");
+static_assert(Rejected(":::"), "");
+static_assert(Rejected(":1::2"), "");
+static_assert(Rejected("1::2:"), "");
+static_assert(Rejected("1::2::3"), "");         // "::" twice
+static_assert(Rejected("1:2:3:4:5:6:7"), "");   // seven groups, no "::"
+static_assert(Rejected("1:2:3:4:5:6:7:8:9"), "");
+static_assert(Rejected("1:2:3:4:5:6:7:8::"), "");   // "::" standing for no group
+static_assert(Rejected("::1:2:3:4:5:6:7:8"), "");
+static_assert(Rejected("12345::1"), "");        // five hex digits
+static_assert(Rejected("2001:db8::g"), "");
+static_assert(Rejected("2001:db8:::1"), "");
+
+// Malformed embedded IPv4 tails
+static_assert(Rejected("::ffff:1.2.3"), "");
+static_assert(Rejected("::ffff:1.2.3.256"), "");
+static_assert(Rejected("::1.2.3.4:5"), "");     // the tail must be last
+static_assert(Rejected("1:2:3:4:5:6:7:1.2.3.4"), "");   // nine groups' worth
+static_assert(Rejected("1:2:3:4:5:6:7::1.2.3.4"), "");
+
+// Malformed zones
+static_assert(Rejected("fe80::1%"), "");
+static_assert(Rejected("fe80::1%0"), "");
+static_assert(Rejected("fe80::1%eth0"), "");    // names only through ResolveIpAddress
+static_assert(Rejected("fe80::1%1234567890"), "");
+static_assert(Rejected("fe80::1%12x"), "");
+static_assert(Rejected("fe80:%1"), "");
+
+void CheckFormat(const char* text, const char* expected) {
+    char out[lt::kIpAddressTextSize];
+    CHECK(lt::FormatIpAddress(ParseIpAddress(text), out, sizeof(out)));
+    CHECK_STR(out, expected);
+}
+
+// Read back: the canonical form of what was parsed
+void TestFormat() {
+    CheckFormat("192.0.2.10", "192.0.2.10");
+    CheckFormat("2001:DB8:0:0:0:0:0:1", "2001:db8::1");
+    CheckFormat("2606:4700:4700:0000:0000:0000:0000:1111", "2606:4700:4700::1111");
+    CheckFormat("::", "::");
+    CheckFormat("1:0:0:2:0:0:0:3", "1:0:0:2::3");   // the longer run of zeros
+    CheckFormat("1:0:2:3:4:5:6:7", "1:0:2:3:4:5:6:7");   // one zero group is not shortened
+    CheckFormat("::ffff:192.0.2.1", "::ffff:c000:201");
+    CheckFormat("fe80::1%12", "fe80::1%12");
+    char out[8];
+    CHECK(!lt::FormatIpAddress(ParseIpAddress("2001:db8::1"), out, sizeof(out)));   // too small
+    CHECK(!lt::FormatIpAddress(ParseIpAddress("bad"), out, sizeof(out)));
+}
+
+} // namespace
+
+int main() {
+    TestFormat();
+    return lt_test::TestResult("ip_address_test");
+}
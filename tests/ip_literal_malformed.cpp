@@ -0,0 +1,13 @@
+// tests/ip_literal_malformed.cpp
+// IpLiteral in a constant expression with the address CMake passes as LT_IP_LITERAL. With a
+// malformed address this must not compile: CMake builds it once per address, expecting the
+// build to fail for the malformed ones and to succeed for a valid one (so that a failure is
+// known to come from IpLiteral and not from this file).
+
+#include "core/ip_address.h"
+
+constexpr lt::IpAddress kAddress = lt::IpLiteral(LT_IP_LITERAL);
+
+int main() {
+    return kAddress.Valid() ? 0 : 1;
+}
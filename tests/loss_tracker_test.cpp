@@ -0,0 +1,207 @@
+// tests/loss_tracker_test.cpp
+// LossTracker on a hand-made outcome sequence (burst buckets, windows, late, duplicate and
+// reordered replies), then a seeded lossy simulator run through ProbeEngine: every result the
+// backend hands the engine is logged, and the tracker's loss, burst, window and late-reply
+// counts must equal what a plain per-probe recount of that log gives.
+
+#include <string.h>
+#include "core/loss_tracker.h"
+#include "core/probe_engine.h"
+#include "core/sim_backend.h"
+#include "check.h"
+
+namespace {
+
+lt::LossTracker g_tracker;
+
+// Record `lost` losses after `ok` replies, from seq
+uint32_t RecordRun(uint32_t seq, uint32_t ok, uint32_t lost) {
+    for (uint32_t i = 0; i < ok; ++i) g_tracker.Record(seq++, false);
+    for (uint32_t i = 0; i < lost; ++i) g_tracker.Record(seq++, true);
+    return seq;
+}
+
+void TestBurstsAndWindows() {
+    g_tracker.Reset();
+    // Bursts of 1, 2, 3, 4, 5, 8, 9, 70, each after two replies
+    const uint32_t bursts[] = {1, 2, 3, 4, 5, 8, 9, 70};
+    uint32_t seq = 1;
+    for (uint32_t length : bursts) seq = RecordRun(seq, 2, length);
+    CHECK_EQ(g_tracker.CurrentBurst(), 70);   // not finished yet
+    CHECK_EQ(g_tracker.Bursts(7), 0);
+    seq = RecordRun(seq, 1, 0);
+    CHECK_EQ(g_tracker.CurrentBurst(), 0);
+    CHECK_EQ(g_tracker.Probes(), 2 * 8 + 102 + 1);
+    CHECK_EQ(g_tracker.Lost(), 102);
+    CHECK_EQ(g_tracker.MaxBurst(), 70);
+    // 1 | 2 | 3-4 | 5-8 | 9-16 | 17-32 | 33-64 | 65+
+    const uint32_t buckets[lt::kLossBurstBuckets] = {1, 1, 2, 2, 1, 0, 0, 1};
+    for (uint32_t b = 0; b < lt::kLossBurstBuckets; ++b) CHECK_EQ(g_tracker.Bursts(b), buckets[b]);
+    CHECK_EQ(g_tracker.Outages(), 4);
+    // The last 60 probes: 59 of the 70 lost and the reply after them
+    CHECK_EQ(g_tracker.ShortWindowProbes(), 60);
+    CHECK_EQ(g_tracker.ShortWindowLost(), 59);
+    CHECK_EQ(g_tracker.ShortLossBp(), 9833);
+    CHECK_EQ(g_tracker.LongWindowProbes(), 119);
+    CHECK_EQ(g_tracker.LongWindowLost(), 102);
+    CHECK_EQ(g_tracker.LifetimeLossBp(), 8571);
+
+    // 900 replies push every loss out of both windows but not out of the lifetime count
+    seq = RecordRun(seq, 900, 0);
+    CHECK_EQ(g_tracker.LongWindowProbes(), 900);
+    CHECK_EQ(g_tracker.LongWindowLost(), 0);
+    CHECK_EQ(g_tracker.ShortLossBp(), 0);
+    CHECK_EQ(g_tracker.Lost(), 102);
+
+    // Late replies: to a timed-out probe (late), again (duplicate), to an answered probe
+    // (duplicate), to a probe older than the newest answer (reordered), and too old to tell
+    seq = RecordRun(seq, 0, 2);       // seq - 2 and seq - 1 time out
+    seq = RecordRun(seq, 1, 0);       // seq - 1 answered
+    g_tracker.RecordLate(seq - 2);    // the second timeout's reply: a later probe was answered
+    g_tracker.RecordLate(seq - 2);
+    g_tracker.RecordLate(seq - 1);
+    g_tracker.RecordLate(seq - 200);
+    CHECK_EQ(g_tracker.LateReplies(), 2);
+    CHECK_EQ(g_tracker.Duplicates(), 2);
+    CHECK_EQ(g_tracker.Reordered(), 1);
+    CHECK_EQ(g_tracker.Lost(), 104);   // a late reply does not undo the loss
+}
+
+// Forwards to the simulator and logs every result it hands the engine, in order
+struct LoggedResult {
+    uint32_t seq;
+    uint8_t status;
+    bool ok;
+};
+
+const uint32_t kLogCapacity = 40000;
+LoggedResult g_log[kLogCapacity];
+uint32_t g_logCount = 0;
+
+class LoggingBackend : public lt::ProbeBackend {
+public:
+    explicit LoggingBackend(lt::SimulatedBackend<1>* sim) : m_sim(sim) {}
+    bool SetTarget(uint32_t target, const char* ip, bool isIPv6) override { return m_sim->SetTarget(target, ip, isIPv6); }
+    bool Send(uint32_t target, uint32_t seq, uint32_t timeoutMs) override { return m_sim->Send(target, seq, timeoutMs); }
+    int Poll(lt::ProbeResult* out, int maxResults, uint32_t waitMs) override {
+        int n = m_sim->Poll(out, maxResults, waitMs);
+        for (int k = 0; k < n && g_logCount < kLogCapacity; ++k) {
+            LoggedResult r = {out[k].seq, out[k].status, out[k].status == lt::PROBE_OK && out[k].rttUs != lt::kNoReply};
+            g_log[g_logCount++] = r;
+        }
+        return n;
+    }
+    uint64_t NowMs() override { return m_sim->NowMs(); }
+
+private:
+    lt::SimulatedBackend<1>* m_sim;
+};
+
+lt::SimulatedBackend<1> g_sim(2024);
+LoggingBackend g_logging(&g_sim);
+lt::ProbeEngine<1> g_engine;
+
+// The recount: outcome per sequence number, bursts as runs, windows as sums over the tail
+struct Recount {
+    uint8_t outcome[kLogCapacity];   // by seq: 0 none, 1 answered, 2 lost
+    uint8_t lostAt[kLogCapacity];    // by completion order
+    uint64_t probes, lost;
+    uint32_t run, maxRun, bursts[lt::kLossBurstBuckets];
+    uint32_t late, duplicates, reordered;
+    uint32_t lastSeq;
+};
+
+Recount g_recount;
+
+uint32_t BucketOf(uint32_t length) {
+    uint32_t b = 0;
+    while ((1u << b) < length && b < lt::kLossBurstBuckets - 1) ++b;
+    return b;
+}
+
+void RecountLog() {
+    Recount& r = g_recount;
+    memset(&r, 0, sizeof(r));
+    for (uint32_t i = 0; i < g_logCount; ++i) {
+        const LoggedResult& e = g_log[i];
+        if (e.status == lt::PROBE_LATE) {
+            uint32_t age = r.lastSeq - e.seq;
+            if (age >= 64) {
+                if (age < r.probes) ++r.late;
+            } else if (r.outcome[e.seq] == 1) {
+                ++r.duplicates;
+            } else if (r.outcome[e.seq] == 2) {
+                ++r.late;
+                for (uint32_t s = e.seq + 1; s <= r.lastSeq; ++s) {
+                    if (r.outcome[s] == 1) {
+                        ++r.reordered;
+                        break;
+                    }
+                }
+                r.outcome[e.seq] = 1;
+            }
+            continue;
+        }
+        r.outcome[e.seq] = e.ok ? 1 : 2;
+        r.lostAt[r.probes++] = !e.ok;
+        r.lastSeq = e.seq;
+        if (!e.ok) {
+            ++r.lost;
+            if (++r.run > r.maxRun) r.maxRun = r.run;
+        } else if (r.run) {
+            ++r.bursts[BucketOf(r.run)];
+            r.run = 0;
+        }
+    }
+}
+
+uint32_t LostInLast(uint32_t probes) {
+    uint32_t n = 0;
+    for (uint64_t i = g_recount.probes > probes ? g_recount.probes - probes : 0; i < g_recount.probes; ++i) n += g_recount.lostAt[i];
+    return n;
+}
+
+void TestSeededLossyRun() {
+    // 40 ms, 4% loss that continues with 60% (Gilbert-Elliott bursts, mean length 2.5), 30% of
+    // lost echoes answered late, 2% duplicated, 2% overtaken by the next reply
+    const lt::SimProfile lossy = {40, 10, 40, 600, 300, 20, 20, lt::SIM_UNIFORM};
+    g_sim.SetProfile(0, lossy);
+    g_engine.Init(&g_logging, 1, 1000, 1000, 64);
+    CHECK(g_engine.SetTarget(0, "192.0.2.1", false));
+    lt::ProbeResult out[4];
+    while (g_sim.NowMs() < 30000 * 1000ull) g_engine.Run(1000, out, 4);
+    CHECK(g_logCount < kLogCapacity);
+    RecountLog();
+
+    const lt::LossTracker& loss = g_engine.State(0).loss;
+    CHECK_EQ(loss.Probes(), g_recount.probes);
+    CHECK_EQ(loss.Lost(), g_recount.lost);
+    CHECK_EQ(g_engine.State(0).completed, g_recount.probes);
+    CHECK_EQ(g_engine.State(0).received, g_recount.probes - g_recount.lost);
+    CHECK_EQ(loss.CurrentBurst(), g_recount.run);
+    CHECK_EQ(loss.MaxBurst(), g_recount.maxRun);
+    for (uint32_t b = 0; b < lt::kLossBurstBuckets; ++b) CHECK_EQ(loss.Bursts(b), g_recount.bursts[b]);
+    CHECK_EQ(loss.ShortWindowLost(), LostInLast(lt::kLossShortWindow));
+    CHECK_EQ(loss.LongWindowLost(), LostInLast(lt::kLossLongWindow));
+    CHECK_EQ(loss.LateReplies(), g_recount.late);
+    CHECK_EQ(loss.Duplicates(), g_recount.duplicates);
+    CHECK_EQ(loss.Reordered(), g_recount.reordered);
+
+    // The run is long enough to exercise every path, and looks like the profile: ~9% lost
+    // to the bursty loss plus ~2% to reordering, in bursts of 2.5 on average
+    CHECK(g_recount.probes >= 29900);
+    CHECK(loss.LifetimeLossBp() >= 900 && loss.LifetimeLossBp() <= 1400);
+    uint32_t bursts = 0;
+    for (uint32_t b = 0; b < lt::kLossBurstBuckets; ++b) bursts += g_recount.bursts[b];
+    CHECK(bursts > 0 && g_recount.lost * 10 >= bursts * 18ull && g_recount.lost * 10 <= bursts * 30ull);
+    CHECK(loss.Outages() > 0);
+    CHECK(g_recount.late > 0 && g_recount.duplicates > 0 && g_recount.reordered > 0);
+}
+
+} // namespace
+
+int main() {
+    TestBurstsAndWindows();
+    TestSeededLossyRun();
+    return lt_test::TestResult("loss_tracker_test");
+}
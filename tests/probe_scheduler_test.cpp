@@ -0,0 +1,201 @@
+// tests/probe_scheduler_test.cpp
+// ProbeScheduler on a fake clock: the scheduler takes the time as an argument, so the tests
+// pass a counter for the deadline grid, the adaptive interval and the probe budget, and the
+// simulator's virtual time (SimulatedBackend::NowMs) for the engine run on top of it.
+
+#include "core/probe_engine.h"
+#include "core/probe_scheduler.h"
+#include "core/sim_backend.h"
+#include "check.h"
+
+namespace {
+
+lt::ProbeScheduler<4> g_scheduler;
+lt::SimulatedBackend<2> g_sim(11);
+lt::ProbeEngine<2> g_engine;
+
+// Deadlines stay on the grid of the first one however late a tick fires; a stall skips the
+// ticks it missed instead of firing them back to back
+void TestAbsoluteDeadlines() {
+    g_scheduler.Configure(lt::FixedCadence(1000), 1);
+    g_scheduler.Start(0, 500);
+    CHECK(!g_scheduler.Fire(0, 499));
+    CHECK(g_scheduler.Fire(0, 500));
+    CHECK_EQ(g_scheduler.DueMs(0), 1500);
+    CHECK(g_scheduler.Fire(0, 1630));   // 130 ms late (a slow render, a long RTT)
+    CHECK_EQ(g_scheduler.DueMs(0), 2500);
+    CHECK(g_scheduler.Fire(0, 2501));
+    CHECK_EQ(g_scheduler.DueMs(0), 3500);
+
+    // Stalled until 6000: 3500 fires late, 4500 and 5500 are skipped
+    CHECK(g_scheduler.Fire(0, 6000));
+    CHECK_EQ(g_scheduler.DueMs(0), 6500);
+    CHECK(!g_scheduler.Fire(0, 6499));
+    const lt::SchedulerStats& stats = g_scheduler.Stats();
+    CHECK_EQ(stats.ticks, 4);
+    CHECK_EQ(stats.skippedTicks, 2);
+    CHECK_EQ(stats.maxLateMs, 2500);
+    CHECK_EQ(stats.deferred, 0);
+
+    // An hour of ticks, each fired 0..999 ms late, ends exactly where the grid says
+    uint64_t now = 6500;
+    for (uint32_t i = 0; i < 3600; ++i) {
+        now = g_scheduler.DueMs(0) + (i * 7919) % 1000;
+        CHECK(g_scheduler.Fire(0, now));
+    }
+    CHECK_EQ(g_scheduler.DueMs(0), 6500 + 3600 * 1000);
+    CHECK_EQ(g_scheduler.Stats().skippedTicks, 2);
+}
+
+struct Probe {
+    uint8_t status;
+    uint32_t rttUs;
+};
+
+// Fire slot 0 on its deadline and feed the result back; returns the interval it was fired on
+uint64_t g_now = 0;
+uint32_t Step(Probe p) {
+    g_now = g_scheduler.DueMs(0);
+    uint64_t firedDue = g_now;
+    CHECK(g_scheduler.Fire(0, g_now));
+    uint64_t interval = g_scheduler.DueMs(0) - firedDue;
+    g_scheduler.OnResult(0, p.status, p.rttUs, g_now + p.rttUs / 1000);
+    return (uint32_t)interval;
+}
+
+void TestAdaptiveCadence() {
+    // 1 s base: 250 ms for 8 probes after a change, doubling after 10 unchanged replies up to 4 s
+    g_scheduler.Configure(lt::AdaptiveCadence(1000, 0), 1);
+    g_scheduler.Start(0, 0);
+    const Probe steady = {lt::PROBE_OK, 20000};
+    struct Expect {
+        uint32_t probes;
+        uint32_t intervalMs;   // what each of them is fired on
+    };
+    const Expect backoff[] = {{10, 1000}, {10, 2000}, {20, 4000}};
+    for (const Expect& e : backoff) {
+        for (uint32_t k = 0; k < e.probes; ++k) CHECK_EQ(Step(steady), e.intervalMs);
+    }
+
+    // The RTT triples: fast probes until the average has caught up and 8 more after that
+    const Probe slower = {lt::PROBE_OK, 60000};
+    Step(slower);
+    uint64_t changedAt = g_now;
+    CHECK_EQ(g_scheduler.IntervalMs(0), 250);
+    CHECK_EQ(g_scheduler.DueMs(0), changedAt + 250);   // from the deadline fired, not from 4 s
+    uint32_t fast = 0;
+    while (fast < 100 && Step(slower) == 250) ++fast;
+    CHECK(fast >= 8 && fast <= 20);
+    CHECK_EQ(g_scheduler.IntervalMs(0), 1000);
+
+    // Small changes below the floor or the relative threshold are not a change
+    const Probe wobble = {lt::PROBE_OK, 61500};
+    for (uint32_t k = 0; k < 8; ++k) Step(wobble);
+    CHECK_EQ(g_scheduler.IntervalMs(0), 1000);
+    for (uint32_t k = 0; k < 2; ++k) Step(slower);
+    CHECK_EQ(g_scheduler.IntervalMs(0), 2000);
+
+    // Starting or stopping to answer bursts too
+    const Probe lost = {lt::PROBE_TIMEOUT, lt::kNoReply};
+    Step(lost);
+    CHECK_EQ(g_scheduler.IntervalMs(0), 250);
+    for (uint32_t k = 0; k < 8; ++k) Step(lost);
+    CHECK_EQ(g_scheduler.IntervalMs(0), 1000);
+    Step(slower);
+    CHECK_EQ(g_scheduler.IntervalMs(0), 250);
+
+    // The displayed target never backs off past the base interval
+    g_scheduler.SetFocus(0);
+    for (uint32_t k = 0; k < 60; ++k) Step(slower);
+    CHECK_EQ(g_scheduler.IntervalMs(0), 1000);
+    g_scheduler.SetFocus(-1);
+    for (uint32_t k = 0; k < 10; ++k) Step(slower);
+    CHECK_EQ(g_scheduler.IntervalMs(0), 2000);
+}
+
+// Fire every slot on its deadline until endMs; returns the probes that went out
+uint64_t RunSlots(uint32_t count, uint64_t endMs) {
+    uint64_t fired = 0;
+    for (;;) {
+        uint32_t next = 0;
+        for (uint32_t i = 1; i < count; ++i) {
+            if (g_scheduler.DueMs(i) < g_scheduler.DueMs(next)) next = i;
+        }
+        uint64_t now = g_scheduler.DueMs(next);
+        if (now >= endMs) return fired;
+        if (g_scheduler.Fire(next, now)) ++fired;
+    }
+}
+
+void TestTokenBucket() {
+    // Four targets at 1 s want 240 probes a minute; the budget allows 60, with up to ten
+    // seconds' worth (10 probes) saved up
+    lt::CadenceConfig config = lt::FixedCadence(1000);
+    config.budgetPerMinute = 60;
+    g_scheduler.Configure(config, 4);
+    for (uint32_t i = 0; i < 4; ++i) g_scheduler.Start(i, i * 250);
+    uint64_t fired = RunSlots(4, 10 * 60000);
+    CHECK(fired >= 600 && fired <= 610);
+    CHECK(g_scheduler.Stats().deferred > 0);
+
+    // Deferred probes wait for their token: in any minute no more than the budget plus the
+    // bucket go out
+    g_scheduler.ResetStats();
+    fired = RunSlots(4, 11 * 60000);
+    CHECK(fired <= 60 + 10);
+    CHECK_EQ(g_scheduler.Stats().ticks, fired);
+
+    // Unlimited: every deadline fires
+    g_scheduler.Configure(lt::FixedCadence(1000), 4);
+    g_scheduler.ResetStats();
+    for (uint32_t i = 0; i < 4; ++i) g_scheduler.Start(i, i * 250);
+    CHECK_EQ(RunSlots(4, 60000), 240);
+    CHECK_EQ(g_scheduler.Stats().deferred, 0);
+
+    // A budget lowered while running takes effect at once
+    config.budgetPerMinute = 6;
+    g_scheduler.Retime(config);
+    CHECK(RunSlots(4, 120000) <= 6 + 1);
+}
+
+// The engine on virtual time: replies take 100..500 ms, longer than the ticks are late, yet
+// every echo leaves on the slot's 1 s grid
+void TestEngineOnVirtualTime() {
+    const lt::SimProfile slow = {300, 200, 0, 0, 0, 0, 0, lt::SIM_UNIFORM};
+    g_sim.SetProfile(0, slow);
+    g_sim.SetProfile(1, slow);
+    g_engine.Init(&g_sim, 2, 1000, 2000);
+    CHECK(g_engine.SetTarget(0, "192.0.2.1", false));
+    CHECK(g_engine.SetTarget(1, "192.0.2.2", false));
+    uint64_t start = g_sim.NowMs();
+    uint64_t firstSend[2] = {0, 0};
+    uint32_t sent[2] = {0, 0};
+    uint32_t offGrid = 0;
+    lt::ProbeResult out[4];
+    while (g_sim.NowMs() < start + 100000) {
+        g_engine.Run(1000, out, 4);
+        for (uint32_t i = 0; i < 2; ++i) {
+            const lt::ProbeEngine<2>::SlotState& t = g_engine.State(i);
+            if (t.sent == sent[i]) continue;
+            sent[i] = t.sent;
+            if (sent[i] == 1) firstSend[i] = t.sentAtMs;
+            if ((t.sentAtMs - firstSend[i]) % 1000 != 0) ++offGrid;
+        }
+    }
+    CHECK_EQ(offGrid, 0);
+    CHECK(sent[0] >= 99 && sent[0] <= 100);
+    CHECK(sent[1] >= 99 && sent[1] <= 100);
+    CHECK_EQ(firstSend[1] - firstSend[0], 500);   // staggered across the interval
+    CHECK_EQ(g_engine.Scheduler().Stats().skippedTicks, 0);
+    CHECK_EQ(g_engine.Scheduler().Stats().maxLateMs, 0);
+}
+
+} // namespace
+
+int main() {
+    TestAbsoluteDeadlines();
+    TestAdaptiveCadence();
+    TestTokenBucket();
+    TestEngineOnVirtualTime();
+    return lt_test::TestResult("probe_scheduler_test");
+}
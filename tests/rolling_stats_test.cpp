@@ -0,0 +1,178 @@
+// tests/rolling_stats_test.cpp
+// RollingStats: window eviction and the running sums, min/max from the monotonic deques
+// against a brute-force scan of the window, RFC 3550 jitter against a sequence worked by
+// hand, and percentiles from a LatencyHistogram kept in step with the window's evictions
+// the way ProbeEngine keeps it.
+
+#include "core/latency_histogram.h"
+#include "core/rolling_stats.h"
+#include "check.h"
+
+namespace {
+
+lt::RollingStats<4> g_small;
+lt::RollingStats<64> g_stats;
+lt::LatencyHistogram g_window;
+
+void TestEviction() {
+    g_small.Reset();
+    uint32_t evicted = 99;
+    const uint32_t first[4] = {5, 1, 4, 2};
+    for (uint32_t v : first) CHECK(!g_small.Add(v, &evicted));
+    CHECK_EQ(evicted, 99);
+    CHECK_EQ(g_small.Count(), 4);
+    CHECK_EQ(g_small.Min(), 1);
+    CHECK_EQ(g_small.Max(), 5);
+    CHECK_EQ(g_small.Mean(), 3);
+
+    // 1 4 2 3: the maximum leaves, the mean 2.5 rounds up
+    CHECK(g_small.Add(3, &evicted));
+    CHECK_EQ(evicted, 5);
+    CHECK_EQ(g_small.Count(), 4);
+    CHECK_EQ(g_small.Max(), 4);
+    CHECK_EQ(g_small.Min(), 1);
+    CHECK_EQ(g_small.Mean(), 3);
+
+    // 4 2 3 6: the minimum leaves
+    CHECK(g_small.Add(6, &evicted));
+    CHECK_EQ(evicted, 1);
+    CHECK_EQ(g_small.Min(), 2);
+    CHECK_EQ(g_small.Max(), 6);
+    CHECK_EQ(g_small.Mean(), 4);
+
+    // 3 6 7 8: population variance 14 / 4
+    CHECK(g_small.Add(7, &evicted));
+    CHECK(g_small.Add(8, &evicted));
+    CHECK_EQ(evicted, 2);
+    CHECK_EQ(g_small.Min(), 3);
+    CHECK_EQ(g_small.Mean(), 6);
+    CHECK_EQ((long long)(g_small.Variance() * 1000 + 0.5), 3500);
+    CHECK_EQ(g_small.StdDev(), 2);
+    CHECK_EQ(g_small.Last(), 8);
+
+    // Values past kMaxTrackedValue are saturated, so the sums cannot overflow
+    CHECK(g_small.Add(0xFFFFFFFFu, &evicted));
+    CHECK_EQ(g_small.Max(), lt::kMaxTrackedValue);
+    CHECK_EQ(g_small.Last(), lt::kMaxTrackedValue);
+
+    // A shorter window starts empty
+    g_small.SetWindow(2);
+    CHECK_EQ(g_small.Count(), 0);
+    CHECK_EQ(g_small.Min(), 0);
+    CHECK_EQ(g_small.Max(), 0);
+    CHECK_EQ(g_small.Mean(), 0);
+    CHECK(!g_small.Add(10));
+    CHECK(!g_small.Add(20));
+    CHECK(g_small.Add(30, &evicted));
+    CHECK_EQ(evicted, 10);
+    g_small.SetWindow(0);   // clamped to 1
+    CHECK_EQ(g_small.Window(), 1);
+    g_small.SetWindow(100);   // clamped to Capacity
+    CHECK_EQ(g_small.Window(), 4);
+}
+
+// The deques against a scan of the last `window` values, over runs that rise, fall, repeat
+// values and turn around, for several window lengths up to the capacity
+void TestMinMaxAgainstScan() {
+    static uint32_t values[1000];
+    uint32_t x = 1;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        x = x * 1103515245u + 12345u;
+        uint32_t phase = i / 50 % 4;
+        values[i] = phase == 0 ? i : phase == 1 ? 5000 - i : phase == 2 ? 700 : (x >> 16) % 300;
+    }
+    const uint32_t windows[] = {1, 2, 3, 17, 63, 64};
+    for (uint32_t window : windows) {
+        g_stats.SetWindow(window);
+        uint32_t failures = 0;
+        for (uint32_t i = 0; i < 1000; ++i) {
+            g_stats.Add(values[i]);
+            uint32_t lo = 0xFFFFFFFFu, hi = 0;
+            uint64_t sum = 0;
+            uint32_t first = i + 1 >= window ? i + 1 - window : 0;
+            for (uint32_t j = first; j <= i; ++j) {
+                if (values[j] < lo) lo = values[j];
+                if (values[j] > hi) hi = values[j];
+                sum += values[j];
+            }
+            uint32_t n = i - first + 1;
+            if (g_stats.Min() != lo || g_stats.Max() != hi || g_stats.Count() != n ||
+                g_stats.Mean() != (uint32_t)((sum + n / 2) / n)) {
+                ++failures;
+            }
+        }
+        CHECK_EQ(failures, 0);
+    }
+}
+
+// RFC 3550 A.8 with J kept times 16: J16 += |D| - (J16 + 8) / 16, reported as J16 / 16
+void TestJitter() {
+    g_stats.SetWindow(64);
+    struct Step {
+        uint32_t value;
+        uint32_t jitter;   // J16 / 16 after the sample
+    };
+    // J16: 0, 10, 10 + 10 - 1 = 19, 19 + 30 - 1 = 48, 48 + 0 - 3 = 45, 45 + 40 - 3 = 82,
+    // 82 + 40 - 5 = 117, 117 + 0 - 7 = 110
+    const Step steps[] = {{100, 0}, {110, 0}, {100, 1}, {130, 3}, {130, 2}, {90, 5}, {130, 7}, {130, 6}};
+    for (const Step& s : steps) {
+        g_stats.Add(s.value);
+        CHECK_EQ(g_stats.Jitter(), s.jitter);
+    }
+    // Steady samples decay it towards zero; eviction does not touch it
+    for (int i = 0; i < 200; ++i) g_stats.Add(130);
+    CHECK_EQ(g_stats.Jitter(), 0);
+    // A steady alternation converges on the step size
+    for (int i = 0; i < 400; ++i) g_stats.Add(i % 2 ? 1000 : 1200);
+    CHECK(g_stats.Jitter() >= 192 && g_stats.Jitter() <= 200);
+    g_stats.Reset();
+    CHECK_EQ(g_stats.Jitter(), 0);
+}
+
+// Add to the window histogram, remove what the rolling window evicts
+void AddSample(uint32_t value) {
+    uint32_t evicted;
+    if (g_stats.Add(value, &evicted)) g_window.Remove(evicted);
+    g_window.Add(value);
+}
+
+void TestPercentiles() {
+    g_stats.SetWindow(10);
+    g_window.Reset();
+    for (uint32_t v = 1; v <= 20; ++v) AddSample(v);
+    // The window holds 11..20; below 64 every bucket is exact, so nearest rank is exact
+    CHECK_EQ(g_window.Count(), 10);
+    const double qs[4] = {0.0, 0.5, 0.9, 0.99};
+    uint32_t p[4];
+    g_window.Quantiles(qs, p, 4);
+    CHECK_EQ(p[0], 11);
+    CHECK_EQ(p[1], 15);
+    CHECK_EQ(p[2], 19);
+    CHECK_EQ(p[3], 20);
+    CHECK_EQ(g_window.Quantile(1.0), g_stats.Max());
+
+    // Larger values land in log-linear buckets: the reported value is inside the true
+    // sample's bucket, within ~3% of it
+    g_stats.SetWindow(64);
+    g_window.Reset();
+    for (uint32_t i = 0; i < 1000; ++i) AddSample(10000 + 37 * (i % 100));
+    CHECK_EQ(g_window.Count(), 64);
+    // The last 64 values are i = 936..999, i % 100 = 36..99: the median is rank 32, i % 100 = 67
+    uint32_t median = g_window.Quantile(0.5);
+    uint32_t index = lt::LatencyHistogram::IndexOf(10000 + 37 * 67);
+    CHECK(median >= lt::LatencyHistogram::LowerBound(index));
+    CHECK(median <= lt::LatencyHistogram::UpperBound(index));
+    CHECK(g_window.Quantile(0.0) <= g_stats.Min() + g_stats.Min() / 32);
+    CHECK(g_window.Quantile(1.0) <= g_stats.Max());
+    CHECK(g_window.Quantile(1.0) + g_stats.Max() / 32 >= g_stats.Max());
+}
+
+} // namespace
+
+int main() {
+    TestEviction();
+    TestMinMaxAgainstScan();
+    TestJitter();
+    TestPercentiles();
+    return lt_test::TestResult("rolling_stats_test");
+}
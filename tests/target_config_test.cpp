@@ -0,0 +1,214 @@
+// tests/target_config_test.cpp
+// ParseTargetConfig's errors (line and message for each kind of bad input), and reloads through
+// TargetSlots and ApplyReload into a ProbeEngine on the simulated backend: kept, renamed, removed
+// and added targets, a shrinking slot count, refused binds, and a slot re-bound with an echo out.
+
+#include <string.h>
+#include "core/probe_engine.h"
+#include "core/sim_backend.h"
+#include "core/target_config.h"
+#include "check.h"
+
+namespace {
+
+const uint32_t kSlots = 4;
+typedef lt::TargetConfig<kSlots> Config;
+
+Config g_config;
+lt::TargetSlots<kSlots> g_slots;
+lt::ReloadPlan<kSlots> g_plan;
+lt::SimulatedBackend<kSlots> g_sim(5);
+lt::ProbeEngine<kSlots> g_engine;
+
+struct ParseCase {
+    const char* text;
+    uint32_t line;
+    const char* message;   // nullptr: parses
+};
+
+const ParseCase kParseCases[] = {
+    {"target icmp 10.0.0.1\n", 0, nullptr},
+    {"target icmp 10.0.0.256\n", 1, "bad address"},
+    {"target icmp 10.0.0.1\ntarget icmp 10.0.0\n", 2, "bad address"},
+    {"target tcp 2001:db8::g port=443\n", 1, "bad address"},
+    {"target icmp 2001:db8:0:0:0:0:0:0:1\n", 1, "bad address"},
+    {"target tcp gateway port=443\n", 1, "the gateway is probed with icmp only"},
+    {"interval 5ms\ntarget icmp 10.0.0.1\n", 1, "expected interval <10ms..60m>"},
+    {"interval 61m\ntarget icmp 10.0.0.1\n", 1, "expected interval <10ms..60m>"},
+    {"interval 10\ntarget icmp 10.0.0.1\n", 1, "expected interval <10ms..60m>"},
+    {"interval 1h\ntarget icmp 10.0.0.1\n", 1, "expected interval <10ms..60m>"},
+    {"interval 1s 2s\ntarget icmp 10.0.0.1\n", 1, "expected interval <10ms..60m>"},
+    {"interval 1s\ninterval 2s\n", 2, "set twice"},
+    {"timeout 0ms\ntarget icmp 10.0.0.1\n", 1, "expected timeout <1ms..1m>"},
+    {"thresholds 150 50\ntarget icmp 10.0.0.1\n", 1, "expected thresholds <fair ms> <poor ms>, fair below poor"},
+    {"target icmp 10.0.0.1\ntarget icmp 10.0.0.2\ntarget icmp 10.0.0.3\ntarget icmp 10.0.0.4\n", 0, nullptr},
+    {"target icmp 10.0.0.1\ntarget icmp 10.0.0.2\ntarget icmp 10.0.0.3\ntarget icmp 10.0.0.4\ntarget icmp 10.0.0.5\n", 5,
+     "too many targets"},
+    // 47 characters fit kMaxTargetNameSize with the NUL, 48 do not
+    {"target icmp 10.0.0.1 name=abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstu\n", 0, nullptr},
+    {"target icmp 10.0.0.1 name=abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuv\n", 1, "bad name"},
+    {"target icmp 10.0.0.1 name=\"abcdefghijklmnopqrstuvwxyz abcdefghijklmnopqrstuv\"\n", 1, "bad name"},
+    {"target icmp 10.0.0.1 name=\"\"\n", 1, "bad name"},
+    {"target icmp 10.0.0.1 name=\"unterminated\n", 1, "unterminated quote"},
+    {"target tcp 10.0.0.1\n", 1, "tcp targets need a port"},
+    {"target icmp 10.0.0.1 port=7\n", 1, "icmp targets take no port"},
+    {"target tcp 10.0.0.1 port=65536\n", 1, "bad port"},
+    {"target udp 10.0.0.1\n", 1, "unknown probe method"},
+    {"target icmp 10.0.0.1\n# the same again\ntarget icmp 10.0.0.1 name=other\n", 3, "same target as an earlier line"},
+    {"target dns 10.0.0.1\ntarget dns 10.0.0.1 port=53\n", 2, "same target as an earlier line"},
+    {"probe icmp 10.0.0.1\n", 1, "unknown directive"},
+    {"# nothing\n\n", 2, "no targets"},
+};
+
+void TestParseErrors() {
+    for (const ParseCase& c : kParseCases) {
+        lt::TargetConfigError error = {99, "unset"};
+        bool ok = lt::ParseTargetConfig(c.text, strlen(c.text), &g_config, &error);
+        CHECK_EQ(ok, c.message == nullptr);
+        CHECK_EQ(error.line, c.line);
+        CHECK_STR(error.message ? error.message : "(none)", c.message ? c.message : "(none)");
+    }
+}
+
+void TestParseValues() {
+    const char text[] =
+        "interval 250ms   # fast\n"
+        "timeout 2s\n"
+        "thresholds 40 120\n"
+        "target icmp gateway name=\"Default Gateway\"\n"
+        "target tcp 203.0.113.7 port=443 name=\"Edge # LB\"\n"
+        "target dns 2001:db8::53\n";
+    lt::TargetConfigError error;
+    CHECK(lt::ParseTargetConfig(text, sizeof(text) - 1, &g_config, &error));
+    CHECK_EQ(g_config.probeIntervalMs, 250);
+    CHECK_EQ(g_config.timeoutMs, 2000);
+    CHECK_EQ(g_config.fairMs, 40);
+    CHECK_EQ(g_config.poorMs, 120);
+    CHECK_EQ(g_config.count, 3);
+    CHECK(g_config.targets[0].IsGateway());
+    CHECK_STR(g_config.targets[0].name, "Default Gateway");
+    CHECK_EQ(g_config.targets[1].method, lt::METHOD_TCP);
+    CHECK_EQ(g_config.targets[1].port, 443);
+    CHECK_STR(g_config.targets[1].name, "Edge # LB");
+    CHECK_EQ(g_config.targets[2].method, lt::METHOD_DNS);
+    CHECK_EQ(g_config.targets[2].port, lt::kConfigDnsPort);
+    CHECK_STR(g_config.targets[2].name, "2001:db8::53");   // the address when unnamed
+    CHECK_EQ(g_config.targets[2].line, 6);
+}
+
+// Slot -> config target and change, as planned
+void CheckSlot(uint32_t slot, uint32_t target, lt::SlotChange change) {
+    CHECK_EQ(g_plan.target[slot], target);
+    CHECK_EQ(g_plan.change[slot], change);
+}
+
+uint32_t g_bindRefused = 0;   // bind fails for this address's last byte (0: never)
+
+uint32_t Reload(const char* text) {
+    lt::TargetConfigError error;
+    CHECK(lt::ParseTargetConfig(text, strlen(text), &g_config, &error));
+    g_slots.Plan(g_config, &g_plan);
+    uint32_t refused = lt::ApplyReload(g_engine, g_config, g_plan, [](uint32_t slot, const lt::ConfigTarget& t) {
+        if (g_bindRefused && t.address.bytes[3] == g_bindRefused) return false;
+        return g_engine.SetTarget(slot, t.address);
+    });
+    g_slots.Commit(g_config, g_plan);
+    return refused;
+}
+
+// Run the engine for a while; every result must be a reply
+void RunFor(uint64_t ms) {
+    lt::ProbeResult out[kSlots];
+    uint64_t until = g_sim.NowMs() + ms;
+    while (g_sim.NowMs() < until) {
+        int n = g_engine.Run(10, out, kSlots);
+        for (int k = 0; k < n; ++k) CHECK_EQ(out[k].status, lt::PROBE_OK);
+    }
+}
+
+void TestReloads() {
+    const lt::SimProfile steady = {60, 0, 0, 0, 0, 0, 0, lt::SIM_UNIFORM};
+    for (uint32_t i = 0; i < kSlots; ++i) g_sim.SetProfile(i, steady);
+    g_engine.Init(&g_sim, 0, 1000, 500);
+
+    // Start: every target added, in file order
+    CHECK_EQ(Reload("target icmp 10.0.0.1\n"
+                    "target tcp 10.0.0.2 port=443\n"
+                    "target dns 10.0.0.3 name=x\n"), 0);
+    CHECK_EQ(g_plan.added, 3);
+    CHECK_EQ(g_plan.slotCount, 3);
+    CheckSlot(0, 0, lt::SLOT_ADDED);
+    CheckSlot(2, 2, lt::SLOT_ADDED);
+    CHECK_EQ(g_engine.Count(), 3);
+    RunFor(5000);
+    CHECK(g_engine.State(0).completed >= 4);
+
+    // Slot 1's target goes while its echo is out; the new target takes its slot. The others
+    // stay where they are although the file lists them in another order, one under a new name.
+    while (!g_engine.State(1).inFlight) RunFor(10);
+    uint32_t keptCompleted = g_engine.State(0).completed;
+    CHECK_EQ(Reload("target dns 10.0.0.3 name=y\n"
+                    "target icmp 10.0.0.4\n"
+                    "target icmp 10.0.0.1\n"), 0);
+    CHECK_EQ(g_plan.kept, 2);
+    CHECK_EQ(g_plan.added, 1);
+    CHECK_EQ(g_plan.removed, 1);
+    CheckSlot(0, 2, lt::SLOT_KEPT);
+    CheckSlot(1, 1, lt::SLOT_ADDED);
+    CheckSlot(2, 0, lt::SLOT_RENAMED);
+    CHECK_STR(g_slots.Target(2).name, "y");
+    CHECK_EQ(g_engine.State(0).completed, keptCompleted);   // statistics kept
+    CHECK_EQ(g_engine.State(1).sent, 0);                    // a new target
+    RunFor(5000);
+    CHECK(g_engine.State(1).completed >= 4);
+    CHECK_EQ(g_engine.State(1).loss.Lost(), 0);
+    CHECK_EQ(g_engine.State(1).received, g_engine.State(1).completed);
+
+    // Removing the last targets shrinks the slot count; a freed slot before a kept one stays free
+    CHECK_EQ(Reload("target dns 10.0.0.3 name=y\n"), 0);
+    CHECK_EQ(g_plan.removed, 2);
+    CHECK_EQ(g_plan.slotCount, 3);
+    CheckSlot(0, lt::kNoConfigTarget, lt::SLOT_REMOVED);
+    CheckSlot(2, 0, lt::SLOT_KEPT);
+    CHECK_EQ(Reload("target icmp 10.0.0.5\n"), 0);
+    CHECK_EQ(g_plan.slotCount, 1);
+    CheckSlot(0, 0, lt::SLOT_ADDED);
+    CheckSlot(2, lt::kNoConfigTarget, lt::SLOT_REMOVED);
+    CHECK_EQ(g_engine.Count(), 1);
+    CHECK_EQ(g_slots.Count(), 1);
+    CHECK(!g_slots.Used(2));
+    CHECK(!g_engine.State(2).bound);
+
+    // A target the program cannot bind is counted and left unbound; the rest go ahead
+    g_bindRefused = 7;
+    CHECK_EQ(Reload("target icmp 10.0.0.5\n"
+                    "target icmp 10.0.0.7\n"
+                    "target icmp 10.0.0.8\n"), 1);
+    g_bindRefused = 0;
+    CHECK(g_engine.State(0).bound);
+    CHECK(!g_engine.State(1).bound);
+    CHECK(g_engine.State(2).bound);
+    RunFor(3000);
+    CHECK_EQ(g_engine.State(1).sent, 0);
+    CHECK(g_engine.State(2).completed >= 2);
+
+    // A file that does not parse leaves the slots as they were; the next good one plans
+    // against them
+    const char bad[] = "target icmp 10.0.0.5\ntarget icmp 10.0.0.300\n";
+    lt::TargetConfigError error;
+    CHECK(!lt::ParseTargetConfig(bad, sizeof(bad) - 1, &g_config, &error));
+    CHECK_EQ(g_slots.Count(), 3);
+    CHECK(lt::ParseTargetConfig("target icmp 10.0.0.8\n", 21, &g_config, &error));
+    g_slots.Plan(g_config, &g_plan);
+    CheckSlot(2, 0, lt::SLOT_KEPT);
+    CHECK_EQ(g_plan.removed, 2);
+}
+
+} // namespace
+
+int main() {
+    TestParseErrors();
+    TestParseValues();
+    TestReloads();
+    return lt_test::TestResult("target_config_test");
+}
@@ -0,0 +1,153 @@
+// tests/tooltip_format_test.cpp
+// FormatTooltip within the tray's szTip (127 UTF-16 units and the terminator): every preset and
+// a longest config name (47 bytes) with the widest values each field can show, including a
+// longest link-local gateway address, must fit once widened; a typical IPv6 preset keeps its API
+// line by giving up the address, and a short one keeps everything.
+
+#include <stdio.h>
+#include <string.h>
+#include "core/presets.h"
+#include "core/target_config.h"
+#include "core/tooltip_format.h"
+#include "check.h"
+
+namespace {
+
+// UTF-16 units after MultiByteToWideChar, decoded independently of tooltip_format.h
+uint32_t WideLength(const char* s) {
+    uint32_t n = 0;
+    for (const unsigned char* p = (const unsigned char*)s; *p; ++n) {
+        uint32_t length = *p < 0x80 ? 1 : *p < 0xE0 ? 2 : *p < 0xF0 ? 3 : 4;
+        if (length == 4) ++n;   // surrogate pair
+        for (uint32_t k = 0; k < length && *p; ++k) ++p;
+    }
+    return n;
+}
+
+// Every field at its widest: 4294967 ms, 100.0% loss, an API error of -2147483647 µs
+lt::LatencySnapshot WorstCase(const char* address, bool isIPv6) {
+    lt::LatencySnapshot snap;
+    memset(&snap, 0, sizeof(snap));
+    snap.completed = UINT32_MAX;
+    snap.samples = UINT32_MAX;
+    snap.rttUs = lt::kNoReply - 1;
+    snap.p50Us = snap.p95Us = snap.p99Us = snap.avgUs = snap.jitterUs = snap.maxUs = lt::kNoReply - 1;
+    snap.apiRttMs = lt::kNoReply - 1;
+    snap.apiErrorUs = -INT32_MAX;
+    snap.lossBp = 10000;
+    snap.lostInRow = UINT32_MAX;
+    snap.isIPv6 = isIPv6 ? 1 : 0;
+    strncpy(snap.address, address, sizeof(snap.address) - 1);
+    return snap;
+}
+
+lt::LatencySnapshot Typical(const char* address, bool isIPv6) {
+    lt::LatencySnapshot snap = WorstCase(address, isIPv6);
+    snap.rttUs = 24000;
+    snap.p50Us = 25000;
+    snap.p95Us = 31000;
+    snap.p99Us = 40000;
+    snap.avgUs = 26000;
+    snap.jitterUs = 850;
+    snap.maxUs = 52000;
+    snap.apiRttMs = 24;
+    snap.apiErrorUs = 310;
+    snap.lossBp = 170;
+    snap.lostInRow = 0;
+    return snap;
+}
+
+char g_tip[256];
+
+const char* Format(const lt::LatencySnapshot& snap, const char* name, lt::ProbeMethod method, uint16_t port,
+                   uint32_t shownRttUs) {
+    lt::TextBuffer text(g_tip, sizeof(g_tip) - 1);
+    lt::FormatTooltip(text, snap, name, method, port, shownRttUs, lt::kTooltipMaxChars);
+    CHECK(!text.Truncated());
+    g_tip[text.Length()] = 0;
+    return g_tip;
+}
+
+// Measuring, no reply and a reply, for one name and endpoint
+void CheckFits(const char* name, lt::ProbeMethod method, uint16_t port, const char* address, bool isIPv6) {
+    lt::LatencySnapshot snap = WorstCase(address, isIPv6);
+    const uint32_t shown[2] = {lt::kNoReply, snap.rttUs};
+    for (uint32_t rttUs : shown) {
+        uint32_t chars = WideLength(Format(snap, name, method, port, rttUs));
+        if (chars > lt::kTooltipMaxChars) fprintf(stderr, "tooltip_format_test: %u chars: %s\n", chars, g_tip);
+        CHECK(chars <= lt::kTooltipMaxChars);
+        CHECK(strstr(g_tip, " " LT_TIP_DASH " ") != nullptr);   // the status is never cut
+    }
+    snap.completed = 0;
+    CHECK(WideLength(Format(snap, name, method, port, lt::kNoReply)) <= lt::kTooltipMaxChars);
+}
+
+// The longest address the gateway slot shows: all eight groups and a 32-bit zone (50 characters)
+const char kLongestGateway[] = "fe80:ffff:ffff:ffff:ffff:ffff:ffff:ffff%4294967295";
+
+void TestPresetsFit() {
+    for (uint32_t i = 0; i < lt::kPresetCount; ++i) {
+        const lt::PresetTarget& p = lt::kPresets[i];
+        CheckFits(p.name, p.method, p.port, p.ip ? p.ip : kLongestGateway, p.ip ? p.IsIPv6() : true);
+    }
+}
+
+void TestLongNamesFit() {
+    char name[lt::kMaxTargetNameSize];
+    memset(name, 'W', sizeof(name) - 1);
+    name[sizeof(name) - 1] = 0;
+    CheckFits(name, lt::METHOD_ICMP, 0, kLongestGateway, true);
+    CheckFits(name, lt::METHOD_TCP, 65535, "2001:db8:ffff:ffff:ffff:ffff:ffff:ffff", true);
+    CheckFits(name, lt::METHOD_DNS, 65535, "255.255.255.255", false);
+    // Multi-byte names count as the units they widen to: 14 three-byte characters and an emoji
+    // (a surrogate pair)
+    char wide[lt::kMaxTargetNameSize] = {};
+    for (int i = 0; i < 14; ++i) memcpy(wide + 3 * i, "\xE2\x82\xAC", 3);   // U+20AC euro sign
+    memcpy(wide + 42, "\xF0\x9F\x93\xB6", 4);                               // U+1F4F6 antenna bars
+    CheckFits(wide, lt::METHOD_ICMP, 0, kLongestGateway, true);
+
+    // 30 units: the 20-unit status and nine of the name's characters with an ellipsis
+    lt::LatencySnapshot snap = Typical("192.0.2.1", false);
+    lt::TextBuffer text(g_tip, sizeof(g_tip) - 1);
+    lt::FormatTooltip(text, snap, wide, lt::METHOD_ICMP, 0, snap.rttUs, 30);
+    g_tip[text.Length()] = 0;
+    CHECK_EQ(WideLength(g_tip), 30);
+    CHECK_STR(g_tip, "\xE2\x82\xAC\xE2\x82\xAC\xE2\x82\xAC\xE2\x82\xAC\xE2\x82\xAC\xE2\x82\xAC\xE2\x82\xAC"
+                     "\xE2\x82\xAC\xE2\x82\xAC\xE2\x80\xA6 " LT_TIP_DASH " 24 ms " LT_TIP_DOT " loss 1.7%");
+}
+
+// What gives way first: the API line, then the address, and the API line comes back when
+// leaving out the address made room for it
+void TestLinesGiveWay() {
+    lt::LatencySnapshot snap = Typical("1.1.1.1", false);
+    CHECK_STR(Format(snap, "Cloudflare DNS", lt::METHOD_ICMP, 0, snap.rttUs),
+              "Cloudflare DNS (1.1.1.1) " LT_TIP_DASH " 24 ms " LT_TIP_DOT " loss 1.7%\n"
+              "p50 25 " LT_TIP_DOT " p95 31 " LT_TIP_DOT " p99 40 ms\n"
+              "avg 26 " LT_TIP_DOT " jitter 0.85 " LT_TIP_DOT " max 52 ms\n"
+              "API 24 ms (+310 " LT_TIP_MICRO "s)");
+
+    // 149 characters in full
+    snap = Typical("2a00:86c0:2054:2054::167", true);
+    CHECK_STR(Format(snap, "Fast.com (Pittsburgh)", lt::METHOD_ICMP, 0, snap.rttUs),
+              "Fast.com (Pittsburgh) " LT_TIP_DASH " 24 ms " LT_TIP_DOT " loss 1.7%\n"
+              "p50 25 " LT_TIP_DOT " p95 31 " LT_TIP_DOT " p99 40 ms\n"
+              "avg 26 " LT_TIP_DOT " jitter 0.85 " LT_TIP_DOT " max 52 ms\n"
+              "API 24 ms (+310 " LT_TIP_MICRO "s)");
+
+    // Still too long without the address: the API line stays out
+    snap.apiErrorUs = -2147483647;
+    snap.apiRttMs = 4000000000u;
+    Format(snap, "Fast.com (Pittsburgh) with a much longer name", lt::METHOD_ICMP, 0, snap.rttUs);
+    CHECK(strstr(g_tip, "API") == nullptr);
+    CHECK(strstr(g_tip, "avg 26") != nullptr);
+    CHECK(WideLength(g_tip) <= lt::kTooltipMaxChars);
+}
+
+} // namespace
+
+int main() {
+    TestPresetsFit();
+    TestLongNamesFit();
+    TestLinesGiveWay();
+    return lt_test::TestResult("tooltip_format_test");
+}
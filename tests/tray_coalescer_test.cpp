@@ -0,0 +1,157 @@
+// tests/tray_coalescer_test.cpp
+// DisplayHysteresis and TrayCoalescer, table driven: the band each display step needs before
+// the shown number changes (ms, tenths, hundredths, across a step boundary), and a run of
+// submissions, flushes and pushes through the coalescer's change detection, its minimum time
+// between pushes, merging of changes made meanwhile, failed pushes and invalidation.
+
+#include <stdio.h>
+#include <wchar.h>
+#include "core/tray_coalescer.h"
+#include "check.h"
+
+namespace {
+
+const uint32_t kNone = lt::kNoReply;
+
+struct HysteresisCase {
+    uint32_t bandPermille;
+    int maxDecimals;
+    uint32_t count;
+    uint32_t inputUs[8];
+    uint32_t shownUs[8];
+    uint32_t held;   // readings that were kept from changing the text
+};
+
+const HysteresisCase kHysteresisCases[] = {
+    // 1 ms steps: 0.75 ms from the shown value switches (half a step plus the 25% band)
+    {250, 1, 8, {23400, 23600, 23740, 23750, 23300, 23249, kNone, 23600},
+                {23000, 23000, 23000, 24000, 24000, 23000, kNone, 24000}, 3},
+    // 0.1 ms steps below 10 ms
+    {250, 1, 5, {5000, 5060, 5074, 5075, 4980}, {5000, 5000, 5000, 5100, 5000}, 2},
+    // 0.01 ms steps below 1 ms when two decimals are shown; one decimal keeps 0.1 ms steps
+    {250, 2, 4, {850, 857, 858, 851}, {850, 850, 860, 850}, 1},
+    {250, 1, 4, {850, 900, 924, 925}, {900, 900, 900, 900}, 3},
+    // The step is the shown value's: from 9.9 ms the next reading is held 1 ms apart
+    {250, 1, 5, {9900, 10100, 9960, 10740, 10750}, {9900, 10000, 10000, 10000, 11000}, 2},
+    // No band: plain rounding to the nearest step
+    {0, 1, 4, {23400, 23500, 23499, 23501}, {23000, 24000, 23000, 24000}, 0},
+    // A wide band holds through a whole step of noise
+    {1000, 1, 5, {40000, 41400, 38600, 41500, 40600}, {40000, 40000, 40000, 42000, 42000}, 3},
+};
+
+void TestHysteresis() {
+    for (const HysteresisCase& c : kHysteresisCases) {
+        lt::DisplayHysteresis h(c.bandPermille, c.maxDecimals);
+        for (uint32_t i = 0; i < c.count; ++i) {
+            uint32_t shown = h.Filter(c.inputUs[i]);
+            CHECK_EQ(shown, c.shownUs[i]);
+            CHECK_EQ(h.Shown(), shown);
+        }
+        CHECK_EQ(h.Held(), c.held);
+        h.Reset();
+        CHECK_EQ(h.Shown(), kNone);
+    }
+}
+
+enum TrayOp { SUBMIT, FLUSH, PUSHED, PUSH_FAILED, INVALIDATE };
+
+struct TrayStep {
+    TrayOp op;
+    uint64_t ms;
+    const char* text;
+    uint32_t tint;
+    const char* tip;
+    uint32_t fields;   // SUBMIT, FLUSH: expected fields to push; PUSHED, PUSH_FAILED: fields pushed
+};
+
+const uint32_t kBoth = lt::TRAY_ICON | lt::TRAY_TIP;
+const uint32_t kGreen = 0xFF2E7D32u, kAmber = 0xFFF9A825u;
+
+// At most one push per 250 ms
+const TrayStep kTraySteps[] = {
+    {SUBMIT, 0, "23", kGreen, "a 23ms", kBoth},      // nothing pushed yet: everything goes
+    {PUSHED, 0, nullptr, 0, nullptr, kBoth},
+    {SUBMIT, 100, "23", kGreen, "a 23ms", 0},        // unchanged
+    {SUBMIT, 100, "23", kGreen, "a 23.4ms", 0},      // tip changed, within 250 ms of the push
+    {SUBMIT, 200, "24", kGreen, "a 24ms", 0},        // merged into the staged change
+    {FLUSH, 249, nullptr, 0, nullptr, 0},
+    {FLUSH, 250, nullptr, 0, nullptr, kBoth},
+    {PUSHED, 250, nullptr, 0, nullptr, kBoth},
+    {FLUSH, 400, nullptr, 0, nullptr, 0},            // nothing staged
+    {SUBMIT, 600, "24", kAmber, "a 24ms", lt::TRAY_ICON},   // only the tint changed
+    {PUSH_FAILED, 600, nullptr, 0, nullptr, lt::TRAY_ICON},
+    {FLUSH, 700, nullptr, 0, nullptr, 0},            // a failed push also waits its turn
+    {FLUSH, 850, nullptr, 0, nullptr, lt::TRAY_ICON},
+    {PUSHED, 850, nullptr, 0, nullptr, lt::TRAY_ICON},
+    {SUBMIT, 900, "25", kAmber, "a 25ms", 0},
+    {SUBMIT, 950, "24", kAmber, "a 24ms", 0},        // back to what is shown: the change is dropped
+    {FLUSH, 5000, nullptr, 0, nullptr, 0},
+    // Tips compare within the tooltip's capacity (15 characters and the terminator)
+    {SUBMIT, 5000, "24", kAmber, "a 24ms", 0},
+    {SUBMIT, 5000, "24", kAmber, "0123456789abcdeX", lt::TRAY_TIP},
+    {PUSHED, 5000, nullptr, 0, nullptr, lt::TRAY_TIP},
+    {SUBMIT, 6000, "24", kAmber, "0123456789abcdeY", 0},
+    // Explorer restarted: the icon was re-added, so everything goes out again at once
+    {INVALIDATE, 7000, nullptr, 0, nullptr, 0},
+    {SUBMIT, 7000, "24", kAmber, "0123456789abcde", kBoth},
+    {PUSHED, 7000, nullptr, 0, nullptr, kBoth},
+};
+
+lt::TrayCoalescer<char, 16> g_tray;
+
+void TestCoalescer() {
+    g_tray.Configure(250);
+    uint32_t step = 0;
+    for (const TrayStep& s : kTraySteps) {
+        ++step;
+        uint32_t fields = 0;
+        switch (s.op) {
+        case SUBMIT:
+            fields = g_tray.Submit(s.text, s.tint, s.tip, s.ms);
+            break;
+        case FLUSH:
+            fields = g_tray.Flush(s.ms);
+            break;
+        case PUSHED:
+        case PUSH_FAILED:
+            g_tray.Commit(s.fields, s.op == PUSHED, s.ms);
+            fields = s.fields;
+            break;
+        case INVALIDATE:
+            g_tray.Invalidate();
+            break;
+        }
+        if (fields != s.fields) fprintf(stderr, "tray_coalescer_test: step %u\n", step);
+        CHECK_EQ(fields, s.fields);
+    }
+    CHECK_STR(g_tray.IconText(), "24");
+    CHECK_STR(g_tray.Tip(), "0123456789abcde");
+    CHECK_EQ(g_tray.NextDueMs(), UINT64_MAX);
+    const lt::TrayCoalescerStats& stats = g_tray.Stats();
+    CHECK_EQ(stats.submitted, 11);
+    CHECK_EQ(stats.pushes, 5);
+    CHECK_EQ(stats.iconPushes, 4);
+    CHECK_EQ(stats.tipPushes, 4);
+    CHECK_EQ(stats.unchanged, 4);
+    CHECK_EQ(stats.coalesced, 1);
+    CHECK_EQ(stats.failures, 1);
+}
+
+// The Unicode tray's tooltip type, with no rate limit
+void TestWideTip() {
+    lt::TrayCoalescer<wchar_t, 8> tray;
+    CHECK_EQ(tray.Submit("5", 0, L"tip", 0), kBoth);
+    tray.Commit(kBoth, true, 0);
+    CHECK_EQ(tray.Submit("5", 0, L"tip", 1), 0);
+    CHECK_EQ(tray.Submit("5", 0, L"tips", 1), lt::TRAY_TIP);
+    CHECK(wcscmp(tray.Tip(), L"tips") == 0);
+}
+
+} // namespace
+
+int main() {
+    TestHysteresis();
+    TestCoalescer();
+    TestWideTip();
+    return lt_test::TestResult("tray_coalescer_test");
+}